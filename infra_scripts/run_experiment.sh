@@ -36,7 +36,7 @@ M2_EXPERIMENT_DIR="${EXPERIMENT_DATA_DIR}/milestone2/batch_size_${PARAM_VAL}"
 M3_EXPERIMENT_DIR="${EXPERIMENT_DATA_DIR}/milestone3"
 
 START_TEST=
-MAX_TEST=65
+MAX_TEST=70
 TEST_IDS=$(seq -w 1 ${MAX_TEST})
 
 if [ "$UPTOMILE" -eq "1" ] ;
@@ -62,7 +62,7 @@ then
     MAX_TEST=59
 elif [ "$UPTOMILE" -eq "5" ] ;
 then
-    MAX_TEST=65
+    MAX_TEST=70
 fi
 
 function killserver () {
@@ -46,7 +46,7 @@ INPUT_DIR="${M1_EXPERIMENT_DIR}"
 OUTPUT_DIR="${M1_EXPERIMENT_DIR}"
 fi
 
-MAX_TEST=65
+MAX_TEST=70
 TEST_IDS=`seq -w 1 ${MAX_TEST}`
 
 if [ "$UPTOMILE" -eq "1" ] ;
@@ -63,7 +63,7 @@ then
     MAX_TEST=59
 elif [ "$UPTOMILE" -eq "5" ] ;
 then
-    MAX_TEST=65
+    MAX_TEST=70
 fi
 
 function killserver () {
@@ -88,7 +88,7 @@ do
             # start the server before the first case we test.
             ./server > last_server.out &
             FIRST_SERVER_START=1
-        elif [ $RUN_M1_EXPERIMENT -eq 1 ] || [ ${TEST_ID} -eq 2 ] || [ ${TEST_ID} -eq 5 ] || [ ${TEST_ID} -eq 11 ] || [ ${TEST_ID} -eq 21 ] || [ ${TEST_ID} -eq 22 ] || [ ${TEST_ID} -eq 31 ] || [ ${TEST_ID} -eq 46 ] || [ ${TEST_ID} -eq 62 ]
+        elif [ $RUN_M1_EXPERIMENT -eq 1 ] || [ ${TEST_ID} -eq 2 ] || [ ${TEST_ID} -eq 5 ] || [ ${TEST_ID} -eq 11 ] || [ ${TEST_ID} -eq 21 ] || [ ${TEST_ID} -eq 22 ] || [ ${TEST_ID} -eq 31 ] || [ ${TEST_ID} -eq 46 ] || [ ${TEST_ID} -eq 62 ] || [ ${TEST_ID} -eq 66 ] || [ ${TEST_ID} -eq 68 ] || [ ${TEST_ID} -eq 69 ]
         then
             # We restart the server after test 1,4,10,20,21,30,33 (before 2,3,11,12,19,20,31,33), as expected.
             # Also, restart when running M1 Experiment so that all first select queries are run on fresh server.
@@ -300,6 +300,141 @@ def createTest65(dataTable):
     data_gen_utils.closeFileHandles(output_file, exp_output_file)
 
 
+def createTest66(dataSize):
+    # a table of its own: test 65 changes tbl5 without tracking it in dataTable
+    outputFile = TEST_BASE_DIR + '/data66.csv'
+    header_line = data_gen_utils.generateHeaderLine('db1', 'tbl66', 2)
+    dataTable = pd.DataFrame(np.random.randint(0, 10000, size=(dataSize, 2)), columns=['col1', 'col2'])
+    dataTable.to_csv(outputFile, sep=',', index=False, header=header_line, lineterminator='\n')
+
+    output_file, exp_output_file = data_gen_utils.openFileHandles(66, TEST_DIR=TEST_BASE_DIR)
+    output_file.write('-- Correctness test: a deferred fetch outlives a resize of the handle table\n')
+    output_file.write('--\n')
+    output_file.write('create(tbl,"tbl66",db1,2)\n')
+    output_file.write('create(col,"col1",db1.tbl66)\n')
+    output_file.write('create(col,"col2",db1.tbl66)\n')
+    output_file.write('load(\"'+DOCKER_TEST_BASE_DIR+'/data66.csv\")\n')
+    output_file.write('--\n')
+    output_file.write('-- SELECT SUM(col2) FROM tbl66 WHERE col1 >= 1000 AND col1 < 5000;\n')
+    output_file.write('-- with more handles made in between than the handle table starts with room for\n')
+    output_file.write('s1=select(db1.tbl66.col1,1000,5000)\n')
+    output_file.write('f1=fetch(db1.tbl66.col2,s1)\n')
+    for i in range(1100):
+        output_file.write('x{}=select(db1.tbl66.col1,1,2)\n'.format(i))
+    output_file.write('a1=sum(f1)\n')
+    output_file.write('print(a1)\n')
+    # generate expected results
+    dfSelectMask = (dataTable['col1'] >= 1000) & (dataTable['col1'] < 5000)
+    exp_output_file.write(str(int(dataTable[dfSelectMask]['col2'].sum())))
+    exp_output_file.write('\n')
+    data_gen_utils.closeFileHandles(output_file, exp_output_file)
+    return dataTable
+
+
+def createTest67(dataSize):
+    outputFile = TEST_BASE_DIR + '/data67.csv'
+    header_line = data_gen_utils.generateHeaderLine('db1', 'tbl67', 2)
+    dataTable = pd.DataFrame(np.random.randint(1, max(dataSize // 10, 2), size=(dataSize, 2)), columns=['col1', 'col2'])
+    # col2 is a key, so that a range of it picks a few rows
+    dataTable['col2'] = np.random.permutation(dataSize)
+    dataTable.to_csv(outputFile, sep=',', index=False, header=header_line, lineterminator='\n')
+
+    output_file, exp_output_file = data_gen_utils.openFileHandles(67, TEST_DIR=TEST_BASE_DIR)
+    output_file.write('-- Correctness test: an automatic join over a clustered btree a row was inserted into out of order\n')
+    output_file.write('--\n')
+    output_file.write('create(tbl,"tbl67",db1,2)\n')
+    output_file.write('create(col,"col1",db1.tbl67)\n')
+    output_file.write('create(col,"col2",db1.tbl67)\n')
+    output_file.write('create(idx,db1.tbl67.col1,btree,clustered)\n')
+    output_file.write('load(\"'+DOCKER_TEST_BASE_DIR+'/data67.csv\")\n')
+    output_file.write('-- A key below the rest: the btree no longer lists its rows in order\n')
+    output_file.write('relational_insert(db1.tbl67,0,{})\n'.format(dataSize))
+    dataTable = pd.concat([dataTable, pd.DataFrame([[0, dataSize]], columns=['col1', 'col2'])])
+    output_file.write('--\n')
+    output_file.write('-- SELECT SUM(a.col2), SUM(b.col2) FROM tbl67 AS a, tbl67 AS b WHERE a.col1 = b.col1 AND b.col2 < 20;\n')
+    output_file.write('p1=select(db1.tbl67.col2,null,{})\n'.format(dataSize + 1))
+    output_file.write('f1=fetch(db1.tbl67.col1,p1)\n')
+    output_file.write('p2=select(db1.tbl67.col2,null,20)\n')
+    output_file.write('f2=fetch(db1.tbl67.col1,p2)\n')
+    output_file.write('t1,t2=join(f1,p1,f2,p2,auto)\n')
+    output_file.write('c1=fetch(db1.tbl67.col2,t1)\n')
+    output_file.write('c2=fetch(db1.tbl67.col2,t2)\n')
+    output_file.write('a1=sum(c1)\n')
+    output_file.write('a2=sum(c2)\n')
+    output_file.write('print(a1,a2)\n')
+    # generate expected results
+    joinedTable = dataTable.merge(dataTable[dataTable['col2'] < 20], on='col1', suffixes=('', '_right'))
+    exp_output_file.write('{},{}\n'.format(int(joinedTable['col2'].sum()), int(joinedTable['col2_right'].sum())))
+    data_gen_utils.closeFileHandles(output_file, exp_output_file)
+
+
+def createTest68(dataTable):
+    output_file, exp_output_file = data_gen_utils.openFileHandles(68, TEST_DIR=TEST_BASE_DIR)
+    output_file.write('-- Correctness test: a deferred fetch that is itself the handle the handle table grows for\n')
+    output_file.write('--\n')
+    output_file.write('-- SELECT SUM(col2) FROM tbl66 WHERE col1 >= 1000 AND col1 < 5000;\n')
+    output_file.write('-- with just as many handles made before the fetch as the handle table starts with room for\n')
+    output_file.write('s1=select(db1.tbl66.col1,1000,5000)\n')
+    for i in range(999):
+        output_file.write('x{}=select(db1.tbl66.col1,1,2)\n'.format(i))
+    output_file.write('f1=fetch(db1.tbl66.col2,s1)\n')
+    output_file.write('a1=sum(f1)\n')
+    output_file.write('print(a1)\n')
+    # generate expected results
+    dfSelectMask = (dataTable['col1'] >= 1000) & (dataTable['col1'] < 5000)
+    exp_output_file.write(str(int(dataTable[dfSelectMask]['col2'].sum())))
+    exp_output_file.write('\n')
+    data_gen_utils.closeFileHandles(output_file, exp_output_file)
+
+
+def createTest69(dataTable):
+    output_file, exp_output_file = data_gen_utils.openFileHandles(69, TEST_DIR=TEST_BASE_DIR)
+    output_file.write('-- Correctness test: a multi-column fetch whose results grow the handle table\n')
+    output_file.write('--\n')
+    output_file.write('-- SELECT SUM(col1), SUM(col2) FROM tbl66 WHERE col1 >= 1000 AND col1 < 5000;\n')
+    output_file.write('-- with room in the handle table for the first of the fetch\'s results, but not the second\n')
+    output_file.write('s1=select(db1.tbl66.col1,1000,5000)\n')
+    for i in range(998):
+        output_file.write('x{}=select(db1.tbl66.col1,1,2)\n'.format(i))
+    output_file.write('f1,f2=fetch(db1.tbl66.{col1,col2},s1)\n')
+    output_file.write('a1=sum(f1)\n')
+    output_file.write('a2=sum(f2)\n')
+    output_file.write('print(a1,a2)\n')
+    # generate expected results
+    dfSelectMask = (dataTable['col1'] >= 1000) & (dataTable['col1'] < 5000)
+    exp_output_file.write('{},{}\n'.format(int(dataTable[dfSelectMask]['col1'].sum()), int(dataTable[dfSelectMask]['col2'].sum())))
+    data_gen_utils.closeFileHandles(output_file, exp_output_file)
+
+
+def createTest70(dataSize):
+    # the same table loaded twice, from two files
+    header_line = data_gen_utils.generateHeaderLine('db1', 'tbl70', 2)
+    dataTables = []
+    for load in range(2):
+        dataTable = pd.DataFrame(np.random.randint(0, 1000, size=(dataSize, 2)), columns=['col1', 'col2'])
+        dataTable.to_csv(TEST_BASE_DIR + '/data70_{}.csv'.format(load), sep=',', index=False, header=header_line, lineterminator='\n')
+        dataTables.append(dataTable)
+
+    output_file, exp_output_file = data_gen_utils.openFileHandles(70, TEST_DIR=TEST_BASE_DIR)
+    output_file.write('-- Correctness test: a reload replaces the data a cracked index was built from\n')
+    output_file.write('--\n')
+    output_file.write('create(tbl,"tbl70",db1,2)\n')
+    output_file.write('create(col,"col1",db1.tbl70)\n')
+    output_file.write('create(col,"col2",db1.tbl70)\n')
+    output_file.write('create(idx,db1.tbl70.col1,cracked)\n')
+    for load, dataTable in enumerate(dataTables):
+        output_file.write('load(\"'+DOCKER_TEST_BASE_DIR+'/data70_{}.csv\")\n'.format(load))
+        output_file.write('-- SELECT SUM(col2) FROM tbl70 WHERE col1 >= 100 AND col1 < 300;\n')
+        output_file.write('s{}=select(db1.tbl70.col1,100,300)\n'.format(load))
+        output_file.write('f{}=fetch(db1.tbl70.col2,s{})\n'.format(load, load))
+        output_file.write('a{}=sum(f{})\n'.format(load, load))
+        output_file.write('print(a{})\n'.format(load))
+        # generate expected results
+        dfSelectMask = (dataTable['col1'] >= 100) & (dataTable['col1'] < 300)
+        exp_output_file.write(str(int(dataTable[dfSelectMask]['col2'].sum())))
+        exp_output_file.write('\n')
+    data_gen_utils.closeFileHandles(output_file, exp_output_file)
+
 
 def generateMilestoneFiveFiles(dataSize,randomSeed=47):
     np.random.seed(randomSeed)
@@ -310,6 +445,11 @@ def generateMilestoneFiveFiles(dataSize,randomSeed=47):
     createTest63(dataTable)
     dataTable = createTest64(dataTable)
     createTest65(dataTable)
+    table66 = createTest66(dataSize)
+    createTest67(dataSize)
+    createTest68(table66)
+    createTest69(table66)
+    createTest70(dataSize)
 
 def main(argv):
     global TEST_BASE_DIR
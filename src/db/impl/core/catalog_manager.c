@@ -15,6 +15,27 @@
 
 void print_column(Column *col);
 
+// Zone maps are persisted next to the column's data file, e.g. disk/db1.tbl1.col1.zones
+static void zones_path(char *path, const Table *table, const Column *col) {
+  snprintf(path, MAX_PATH_LEN, "%s/%s.%s.%s.zones", STORAGE_PATH, current_db->name,
+           table->name, col->name);
+}
+
+static void index_path(char *path, const Table *table, const Column *col) {
+  snprintf(path, MAX_PATH_LEN, "%s/%s.%s.%s.idx", STORAGE_PATH, current_db->name,
+           table->name, col->name);
+}
+
+void build_zone_maps(Table *table) {
+  for (size_t i = 0; i < table->num_cols; i++) {
+    Column *col = &table->columns[i];
+    if (!col->data) continue;
+    zonemap_free(col->zones);
+    col->zones = zonemap_build((int *)col->data, col->num_elements, ZONE_SIZE);
+    if (!col->zones) log_err("build_zone_maps: Failed for column %s\n", col->name);
+  }
+}
+
 bool is_valid_index_type(int value) {
   switch (value) {
     case BTREE_CLUSTERED:
@@ -22,6 +43,8 @@ bool is_valid_index_type(int value) {
     case SORTED_CLUSTERED:
     case SORTED_UNCLUSTERED:
     case NONE:
+    case CRACKED:
+    case SORTED_EYTZINGER:
       return true;
     default:
       return false;
@@ -73,6 +96,17 @@ Status deserialize_column(Column *col, Table *table, FILE *meta_file) {
     return (Status){ERROR, "Failed to mmap column data"};
   }
 
+  // Load the zone map, or rebuild it if it is missing or stale
+  char zm_path[MAX_PATH_LEN];
+  zones_path(zm_path, table, col);
+  col->zones = zonemap_load(zm_path);
+  if (!col->zones || col->zones->num_elements != col->num_elements ||
+      col->zones->zone_size != ZONE_SIZE) {
+    cs165_log(stdout, "Rebuilding zone map for column %s\n", col->name);
+    zonemap_free(col->zones);
+    col->zones = zonemap_build((int *)col->data, col->num_elements, ZONE_SIZE);
+  }
+
   // Handle index creation, if necessary
   if (!is_valid_index_type(idx_type)) {
     log_err("init_db_from_disk: Invalid index type %d for column %s\n", idx_type,
@@ -80,9 +114,14 @@ Status deserialize_column(Column *col, Table *table, FILE *meta_file) {
     return (Status){ERROR, "Invalid index type"};
   }
   if (idx_type != NONE) {
-    col->index = (ColumnIndex *)malloc(sizeof(ColumnIndex));
+    col->index = (ColumnIndex *)calloc(1, sizeof(ColumnIndex));
     col->index->idx_type = idx_type;
-    create_idx_on(col, NULL);
+    // Sorted and btree indexes map straight from their files, if those are current
+    char idx_path[MAX_PATH_LEN];
+    index_path(idx_path, table, col);
+    if (idx_type == CRACKED || load_idx(col, idx_path) != 0) {
+      create_idx_on(col, NULL);
+    }
   } else {
     col->index = NULL;
     col->root = NULL;
@@ -198,7 +237,7 @@ Status init_db_from_disk(void) {
           table->num_cols = num_cols;
 
           // Allocate memory for columns
-          table->columns = (Column *)malloc(table->col_capacity * sizeof(Column));
+          table->columns = (Column *)calloc(table->col_capacity, sizeof(Column));
           if (!table->columns) {
             log_err("init_db_from_disk: Failed to allocate memory for columns\n");
             free(current_db->tables);
@@ -346,13 +385,21 @@ Status shutdown_catalog_manager(void) {
               idx_type);
 
       if (idx_type != NONE) {
-        if (col->index->idx_type == BTREE_CLUSTERED ||
-            col->index->idx_type == BTREE_UNCLUSTERED) {
-          free_btree(col->root);
+        char idx_path[MAX_PATH_LEN];
+        index_path(idx_path, table, col);
+        if (save_idx(col, idx_path) != 0) {
+          log_err("shutdown_catalog_manager: Failed to save the index of %s\n",
+                  col->name);
         }
-        free(col->index->sorted_data);
-        free(col->index->positions);
-        free(col->index);
+        free_idx(col);
+      }
+
+      if (col->zones) {
+        char zm_path[MAX_PATH_LEN];
+        zones_path(zm_path, table, col);
+        zonemap_save(col->zones, zm_path);
+        zonemap_free(col->zones);
+        col->zones = NULL;
       }
 
       if (col->is_dirty) {
@@ -415,7 +462,7 @@ void print_column(Column *col) {
       log_info("----------------\n");
     }
 
-    if (col->index && col->index->idx_type != NONE) {
+    if (col->index && col->index->sorted_data) {
       log_info("Sorted layer: \n================\n");
       for (size_t i = 0; i < col->num_elements; i++) {
         printf("(val: %d, pos: %d) ", col->index->sorted_data[i],
@@ -6,6 +6,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "query_exec.h"
+
 #define INITIAL_CHANDLE_SLOTS 1000
 #define GROWTH_FACTOR 2
 
@@ -56,6 +58,8 @@ void free_client_context(void) {
         // such columns should be managed by the catalog manager. this is variable pool.
         cs165_log(stdout, "free_client_context: Freeing column %s\n", col->name);
         free(col->data);
+        bitvector_free(col->bitmap);
+        free(col->pending);
         memset(col, 0, sizeof(Column));  // Clear sensitive data
       }
     }
@@ -66,6 +70,39 @@ void free_client_context(void) {
   g_client_context = NULL;
 }
 
+/**
+ * @brief Grows the handle table, if need be, to make room for `n` more handles, so that
+ * the next `n` calls to `create_new_handle` do not move it. Growing it moves every
+ * handle: a `Column *` into the table taken before this call is invalid after it, and
+ * operators that create handles reserve them before they look up any others.
+ * @return 0 on success, -1 on failure
+ */
+int reserve_handles(size_t n) {
+  if (!g_client_context) return -1;
+  size_t needed = (size_t)g_client_context->chandles_in_use + n;
+  if (needed <= (size_t)g_client_context->chandle_slots) return 0;
+  size_t new_size = g_client_context->chandle_slots;
+  while (new_size < needed) new_size *= GROWTH_FACTOR;
+  // Deferred operators point at the handles they read, which the realloc may move: run
+  // them all first, so none is left to read a handle through a stale pointer
+  exec_all_pending(g_client_context);
+
+  Column *new_table =
+      (Column *)realloc(g_client_context->chandle_table, new_size * sizeof(Column));
+  if (!new_table) {
+    log_err("reserve_handles: failed to resize chandle table\n");
+    return -1;
+  }
+
+  // Zero initialize new memory
+  memset(new_table + g_client_context->chandle_slots, 0,
+         (new_size - g_client_context->chandle_slots) * sizeof(Column));
+
+  g_client_context->chandle_table = new_table;
+  g_client_context->chandle_slots = new_size;
+  return 0;
+}
+
 int create_new_handle(const char *name, Column **out_column) {
   if (!g_client_context) {
     log_err("create_new_handle: client context is not initialized\n");
@@ -86,27 +123,9 @@ int create_new_handle(const char *name, Column **out_column) {
   //     return -1;
   //   }
 
-  // Check if resize needed
-  if (g_client_context->chandles_in_use >= g_client_context->chandle_slots) {
-    size_t new_size = g_client_context->chandle_slots * GROWTH_FACTOR;
-
-    // TODO: Fix the issue that the actual columns gets freed and not copied back into
-    // the new memory. To reproduce the issue, use a small INITIAL_CHANDLE_SLOTS value
-    // Currently, using larger INITIAL_CHANDLE_SLOTS value to avoid the issue.
-    Column *new_table =
-        (Column *)realloc(g_client_context->chandle_table, new_size * sizeof(Column));
-    if (!new_table) {
-      log_err("create_new_handle: failed to resize chandle table\n");
-      return -1;
-    }
-
-    // Zero initialize new memory
-    memset(new_table + g_client_context->chandle_slots, 0,
-           (new_size - g_client_context->chandle_slots) * sizeof(Column));
-
-    g_client_context->chandle_table = new_table;
-    g_client_context->chandle_slots = new_size;
-  }
+  // Resize if needed, which invalidates every Column * into the table (see
+  // reserve_handles)
+  if (reserve_handles(1) != 0) return -1;
 
   // Initialize new handle
   Column *new_col = &g_client_context->chandle_table[g_client_context->chandles_in_use];
@@ -120,6 +139,62 @@ int create_new_handle(const char *name, Column **out_column) {
   return 0;
 }
 
+/**
+ * @brief Converts a bitmap or index range select result into a position list in place,
+ * for operators that only consume positions (e.g. joins). Any other handle is left as is.
+ * @return 0 on success, -1 on failure
+ */
+int materialize_positions(Column *handle) {
+  if (handle && handle->range.col) {
+    PositionRange range = handle->range;
+    int *positions = malloc(sizeof(int) * (handle->num_elements + 1));
+    if (!positions) {
+      log_err("materialize_positions: failed to allocate %zu positions\n",
+              handle->num_elements);
+      return -1;
+    }
+    for (size_t i = 0; i < handle->num_elements; i++) {
+      positions[i] = range_position(&range, i);
+    }
+    handle->data = positions;
+    memset(&handle->range, 0, sizeof(PositionRange));
+    return 0;
+  }
+  if (!handle || !handle->bitmap) return 0;
+
+  Bitvector *bitmap = handle->bitmap;
+  int *positions = malloc(sizeof(int) * (handle->num_elements + 1));
+  if (!positions) {
+    log_err("materialize_positions: failed to allocate %zu positions\n",
+            handle->num_elements);
+    return -1;
+  }
+  handle->num_elements =
+      bitvector_positions(bitmap, 0, BITVECTOR_WORDS(bitmap->num_bits), positions);
+  free(handle->data);
+  handle->data = positions;
+  handle->bitmap = NULL;
+  bitvector_free(bitmap);
+  return 0;
+}
+
+/**
+ * @brief Materializes every handle holding an unclustered index range of `col`, before
+ * the index's positions change under it.
+ * @return 0 on success, -1 on failure
+ */
+int materialize_ranges_on(Column *col) {
+  if (!g_client_context) return 0;
+  for (int i = 0; i < g_client_context->chandles_in_use; i++) {
+    Column *handle = &g_client_context->chandle_table[i];
+    if (handle->range.col == col && !handle->range.clustered &&
+        materialize_positions(handle) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
 Column *get_handle(const char *name_) {
   if (!g_client_context || !name_) {
     log_err("get_handle: invalid arguments\n");
@@ -1,12 +1,46 @@
 #include "catalog_manager.h"
 #include "operators.h"
+#include "query_exec.h"
 #include "utils.h"
 
 // In this class, there will always be only one active database at a time
 Db *current_db;
+ThreadPool *worker_pool = NULL;
+size_t join_memory_budget = (size_t)JOIN_MEMORY_BUDGET_MB << 20;
+
+// Number of pool workers: WORKER_THREADS_ENV if set to a positive number, else
+// NUM_WORKER_THREADS (0 lets the pool use one worker per online core)
+static size_t configured_workers(void) {
+  const char *env = getenv(WORKER_THREADS_ENV);
+  if (env) {
+    long n = strtol(env, NULL, 10);
+    if (n > 0) return (size_t)n;
+    log_err("db_startup: ignoring invalid %s=%s\n", WORKER_THREADS_ENV, env);
+  }
+  return NUM_WORKER_THREADS;
+}
+
+// Grace hash join memory budget: JOIN_MEMORY_ENV MiB if set to a positive number, else
+// JOIN_MEMORY_BUDGET_MB
+static size_t configured_join_memory(void) {
+  const char *env = getenv(JOIN_MEMORY_ENV);
+  if (env) {
+    long mb = strtol(env, NULL, 10);
+    if (mb > 0) return (size_t)mb << 20;
+    log_err("db_startup: ignoring invalid %s=%s\n", JOIN_MEMORY_ENV, env);
+  }
+  return (size_t)JOIN_MEMORY_BUDGET_MB << 20;
+}
 
 Status db_startup(void) {
   cs165_log(stdout, "Startup server\n");
+  worker_pool = threadpool_create(configured_workers());
+  if (!worker_pool) {
+    log_err("db_startup: failed to start worker pool; running single-threaded\n");
+  } else {
+    log_info("db_startup: started %zu worker threads\n", threadpool_size(worker_pool));
+  }
+  join_memory_budget = configured_join_memory();
   init_db_from_disk();
   init_client_context();
   return (Status){OK, NULL};
@@ -15,9 +49,17 @@ Status db_startup(void) {
 void db_shutdown(void) {
   shutdown_catalog_manager();
   free_client_context();
+  threadpool_destroy(worker_pool);
+  worker_pool = NULL;
   cs165_log(stdout, "Shutdown server\n");
 }
 
+ThreadPool *executor_pool(const DbOperator *query, size_t n_elements) {
+  if (!worker_pool || n_elements < NUM_ELEMENTS_TO_MULTITHREAD) return NULL;
+  if (query && query->context && query->context->is_single_core) return NULL;
+  return worker_pool;
+}
+
 /**
  * @brief free the memory allocated for a db operator
  */
@@ -42,6 +84,21 @@ void db_operator_free(DbOperator *dbo) {
       }
       break;
 
+    case MULTI_FETCH:
+      free(dbo->operator_fields.multi_fetch_operator.fetch_handles);
+      free(dbo->operator_fields.multi_fetch_operator.cols);
+      break;
+
+    case EXPR:
+      free(dbo->operator_fields.expr_operator.steps);
+      free(dbo->operator_fields.expr_operator.cols);
+      break;
+
+    case GROUP_BY:
+      free(dbo->operator_fields.group_by_operator.aggs);
+      free(dbo->operator_fields.group_by_operator.res_handles);
+      break;
+
     default:
       break;
   }
@@ -206,10 +206,11 @@ int receive_columns(int socket, message *send_message) {
   ColumnMetadata metadata = {0};
   ssize_t bytes_received = 0;
   Table *table = NULL;
-  Column *primary_col = NULL;    // Primary column for indexing, this is the first column
-                                 // with clustered index
-  Column *secondary_col = NULL;  // Secondary column for indexing, this is unclustered
-                                 // column
+  Column *primary_col = NULL;  // Primary column for indexing, this is the first column
+                               // with clustered index
+
+  // Deferred selects and fetches must not see the loaded data
+  exec_all_pending(g_client_context);
 
   while ((bytes_received = recv(socket, &metadata, sizeof(ColumnMetadata), 0)) > 0) {
     if (bytes_received != sizeof(ColumnMetadata)) {
@@ -303,14 +304,8 @@ int receive_columns(int socket, message *send_message) {
     }
 
     IndexType idx_type = col->index ? col->index->idx_type : NONE;
-    if (idx_type != NONE) {
-      if (!primary_col && (idx_type == SORTED_CLUSTERED || idx_type == BTREE_CLUSTERED)) {
-        primary_col = col;
-      }
-      if (!secondary_col &&
-          (idx_type == SORTED_UNCLUSTERED || idx_type == BTREE_UNCLUSTERED)) {
-        secondary_col = col;
-      }
+    if (!primary_col && (idx_type == SORTED_CLUSTERED || idx_type == BTREE_CLUSTERED)) {
+      primary_col = col;
     }
     col->is_dirty = 0;
     // NOTE: Differing this for `shutdown`
@@ -324,13 +319,25 @@ int receive_columns(int socket, message *send_message) {
     log_info("Successfully received and stored data for column %s\n", metadata.name);
   }
 
-  if (!primary_col) return 0;
-  create_idx_on(primary_col, send_message);
-  // TODO: debug why this messes up correctness on grading server. particularly,
-  // Benchmark3
-  cluster_idx_on(table, primary_col, send_message);
+  if (primary_col) {
+    create_idx_on(primary_col, send_message);
+    // TODO: debug why this messes up correctness on grading server. particularly,
+    // Benchmark3
+    cluster_idx_on(table, primary_col, send_message);
+  }
+  // Every unclustered index, after clustering, which moves the rows they point to; a
+  // cracked one is dropped, for the next select to build over the new data
+  for (size_t c = 0; table && c < table->num_cols; c++) {
+    Column *col = &table->columns[c];
+    IndexType idx_type = col->index ? col->index->idx_type : NONE;
+    if (idx_type == SORTED_UNCLUSTERED || idx_type == BTREE_UNCLUSTERED ||
+        idx_type == SORTED_EYTZINGER || idx_type == CRACKED) {
+      create_idx_on(col, send_message);
+    }
+  }
 
-  if (secondary_col) create_idx_on(secondary_col, send_message);
+  // Zone maps summarize the final layout, so build them after clustering
+  if (table) build_zone_maps(table);
 
   return 0;
 }
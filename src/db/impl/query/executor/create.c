@@ -32,9 +32,14 @@ void exec_create(DbOperator *query, message *send_message) {
     col->index->idx_type = idx_type;
 
     // Set these to NULL since all create_idx queries are before data is loaded
-    // The actual index is made on during `load`
+    // The actual index is made on during `load`; a cracked index on the first select
     col->index->sorted_data = NULL;
     col->index->positions = NULL;
+    col->index->eytzinger = NULL;
+    col->index->eytzinger_ranks = NULL;
+    col->index->clustered = 0;
+    col->index->cracker = NULL;
+    col->index->file = NULL;
     return;
   }
 
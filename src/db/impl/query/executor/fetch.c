@@ -1,14 +1,87 @@
+#include <limits.h>
 #include <string.h>
 
 #include "client_context.h"
 #include "query_exec.h"
 #include "utils.h"
 
+// Rows of a bitmap select result per fetch morsel; a whole number of bitvector words
+#define FETCH_BITMAP_MORSEL_WORDS (MORSEL_SIZE / 64)
+
+// Bitvector words whose set bits a bitmap morsel extracts into positions at a time
+#define FETCH_BITMAP_BATCH_WORDS 16
+
+// Shared by every morsel of a fetch of `num_cols` columns at the same positions; each
+// morsel gathers its slice of every `outs[c]` and folds column c's values into
+// `stats[worker * num_cols + c]`. For a bitmap select result, morsels are ranges of its
+// words and `offsets[m]` is where morsel m's first value goes. For a clustered index
+// range, `values` start at the range and rows are read in order.
+typedef struct {
+  const int *positions;
+  const Bitvector *bitmap;
+  const size_t *offsets;
+  const int **values;
+  int **outs;
+  size_t num_cols;
+  ValueStats *stats;
+} FetchArgs;
+
+static void fetch_morsel(void *args, size_t worker, size_t morsel, size_t start,
+                         size_t end) {
+  (void)morsel;
+  FetchArgs *fetch_args = (FetchArgs *)args;
+  size_t num_cols = fetch_args->num_cols;
+  int *outs[num_cols];
+  for (size_t c = 0; c < num_cols; c++) outs[c] = fetch_args->outs[c] + start;
+  simd_gather_columns(fetch_args->values, num_cols, fetch_args->positions + start,
+                      end - start, outs, &fetch_args->stats[worker * num_cols]);
+}
+
+static void fetch_range_morsel(void *args, size_t worker, size_t morsel, size_t start,
+                               size_t end) {
+  (void)morsel;
+  FetchArgs *fetch_args = (FetchArgs *)args;
+  size_t num_cols = fetch_args->num_cols;
+  for (size_t c = 0; c < num_cols; c++) {
+    simd_copy(fetch_args->values[c] + start, end - start, fetch_args->outs[c] + start,
+              &fetch_args->stats[worker * num_cols + c]);
+  }
+}
+
+static void fetch_bitmap_morsel(void *args, size_t worker, size_t morsel,
+                                size_t start_word, size_t end_word) {
+  FetchArgs *fetch_args = (FetchArgs *)args;
+  size_t num_cols = fetch_args->num_cols;
+  int *outs[num_cols];
+  for (size_t c = 0; c < num_cols; c++) {
+    outs[c] = fetch_args->outs[c] + fetch_args->offsets[morsel];
+  }
+  int positions[FETCH_BITMAP_BATCH_WORDS * 64];
+
+  // Full words become dense runs of positions, which the gather reads with plain loads
+  for (size_t w = start_word; w < end_word; w += FETCH_BITMAP_BATCH_WORDS) {
+    size_t w_end = w + FETCH_BITMAP_BATCH_WORDS < end_word ? w + FETCH_BITMAP_BATCH_WORDS
+                                                           : end_word;
+    size_t k = bitvector_positions(fetch_args->bitmap, w, w_end, positions);
+    simd_gather_columns(fetch_args->values, num_cols, positions, k, outs,
+                        &fetch_args->stats[worker * num_cols]);
+    for (size_t c = 0; c < num_cols; c++) outs[c] += k;
+  }
+}
+
 void exec_fetch(DbOperator *query, message *send_message) {
   cs165_log(stdout, "Executing fetch query.\n");
   FetchOperator *fetch_op = &query->operator_fields.fetch_operator;
 
-  // Get the Result from the select handle
+  // Room for the result first: creating it must not move the select handle, which a
+  // deferred fetch keeps pointing at
+  if (reserve_handles(1) != 0) {
+    handle_error(send_message, "Failed to create new handle\n");
+    log_err("L%d in exec_fetch: %s\n", __LINE__, send_message->payload);
+    return;
+  }
+
+  // Get the Result from the select handle, which may not have been run yet
   Column *positions = get_handle(fetch_op->select_handle);
   if (!positions) {
     handle_error(send_message, "Invalid select handle\n");
@@ -34,22 +107,48 @@ void exec_fetch(DbOperator *query, message *send_message) {
     return;
   }
   fetch_result->data_type = fetch_col->data_type;
-  fetch_result->num_elements = positions->num_elements;
 
-  // get the size of a single element in the column
-  if (fetch_col->data_type == INT) {
-    fetch_result->data = malloc(fetch_result->num_elements * sizeof(int));
-  } else {
-    handle_error(send_message, "Fetching from non-integer column not supported\n");
-    log_err("L%d in exec_fetch: %s\n", __LINE__, send_message->payload);
+  // A fetch of a deferred select or an index range waits for its consumer too: an
+  // aggregate over it then runs as one fused pass (see pipeline.c)
+  if (defer_fetch(query, positions, fetch_result)) {
+    send_message->status = OK_DONE;
+    send_message->payload = "Done";
+    send_message->length = strlen(send_message->payload);
     return;
   }
-
-  if (!fetch_result->data) {
-    handle_error(send_message, "Failed to allocate memory for result data\n");
+  if (exec_pending(positions) != 0) {
+    handle_error(send_message, "Failed to run select\n");
     log_err("L%d in exec_fetch: %s\n", __LINE__, send_message->payload);
     return;
   }
+  fetch_into(query, positions, fetch_result, send_message);
+}
+
+/**
+ * @brief Fetches each of `cols[0..num_cols)` at the select result `positions` into the
+ * (empty) handle `results[c]`, with one pass over the positions for all of them.
+ */
+static void fetch_columns_into(DbOperator *query, Column *positions, Column **cols,
+                               Column **results, size_t num_cols,
+                               message *send_message) {
+  for (size_t c = 0; c < num_cols; c++) {
+    results[c]->num_elements = positions->num_elements;
+
+    // get the size of a single element in the column
+    if (cols[c]->data_type == INT) {
+      results[c]->data = malloc(results[c]->num_elements * sizeof(int));
+    } else {
+      handle_error(send_message, "Fetching from non-integer column not supported\n");
+      log_err("L%d in exec_fetch: %s\n", __LINE__, send_message->payload);
+      return;
+    }
+
+    if (!results[c]->data) {
+      handle_error(send_message, "Failed to allocate memory for result data\n");
+      log_err("L%d in exec_fetch: %s\n", __LINE__, send_message->payload);
+      return;
+    }
+  }
 
   if (positions->num_elements == 0) {
     send_message->status = OK_DONE;
@@ -61,27 +160,78 @@ void exec_fetch(DbOperator *query, message *send_message) {
   //    Fetching the values
   //    -----------
 
-  // Now we can start fetching the values. Since we have at least one element in the
-  // select, we can initialize the min and max as below.
-  fetch_result->min_value = fetch_col->max_value;
-  fetch_result->max_value = fetch_col->min_value;
-  fetch_result->sum = 0;
-
-  log_info("exec_fetch: fetching from col %s\n", fetch_col->name);
-  for (size_t i = 0; i < positions->num_elements; i++) {
-    size_t index = ((int *)positions->data)[i];
-    //   TODO: consider alternative implementation for fetching values, while updating
-    //   stats. How can we optimize with batching, SIMD, etc?
-    int value = ((int *)fetch_col->data)[index];
-    cs165_log(stdout, "index= %zu, val= %d ", index, ((int *)fetch_col->data)[index]);
-    ((int *)fetch_result->data)[i] = value;
-
-    fetch_result->sum += value;
-    if (value < fetch_result->min_value) {
-      fetch_result->min_value = value;
+  // Large fetches run in morsels on the worker pool; per-worker stats are merged below
+  ThreadPool *pool = executor_pool(query, positions->num_elements);
+  size_t n_workers = threadpool_morsel_workers(pool);
+  ValueStats stats[n_workers * num_cols];
+  for (size_t i = 0; i < n_workers * num_cols; i++) {
+    stats[i] = (ValueStats){.sum = 0, .min = INT_MAX, .max = INT_MIN};
+  }
+
+  const int *values[num_cols];
+  int *outs[num_cols];
+  for (size_t c = 0; c < num_cols; c++) {
+    log_info("exec_fetch: fetching from col %s\n", cols[c]->name);
+    values[c] = (const int *)cols[c]->data;
+    outs[c] = (int *)results[c]->data;
+  }
+  FetchArgs fetch_args = {.positions = (int *)positions->data,
+                          .bitmap = positions->bitmap,
+                          .values = values,
+                          .outs = outs,
+                          .num_cols = num_cols,
+                          .stats = stats};
+  if (positions->bitmap) {
+    // Prefix-count the set bits of each morsel so morsels can fill `outs` independently
+    size_t num_words = BITVECTOR_WORDS(positions->bitmap->num_bits);
+    size_t num_morsels = threadpool_num_morsels(num_words, FETCH_BITMAP_MORSEL_WORDS);
+    size_t *offsets = malloc(sizeof(size_t) * (num_morsels + 1));
+    if (!offsets) {
+      handle_error(send_message, "Failed to allocate fetch morsel offsets\n");
+      log_err("L%d in exec_fetch: %s\n", __LINE__, send_message->payload);
+      return;
+    }
+    size_t offset = 0;
+    for (size_t m = 0; m < num_morsels; m++) {
+      size_t start = m * FETCH_BITMAP_MORSEL_WORDS;
+      size_t end = start + FETCH_BITMAP_MORSEL_WORDS;
+      offsets[m] = offset;
+      offset += bitvector_count_words(positions->bitmap, start,
+                                      end < num_words ? end : num_words);
+    }
+    fetch_args.offsets = offsets;
+    threadpool_parallel_morsels(pool, num_words, FETCH_BITMAP_MORSEL_WORDS,
+                                fetch_bitmap_morsel, &fetch_args);
+    free(offsets);
+  } else if (positions->range.col) {
+    // An index range: a contiguous run of the columns if clustered, else a contiguous
+    // slice of the index's position list
+    PositionRange *range = &positions->range;
+    if (range->clustered) {
+      for (size_t c = 0; c < num_cols; c++) values[c] += range->start;
+      threadpool_parallel_morsels(pool, positions->num_elements, MORSEL_SIZE,
+                                  fetch_range_morsel, &fetch_args);
+    } else {
+      fetch_args.positions = range->col->index->positions + range->start;
+      threadpool_parallel_morsels(pool, positions->num_elements, MORSEL_SIZE,
+                                  fetch_morsel, &fetch_args);
     }
-    if (value > fetch_result->max_value) {
-      fetch_result->max_value = value;
+  } else {
+    threadpool_parallel_morsels(pool, positions->num_elements, MORSEL_SIZE, fetch_morsel,
+                                &fetch_args);
+  }
+
+  // At least one value was fetched, so the merged min and max are real values
+  for (size_t c = 0; c < num_cols; c++) {
+    Column *result = results[c];
+    result->sum = 0;
+    result->min_value = INT_MAX;
+    result->max_value = INT_MIN;
+    for (size_t w = 0; w < n_workers; w++) {
+      const ValueStats *worker_stats = &stats[w * num_cols + c];
+      result->sum += worker_stats->sum;
+      if (worker_stats->min < result->min_value) result->min_value = worker_stats->min;
+      if (worker_stats->max > result->max_value) result->max_value = worker_stats->max;
     }
   }
 
@@ -91,3 +241,52 @@ void exec_fetch(DbOperator *query, message *send_message) {
   send_message->length = strlen(send_message->payload);
   return;
 }
+
+/**
+ * @brief Runs the fetch `query` of the select result `positions` into the (empty) handle
+ * `fetch_result`.
+ */
+void fetch_into(DbOperator *query, Column *positions, Column *fetch_result,
+                message *send_message) {
+  fetch_columns_into(query, positions, &query->operator_fields.fetch_operator.col,
+                     &fetch_result, 1, send_message);
+}
+
+void exec_multi_fetch(DbOperator *query, message *send_message) {
+  cs165_log(stdout, "Executing multi-column fetch query.\n");
+  MultiFetchOperator *fetch_op = &query->operator_fields.multi_fetch_operator;
+
+  // Room for every result first, so that creating them moves neither the select handle
+  // nor the results created before them
+  if (reserve_handles(fetch_op->num_cols) != 0) {
+    handle_error(send_message, "Failed to create new handles\n");
+    log_err("L%d in exec_multi_fetch: %s\n", __LINE__, send_message->payload);
+    return;
+  }
+
+  Column *positions = get_handle(fetch_op->select_handle);
+  if (!positions) {
+    handle_error(send_message, "Invalid select handle\n");
+    log_err("L%d in exec_multi_fetch: %s\n", __LINE__, send_message->payload);
+    return;
+  }
+  // The columns share one pass over the positions, so a deferred select is run here
+  // rather than deferring a fetch per column
+  if (exec_pending(positions) != 0) {
+    handle_error(send_message, "Failed to run select\n");
+    log_err("L%d in exec_multi_fetch: %s\n", __LINE__, send_message->payload);
+    return;
+  }
+
+  Column *results[fetch_op->num_cols];
+  for (size_t c = 0; c < fetch_op->num_cols; c++) {
+    if (create_new_handle(fetch_op->fetch_handles[c], &results[c]) != 0) {
+      handle_error(send_message, "Failed to create new handle\n");
+      log_err("L%d in exec_multi_fetch: %s\n", __LINE__, send_message->payload);
+      return;
+    }
+    results[c]->data_type = fetch_op->cols[c]->data_type;
+  }
+  fetch_columns_into(query, positions, fetch_op->cols, results, fetch_op->num_cols,
+                     send_message);
+}
@@ -0,0 +1,298 @@
+#include <limits.h>
+#include <string.h>
+
+#include "algorithms.h"
+#include "client_context.h"
+#include "group_table.h"
+#include "query_exec.h"
+#include "utils.h"
+
+// Initial groups per thread-local table; tables grow past it for high-cardinality keys
+#define GROUP_BY_INITIAL_GROUPS 1024
+
+// Groups per morsel of a sort-based group-by; work stealing evens out uneven run lengths
+#define GROUP_BY_RUN_MORSEL_SIZE 64
+
+// Shared by every morsel of a hash group-by; each morsel pre-aggregates its rows into
+// the table of the worker running it, so workers never contend on a group
+typedef struct {
+  const int *keys;
+  const int *vals;
+  GroupTable **tables;
+  int *failed;
+} GroupByArgs;
+
+static void group_by_morsel(void *args, size_t worker, size_t morsel, size_t start,
+                            size_t end) {
+  (void)morsel;
+  GroupByArgs *group_args = (GroupByArgs *)args;
+  if (group_table_add(group_args->tables[worker], group_args->keys + start,
+                      group_args->vals + start, end - start) != 0) {
+    group_args->failed[worker] = 1;
+  }
+}
+
+// Fills the result handle of `agg` with its value for each of `groups`, and its stats
+static int fill_group_result(Column *result, GroupAggregate agg, const GroupEntry *groups,
+                             size_t num_groups) {
+  result->num_elements = num_groups;
+  result->data_type = agg == GROUP_AVG ? DOUBLE : LONG;
+  result->data = malloc(sizeof(long) * (num_groups + 1));
+  if (!result->data) return -1;
+  if (agg == GROUP_AVG) {
+    double *out = (double *)result->data;
+    for (size_t g = 0; g < num_groups; g++) {
+      out[g] = (double)groups[g].sum / groups[g].count;
+    }
+    return 0;
+  }
+
+  long *out = (long *)result->data;
+  result->sum = 0;
+  result->min_value = num_groups ? LONG_MAX : 0;
+  result->max_value = num_groups ? LONG_MIN : 0;
+  for (size_t g = 0; g < num_groups; g++) {
+    switch (agg) {
+      case GROUP_COUNT:
+        out[g] = groups[g].count;
+        break;
+      case GROUP_SUM:
+        out[g] = groups[g].sum;
+        break;
+      case GROUP_MIN:
+        out[g] = groups[g].min;
+        break;
+      default:
+        out[g] = groups[g].max;
+    }
+    result->sum += out[g];
+    if (out[g] < result->min_value) result->min_value = out[g];
+    if (out[g] > result->max_value) result->max_value = out[g];
+  }
+  return 0;
+}
+
+/**
+ * @brief Hash group-by: each worker pre-aggregates its morsels into its own table, and
+ * the tables are merged once the parallel pass is done.
+ * @return the groups in ascending key order (`*num_groups` of them), or NULL on failure
+ */
+static GroupEntry *hash_group_by(ThreadPool *pool, Column *keys, Column *vals,
+                                 size_t *num_groups) {
+  // The key range bounds the number of groups, and so the tables' initial size
+  size_t num_rows = keys->num_elements;
+  size_t expected_groups = GROUP_BY_INITIAL_GROUPS;
+  if (num_rows > 0 && keys->max_value - keys->min_value < GROUP_BY_INITIAL_GROUPS) {
+    expected_groups = keys->max_value - keys->min_value + 1;
+  }
+  size_t n_workers = threadpool_morsel_workers(pool);
+  GroupTable *tables[n_workers];
+  int failed[n_workers];
+  int status = 0;
+  for (size_t w = 0; w < n_workers; w++) {
+    tables[w] = group_table_create(expected_groups);
+    failed[w] = 0;
+    if (!tables[w]) status = -1;
+  }
+  if (status == 0) {
+    GroupByArgs group_args = {.keys = (const int *)keys->data,
+                              .vals = (const int *)vals->data,
+                              .tables = tables,
+                              .failed = failed};
+    threadpool_parallel_morsels(pool, num_rows, MORSEL_SIZE, group_by_morsel,
+                                &group_args);
+  }
+  for (size_t w = 0; w < n_workers && status == 0; w++) {
+    if (failed[w] || (w > 0 && group_table_merge(tables[0], tables[w]) != 0)) {
+      status = -1;
+    }
+  }
+
+  GroupEntry *groups = NULL;
+  if (status == 0) {
+    groups = malloc(sizeof(GroupEntry) * (tables[0]->num_groups + 1));
+    if (groups) *num_groups = group_table_sorted(tables[0], groups);
+  }
+  for (size_t w = 0; w < n_workers; w++) group_table_free(tables[w]);
+  log_perf("group by: hashed %zu rows on %zu workers\n", num_rows, n_workers);
+  return groups;
+}
+
+// Whether `keys` is a column with a sorted index, whose sorted order holds every group
+// as a contiguous run
+static int has_sorted_runs(const Column *keys) {
+  const ColumnIndex *index = keys->index;
+  if (!index) return 0;
+  if (index->idx_type == BTREE_CLUSTERED || index->idx_type == BTREE_UNCLUSTERED) {
+    return keys->root != NULL;
+  }
+  return (index->idx_type == SORTED_CLUSTERED || index->idx_type == SORTED_UNCLUSTERED ||
+          index->idx_type == SORTED_EYTZINGER) &&
+         index->sorted_data;
+}
+
+// Shared by every morsel of a sort-based group-by; morsels are ranges of groups, and
+// group g aggregates the rows at [starts[g], starts[g + 1]) of the sorted keys. Those
+// rows are the same positions of `vals` if `clustered`, else `positions[...]` of it.
+typedef struct {
+  const int *sorted_data;
+  const int *positions;
+  int clustered;
+  const size_t *starts;
+  const int *vals;
+  GroupEntry *groups;
+} RunGroupArgs;
+
+static void run_group_morsel(void *args, size_t worker, size_t morsel, size_t start,
+                             size_t end) {
+  (void)worker;
+  (void)morsel;
+  RunGroupArgs *run_args = (RunGroupArgs *)args;
+  for (size_t g = start; g < end; g++) {
+    size_t run_start = run_args->starts[g];
+    size_t run_length = run_args->starts[g + 1] - run_start;
+    ValueStats stats = {.sum = 0, .min = INT_MAX, .max = INT_MIN};
+    if (run_args->clustered) {
+      simd_copy(run_args->vals + run_start, run_length, NULL, &stats);
+    } else {
+      simd_gather(run_args->vals, run_args->positions + run_start, run_length, NULL,
+                  &stats);
+    }
+    run_args->groups[g] = (GroupEntry){.sum = stats.sum,
+                                       .count = run_length,
+                                       .key = run_args->sorted_data[run_start],
+                                       .min = stats.min,
+                                       .max = stats.max,
+                                       .used = 1};
+  }
+}
+
+/**
+ * @brief Sort-based group-by over the runs of a sorted key index: no hashing, and the
+ * groups come out in key order. The run boundaries are found by galloping over the
+ * sorted keys, read off the leaves first for a btree. Each run is then aggregated in one
+ * streaming pass over its values, a contiguous copy if the index is clustered.
+ * @return the groups in ascending key order (`*num_groups` of them), or NULL on failure
+ */
+static GroupEntry *run_group_by(ThreadPool *pool, Column *keys, Column *vals,
+                                size_t *num_groups) {
+  const ColumnIndex *index = keys->index;
+  size_t num_rows = keys->num_elements;
+  RunGroupArgs run_args = {.sorted_data = index->sorted_data,
+                           .positions = index->positions,
+                           .clustered = index->clustered,
+                           .vals = (const int *)vals->data};
+  int *tree_keys = NULL, *tree_rowids = NULL;
+  if (keys->root) {
+    tree_keys = malloc(sizeof(int) * (num_rows + 1));
+    tree_rowids = index->clustered ? NULL : malloc(sizeof(int) * (num_rows + 1));
+    if (!tree_keys || (!index->clustered && !tree_rowids)) {
+      free(tree_keys);
+      free(tree_rowids);
+      return NULL;
+    }
+    btree_range_copy(keys->root, btree_begin(keys->root), btree_end(), tree_keys,
+                     tree_rowids);
+    run_args.sorted_data = tree_keys;
+    run_args.positions = tree_rowids;
+  }
+
+  size_t *starts = malloc(sizeof(size_t) * (num_rows + 1));
+  GroupEntry *groups = malloc(sizeof(GroupEntry) * (num_rows + 1));
+  if (!starts || !groups) {
+    free(starts);
+    free(groups);
+    free(tree_keys);
+    free(tree_rowids);
+    return NULL;
+  }
+
+  size_t n = 0;
+  const int *sorted_data = run_args.sorted_data;
+  for (size_t i = 0; i < num_rows; i = sorted_run_end(sorted_data, num_rows, i)) {
+    starts[n++] = i;
+  }
+  starts[n] = num_rows;
+
+  run_args.starts = starts;
+  run_args.groups = groups;
+  threadpool_parallel_morsels(pool, n, GROUP_BY_RUN_MORSEL_SIZE, run_group_morsel,
+                              &run_args);
+  free(starts);
+  free(tree_keys);
+  free(tree_rowids);
+  *num_groups = n;
+  log_perf("group by: streamed %zu rows over the runs of the index on %s\n", num_rows,
+           keys->name);
+  return groups;
+}
+
+void exec_group_by(DbOperator *query, message *send_message) {
+  GroupByOperator *group_op = &query->operator_fields.group_by_operator;
+  Column *keys = group_op->keys;
+  Column *vals = group_op->vals;
+  cs165_log(stdout, "Executing group by of %s on %s\n", vals->name, keys->name);
+
+  if (keys->data_type != INT || vals->data_type != INT) {
+    handle_error(send_message, "Group by is only supported on integer columns\n");
+    log_err("L%d in exec_group_by: %s\n", __LINE__, send_message->payload);
+    return;
+  }
+  if (keys->num_elements != vals->num_elements) {
+    handle_error(send_message, "Group by keys and values differ in length\n");
+    log_err("L%d in exec_group_by: %s\n", __LINE__, send_message->payload);
+    return;
+  }
+
+  // A key column with a sorted index already has its groups laid out as runs
+  ThreadPool *pool = executor_pool(query, keys->num_elements);
+  size_t num_groups = 0;
+  GroupEntry *groups = has_sorted_runs(keys)
+                           ? run_group_by(pool, keys, vals, &num_groups)
+                           : hash_group_by(pool, keys, vals, &num_groups);
+  if (!groups) {
+    handle_error(send_message, "Failed to aggregate groups\n");
+    log_err("L%d in exec_group_by: %s\n", __LINE__, send_message->payload);
+    return;
+  }
+  log_perf("group by: %zu rows into %zu groups\n", keys->num_elements, num_groups);
+
+  int status = 0;
+
+  // The distinct keys, in ascending order, then one handle per aggregate
+  Column *key_result;
+  if (create_new_handle(group_op->res_handles[0], &key_result) != 0) {
+    free(groups);
+    handle_error(send_message, "Failed to create new handle\n");
+    log_err("L%d in exec_group_by: %s\n", __LINE__, send_message->payload);
+    return;
+  }
+  key_result->data_type = INT;
+  key_result->num_elements = num_groups;
+  key_result->data = malloc(sizeof(int) * (num_groups + 1));
+  if (!key_result->data) status = -1;
+  for (size_t g = 0; g < num_groups && status == 0; g++) {
+    ((int *)key_result->data)[g] = groups[g].key;
+    key_result->sum += groups[g].key;
+  }
+  key_result->min_value = num_groups ? groups[0].key : 0;
+  key_result->max_value = num_groups ? groups[num_groups - 1].key : 0;
+
+  for (size_t a = 0; a < group_op->num_aggs && status == 0; a++) {
+    Column *result;
+    if (create_new_handle(group_op->res_handles[a + 1], &result) != 0 ||
+        fill_group_result(result, group_op->aggs[a], groups, num_groups) != 0) {
+      status = -1;
+    }
+  }
+  free(groups);
+  if (status != 0) {
+    handle_error(send_message, "Failed to create group by results\n");
+    log_err("L%d in exec_group_by: %s\n", __LINE__, send_message->payload);
+    return;
+  }
+
+  send_message->status = OK_DONE;
+  send_message->payload = "Done";
+  send_message->length = strlen(send_message->payload);
+}
@@ -5,6 +5,7 @@
 #include <sys/mman.h>  // for mremap
 #include <unistd.h>    // for sysconf
 
+#include "optimizer.h"
 #include "query_exec.h"
 #include "utils.h"
 
@@ -81,6 +82,23 @@ void exec_insert(DbOperator *query, message *send_message) {
     cols[i].max_value = values[i] > cols[i].max_value ? values[i] : cols[i].max_value;
     cols[i].sum += values[i];
     cols[i].is_dirty = 0;
+
+    // Keep the zone map covering the new value
+    if (!cols[i].zones) {
+      cols[i].zones = zonemap_build(new_region, cols[i].num_elements, ZONE_SIZE);
+    } else if (zonemap_append(cols[i].zones, values[i]) != 0) {
+      zonemap_free(cols[i].zones);
+      cols[i].zones = NULL;  // scans fall back to reading every block
+    }
+
+    // Keep the column's index covering the new row
+    if (idx_insert(&cols[i]) != 0) {
+      log_err("exec_insert: Failed to update the index of %s\n", cols[i].name);
+      send_message->status = EXECUTION_ERROR;
+      send_message->payload = "Failed to update index";
+      send_message->length = strlen(send_message->payload);
+      return;
+    }
   }
 
   log_info("successfully added new values in table");
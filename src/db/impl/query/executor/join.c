@@ -1,25 +1,40 @@
 #include <limits.h>
+#include <math.h>
+#include <string.h>
 
+#include "bitvector.h"
 #include "client_context.h"
+#include "grace_join.h"
 #include "hash_table.h"
+#include "join_output.h"
+#include "join_planner.h"
 #include "optimizer.h"
 #include "query_exec.h"
+#include "radix_join.h"
+#include "sort_merge_join.h"
 #include "utils.h"
 
+// Left rows per nested loop join morsel; each one scans the whole right side
+#define NESTED_LOOP_MORSEL_SIZE 1024
+
 // O(n * m) where n is the number of elements in psn1_col and m is the number of elements
 // in psn2_col
-void exec_nested_loop_join(Column *psn1_col, Column *psn2_col, Column *vals1_col,
-                           Column *vals2_col, Column *resL, Column *resR);
-void exec_naive_hash_join(Column *psn1_col, Column *psn2_col, Column *vals1_col,
-                          Column *vals2_col, Column *resL, Column *resR);
-void exec_grace_hash_join(Column *psn1_col, Column *psn2_col, Column *vals1_col,
-                          Column *vals2_col, Column *resL, Column *resR);
-void exec_hash_join(Column *psn1_col, Column *psn2_col, Column *vals1_col,
-                    Column *vals2_col, Column *resL, Column *resR);
-
-// just for experimenting on how using sorted index can improve the performance
-void exec_sorted_idx_join(Column *psn1_col, Column *psn2_col, Column *vals1_col,
-                          Column *vals2_col, Column *resL, Column *resR);
+void exec_nested_loop_join(ThreadPool *pool, Column *psn1_col, Column *psn2_col,
+                           Column *vals1_col, Column *vals2_col, Column *resL,
+                           Column *resR);
+void exec_naive_hash_join(ThreadPool *pool, Column *psn1_col, Column *psn2_col,
+                          Column *vals1_col, Column *vals2_col, Column *resL,
+                          Column *resR);
+void exec_grace_hash_join(ThreadPool *pool, Column *psn1_col, Column *psn2_col,
+                          Column *vals1_col, Column *vals2_col, Column *resL,
+                          Column *resR);
+void exec_hash_join(ThreadPool *pool, Column *psn1_col, Column *psn2_col,
+                    Column *vals1_col, Column *vals2_col, Column *resL, Column *resR);
+void exec_sort_merge_join(ThreadPool *pool, Column *psn1_col, Column *psn2_col,
+                          Column *vals1_col, Column *vals2_col, int vals1_sorted,
+                          int vals2_sorted, Column *resL, Column *resR);
+static void exec_auto_join(ThreadPool *pool, const JoinOperator *join_op, Column *resL,
+                           Column *resR);
 
 void exec_join(DbOperator *query, message *send_message) {
   JoinOperator join_op = query->operator_fields.join_operator;
@@ -45,18 +60,33 @@ void exec_join(DbOperator *query, message *send_message) {
   resL_col->num_elements = 0;
   resR_col->num_elements = 0;
 
+  // Large joins run their probe/scan side on the worker pool
+  ThreadPool *pool =
+      executor_pool(query, psn1_col->num_elements + psn2_col->num_elements);
+
   switch (join_op.join_type) {
     case NESTED_LOOP:
-      exec_nested_loop_join(psn1_col, psn2_col, vals1_col, vals2_col, resL_col, resR_col);
+      exec_nested_loop_join(pool, psn1_col, psn2_col, vals1_col, vals2_col, resL_col,
+                            resR_col);
       break;
     case HASH:
-      exec_hash_join(psn1_col, psn2_col, vals1_col, vals2_col, resL_col, resR_col);
+      exec_hash_join(pool, psn1_col, psn2_col, vals1_col, vals2_col, resL_col, resR_col);
       break;
     case GRACE_HASH:
-      exec_grace_hash_join(psn1_col, psn2_col, vals1_col, vals2_col, resL_col, resR_col);
+      exec_grace_hash_join(pool, psn1_col, psn2_col, vals1_col, vals2_col, resL_col,
+                           resR_col);
       break;
     case NAIVE_HASH:
-      exec_naive_hash_join(psn1_col, psn2_col, vals1_col, vals2_col, resL_col, resR_col);
+      exec_naive_hash_join(pool, psn1_col, psn2_col, vals1_col, vals2_col, resL_col,
+                           resR_col);
+      break;
+    case SORT_MERGE:
+      exec_sort_merge_join(pool, psn1_col, psn2_col, vals1_col, vals2_col,
+                           join_op.vals1_sorted, join_op.vals2_sorted, resL_col,
+                           resR_col);
+      break;
+    case AUTO:
+      exec_auto_join(pool, &join_op, resL_col, resR_col);
       break;
     default:
       send_message->status = EXECUTION_ERROR;
@@ -65,9 +95,52 @@ void exec_join(DbOperator *query, message *send_message) {
   }
 }
 
+// Hands the pairs of `result` over to the result columns
+static void set_join_result(Column *resL, Column *resR, JoinResult *result) {
+  resL->data = result->left;
+  resR->data = result->right;
+  resL->num_elements = result->n;
+  resR->num_elements = result->n;
+}
+
+// Shared by every morsel of a nested loop join; morsel m joins its slice of the left side
+// against the whole right side into `outputs[m]`
+typedef struct {
+  const int *l_psn;
+  const int *r_psn;
+  const int *l_vals;
+  const int *r_vals;
+  size_t r_N;
+  JoinOutput *outputs;
+  int failed;
+} NestedLoopArgs;
+
+static void nested_loop_morsel(void *args, size_t worker, size_t morsel, size_t start,
+                               size_t end) {
+  (void)worker;
+  NestedLoopArgs *nl_args = (NestedLoopArgs *)args;
+  const int *r_vals = nl_args->r_vals;
+  size_t r_N = nl_args->r_N;
+  JoinOutput *out = &nl_args->outputs[morsel];
+
+  for (size_t i = start; i < end; i++) {
+    int l_val = nl_args->l_vals[i];
+    for (size_t j = 0; j < r_N; j++) {
+      if (l_val != r_vals[j]) continue;
+      if (join_output_emit(out, nl_args->l_psn[i], nl_args->r_psn[j]) != 0) {
+        __atomic_store_n(&nl_args->failed, 1, __ATOMIC_RELAXED);
+        return;
+      }
+    }
+  }
+}
+
 /**
- * @brief Execute a join operation using a nested loop join algorithm.
+ * @brief Execute a join operation using a nested loop join algorithm. The left side is
+ * split into morsels run on the worker pool; morsel results are concatenated in morsel
+ * order so the output matches the sequential loop.
  *
+ * @param pool worker pool to run on, or NULL to run on the calling thread
  * @param psn1_col
  * @param psn2_col
  * @param vals1_col
@@ -75,186 +148,381 @@ void exec_join(DbOperator *query, message *send_message) {
  * @param resL
  * @param resR
  */
-void exec_nested_loop_join(Column *psn1_col, Column *psn2_col, Column *vals1_col,
-                           Column *vals2_col, Column *resL, Column *resR) {
+void exec_nested_loop_join(ThreadPool *pool, Column *psn1_col, Column *psn2_col,
+                           Column *vals1_col, Column *vals2_col, Column *resL,
+                           Column *resR) {
   log_debug("exec_nested_loop_join: executing nested loop join\n");
   size_t l_N = psn1_col->num_elements;
   size_t r_N = psn2_col->num_elements;
 
-  int *l_psn = (int *)psn1_col->data;
-  int *r_psn = (int *)psn2_col->data;
-
-  int *l_vals = (int *)vals1_col->data;
-  int *r_vals = (int *)vals2_col->data;
+  size_t n_morsels = threadpool_num_morsels(l_N, NESTED_LOOP_MORSEL_SIZE);
+  JoinOutput *outputs = calloc(n_morsels + 1, sizeof(JoinOutput));
+  if (!outputs) {
+    log_err("exec_nested_loop_join: failed to allocate morsel outputs\n");
+    return;
+  }
 
-  size_t max_res_size = psn1_col->num_elements * psn2_col->num_elements;
-  resL->data = malloc(sizeof(int) * max_res_size);
-  resR->data = malloc(sizeof(int) * max_res_size);
+  NestedLoopArgs nl_args = {.l_psn = (int *)psn1_col->data,
+                            .r_psn = (int *)psn2_col->data,
+                            .l_vals = (int *)vals1_col->data,
+                            .r_vals = (int *)vals2_col->data,
+                            .r_N = r_N,
+                            .outputs = outputs};
+  threadpool_parallel_morsels(pool, l_N, NESTED_LOOP_MORSEL_SIZE, nested_loop_morsel,
+                              &nl_args);
+
+  JoinResult result;
+  if (nl_args.failed || join_output_concat(outputs, n_morsels, &result) != 0) {
+    log_err("exec_nested_loop_join: failed to allocate results\n");
+    for (size_t m = 0; m < n_morsels; m++) join_output_free(&outputs[m]);
+  } else {
+    set_join_result(resL, resR, &result);
+  }
+  free(outputs);
+  log_info("exec_nested_loop_join: done\n");
+}
 
-  size_t k = 0;
-  for (size_t i = 0; i < l_N; i++) {
-    for (size_t j = 0; j < r_N; j++) {
-      if (l_vals[i] == r_vals[j]) {
-        ((int *)resL->data)[k] = l_psn[i];
-        ((int *)resR->data)[k] = r_psn[j];
-        k++;
+// Shared by every morsel of a hash join probe: morsel m probes its slice of the right
+// side and writes the matches to `outputs[m]`, so concatenating the outputs in morsel
+// order gives the same order as a sequential probe.
+typedef struct {
+  const hashtable *ht;
+  const int *r_psn;
+  const int *r_vals;
+  JoinOutput *outputs;
+  int failed;
+} HashProbeArgs;
+
+static void hash_probe_morsel(void *args, size_t worker, size_t morsel, size_t start,
+                              size_t end) {
+  (void)worker;
+  HashProbeArgs *probe = (HashProbeArgs *)args;
+  JoinOutput *out = &probe->outputs[morsel];
+  size_t num_matches;
+
+  for (size_t j = start; j < end; j++) {
+    const int *matches = get_values(probe->ht, probe->r_vals[j], &num_matches);
+    for (size_t m = 0; m < num_matches; m++) {
+      if (join_output_emit(out, matches[m], probe->r_psn[j]) != 0) {
+        __atomic_store_n(&probe->failed, 1, __ATOMIC_RELAXED);
+        return;
       }
     }
   }
-  resL->num_elements = k;
-  resR->num_elements = k;
-  log_info("exec_nested_loop_join: done\n");
 }
 
-void exec_naive_hash_join(Column *psn1_col, Column *psn2_col, Column *vals1_col,
-                          Column *vals2_col, Column *resL, Column *resR) {
+/**
+ * @brief Hash join over one table of the left side, with room for `expected_keys`
+ * distinct values before it grows, probed by morsels of the right side on the pool.
+ */
+static void exec_table_hash_join(ThreadPool *pool, Column *psn1_col, Column *psn2_col,
+                                 Column *vals1_col, Column *vals2_col, Column *resL,
+                                 Column *resR, size_t expected_keys) {
   log_debug("exec_hash_join: executing hash join\n");
 
   size_t l_N = psn1_col->num_elements;
   size_t r_N = psn2_col->num_elements;
 
   int *l_psn = (int *)psn1_col->data;
-  int *r_psn = (int *)psn2_col->data;
   int *l_vals = (int *)vals1_col->data;
-  int *r_vals = (int *)vals2_col->data;
 
-  // First pass: Count matches to determine exact result size
+  // Build phase: the whole left relation in one table, each value's positions together
   hashtable *ht = NULL;
-  if (allocate(&ht, l_N) != 0) {
-    log_err("exec_hash_join: failed to allocate hash table\n");
+  int size = expected_keys ? (int)expected_keys : 1;
+  if (allocate(&ht, size) != 0 || bulk_put(ht, l_vals, l_psn, l_N) != 0) {
+    log_err("exec_hash_join: failed to build hash table\n");
+    deallocate(ht);
     return;
   }
 
-  // Build phase: Insert all elements from left relation
-  for (size_t i = 0; i < l_N; i++) {
-    if (put(ht, l_vals[i], l_psn[i]) != 0) {
-      log_err("exec_hash_join: failed to insert into hash table\n");
-      deallocate(ht);
-      return;
-    }
-  }
-
-  // First probe phase: Count matches
-  size_t total_matches = 0;
-  int *matching_positions = malloc(sizeof(int) * l_N);
-  int num_matches;
-
-  if (!matching_positions) {
-    log_err("exec_hash_join: failed to allocate matching positions buffer\n");
+  // Probe phase, in one pass over morsels of the right relation on the pool; the table
+  // is only read from here on, and hands out the matching positions in place
+  size_t n_morsels = threadpool_num_morsels(r_N, MORSEL_SIZE);
+  JoinOutput *outputs = calloc(n_morsels + 1, sizeof(JoinOutput));
+  if (!outputs) {
+    log_err("exec_hash_join: failed to allocate morsel outputs\n");
     deallocate(ht);
     return;
   }
+  HashProbeArgs probe = {.ht = ht,
+                         .r_psn = (int *)psn2_col->data,
+                         .r_vals = (int *)vals2_col->data,
+                         .outputs = outputs};
+  threadpool_parallel_morsels(pool, r_N, MORSEL_SIZE, hash_probe_morsel, &probe);
+  deallocate(ht);
 
-  for (size_t j = 0; j < r_N; j++) {
-    if (get(ht, r_vals[j], matching_positions, l_N, &num_matches) == 0) {
-      total_matches += num_matches;
-    }
+  JoinResult result;
+  if (probe.failed || join_output_concat(outputs, n_morsels, &result) != 0) {
+    log_err("exec_hash_join: failed to allocate results\n");
+    for (size_t m = 0; m < n_morsels; m++) join_output_free(&outputs[m]);
+    free(outputs);
+    return;
   }
+  free(outputs);
+  set_join_result(resL, resR, &result);
 
-  // Allocate exact space needed
-  resL->data = malloc(sizeof(int) * total_matches);
-  resR->data = malloc(sizeof(int) * total_matches);
+  log_info("exec_hash_join: done. Produced %zu results\n", result.n);
+}
 
-  if (!resL->data || !resR->data) {
-    log_err("exec_hash_join: failed to allocate result arrays\n");
-    free(matching_positions);
-    deallocate(ht);
-    if (resL->data) free(resL->data);
-    if (resR->data) free(resR->data);
+void exec_naive_hash_join(ThreadPool *pool, Column *psn1_col, Column *psn2_col,
+                          Column *vals1_col, Column *vals2_col, Column *resL,
+                          Column *resR) {
+  exec_table_hash_join(pool, psn1_col, psn2_col, vals1_col, vals2_col, resL, resR,
+                       psn1_col->num_elements);
+}
+
+/**
+ * @brief Joins the values with a radix-partitioned hash join (see `radix_join`), on
+ * `radix_bits` bits of their hash, with the positions as the payloads.
+ */
+static void exec_radix_join(ThreadPool *pool, Column *psn1_col, Column *psn2_col,
+                            Column *vals1_col, Column *vals2_col, Column *resL,
+                            Column *resR, size_t radix_bits) {
+  JoinResult result;
+  if (radix_join((int *)vals1_col->data, (int *)psn1_col->data, vals1_col->num_elements,
+                 (int *)vals2_col->data, (int *)psn2_col->data, vals2_col->num_elements,
+                 radix_bits, pool, &result) != 0) {
+    log_err("exec_radix_join: join failed\n");
     return;
   }
+  set_join_result(resL, resR, &result);
+  log_perf("radix join: %zu x %zu on %zu bits, %zu results\n", vals1_col->num_elements,
+           vals2_col->num_elements, radix_bits, result.n);
+}
 
-  // Second probe phase: Fill results
-  size_t k = 0;
-  for (size_t j = 0; j < r_N; j++) {
-    if (get(ht, r_vals[j], matching_positions, l_N, &num_matches) == 0) {
-      for (int m = 0; m < num_matches; m++) {
-        ((int *)resL->data)[k] = matching_positions[m];
-        ((int *)resR->data)[k] = r_psn[j];
-        k++;
-      }
-    }
+/**
+ * @brief Grace hash join: both sides are always partitioned first, and the pairs of
+ * partitions are joined one by one. Partitions stay in memory if the build side fits in
+ * `join_memory_budget`; otherwise they are spilled to files under STORAGE_PATH and read
+ * back a pair at a time (see `grace_join`).
+ */
+void exec_grace_hash_join(ThreadPool *pool, Column *psn1_col, Column *psn2_col,
+                          Column *vals1_col, Column *vals2_col, Column *resL,
+                          Column *resR) {
+  JoinResult result;
+  if (grace_join((int *)vals1_col->data, (int *)psn1_col->data, vals1_col->num_elements,
+                 (int *)vals2_col->data, (int *)psn2_col->data, vals2_col->num_elements,
+                 join_memory_budget, STORAGE_PATH, pool, &result) != 0) {
+    log_err("exec_grace_hash_join: join failed\n");
+    return;
   }
+  set_join_result(resL, resR, &result);
+  log_perf("grace hash join: %zu x %zu with a %zu MiB budget, %zu results\n",
+           vals1_col->num_elements, vals2_col->num_elements, join_memory_budget >> 20,
+           result.n);
+}
 
-  // Clean up
-  free(matching_positions);
-  deallocate(ht);
-
-  resL->num_elements = k;
-  resR->num_elements = k;
-
-  log_info("exec_hash_join: done. Produced %zu results\n", k);
+/**
+ * @brief Hash join partitioned just enough for each partition's table to stay in the L2
+ * cache; a build side that fits as it is gets one table, probed in parallel.
+ */
+void exec_hash_join(ThreadPool *pool, Column *psn1_col, Column *psn2_col,
+                    Column *vals1_col, Column *vals2_col, Column *resL, Column *resR) {
+  size_t build_n = psn1_col->num_elements < psn2_col->num_elements
+                       ? psn1_col->num_elements
+                       : psn2_col->num_elements;
+  exec_radix_join(pool, psn1_col, psn2_col, vals1_col, vals2_col, resL, resR,
+                  radix_join_bits(build_n));
 }
 
-void exec_grace_hash_join(Column *psn1_col, Column *psn2_col, Column *vals1_col,
-                          Column *vals2_col, Column *resL, Column *resR) {
-  log_debug("exec_grace_hash_join: Not implemented; using naive hash join\n");
-  exec_naive_hash_join(psn1_col, psn2_col, vals1_col, vals2_col, resL, resR);
+/**
+ * @brief Sort-merge join (see `sort_merge_join`). Values fetched through an index range
+ * of their own column are merged in the index's order as they are; others are checked
+ * for order and radix sorted if need be. The results come out in ascending order of
+ * the join values.
+ */
+void exec_sort_merge_join(ThreadPool *pool, Column *psn1_col, Column *psn2_col,
+                          Column *vals1_col, Column *vals2_col, int vals1_sorted,
+                          int vals2_sorted, Column *resL, Column *resR) {
+  JoinResult result;
+  if (sort_merge_join((int *)vals1_col->data, (int *)psn1_col->data,
+                      vals1_col->num_elements, vals1_sorted, (int *)vals2_col->data,
+                      (int *)psn2_col->data, vals2_col->num_elements, vals2_sorted, pool,
+                      &result) != 0) {
+    log_err("exec_sort_merge_join: join failed\n");
+    return;
+  }
+  set_join_result(resL, resR, &result);
+  log_perf("sort-merge join: %zu x %zu (%s / %s), %zu results\n",
+           vals1_col->num_elements, vals2_col->num_elements,
+           vals1_sorted ? "index order" : "sorted if need be",
+           vals2_sorted ? "index order" : "sorted if need be", result.n);
 }
 
-void exec_hash_join(Column *psn1_col, Column *psn2_col, Column *vals1_col,
-                    Column *vals2_col, Column *resL, Column *resR) {
-  log_debug("exec_hash_join: Not implemented; using naive hash join\n");
-  exec_naive_hash_join(psn1_col, psn2_col, vals1_col, vals2_col, resL, resR);
+// Whether the index of `col` can be looked up value by value: a sorted index, or a
+// clustered btree, whose rows for a value are a run of its sorted order. A btree stops
+// being clustered once a row is inserted out of order: its row ids are no longer ranks,
+// and it has no positions to resolve them with.
+static int has_lookup_index(const Column *col) {
+  const ColumnIndex *index = col->index;
+  if (!index) return 0;
+  if (index->idx_type == BTREE_CLUSTERED) return col->root != NULL && index->clustered;
+  return (index->idx_type == SORTED_CLUSTERED || index->idx_type == SORTED_UNCLUSTERED ||
+          index->idx_type == SORTED_EYTZINGER) &&
+         index->sorted_data;
 }
 
-// TODO: experiment on how using sorted index can improve the performance
-void exec_sorted_idx_join(Column *psn1_col, Column *psn2_col, Column *vals1_col,
-                          Column *vals2_col, Column *resL, Column *resR) {
-  //   First create indices on both values columns
-  vals1_col->index = malloc(sizeof(ColumnIndex));
-  vals2_col->index = malloc(sizeof(ColumnIndex));
-  vals1_col->index->idx_type = SORTED_UNCLUSTERED;
-  vals2_col->index->idx_type = SORTED_UNCLUSTERED;
-  create_idx_on(vals1_col, NULL);
-  create_idx_on(vals2_col, NULL);
-
-  // Since they are both sorted, we can do one pass through the data
-  // and find the matching values
-  size_t l_N = vals1_col->num_elements;
-  size_t r_N = vals2_col->num_elements;
-
-  int *l_vals = (int *)vals1_col->index->sorted_data;
-  int *l_original_idxs = (int *)vals1_col->index->positions;
-  int *l_psn = (int *)psn1_col->data;
+// The rows of `col` equal to `value`, as a run of its index's sorted order
+static PositionRange index_lookup(Column *col, int value) {
+  size_t start, end;
+  if (col->root) {
+    start = btree_cursor_rowid(col->root, btree_lower_bound(col->root, value));
+    end = btree_cursor_rowid(col->root, btree_upper_bound(col->root, value));
+  } else {
+    start = idx_lower_bound(col, value);
+    end = idx_upper_bound(col, value);
+  }
+  return (PositionRange){col, start, end < start ? start : end, col->index->clustered};
+}
 
-  int *r_vals = (int *)vals2_col->index->sorted_data;
-  int *r_original_idxs = (int *)vals2_col->index->positions;
-  int *r_psn = (int *)psn2_col->data;
-
-  size_t max_res_size = vals1_col->num_elements * vals2_col->num_elements;
-  resL->data = malloc(sizeof(int) * max_res_size);
-  resR->data = malloc(sizeof(int) * max_res_size);
-
-  size_t i = 0, j = 0, k = 0;
-  while (i < l_N && j < r_N) {
-    if (l_vals[i] == r_vals[j]) {
-      // Use a temp pointer since we want the next match to start at `j` too, in case of
-      // duplicates
-      //   NOTE: This handling of duplicates is BADD... worst case, both values on left
-      //   and
-      // right are the same
-      size_t temp_j = j;
-
-      // As long as the right matching values are not done, keep recording matches
-      while (temp_j < r_N && l_vals[i] == r_vals[temp_j]) {
-        // get the orginal positions before applying indexes
-        int i_idx = l_original_idxs[i], j_idx = r_original_idxs[temp_j];
-        ((int *)resL->data)[k] = l_psn[i_idx];
-        ((int *)resR->data)[k] = r_psn[j_idx];
-        k++;
-
-        // move on to the next right value
-        temp_j++;
+// Shared by every morsel of an index nested loop join: morsel m looks its slice of the
+// probe side up in the index of `col`, keeps the rows set in `rows`, and writes them to
+// `outputs[m]` as (row, probe position) pairs
+typedef struct {
+  Column *col;
+  const Bitvector *rows;
+  const int *probe_psn;
+  const int *probe_vals;
+  JoinOutput *outputs;
+  int failed;
+} IndexLookupArgs;
+
+static void index_lookup_morsel(void *args, size_t worker, size_t morsel, size_t start,
+                                size_t end) {
+  (void)worker;
+  IndexLookupArgs *lookup = (IndexLookupArgs *)args;
+  JoinOutput *out = &lookup->outputs[morsel];
+
+  for (size_t j = start; j < end; j++) {
+    PositionRange range = index_lookup(lookup->col, lookup->probe_vals[j]);
+    for (size_t k = 0; k < range.end - range.start; k++) {
+      int row = range_position(&range, k);
+      if (!bitvector_test(lookup->rows, (size_t)row)) continue;
+      if (join_output_emit(out, row, lookup->probe_psn[j]) != 0) {
+        __atomic_store_n(&lookup->failed, 1, __ATOMIC_RELAXED);
+        return;
       }
-      i++;
-    } else if (l_vals[i] < r_vals[j]) {
-      i++;
-    } else {
-      j++;
     }
   }
-  resL->num_elements = k;
-  resR->num_elements = k;
-  log_info("exec_sorted_idx_join: done\n");
+}
+
+/**
+ * @brief Index nested loop join: each value of the probe side is looked up in the index
+ * of `col`, the column the indexed side's values were fetched from at `psn_col`'s
+ * positions, instead of in those values. Of the rows a lookup finds, those among the
+ * positions are the matches, which a bitmap of them tells apart. Lookups run in morsels
+ * of the probe side on the pool.
+ */
+static void exec_index_nested_loop_join(ThreadPool *pool, Column *psn_col, Column *col,
+                                        Column *probe_psn_col, Column *probe_vals_col,
+                                        Column *res, Column *res_probe) {
+  size_t n = psn_col->num_elements, probe_N = probe_psn_col->num_elements;
+  Bitvector *rows = bitvector_create(col->num_elements);
+  size_t n_morsels = threadpool_num_morsels(probe_N, MORSEL_SIZE);
+  JoinOutput *outputs = calloc(n_morsels + 1, sizeof(JoinOutput));
+  if (!rows || !outputs) {
+    log_err("exec_index_nested_loop_join: failed to allocate\n");
+    bitvector_free(rows);
+    free(outputs);
+    return;
+  }
+  const int *psn = (int *)psn_col->data;
+  for (size_t i = 0; i < n; i++) {
+    if ((size_t)psn[i] < col->num_elements) bitvector_set(rows, (size_t)psn[i]);
+  }
+  // A lookup may lay the index out first (see `idx_lower_bound`); do that here, before
+  // the lookups run concurrently
+  if (!col->root && col->num_elements > 0) idx_lower_bound(col, 0);
+
+  IndexLookupArgs lookup = {.col = col,
+                            .rows = rows,
+                            .probe_psn = (int *)probe_psn_col->data,
+                            .probe_vals = (int *)probe_vals_col->data,
+                            .outputs = outputs};
+  threadpool_parallel_morsels(pool, probe_N, MORSEL_SIZE, index_lookup_morsel, &lookup);
+  bitvector_free(rows);
+
+  JoinResult result;
+  if (lookup.failed || join_output_concat(outputs, n_morsels, &result) != 0) {
+    log_err("exec_index_nested_loop_join: failed to allocate results\n");
+    for (size_t m = 0; m < n_morsels; m++) join_output_free(&outputs[m]);
+    free(outputs);
+    return;
+  }
+  free(outputs);
+  set_join_result(res, res_probe, &result);
+  log_perf("index nested loop join: %zu lookups in the index of %s (%zu of %zu rows), "
+           "%zu results\n",
+           probe_N, col->name, n, col->num_elements, result.n);
+}
+
+/**
+ * @brief Joins with whichever algorithm `plan_join` estimates is cheapest, from the
+ * sizes of the sides, their distinct values (estimated from a sample), whether they are
+ * in index order, and whether an index of the columns they were fetched from can be
+ * looked up. The plan, and the estimates it was chosen on, are logged with `log_perf`.
+ * Algorithms that build on one side get the side the plan says, swapping the sides (and
+ * the result columns with them) to put it on the left if need be.
+ */
+static void exec_auto_join(ThreadPool *pool, const JoinOperator *join_op, Column *resL,
+                           Column *resR) {
+  Column *psn[2] = {join_op->posn1, join_op->posn2};
+  Column *vals[2] = {join_op->vals1, join_op->vals2};
+  Column *cols[2] = {join_op->vals1_column, join_op->vals2_column};
+  Column *res[2] = {resL, resR};
+  int sorted[2] = {join_op->vals1_sorted, join_op->vals2_sorted};
+  JoinSideStats stats[2];
+  for (int s = 0; s < 2; s++) {
+    size_t n = vals[s]->num_elements;
+    stats[s] = (JoinSideStats){
+        .n = n,
+        .distinct = estimate_distinct((int *)vals[s]->data, n),
+        .sorted = sorted[s],
+        .index_n = cols[s] && has_lookup_index(cols[s]) ? cols[s]->num_elements : 0};
+  }
+  JoinPlan plan = plan_join(&stats[0], &stats[1], join_memory_budget);
+
+  char costs[256];
+  size_t length = 0;
+  for (int a = 0; a < JOIN_ALGO_COUNT && length < sizeof(costs); a++) {
+    double cost = plan.costs[a];
+    length += isinf(cost) ? snprintf(costs + length, sizeof(costs) - length, " %s -",
+                                     join_algorithm_name((JoinAlgorithm)a))
+                          : snprintf(costs + length, sizeof(costs) - length, " %s %.3f",
+                                     join_algorithm_name((JoinAlgorithm)a), cost / 1e6);
+  }
+  int sided = plan.algorithm == JOIN_ALGO_HASH ||
+              plan.algorithm == JOIN_ALGO_INDEX_NESTED_LOOP;
+  log_perf("auto join: %s%s; %zu x %zu tuples, ~%zu x ~%zu distinct, sorted %d/%d, "
+           "indexed %zu/%zu, ~%.0f results; est. ms:%s\n",
+           join_algorithm_name(plan.algorithm),
+           !sided ? "" : plan.build_side ? " on the right side" : " on the left side",
+           stats[0].n, stats[1].n, stats[0].distinct, stats[1].distinct, sorted[0],
+           sorted[1], stats[0].index_n, stats[1].index_n, plan.output, costs);
+
+  int b = plan.build_side, p = !b;
+  switch (plan.algorithm) {
+    case JOIN_ALGO_NESTED_LOOP:
+      exec_nested_loop_join(pool, psn[0], psn[1], vals[0], vals[1], resL, resR);
+      break;
+    case JOIN_ALGO_HASH:
+      exec_table_hash_join(pool, psn[b], psn[p], vals[b], vals[p], res[b], res[p],
+                           stats[b].distinct);
+      break;
+    case JOIN_ALGO_RADIX:
+      exec_hash_join(pool, psn[0], psn[1], vals[0], vals[1], resL, resR);
+      break;
+    case JOIN_ALGO_GRACE:
+      exec_grace_hash_join(pool, psn[0], psn[1], vals[0], vals[1], resL, resR);
+      break;
+    case JOIN_ALGO_SORT_MERGE:
+      exec_sort_merge_join(pool, psn[0], psn[1], vals[0], vals[1], sorted[0], sorted[1],
+                           resL, resR);
+      break;
+    case JOIN_ALGO_INDEX_NESTED_LOOP:
+      exec_index_nested_loop_join(pool, psn[b], cols[b], psn[p], vals[p], res[b], res[p]);
+      break;
+    default:
+      log_err("exec_auto_join: no plan for the join\n");
+  }
 }
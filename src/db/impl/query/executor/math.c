@@ -13,6 +13,13 @@ void exec_aggr(DbOperator *query, message *send_message) {
   AggregateOperator *aggr_op = &query->operator_fields.aggregate_operator;
   Column *col = aggr_op->col;
 
+  // A deferred fetch gets its stats from one fused select-fetch-aggregate pass
+  if (is_deferred_fetch(col) && pipeline_stats(col) != 0) {
+    handle_error(send_message, "Failed to evaluate the fetch to aggregate\n");
+    log_err("L%d in handle_aggr: %s\n", __LINE__, send_message->payload);
+    return;
+  }
+
   // Create a new Column to store the result
   Column *res_col;
   if (create_new_handle(aggr_op->res_handle, &res_col) != 0) {
@@ -48,65 +55,241 @@ void exec_aggr(DbOperator *query, message *send_message) {
   send_message->length = strlen(send_message->payload);
 }
 
+// Shared by every morsel of an arithmetic op; each morsel fills its slice of `out` and
+// folds its values into the stats of the worker running it
+typedef struct {
+  ArithOp op;
+  ArithOperand lhs;
+  ArithOperand rhs;
+  int *out;
+  ValueStats *stats;
+  int *failed;
+} ArithmeticArgs;
+
+// The rows [start, ...) of an operand; a constant is the same in every row
+static inline ArithOperand operand_slice(ArithOperand operand, size_t start) {
+  if (operand.values) operand.values += start;
+  return operand;
+}
+
+static void arithmetic_morsel(void *args, size_t worker, size_t morsel, size_t start,
+                              size_t end) {
+  (void)morsel;
+  ArithmeticArgs *arith_args = (ArithmeticArgs *)args;
+  if (simd_arith(arith_args->op, operand_slice(arith_args->lhs, start),
+                 operand_slice(arith_args->rhs, start), end - start,
+                 arith_args->out + start, &arith_args->stats[worker]) != 0) {
+    arith_args->failed[worker] = 1;
+  }
+}
+
+// Reads a column or handle operand, or its constant if `col` is NULL
+static ArithOperand arith_operand(const Column *col, int constant) {
+  return (ArithOperand){.values = col ? (const int *)col->data : NULL,
+                        .constant = constant};
+}
+
 void exec_arithmetic(DbOperator *query, message *send_message) {
-  Column *col1 = query->operator_fields.arithmetic_operator.col1;
-  Column *col2 = query->operator_fields.arithmetic_operator.col2;
-  cs165_log(stdout, "Executing arithmetic on columns: %s, %s\n", col1->name, col2->name);
+  ArithmeticOperator *arith_op = &query->operator_fields.arithmetic_operator;
+  Column *col1 = arith_op->col1;
+  Column *col2 = arith_op->col2;
+  // At least one operand is a column (see parse_arithmetic); it sets the row count
+  Column *rows_col = col1 ? col1 : col2;
+  cs165_log(stdout, "Executing arithmetic on columns: %s, %s\n",
+            col1 ? col1->name : "(constant)", col2 ? col2->name : "(constant)");
 
-  //   We currently only support ADD and SUB over integer columns
-  if (col1->data_type != INT || col2->data_type != INT) {
+  //   We currently only support arithmetic over integer columns
+  if ((col1 && col1->data_type != INT) || (col2 && col2->data_type != INT)) {
     handle_error(send_message,
                  "Arithmetic operations are only supported on integer columns");
     log_err("L%d in handle_arithmetic: %s\n", __LINE__, send_message->payload);
+    return;
+  }
+  if (col1 && col2 && col1->num_elements != col2->num_elements) {
+    handle_error(send_message, "Arithmetic operands differ in length");
+    log_err("L%d in handle_arithmetic: %s\n", __LINE__, send_message->payload);
+    return;
+  }
+  ArithOp op;
+  switch (query->type) {
+    case ADD:
+      op = ARITH_ADD;
+      break;
+    case SUB:
+      op = ARITH_SUB;
+      break;
+    case MUL:
+      op = ARITH_MUL;
+      break;
+    case DIV:
+      op = ARITH_DIV;
+      break;
+    default:
+      handle_error(send_message, "Unsupported arithmetic operation");
+      log_err("L%d in handle_arithmetic: %s\n", __LINE__, send_message->payload);
+      return;
   }
 
   // Create a new Column to store the result
   Column *res_col;
-  if (create_new_handle(query->operator_fields.arithmetic_operator.res_handle,
-                        &res_col) != 0) {
+  if (create_new_handle(arith_op->res_handle, &res_col) != 0) {
     handle_error(send_message, "Failed to create new handle\n");
     log_err("L%d in handle_arithmetic: %s\n", __LINE__, send_message->payload);
+    return;
   }
-
-  res_col->data = malloc(col1->num_elements * sizeof(int));
+  size_t num_rows = rows_col->num_elements;
+  res_col->data_type = INT;
+  res_col->data = malloc(num_rows * sizeof(int));
   if (!res_col->data) {
-    free(res_col);
     handle_error(send_message, "Failed to allocate memory for result data");
+    log_err("L%d in handle_arithmetic: %s\n", __LINE__, send_message->payload);
+    return;
   }
   //   initialize stats
   res_col->min_value = INT_MAX;
   res_col->max_value = INT_MIN;
   res_col->sum = 0;
 
-  // Perform the arithmetic operation
-  if (query->type == ADD) {
-    for (size_t i = 0; i < col1->num_elements; i++) {
-      ((int *)res_col->data)[i] = ((int *)col1->data)[i] + ((int *)col2->data)[i];
-      int val = ((int *)res_col->data)[i];
+  // Perform the arithmetic operation with the SIMD kernels, in morsels on the worker
+  // pool for large columns
+  ThreadPool *pool = executor_pool(query, num_rows);
+  size_t n_workers = threadpool_morsel_workers(pool);
+  ValueStats stats[n_workers];
+  int failed[n_workers];
+  for (size_t w = 0; w < n_workers; w++) {
+    stats[w] = (ValueStats){.sum = 0, .min = INT_MAX, .max = INT_MIN};
+    failed[w] = 0;
+  }
+
+  ArithmeticArgs arith_args = {.op = op,
+                               .lhs = arith_operand(col1, arith_op->constant1),
+                               .rhs = arith_operand(col2, arith_op->constant2),
+                               .out = (int *)res_col->data,
+                               .stats = stats,
+                               .failed = failed};
+  threadpool_parallel_morsels(pool, num_rows, MORSEL_SIZE, arithmetic_morsel,
+                              &arith_args);
 
-      res_col->sum += val;
-      res_col->min_value = val < res_col->min_value ? val : res_col->min_value;
-      res_col->max_value = val > res_col->max_value ? val : res_col->max_value;
+  for (size_t w = 0; w < n_workers; w++) {
+    if (failed[w]) {
+      // The handle stays, empty, so that later queries do not read a partial result
+      free(res_col->data);
+      res_col->data = NULL;
+      handle_error(send_message, "Division by zero");
+      log_err("L%d in handle_arithmetic: %s\n", __LINE__, send_message->payload);
+      return;
     }
-  } else if (query->type == SUB) {
-    for (size_t i = 0; i < col1->num_elements; i++) {
-      ((int *)res_col->data)[i] = ((int *)col1->data)[i] - ((int *)col2->data)[i];
-      int val = ((int *)res_col->data)[i];
-      // TODO: for maintainability, consider refactoring this in
-      res_col->sum += val;
-      res_col->min_value = val < res_col->min_value ? val : res_col->min_value;
-      res_col->max_value = val > res_col->max_value ? val : res_col->max_value;
+    res_col->sum += stats[w].sum;
+    res_col->min_value = stats[w].min < res_col->min_value ? stats[w].min
+                                                           : res_col->min_value;
+    res_col->max_value = stats[w].max > res_col->max_value ? stats[w].max
+                                                           : res_col->max_value;
+  }
+
+  res_col->num_elements = num_rows;
+  send_message->status = OK_DONE;
+  send_message->payload = "Done";
+  send_message->length = strlen(send_message->payload);
+  log_info("Arithmetic operation completed for %s, with result stored in %s\n",
+           rows_col->name, res_col->name);
+}
+
+// Shared by every morsel of an expression; each morsel evaluates its rows of the
+// expression into its slice of `out`, folding them into the stats of its worker
+typedef struct {
+  const ExprStep *steps;
+  size_t num_steps;
+  int *out;
+  ValueStats *stats;
+  int *failed;
+} ExprArgs;
+
+static void expr_morsel(void *args, size_t worker, size_t morsel, size_t start,
+                        size_t end) {
+  (void)morsel;
+  ExprArgs *expr_args = (ExprArgs *)args;
+  if (expr_eval(expr_args->steps, expr_args->num_steps, start, end - start,
+                expr_args->out + start, &expr_args->stats[worker]) != 0) {
+    expr_args->failed[worker] = 1;
+  }
+}
+
+void exec_expr(DbOperator *query, message *send_message) {
+  ExprOperator *expr_op = &query->operator_fields.expr_operator;
+  cs165_log(stdout, "Executing expr of %zu steps into %s\n", expr_op->num_steps,
+            expr_op->res_handle);
+
+  // Point the steps at their columns, which all set the row count (see parse_expr)
+  Column *rows_col = NULL;
+  for (size_t i = 0; i < expr_op->num_steps; i++) {
+    Column *col = expr_op->cols[i];
+    if (!col) continue;
+    if (col->data_type != INT) {
+      handle_error(send_message,
+                   "Arithmetic operations are only supported on integer columns");
+      log_err("L%d in exec_expr: %s\n", __LINE__, send_message->payload);
+      return;
     }
-  } else {
-    handle_error(send_message, "Unsupported arithmetic operation");
-    log_err("L%d in handle_arithmetic: %s\n", __LINE__, send_message->payload);
+    if (rows_col && col->num_elements != rows_col->num_elements) {
+      handle_error(send_message, "Arithmetic operands differ in length");
+      log_err("L%d in exec_expr: %s\n", __LINE__, send_message->payload);
+      return;
+    }
+    rows_col = col;
+    expr_op->steps[i].values = (const int *)col->data;
   }
+  size_t num_rows = rows_col->num_elements;
 
+  Column *res_col;
+  if (create_new_handle(expr_op->res_handle, &res_col) != 0) {
+    handle_error(send_message, "Failed to create new handle\n");
+    log_err("L%d in exec_expr: %s\n", __LINE__, send_message->payload);
+    return;
+  }
   res_col->data_type = INT;
-  res_col->num_elements = col1->num_elements;
+  res_col->data = malloc(num_rows * sizeof(int));
+  if (!res_col->data) {
+    handle_error(send_message, "Failed to allocate memory for result data");
+    log_err("L%d in exec_expr: %s\n", __LINE__, send_message->payload);
+    return;
+  }
+  res_col->min_value = INT_MAX;
+  res_col->max_value = INT_MIN;
+  res_col->sum = 0;
+
+  ThreadPool *pool = executor_pool(query, num_rows);
+  size_t n_workers = threadpool_morsel_workers(pool);
+  ValueStats stats[n_workers];
+  int failed[n_workers];
+  for (size_t w = 0; w < n_workers; w++) {
+    stats[w] = (ValueStats){.sum = 0, .min = INT_MAX, .max = INT_MIN};
+    failed[w] = 0;
+  }
+  ExprArgs expr_args = {.steps = expr_op->steps,
+                        .num_steps = expr_op->num_steps,
+                        .out = (int *)res_col->data,
+                        .stats = stats,
+                        .failed = failed};
+  threadpool_parallel_morsels(pool, num_rows, MORSEL_SIZE, expr_morsel, &expr_args);
+
+  for (size_t w = 0; w < n_workers; w++) {
+    if (failed[w]) {
+      free(res_col->data);
+      res_col->data = NULL;
+      handle_error(send_message, "Division by zero");
+      log_err("L%d in exec_expr: %s\n", __LINE__, send_message->payload);
+      return;
+    }
+    res_col->sum += stats[w].sum;
+    res_col->min_value = stats[w].min < res_col->min_value ? stats[w].min
+                                                           : res_col->min_value;
+    res_col->max_value = stats[w].max > res_col->max_value ? stats[w].max
+                                                           : res_col->max_value;
+  }
+
+  res_col->num_elements = num_rows;
   send_message->status = OK_DONE;
   send_message->payload = "Done";
   send_message->length = strlen(send_message->payload);
-  log_info("Arithmetic operation completed for %s, with result stored in %s\n",
-           col1->name, res_col->name);
+  log_info("Expression evaluated into %s\n", res_col->name);
 }
@@ -0,0 +1,218 @@
+#include <limits.h>
+#include <string.h>
+
+#include "client_context.h"
+#include "query_exec.h"
+#include "utils.h"
+
+// Rows per vector of the fused pipeline: a vector's positions and the values fetched for
+// them stay in L1 between the select, fetch and aggregate stages
+#define PIPELINE_VECTOR_SIZE 1024
+
+/**
+ * @brief The operator that fills a deferred handle: a copy of its select or fetch. A
+ * fetch reads the select result `source`, which may itself still be deferred. Once
+ * `has_stats` is set, the handle's num_elements/sum/min/max are final even though its
+ * data has not been materialized.
+ */
+typedef struct PendingOp {
+  DbOperator query;
+  Column *source;
+  int has_stats;
+} PendingOp;
+
+// Shared by every morsel of a fused select -> fetch -> aggregate pass. The qualifying
+// positions come either from scanning `data` with `pred` (a deferred select), or from
+// `range` (an index range select). Each morsel folds the values of `values` at those
+// positions into the stats of the worker running it.
+typedef struct {
+  const int *data;
+  ScanPredicate pred;
+  const ZoneMap *zones;  // zone map of `data`, or NULL
+  const PositionRange *range;
+  const int *values;
+  size_t *counts;
+  ValueStats *stats;
+} PipelineArgs;
+
+static PendingOp *pending_create(DbOperator *query, Column *source) {
+  PendingOp *op = malloc(sizeof(PendingOp));
+  if (!op) {
+    log_err("pending_create: failed to allocate a deferred operator\n");
+    return NULL;
+  }
+  op->query = *query;
+  op->source = source;
+  op->has_stats = 0;
+  return op;
+}
+
+int defer_select(DbOperator *query, Column *result) {
+  Comparator *comparator = query->operator_fields.select_operator.comparator;
+  Column *column = comparator->col;
+  // Selects over prior results read handles that may change meaning, and index range
+  // selects are already free; only plain scans are worth deferring
+  if (comparator->ref_posns || comparator->ref_bitmap || column->pending) return 0;
+  if (column->index && column->index->idx_type != NONE) return 0;
+
+  result->pending = pending_create(query, NULL);
+  return result->pending != NULL;
+}
+
+int defer_fetch(DbOperator *query, Column *positions, Column *result) {
+  if (query->operator_fields.fetch_operator.col->data_type != INT) return 0;
+  int deferred_select = positions->pending && positions->pending->query.type == SELECT;
+  if (!deferred_select && !positions->range.col) return 0;
+
+  result->pending = pending_create(query, positions);
+  return result->pending != NULL;
+}
+
+int is_deferred_fetch(const Column *handle) {
+  return handle->pending && handle->pending->query.type == FETCH;
+}
+
+int is_sorted_fetch(Column *handle) {
+  if (!handle || !is_deferred_fetch(handle)) return 0;
+  PendingOp *op = handle->pending;
+  if (exec_pending(op->source) != 0) return 0;
+  Column *col = op->query.operator_fields.fetch_operator.col;
+  return op->source->range.col && op->source->range.col == col;
+}
+
+Column *fetched_column(const Column *handle, const Column *positions) {
+  if (!handle || !is_deferred_fetch(handle) || handle->pending->source != positions) {
+    return NULL;
+  }
+  return handle->pending->query.operator_fields.fetch_operator.col;
+}
+
+int exec_pending(Column *handle) {
+  if (!handle || !handle->pending) return 0;
+  PendingOp *op = handle->pending;
+  handle->pending = NULL;
+
+  message send_message = {.status = OK_WAIT_FOR_RESPONSE, .length = 0, .payload = NULL};
+  if (op->query.type == SELECT) {
+    select_into(&op->query, handle, &send_message);
+  } else if (exec_pending(op->source) == 0) {
+    fetch_into(&op->query, op->source, handle, &send_message);
+  }
+  free(op);
+  if (send_message.status != OK_DONE) {
+    log_err("exec_pending: failed to run the deferred operator of %s\n", handle->name);
+    return -1;
+  }
+  return 0;
+}
+
+void exec_all_pending(ClientContext *context) {
+  if (!context) return;
+  for (int i = 0; i < context->chandles_in_use; i++) {
+    exec_pending(&context->chandle_table[i]);
+  }
+}
+
+static void pipeline_morsel(void *args, size_t worker, size_t morsel, size_t start,
+                            size_t end) {
+  (void)morsel;
+  PipelineArgs *pipeline_args = (PipelineArgs *)args;
+  const PositionRange *range = pipeline_args->range;
+  const int *values = pipeline_args->values;
+  ValueStats *stats = &pipeline_args->stats[worker];
+  int positions[PIPELINE_VECTOR_SIZE];
+
+  size_t count = 0;
+  for (size_t v = start; v < end; v += PIPELINE_VECTOR_SIZE) {
+    size_t v_end = v + PIPELINE_VECTOR_SIZE < end ? v + PIPELINE_VECTOR_SIZE : end;
+
+    // A clustered range is a run of the fetched column: no positions at all
+    if (!pipeline_args->data && range->clustered) {
+      simd_copy(values + range->start + v, v_end - v, NULL, stats);
+      count += v_end - v;
+      continue;
+    }
+
+    const int *vector_positions;
+    size_t k;
+    if (pipeline_args->data) {
+      const ScanPredicate *pred = &pipeline_args->pred;
+      if (pipeline_args->zones &&
+          !zonemap_range_may_match(pipeline_args->zones, v, v_end, pred->low,
+                                   pred->high)) {
+        continue;
+      }
+      k = simd_select(pipeline_args->data + v, v_end - v, pred, NULL, v, positions);
+      vector_positions = positions;
+    } else {
+      k = v_end - v;
+      vector_positions = range->col->index->positions + range->start + v;
+    }
+    simd_gather(values, vector_positions, k, NULL, stats);
+    count += k;
+  }
+  pipeline_args->counts[worker] += count;
+}
+
+/**
+ * @brief Computes the stats of a deferred fetch in one pass over its select: each vector
+ * of qualifying positions is fetched and aggregated while still in cache, so neither the
+ * select nor the fetch result is ever materialized.
+ */
+int pipeline_stats(Column *handle) {
+  PendingOp *op = handle->pending;
+  if (op->has_stats) return 0;
+
+  // The select may have been materialized since (e.g. printed); then the plain fetch is
+  // as cheap as the pipeline
+  Column *positions = op->source;
+  if (!positions->pending && !positions->range.col) return exec_pending(handle);
+
+  PipelineArgs pipeline_args = {
+      .values = (const int *)op->query.operator_fields.fetch_operator.col->data};
+  size_t num_rows;
+  if (positions->pending) {
+    Comparator *comparator =
+        positions->pending->query.operator_fields.select_operator.comparator;
+    pipeline_args.data = (const int *)comparator->col->data;
+    pipeline_args.pred = comparator_predicate(comparator);
+    pipeline_args.zones = comparator->col->zones;
+    num_rows =
+        pipeline_args.pred.shape == SCAN_NONE ? 0 : comparator->col->num_elements;
+  } else {
+    pipeline_args.range = &positions->range;
+    num_rows = positions->num_elements;
+  }
+
+  ThreadPool *pool = executor_pool(&op->query, num_rows);
+  size_t n_workers = threadpool_morsel_workers(pool);
+  size_t counts[n_workers];
+  ValueStats stats[n_workers];
+  for (size_t w = 0; w < n_workers; w++) {
+    counts[w] = 0;
+    stats[w] = (ValueStats){.sum = 0, .min = INT_MAX, .max = INT_MIN};
+  }
+  pipeline_args.counts = counts;
+  pipeline_args.stats = stats;
+  threadpool_parallel_morsels(pool, num_rows, MORSEL_SIZE, pipeline_morsel,
+                              &pipeline_args);
+
+  size_t count = 0;
+  long sum = 0;
+  int min_value = INT_MAX, max_value = INT_MIN;
+  for (size_t w = 0; w < n_workers; w++) {
+    count += counts[w];
+    sum += stats[w].sum;
+    if (stats[w].min < min_value) min_value = stats[w].min;
+    if (stats[w].max > max_value) max_value = stats[w].max;
+  }
+  // Same stats as a materialized fetch, which leaves them zero when nothing qualifies
+  handle->num_elements = count;
+  handle->sum = sum;
+  handle->min_value = count ? min_value : 0;
+  handle->max_value = count ? max_value : 0;
+  op->has_stats = 1;
+  log_perf("pipeline: aggregated %zu of %zu rows without materializing\n", count,
+           num_rows);
+  return 0;
+}
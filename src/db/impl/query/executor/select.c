@@ -1,3 +1,4 @@
+#include <limits.h>
 #include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -12,44 +13,54 @@
 #include "optimizer.h"
 #include "parse.h"
 #include "query_exec.h"
+#include "simd.h"
 #include "utils.h"
 #include "vector.h"
 
 #define BLOCK_SIZE 1024       // TODO: adjust based on L1 cache size
 #define TEMP_BUFFER_SIZE 256  // Size for temporary results
 
-// Define a structure to hold thread-specific results for each query
-typedef struct {
-  int **data;            // Array of result arrays, one per query
-  size_t *num_elements;  // Array of element counts, one per query
-} ThreadResultBuffer;
-
-// Define a structure to pass data to threads
+// Shared by every morsel of a multi-core select running on the worker pool. A morsel
+// writes its matches for query q into result_columns[q]->data at the morsel's own offset
+// (it can't produce more matches than values), recording how many it wrote; the slices
+// are then compacted in morsel order. Bitmap results need no compaction: morsels and
+// blocks start at multiples of 64, so each one owns whole words of the bitvector.
 typedef struct {
   const int *data;
-  size_t start_idx;
-  size_t end_idx;
   Comparator **comparators;
-  ThreadResultBuffer *thread_buffers;
+  ScanPredicate *predicates;  // comparators resolved to scan kernel shapes
+  Column **result_columns;
+  const ZoneMap *zones;   // zone map of `data`, or NULL
+  size_t *morsel_counts;  // [query][morsel]
+  size_t num_morsels;
   size_t num_queries;
 } ThreadArgs;
 
 // Function prototypes
 size_t select_values_singlecore(const int *data, size_t num_elements,
-                                Comparator *comparator, int *result_indices);
+                                Comparator *comparator, int *result_indices,
+                                const ZoneMap *zones);
 
 int batch_select_single_core(const int *data, size_t num_elements,
                              Comparator **comparators, Column **result_columns,
-                             size_t num_queries);
+                             size_t num_queries, const ZoneMap *zones);
 int batch_select_single_core_optimized(const int *data, size_t num_elements,
                                        Comparator **comparators, Column **result_columns,
-                                       size_t num_queries);
-int batch_select_multi_core(const int *data, size_t num_elements,
+                                       size_t num_queries, const ZoneMap *zones);
+int batch_select_multi_core(ThreadPool *pool, const int *data, size_t num_elements,
                             Comparator **comparators, Column **result_columns,
-                            size_t num_queries);
-
-void double_probe_select(Column *column, Comparator *comparator, Column *result,
-                         message *send_message);
+                            size_t num_queries, const ZoneMap *zones);
+
+static int select_index_range(Column *column, const ScanPredicate *pred,
+                              Column *result);
+static int select_cracked(Column *column, const ScanPredicate *pred, Column *result);
+static bool wants_bitmap_result(const Comparator *comparator, const ScanPredicate *pred);
+static size_t select_bitmap_singlecore(const int *data, size_t num_elements,
+                                       const ScanPredicate *pred, Bitvector *bitmap,
+                                       const ZoneMap *zones);
+static size_t select_over_bitmap(const int *vals, size_t num_elements,
+                                 const ScanPredicate *pred, const Bitvector *ref,
+                                 Column *result);
 
 /**
  * @brief exec_select
@@ -63,10 +74,6 @@ void double_probe_select(Column *column, Comparator *comparator, Column *result,
  */
 void exec_select(DbOperator *query, message *send_message) {
   SelectOperator *select_op = &query->operator_fields.select_operator;
-  Comparator *comparator = select_op->comparator;
-  Column *column = comparator->col;
-  size_t n_elts = column->num_elements;
-  int *data = (int *)column->data;
 
   // Create a new Column to store the result indices
   Column *result;
@@ -79,11 +86,65 @@ void exec_select(DbOperator *query, message *send_message) {
   }
   result->data_type = INT;  // Select returns an array of indices/integers
 
-  // Allocate memory for the result data
-  //   For simplicity, we will allocate the maximum possible size (for now).
+  // A plain scan is only run once its result is read; fetches and aggregates over it
+  // may never need it materialized (see pipeline.c)
+  if (defer_select(query, result)) {
+    send_message->status = OK_DONE;
+    send_message->payload = "Done";
+    send_message->length = strlen(send_message->payload);
+    return;
+  }
+  select_into(query, result, send_message);
+}
+
+/**
+ * @brief Runs the select `query` into the (empty) handle `result`.
+ */
+void select_into(DbOperator *query, Column *result, message *send_message) {
+  Comparator *comparator = query->operator_fields.select_operator.comparator;
+  Column *column = comparator->col;
+  size_t n_elts = column->num_elements;
+  int *data = (int *)column->data;
+
+  ScanPredicate pred = comparator_predicate(comparator);
+
+  //   Milestone 3: Index-based selection. Indexes are on catalog columns, so this only
+  //   applies to selects over a whole column, never over a prior result.
+  if (column->index && column->index->idx_type != NONE && !comparator->ref_posns &&
+      !comparator->ref_bitmap) {
+    int status = column->index->idx_type != CRACKED
+                     ? select_index_range(column, &pred, result)
+                     : select_cracked(column, &pred, result);
+    if (status != 0) {
+      log_err("exec_select: Failed to select through the index of %s\n", column->name);
+      send_message->status = EXECUTION_ERROR;
+      send_message->length = 0;
+      send_message->payload = NULL;
+      return;
+    }
+    send_message->status = OK_DONE;
+    send_message->payload = "Done";
+    send_message->length = strlen(send_message->payload);
+    return;
+  }
+
+  cs165_log(stdout, "exec_select: Starting to scan\n");
+
+  // Zone maps describe the column's own layout, so only a plain scan of it can use them
+  const ZoneMap *zones =
+      !comparator->ref_posns && !comparator->ref_bitmap ? column->zones : NULL;
+
+  // Allocate memory for the result data: a bitvector over the scanned column when
+  // enough rows are expected to qualify, else a position list of the maximum size.
   //   TODO: replace this with a dynamic array after implementing such a data structure.
-  result->data = malloc(sizeof(int) * n_elts);
-  if (!result->data) {
+  if (wants_bitmap_result(comparator, &pred)) {
+    result->bitmap = bitvector_create(comparator->ref_bitmap
+                                          ? comparator->ref_bitmap->num_bits
+                                          : column->num_elements);
+  } else {
+    result->data = malloc(sizeof(int) * n_elts);
+  }
+  if (!result->data && !result->bitmap) {
     log_err("exec_select: Failed to allocate memory for result data\n");
     send_message->status = EXECUTION_ERROR;
     send_message->length = 0;
@@ -91,36 +152,18 @@ void exec_select(DbOperator *query, message *send_message) {
     return;
   }
 
-  cs165_log(stdout, "exec_select: Starting to scan\n");
-
-  // ref_posns is used to store the original positions of the data, this is used in
-  // in the second type of `select()` query that receives results from fetch.
-  //   Since indexes are on catalog columns, this `ref_posns` must always be NULL.
-  int using_temp_ref_posns = 0;
-
-  if (column->index && column->index->idx_type != NONE && !comparator->ref_posns) {
-    //   Milestone 3: Index-based selection
-    // double_probe_select(column, comparator, result, send_message);
-    // return;
-
-    // Get offset: where to start scanning based on the low value
-    if (comparator->type1 == GREATER_THAN_OR_EQUAL &&
-        comparator->p_low >= column->min_value) {
-      // since low of query > min_value idx must be found
-      size_t start_idx = idx_lookup_left(column, comparator->p_low);
-      n_elts = column->num_elements - start_idx;
-      data = column->index->sorted_data + start_idx;
-      using_temp_ref_posns = 1;
-      comparator->ref_posns = column->index->positions + start_idx;
-      comparator->on_sorted_data = 1;
-    }
-  }
-
-  if (n_elts < NUM_ELEMENTS_TO_MULTITHREAD || query->context->is_single_core) {
+  ThreadPool *pool = executor_pool(query, n_elts);
+  if (comparator->ref_bitmap) {
+    // Values fetched through a bitmap result: walk them alongside its set bits
+    result->num_elements =
+        select_over_bitmap(data, n_elts, &pred, comparator->ref_bitmap, result);
+  } else if (!pool) {
     //   Milestone 1 : Single - core selection: to avoid the overhead of creating
     //   threads
     result->num_elements =
-        select_values_singlecore(data, n_elts, comparator, result->data);
+        result->bitmap
+            ? select_bitmap_singlecore(data, n_elts, &pred, result->bitmap, zones)
+            : select_values_singlecore(data, n_elts, comparator, result->data, zones);
     log_perf("\nqualifying range: [%ld, %ld]\n", comparator->p_low, comparator->p_high);
     log_perf("selectivity: %d/%zu = %.2f%%\n", result->num_elements, n_elts,
              (double)result->num_elements / n_elts * 100);
@@ -130,13 +173,12 @@ void exec_select(DbOperator *query, message *send_message) {
     comparators[0] = comparator;
     Column **result_columns = malloc(sizeof(Column *));
     result_columns[0] = result;
-    batch_select_multi_core(data, n_elts, comparators, result_columns, 1);
+    batch_select_multi_core(pool, data, n_elts, comparators, result_columns, 1, zones);
+    free(comparators);
+    free(result_columns);
   }
   log_info("exec_select: Selection operation completed successfully.\n");
 
-  //   Reset the temporary reference positions
-  if (using_temp_ref_posns) comparator->ref_posns = NULL;
-
   //   set send_message
   send_message->status = OK_DONE;
   send_message->payload = "Done";
@@ -193,16 +235,38 @@ void exec_batch_select(DbOperator *query, message *send_message) {
       return;
     }
 
+    comparators[i] = select_op->comparator;
+
+    // The batch kernels read prior results as position lists, so a bitmap one is
+    // listed out for the duration of the batch
+    if (comparators[i]->ref_bitmap) {
+      const Bitvector *ref = comparators[i]->ref_bitmap;
+      size_t num_posns = bitvector_count(ref);
+      if (num_posns < num_elements) num_posns = num_elements;
+      comparators[i]->ref_posns = calloc(num_posns + 1, sizeof(int));
+      if (comparators[i]->ref_posns) {
+        bitvector_positions(ref, 0, BITVECTOR_WORDS(ref->num_bits),
+                            comparators[i]->ref_posns);
+      }
+    }
+
     result_columns[i]->data_type = INT;
-    result_columns[i]->data = malloc(sizeof(int) * num_elements);
     result_columns[i]->num_elements = 0;
+    // Kernels index prior results by value, so only plain scans can fill a bitvector
+    ScanPredicate pred = comparator_predicate(comparators[i]);
+    if (!comparators[i]->ref_posns && wants_bitmap_result(comparators[i], &pred)) {
+      result_columns[i]->bitmap = bitvector_create(num_elements);
+    } else {
+      result_columns[i]->data = malloc(sizeof(int) * num_elements);
+    }
 
-    comparators[i] = select_op->comparator;
-
-    if (!result_columns[i]->data) {
+    if ((!result_columns[i]->data && !result_columns[i]->bitmap) ||
+        (comparators[i]->ref_bitmap && !comparators[i]->ref_posns)) {
       // Clean up on failure
       for (size_t j = 0; j <= i; j++) {
         free(result_columns[j]->data);
+        bitvector_free(result_columns[j]->bitmap);
+        if (comparators[j]->ref_bitmap) free(comparators[j]->ref_posns);
         free(result_columns[j]);
       }
       free(result_columns);
@@ -216,12 +280,20 @@ void exec_batch_select(DbOperator *query, message *send_message) {
 
   if (query->context->is_single_core) {
     batch_select_single_core((int *)source_column->data, num_elements, comparators,
-                             result_columns, num_queries);
+                             result_columns, num_queries, source_column->zones);
   } else {
-    batch_select_multi_core((int *)source_column->data, num_elements, comparators,
-                            result_columns, num_queries);
+    batch_select_multi_core(worker_pool, (int *)source_column->data, num_elements,
+                            comparators, result_columns, num_queries,
+                            source_column->zones);
   }
   // Clean up and set success message
+  for (size_t i = 0; i < num_queries; i++) {
+    if (comparators[i]->ref_bitmap) {
+      free(comparators[i]->ref_posns);
+      comparators[i]->ref_posns = NULL;
+    }
+  }
+  free(comparators);
   free(result_columns);
   vector_destroy(batch_queries);
   query->context->bselect_dbos = NULL;
@@ -272,23 +344,258 @@ bool should_include(int value, Comparator *comparator) {
   return false;
 }
 
-// Basic selection function (initial version)
+// Narrows the inclusive bounds [low, high] by one side of a comparator
+static void narrow_bounds(ComparatorType type, long int p, long int *low,
+                          long int *high) {
+  switch (type) {
+    case LESS_THAN:
+      if (p - 1 < *high) *high = p - 1;
+      break;
+    case LESS_THAN_OR_EQUAL:
+      if (p < *high) *high = p;
+      break;
+    case GREATER_THAN:
+      if (p + 1 > *low) *low = p + 1;
+      break;
+    case GREATER_THAN_OR_EQUAL:
+      if (p > *low) *low = p;
+      break;
+    case EQUAL:
+      if (p > *low) *low = p;
+      if (p < *high) *high = p;
+      break;
+    default:
+      break;
+  }
+}
+
+/**
+ * @brief Resolves a comparator to the scan kernel shape that evaluates it, so the
+ * comparator switch runs once per query instead of once per row.
+ * A comparator with no side set selects nothing, same as `should_include`.
+ */
+ScanPredicate comparator_predicate(const Comparator *comparator) {
+  if (comparator->type1 == NO_COMPARISON && comparator->type2 == NO_COMPARISON) {
+    return (ScanPredicate){SCAN_NONE, 0, 0};
+  }
+  long int low = LONG_MIN, high = LONG_MAX;
+  narrow_bounds(comparator->type1, comparator->p_low, &low, &high);
+  narrow_bounds(comparator->type2, comparator->p_high, &low, &high);
+  return scan_predicate(low, high);
+}
+
+/**
+ * @brief Index-based selection: two probes of the column's index bound the qualifying
+ * run of its sorted order, and the result is that run itself (see PositionRange), with
+ * no per-row work. On a clustered column the run is a run of base positions too. A
+ * btree holds its row ids in its leaves, so an unclustered run of one is copied out.
+ * @return 0 on success, -1 on failure
+ */
+static int select_index_range(Column *column, const ScanPredicate *pred,
+                              Column *result) {
+  int clustered = column->index->clustered;
+  size_t start = 0, end = 0;
+  if (column->root) {
+    BtreeCursor low = btree_end(), high = btree_end();
+    if (pred->shape != SCAN_NONE) {
+      low = btree_lower_bound(column->root, pred->low);
+      high = btree_upper_bound(column->root, pred->high);
+    }
+    if (clustered) {
+      start = btree_cursor_rowid(column->root, low);
+      end = btree_cursor_rowid(column->root, high);
+    } else {
+      size_t count = btree_range_count(column->root, low, high);
+      result->data = malloc(sizeof(int) * (count + 1));
+      if (!result->data) return -1;
+      result->num_elements =
+          btree_range_copy(column->root, low, high, NULL, (int *)result->data);
+      log_perf("btree: %zu of %zu, unclustered\n", count, column->num_elements);
+      return 0;
+    }
+  } else if (pred->shape != SCAN_NONE && column->num_elements > 0) {
+    start = idx_lower_bound(column, pred->low);
+    end = idx_upper_bound(column, pred->high);
+  }
+  if (end < start) end = start;
+  result->range = (PositionRange){column, start, end, clustered};
+  result->num_elements = end - start;
+  log_perf("index range: [%zu, %zu) of %zu, %s\n", start, end, column->num_elements,
+           clustered ? "clustered" : "unclustered");
+  return 0;
+}
+
+/**
+ * @brief Adaptive index selection: cracks the column's cracker column on the predicate's
+ * bounds (building it on first use) and copies out the qualifying positions. Unlike an
+ * index range, the result can't point into the cracker column, as later selects reorder
+ * the positions within it.
+ * @return 0 on success, -1 on failure
+ */
+static int select_cracked(Column *column, const ScanPredicate *pred, Column *result) {
+  ColumnIndex *index = column->index;
+  if (!index->cracker) {
+    index->cracker = cracker_create((int *)column->data, column->num_elements);
+    if (!index->cracker) return -1;
+  }
+
+  size_t start = 0, end = 0;
+  if (pred->shape != SCAN_NONE) {
+    cracker_select(index->cracker, pred->low, pred->high, &start, &end);
+  }
+  result->data = malloc(sizeof(int) * (end - start + 1));
+  if (!result->data) return -1;
+  memcpy(result->data, index->cracker->positions + start, sizeof(int) * (end - start));
+  result->num_elements = end - start;
+  log_perf("cracker: [%zu, %zu) of %zu, %zu pieces\n", start, end, column->num_elements,
+           index->cracker->num_pivots + 1);
+  return 0;
+}
+
+/**
+ * @brief Estimates the fraction of the comparator's column that qualifies, assuming
+ * values spread evenly over the column's [min, max].
+ */
+static double estimate_selectivity(const Column *column, const ScanPredicate *pred) {
+  if (pred->shape == SCAN_NONE || column->num_elements == 0 ||
+      column->min_value > column->max_value) {
+    return 0;
+  }
+  double low = pred->low > column->min_value ? pred->low : column->min_value;
+  double high = pred->high < column->max_value ? pred->high : column->max_value;
+  if (low > high) return 0;
+  return (high - low + 1) / ((double)column->max_value - column->min_value + 1);
+}
+
+/**
+ * @brief Whether a select should produce a bitvector rather than a position list. A
+ * bitvector spans the whole scanned column, so it only pays off once the estimated
+ * matches are dense enough in it (see BITMAP_RESULT_SELECTIVITY). Selects over a prior
+ * position list can't produce one: the column those positions refer to is unknown.
+ */
+static bool wants_bitmap_result(const Comparator *comparator, const ScanPredicate *pred) {
+  if (comparator->ref_posns && !comparator->ref_bitmap) return false;
+  Column *column = comparator->col;
+  size_t num_bits =
+      comparator->ref_bitmap ? comparator->ref_bitmap->num_bits : column->num_elements;
+  if (num_bits == 0) return false;
+  double expected = estimate_selectivity(column, pred) * column->num_elements;
+  return expected >= BITMAP_RESULT_SELECTIVITY * num_bits;
+}
+
+/**
+ * @brief Single-core selection into a bitvector: the vectorized bitmap kernel writes
+ * one word per 64 values. With `zones`, zones that cannot qualify are left clear.
+ */
+static size_t select_bitmap_singlecore(const int *data, size_t num_elements,
+                                       const ScanPredicate *pred, Bitvector *bitmap,
+                                       const ZoneMap *zones) {
+  // Skipping needs every zone to start on a word boundary
+  if (!zones || zones->zone_size % 64 != 0 || pred->shape == SCAN_NONE) {
+    return simd_select_bitmap(data, num_elements, pred, bitmap->words);
+  }
+
+  size_t count = 0, skipped = 0;
+  for (size_t start = 0; start < num_elements; start += zones->zone_size) {
+    size_t end =
+        start + zones->zone_size < num_elements ? start + zones->zone_size : num_elements;
+    if (!zonemap_range_may_match(zones, start, end, pred->low, pred->high)) {
+      skipped++;
+      continue;
+    }
+    count +=
+        simd_select_bitmap(data + start, end - start, pred, bitmap->words + start / 64);
+  }
+  log_perf("zone maps: skipped %zu/%zu zones\n", skipped, zones->num_zones);
+  return count;
+}
+
+/**
+ * @brief Selects over values fetched through a bitmap result, where `vals[j]` belongs to
+ * the j-th set position of `ref`. The qualifying positions go to `result` as a bitvector
+ * over the same column if it has one, else as a position list.
+ */
+static size_t select_over_bitmap(const int *vals, size_t num_elements,
+                                 const ScanPredicate *pred, const Bitvector *ref,
+                                 Column *result) {
+  int *positions = (int *)result->data;
+  size_t num_words = BITVECTOR_WORDS(ref->num_bits);
+  size_t j = 0, k = 0;
+  for (size_t w = 0; w < num_words; w++) {
+    uint64_t bits = ref->words[w], keep = 0;
+    for (; bits && j < num_elements; bits &= bits - 1) {
+      int x = vals[j++];
+      uint64_t match = pred->shape != SCAN_NONE && x >= pred->low && x <= pred->high;
+      keep |= match << __builtin_ctzll(bits);
+    }
+
+    if (result->bitmap) {
+      result->bitmap->words[w] = keep;
+      k += __builtin_popcountll(keep);
+    } else {
+      for (; keep; keep &= keep - 1) {
+        positions[k++] = (int)(w * 64 + __builtin_ctzll(keep));
+      }
+    }
+  }
+  return k;
+}
+
+// Whether query `comparator` may match any value in [start, end) of the zone-mapped data
+static inline bool block_may_match(const ZoneMap *zones, const Comparator *comparator,
+                                   const ScanPredicate *pred, size_t start, size_t end) {
+  if (!zones || comparator->ref_posns) return true;
+  return zonemap_range_may_match(zones, start, end, pred->low, pred->high);
+}
+
+/**
+ * @brief Runs the scan kernel over the runs of consecutive zones that may hold
+ * qualifying values, skipping the rest of the column.
+ */
+static size_t select_zones(const int *data, size_t num_elements,
+                           const ScanPredicate *pred, const ZoneMap *zones,
+                           int *result_indices) {
+  size_t k = 0, run_start = 0, run_end = 0, skipped = 0;
+  for (size_t start = 0; start < num_elements; start += zones->zone_size) {
+    size_t end =
+        start + zones->zone_size < num_elements ? start + zones->zone_size : num_elements;
+    if (!zonemap_range_may_match(zones, start, end, pred->low, pred->high)) {
+      skipped++;
+      continue;
+    }
+    // A skipped gap ends the current run
+    if (start != run_end) {
+      k += simd_select(data + run_start, run_end - run_start, pred, NULL, run_start,
+                       result_indices + k);
+      run_start = start;
+    }
+    run_end = end;
+  }
+  k += simd_select(data + run_start, run_end - run_start, pred, NULL, run_start,
+                   result_indices + k);
+  log_perf("zone maps: skipped %zu/%zu zones\n", skipped, zones->num_zones);
+  return k;
+}
+
+/**
+ * @brief Single-core selection: one pass of the vectorized scan kernel for the
+ * comparator's shape (see simd.h), which writes qualifying positions branch-free.
+ * With `zones` (the zone map of `data`), only zones that may qualify are scanned.
+ */
 size_t select_values_singlecore(const int *data, size_t num_elements,
-                                Comparator *comparator, int *result_indices) {
+                                Comparator *comparator, int *result_indices,
+                                const ZoneMap *zones) {
   if (result_indices == NULL) {
     log_err("select_values_basic: result_indices is NULL\n");
     return -1;
   }
-  int *ref_posns = comparator->ref_posns;
-  int can_terminate = comparator->on_sorted_data && comparator->p_high;
+  ScanPredicate pred = comparator_predicate(comparator);
 
-  size_t result_count = 0;
-  for (size_t i = 0; i < num_elements; i += 1) {
-    if (can_terminate && comparator->p_high < data[i]) break;
-    if (should_include(data[i], comparator)) {
-      result_indices[result_count++] = ref_posns ? (size_t)ref_posns[i] : i;
-    }
-  }
+  size_t result_count =
+      zones && !comparator->ref_posns && pred.shape != SCAN_NONE
+          ? select_zones(data, num_elements, &pred, zones, result_indices)
+          : simd_select(data, num_elements, &pred, comparator->ref_posns, 0,
+                        result_indices);
   log_info("select_values_basic: Found %zu matching elements out of %zu\n", result_count,
            num_elements);
   return result_count;
@@ -296,7 +603,7 @@ size_t select_values_singlecore(const int *data, size_t num_elements,
 
 int batch_select_single_core(const int *data, size_t num_elements,
                              Comparator **comparators, Column **result_columns,
-                             size_t num_queries) {
+                             size_t num_queries, const ZoneMap *zones) {
   //   if (!data || !comparators || !result_columns) {
   //     log_err("batch_select_with_one_pass: Invalid input\n");
   //     return -1;
@@ -325,114 +632,104 @@ int batch_select_single_core(const int *data, size_t num_elements,
 
   // use optimized version
   return batch_select_single_core_optimized(data, num_elements, comparators,
-                                            result_columns, num_queries);
+                                            result_columns, num_queries, zones);
 }
 
-// Worker function for each thread
-void *thread_worker(void *args) {
+// Runs every query of a multi-core select over one morsel [start_idx, end_idx)
+static void thread_worker(void *args, size_t worker, size_t morsel, size_t start_idx,
+                          size_t end_idx) {
+  (void)worker;
   ThreadArgs *thread_args = (ThreadArgs *)args;
   const int *data = thread_args->data;
-  size_t start_idx = thread_args->start_idx;
-  size_t end_idx = thread_args->end_idx;
   Comparator **comparators = thread_args->comparators;
-  ThreadResultBuffer *thread_buffers = thread_args->thread_buffers;
+  ScanPredicate *predicates = thread_args->predicates;
   size_t num_queries = thread_args->num_queries;
 
-  // Initialize local buffers for this thread
-  for (size_t q = 0; q < num_queries; q++) {
-    thread_buffers->data[q] =
-        malloc(sizeof(int) * (end_idx - start_idx));  // Over-allocate
-    thread_buffers->num_elements[q] = 0;
-  }
+  size_t counts[num_queries];
+  for (size_t q = 0; q < num_queries; q++) counts[q] = 0;
 
-  for (size_t i = start_idx; i < end_idx; i++) {
-    int current_value = data[i];
+  // Scan the morsel one block at a time and run every query's kernel over a block while
+  // it is still in L1, so batched queries still share a single pass over the data.
+  for (size_t base_idx = start_idx; base_idx < end_idx; base_idx += BLOCK_SIZE) {
+    size_t block_size =
+        (end_idx - base_idx) < BLOCK_SIZE ? (end_idx - base_idx) : BLOCK_SIZE;
 
     for (size_t q = 0; q < num_queries; q++) {
-      Comparator *comparator = comparators[q];
-
-      if (should_include(current_value, comparator)) {
-        int *result_data = thread_buffers->data[q];
-        size_t curr_idx = thread_buffers->num_elements[q];
-
-        result_data[curr_idx] =
-            comparator->ref_posns ? (size_t)comparator->ref_posns[i] : i;
-
-        thread_buffers->num_elements[q]++;
+      if (!block_may_match(thread_args->zones, comparators[q], &predicates[q], base_idx,
+                           base_idx + block_size)) {
+        continue;
       }
+      Bitvector *bitmap = thread_args->result_columns[q]->bitmap;
+      if (bitmap) {
+        counts[q] += simd_select_bitmap(data + base_idx, block_size, &predicates[q],
+                                        bitmap->words + base_idx / 64);
+        continue;
+      }
+      const int *ref_posns = comparators[q]->ref_posns;
+      int *result_data =
+          (int *)thread_args->result_columns[q]->data + start_idx + counts[q];
+      counts[q] += simd_select(data + base_idx, block_size, &predicates[q],
+                               ref_posns ? ref_posns + base_idx : NULL, base_idx,
+                               result_data);
     }
   }
 
-  return NULL;
+  for (size_t q = 0; q < num_queries; q++) {
+    thread_args->morsel_counts[q * thread_args->num_morsels + morsel] = counts[q];
+  }
 }
 
-int batch_select_multi_core(const int *data, size_t num_elements,
+/**
+ * @brief Runs a batch of selects over `data` in morsels on the worker pool (inline if
+ * `pool` is NULL), skipping blocks that `zones` rules out for a query. Each result
+ * column's data must have room for `num_elements` values.
+ */
+int batch_select_multi_core(ThreadPool *pool, const int *data, size_t num_elements,
                             Comparator **comparators, Column **result_columns,
-                            size_t num_queries) {
+                            size_t num_queries, const ZoneMap *zones) {
   if (!data || !comparators || !result_columns) {
     log_err("batch_select_with_one_pass: Invalid input\n");
     return -1;
   }
 
-  // Get the number of available cores
-  size_t num_threads = sysconf(_SC_NPROCESSORS_ONLN);
-  pthread_t threads[num_threads];
-  ThreadArgs thread_args[num_threads];
-
-  // Allocate thread-local buffers
-  ThreadResultBuffer thread_buffers[num_threads];
-  for (size_t t = 0; t < num_threads; t++) {
-    thread_buffers[t].data = malloc(sizeof(int *) * num_queries);
-    thread_buffers[t].num_elements = malloc(sizeof(size_t) * num_queries);
-  }
-
-  // Determine chunk size
-  size_t chunk_size = (num_elements + num_threads - 1) / num_threads;
-
-  // Create threads
-  for (size_t t = 0; t < num_threads; t++) {
-    thread_args[t].data = data;
-    thread_args[t].start_idx = t * chunk_size;
-    thread_args[t].end_idx =
-        (t + 1) * chunk_size < num_elements ? (t + 1) * chunk_size : num_elements;
-    thread_args[t].comparators = comparators;
-    thread_args[t].thread_buffers = &thread_buffers[t];
-    thread_args[t].num_queries = num_queries;
-
-    if (pthread_create(&threads[t], NULL, thread_worker, &thread_args[t]) != 0) {
-      log_err("Error creating thread %zu\n", t);
-      return -1;
-    }
+  size_t num_morsels = threadpool_num_morsels(num_elements, MORSEL_SIZE);
+  size_t *morsel_counts = malloc(sizeof(size_t) * (num_queries * num_morsels + 1));
+  ScanPredicate *predicates = malloc(sizeof(ScanPredicate) * num_queries);
+  if (!morsel_counts || !predicates) {
+    log_err("batch_select_multi_core: Failed to allocate morsel bookkeeping\n");
+    free(morsel_counts);
+    free(predicates);
+    return -1;
   }
 
-  // Wait for threads to complete
-  for (size_t t = 0; t < num_threads; t++) {
-    pthread_join(threads[t], NULL);
+  // Resolve each query's comparator to its scan kernel once, shared by all morsels
+  for (size_t q = 0; q < num_queries; q++) {
+    predicates[q] = comparator_predicate(comparators[q]);
   }
 
-  // Merge thread-local buffers into global result_columns
+  ThreadArgs thread_args = {.data = data,
+                            .comparators = comparators,
+                            .predicates = predicates,
+                            .result_columns = result_columns,
+                            .zones = zones,
+                            .morsel_counts = morsel_counts,
+                            .num_morsels = num_morsels,
+                            .num_queries = num_queries};
+  threadpool_parallel_morsels(pool, num_elements, MORSEL_SIZE, thread_worker,
+                              &thread_args);
+
+  // Compact each query's morsel slices in morsel order. Slices only ever move towards
+  // the front, so this is safe in place.
   for (size_t q = 0; q < num_queries; q++) {
+    int *result_data = (int *)result_columns[q]->data;
     size_t total_elements = 0;
-
-    // Calculate total elements for this query
-    for (size_t t = 0; t < num_threads; t++) {
-      total_elements += thread_buffers[t].num_elements[q];
-    }
-
-    // Allocate enough space in the global result_columns
-    result_columns[q]->data =
-        realloc(result_columns[q]->data, sizeof(int) * total_elements);
-
-    // Copy data from each thread-local buffer
-    size_t offset = 0;
-    for (size_t t = 0; t < num_threads; t++) {
-      size_t num_elements = thread_buffers[t].num_elements[q];
-      memcpy((int *)result_columns[q]->data + offset, thread_buffers[t].data[q],
-             sizeof(int) * num_elements);
-      offset += num_elements;
-
-      // Free thread-local buffer
-      free(thread_buffers[t].data[q]);
+    for (size_t m = 0; m < num_morsels; m++) {
+      size_t count = morsel_counts[q * num_morsels + m];
+      if (count && !result_columns[q]->bitmap && total_elements != m * MORSEL_SIZE) {
+        memmove(result_data + total_elements, result_data + m * MORSEL_SIZE,
+                sizeof(int) * count);
+      }
+      total_elements += count;
     }
 
     log_perf("qualifying range: [%d, %d]\n", comparators[q]->p_low,
@@ -442,55 +739,12 @@ int batch_select_multi_core(const int *data, size_t num_elements,
     result_columns[q]->num_elements = total_elements;
   }
 
-  // Free thread-local buffer metadata
-  for (size_t t = 0; t < num_threads; t++) {
-    free(thread_buffers[t].data);
-    free(thread_buffers[t].num_elements);
-  }
+  free(morsel_counts);
+  free(predicates);
 
   return 0;
 }
 
-// Function to perform double-probe selection
-void double_probe_select(Column *column, Comparator *comparator, Column *result,
-                         message *send_message) {
-  // Get offset: where to start scanning based on the low value
-  if (comparator->p_high - 1 < column->min_value ||
-      comparator->p_low > column->max_value) {
-    //   if p_high is less than the min value, then no need to scan
-    result->num_elements = 0;
-    log_info("exec_select: No elements qualify the selection criteria\n");
-    send_message->status = OK_DONE;
-    send_message->payload = "Done";
-    send_message->length = strlen(send_message->payload);
-    return;
-  }
-
-  int has_low_and_high =
-      comparator->type1 == GREATER_THAN_OR_EQUAL && comparator->type2 == LESS_THAN;
-  if (has_low_and_high) {
-    // since low of query > min_value idx must be found
-    size_t start_idx = comparator->p_low <= column->min_value
-                           ? 0
-                           : idx_lookup_left(column, comparator->p_low);
-    size_t end_idx = comparator->p_high >= column->max_value
-                         ? column->num_elements - 1
-                         : idx_lookup_right(column, comparator->p_high - 1);
-    result->num_elements = end_idx - start_idx + 1;
-    result->data = malloc(sizeof(int) * result->num_elements);
-    memcpy(result->data, column->index->positions + start_idx,
-           sizeof(int) * result->num_elements);
-    log_info("p_low: %ld, p_high: %ld\n", comparator->p_low, comparator->p_high);
-    log_info("idx suggests l,r where sorted_data[%ld] = %d, sorted_data[%ld] = %d\n",
-             start_idx, column->index->sorted_data[start_idx], end_idx,
-             column->index->sorted_data[end_idx]);
-  }
-
-  send_message->status = OK_DONE;
-  send_message->payload = "Done";
-  send_message->length = strlen(send_message->payload);
-}
-
 // Bitmap to track matches for each query
 typedef struct {
   uint64_t bits[BLOCK_SIZE / 64];
@@ -500,26 +754,15 @@ static inline void clear_bitmap(QueryBitmap *bitmap) {
   memset(bitmap->bits, 0, sizeof(bitmap->bits));
 }
 
-// Efficiently mark matches in bitmap
-static inline void mark_matches_bitmap(const int *block_data, size_t block_size,
-                                       Comparator *comparator, QueryBitmap *bitmap) {
-  for (size_t i = 0; i < block_size; i++) {
-    int current_value = block_data[i];
-    if (should_include(current_value, comparator)) {
-      bitmap->bits[i / 64] |= (1ULL << (i % 64));
-    }
-  }
-}
-
 // Process matches using bitmap to reduce branching
 static void process_matches(const size_t block_size, size_t base_idx,
                             const QueryBitmap *bitmap, const int *ref_posns,
                             int *result_data, size_t *result_count) {
-  size_t temp_buffer[TEMP_BUFFER_SIZE];
+  int temp_buffer[TEMP_BUFFER_SIZE];
   size_t temp_count = 0;
 
-  // Process 64 bits at a time
-  for (size_t i = 0; i < block_size / 64; i++) {
+  // Process 64 bits at a time, including the partial word of a short last block
+  for (size_t i = 0; i < (block_size + 63) / 64; i++) {
     uint64_t mask = bitmap->bits[i];
     while (mask) {
       // Find next set bit
@@ -551,13 +794,21 @@ static void process_matches(const size_t block_size, size_t base_idx,
 
 int batch_select_single_core_optimized(const int *data, size_t num_elements,
                                        Comparator **comparators, Column **result_columns,
-                                       size_t num_queries) {
+                                       size_t num_queries, const ZoneMap *zones) {
   if (!data || !comparators || !result_columns) {
     return -1;
   }
 
   QueryBitmap *query_bitmaps = malloc(num_queries * sizeof(QueryBitmap));
-  if (!query_bitmaps) return -1;
+  ScanPredicate *predicates = malloc(num_queries * sizeof(ScanPredicate));
+  if (!query_bitmaps || !predicates) {
+    free(query_bitmaps);
+    free(predicates);
+    return -1;
+  }
+  for (size_t q = 0; q < num_queries; q++) {
+    predicates[q] = comparator_predicate(comparators[q]);
+  }
 
   // Process data in blocks
   for (size_t base_idx = 0; base_idx < num_elements; base_idx += BLOCK_SIZE) {
@@ -565,14 +816,23 @@ int batch_select_single_core_optimized(const int *data, size_t num_elements,
         (num_elements - base_idx) < BLOCK_SIZE ? (num_elements - base_idx) : BLOCK_SIZE;
     const int *block_data = &data[base_idx];
 
-    // First pass: Build bitmaps for all queries
+    // First pass: Build bitmaps for all queries, leaving them empty for queries the
+    // zone map rules out for this block. Bitmap results are built in place.
     for (size_t q = 0; q < num_queries; q++) {
-      clear_bitmap(&query_bitmaps[q]);
-      mark_matches_bitmap(block_data, block_size, comparators[q], &query_bitmaps[q]);
+      Bitvector *bitmap = result_columns[q]->bitmap;
+      uint64_t *words = bitmap ? bitmap->words + base_idx / 64 : query_bitmaps[q].bits;
+      if (!block_may_match(zones, comparators[q], &predicates[q], base_idx,
+                           base_idx + block_size)) {
+        if (!bitmap) clear_bitmap(&query_bitmaps[q]);
+        continue;
+      }
+      size_t count = simd_select_bitmap(block_data, block_size, &predicates[q], words);
+      if (bitmap) result_columns[q]->num_elements += count;
     }
 
-    // Second pass: Process matches for each query
+    // Second pass: Process matches for each query that wants positions
     for (size_t q = 0; q < num_queries; q++) {
+      if (result_columns[q]->bitmap) continue;
       int *result_data = (int *)result_columns[q]->data;
       process_matches(block_size, base_idx, &query_bitmaps[q], comparators[q]->ref_posns,
                       result_data, &result_columns[q]->num_elements);
@@ -580,5 +840,6 @@ int batch_select_single_core_optimized(const int *data, size_t num_elements,
   }
 
   free(query_bitmaps);
+  free(predicates);
   return 0;
 }
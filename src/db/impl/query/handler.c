@@ -35,6 +35,11 @@ void handle_query(char *query, message *send_message, int client_socket,
  * @return char*
  */
 void handle_dbOperator(DbOperator *query, message *send_message) {
+  // Deferred selects and fetches must see the data as it was when they were issued
+  if (query->type == CREATE || query->type == CREATE_INDEX || query->type == INSERT) {
+    exec_all_pending(query->context);
+  }
+
   switch (query->type) {
     case CREATE:
     case CREATE_INDEX:
@@ -48,6 +53,9 @@ void handle_dbOperator(DbOperator *query, message *send_message) {
     case FETCH:
       exec_fetch(query, send_message);
       break;
+    case MULTI_FETCH:
+      exec_multi_fetch(query, send_message);
+      break;
     case PRINT: {
       char *result = handle_print(query);
       if (!result) {
@@ -66,8 +74,13 @@ void handle_dbOperator(DbOperator *query, message *send_message) {
       break;
     case ADD:
     case SUB:
+    case MUL:
+    case DIV:
       exec_arithmetic(query, send_message);
       break;
+    case EXPR:
+      exec_expr(query, send_message);
+      break;
     case INSERT:
       exec_insert(query, send_message);
       break;
@@ -81,6 +94,9 @@ void handle_dbOperator(DbOperator *query, message *send_message) {
     case JOIN:
       exec_join(query, send_message);
       break;
+    case GROUP_BY:
+      exec_group_by(query, send_message);
+      break;
     default:
       cs165_log(stdout, "execute_DbOperator: Unknown query type\n");
       break;
@@ -136,6 +152,10 @@ char *handle_print(DbOperator *query) {
   char *current = result;
   size_t remaining = buffer_size;
 
+  // Bitmap select results are printed by walking their set bits, one per row
+  size_t next_bit[print_op->num_columns];
+  for (size_t col = 0; col < print_op->num_columns; col++) next_bit[col] = 0;
+
   //   cs165_log(stdout, "handle_print: scanning columns\n");
   // Print each row
   cs165_log(stdout, "handle_print: num_rows: %zu\n", num_rows);
@@ -147,7 +167,13 @@ char *handle_print(DbOperator *query) {
       size_t printed;
 
       // Print value based on data type
-      if (column->data_type == INT) {
+      if (column->bitmap) {
+        size_t position = bitvector_next(column->bitmap, next_bit[col]);
+        next_bit[col] = position + 1;
+        printed = snprintf(current, remaining, "%zu", position);
+      } else if (column->range.col) {
+        printed = snprintf(current, remaining, "%d", range_position(&column->range, row));
+      } else if (column->data_type == INT) {
         int *data = (int *)column->data;
         printed = snprintf(current, remaining, "%d", data[row]);
       } else if (column->data_type == LONG) {
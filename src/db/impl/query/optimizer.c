@@ -1,7 +1,10 @@
+#define _GNU_SOURCE
 #include "optimizer.h"
 
 #include "algorithms.h"
 #include "btree.h"
+#include "client_context.h"
+#include "query_exec.h"
 
 void reorder_nums(int *data, size_t n_elements, int *idx_order);
 
@@ -23,15 +26,77 @@ void init_column_index(Column *col, message *send_message) {
   // Copy the data from the column to the index
   memcpy(col->index->sorted_data, col->data, sizeof(int) * col->num_elements);
 
-  // Sort the data and keep track of the original positions
-  if (sort(col->index->sorted_data, col->num_elements, col->index->positions) != 0) {
+  // Sort the data and keep track of the original positions, on the worker pool for
+  // large columns
+  ThreadPool *pool = executor_pool(NULL, col->num_elements);
+  if (radix_sort(col->index->sorted_data, col->num_elements, col->index->positions,
+                 pool) != 0) {
     handle_error(send_message, "Failed to sort data");
     log_err("init_column_index: Failed to sort data\n");
     return;
   }
+
+  // Data that is already in order (e.g. a clustered column reloaded from disk) needs no
+  // position lookups: the sorted order is the base order
+  col->index->clustered =
+      memcmp(col->index->sorted_data, col->data, sizeof(int) * col->num_elements) == 0;
+  if (col->index->clustered) {
+    for (size_t i = 0; i < col->num_elements; i++) {
+      col->index->positions[i] = i;
+    }
+  }
+}
+/**
+ * @brief Lays out the sorted data of a SORTED_EYTZINGER index in BFS order for its
+ * lookups.
+ * @return 0 on success, -1 on failure (lookups then binary search the sorted data)
+ */
+static int eytzinger_layout(Column *col) {
+  ColumnIndex *index = col->index;
+  size_t n = col->num_elements;
+  // Whole cache lines, so every prefetched line of the keys is one of theirs
+  index->eytzinger = aligned_alloc(64, sizeof(int) * ((n + 16) / 16 * 16));
+  index->eytzinger_ranks = malloc(sizeof(uint32_t) * (n + 1));
+  if (!index->eytzinger || !index->eytzinger_ranks || n > UINT32_MAX) {
+    free(index->eytzinger);
+    free(index->eytzinger_ranks);
+    index->eytzinger = NULL;
+    index->eytzinger_ranks = NULL;
+    log_err("eytzinger_layout: Failed to lay out the index of %s\n", col->name);
+    return -1;
+  }
+  eytzinger_build(index->sorted_data, n, index->eytzinger, index->eytzinger_ranks);
+  return 0;
+}
+
+// Drops the Eytzinger layout of `index`, which is in its index file if it has one
+static void eytzinger_drop(ColumnIndex *index) {
+  if (!index->file) {
+    free(index->eytzinger);
+    free(index->eytzinger_ranks);
+  }
+  index->eytzinger = NULL;
+  index->eytzinger_ranks = NULL;
 }
+
 void create_idx_on(Column *col, message *send_message) {
   if (!col->index || col->index->idx_type == NONE) return;
+  col->index->file = NULL;
+  col->index->eytzinger = NULL;
+  col->index->eytzinger_ranks = NULL;
+
+  // A cracked index costs nothing upfront: the first select builds it, from the data as
+  // it is now, so a cracker built from the data before a reload goes
+  if (col->index->idx_type == CRACKED) {
+    col->index->sorted_data = NULL;
+    col->index->positions = NULL;
+    col->index->clustered = 0;
+    cracker_free(col->index->cracker);
+    col->index->cracker = NULL;
+    col->root = NULL;
+    return;
+  }
+  col->index->cracker = NULL;
 
   // Any column with an index needs to have ColumnIndex initialized
   init_column_index(col, send_message);
@@ -39,134 +104,325 @@ void create_idx_on(Column *col, message *send_message) {
 
   IndexType idx_type = col->index->idx_type;
   if (idx_type == BTREE_CLUSTERED || idx_type == BTREE_UNCLUSTERED) {
-    // Create the btree index
-    col->root = init_btree(col->index->sorted_data, col->num_elements, BTREE_FANOUT);
+    // Bulk load the btree index; from then on it is the index, updated in place by
+    // inserts, so the sorted arrays are not kept
+    col->root = btree_create(col->index->sorted_data, col->index->positions,
+                             col->num_elements);
     if (!col->root) {
       log_err("Failed to create btree index for column %s\n", col->name);
       return;
     }
+    free(col->index->sorted_data);
+    free(col->index->positions);
+    col->index->sorted_data = NULL;
+    col->index->positions = NULL;
     cs165_log(stdout, "Created btree index for column %s\n", col->name);
   } else {
     col->root = NULL;
+    if (idx_type == SORTED_EYTZINGER && col->index->sorted_data) eytzinger_layout(col);
   }
 }
 
 void cluster_idx_on(Table *table, Column *primary_col, message *send_message) {
   (void)send_message;
-  // Cluster the primary column if it exists
-  int *idx_order = primary_col->index->positions;
+  ColumnIndex *index = primary_col->index;
+  size_t n = primary_col->num_elements;
+
+  // The sorted order of the primary column: its index arrays, or its btree's contents
+  int *sorted_data = index->sorted_data, *idx_order = index->positions;
+  if (primary_col->root) {
+    sorted_data = malloc(sizeof(int) * (n + 1));
+    idx_order = malloc(sizeof(int) * (n + 1));
+    if (!sorted_data || !idx_order) {
+      free(sorted_data);
+      free(idx_order);
+      log_err("cluster_idx_on: Failed to allocate memory for %s\n", primary_col->name);
+      return;
+    }
+    btree_range_copy(primary_col->root, btree_begin(primary_col->root), btree_end(),
+                     sorted_data, idx_order);
+  }
 
   for (size_t i = 0; i < table->num_cols; i++) {
     Column *col = &table->columns[i];
     if (col == primary_col) continue;
     reorder_nums(col->data, col->num_elements, idx_order);
   }
-  memcpy(primary_col->data, primary_col->index->sorted_data,
-         sizeof(int) * primary_col->num_elements);
+  memcpy(primary_col->data, sorted_data, sizeof(int) * n);
 
-  // erase old positions
-  for (size_t i = 0; i < primary_col->num_elements; i++) {
-    primary_col->index->positions[i] = i;
+  if (primary_col->root) {
+    // Each row moved: the tree is rebuilt over the new row ids
+    free(sorted_data);
+    free(idx_order);
+    free_btree(primary_col->root);
+    primary_col->root = btree_create(primary_col->data, NULL, n);
+    if (!primary_col->root) {
+      log_err("cluster_idx_on: Failed to rebuild btree index for %s\n",
+              primary_col->name);
+    }
+  } else {
+    // erase old positions
+    for (size_t i = 0; i < n; i++) {
+      index->positions[i] = i;
+    }
   }
+  index->clustered = 1;
 }
 
-size_t idx_lookup_left(Column *col, int value) {
-  if (!col->index || col->index->idx_type == NONE) {
-    log_err("idx_lookup: Column %s does not have an index\n", col->name);
-    return 0;
-  }
-  int *sorted_data = col->index->sorted_data;
-  size_t num_elements = col->num_elements;
-  IndexType idx_type = col->index->idx_type;
-  //   ssize_t match_idx = 0;
+/**
+ * @brief Adds the last row of `col`, just appended, to its index: a btree takes it in
+ * place, a sorted index shifts its arrays to make room (dropping its Eytzinger layout,
+ * if any), and a cracker column ripples it into its piece. An index that has not been
+ * built yet is left to be built on load.
+ * @return 0 on success, -1 on failure
+ */
+int idx_insert(Column *col) {
+  ColumnIndex *index = col->index;
+  if (!index || index->idx_type == NONE || col->num_elements == 0) return 0;
+  size_t rowid = col->num_elements - 1;
+  int value = ((int *)col->data)[rowid];
 
-  // Handle edge cases
-  if (value <= sorted_data[0]) return 0;
-  if (value >= sorted_data[num_elements - 1]) return num_elements - 1;
+  switch (index->idx_type) {
+    case CRACKED:
+      if (index->cracker && cracker_insert(index->cracker, value, (int)rowid) != 0) {
+        cracker_free(index->cracker);
+        index->cracker = NULL;  // the next select builds it again
+      }
+      return 0;
+    case BTREE_CLUSTERED:
+    case BTREE_UNCLUSTERED:
+      if (!col->root) {
+        if (rowid > 0) return 0;
+        col->root = btree_create(NULL, NULL, 0);
+        if (!col->root) return -1;
+        index->clustered = 1;
+      }
+      // Row ids stay the sorted order only while rows come in order
+      if (btree_upper_bound(col->root, value).leaf != BTREE_NIL) index->clustered = 0;
+      return btree_insert(col->root, value, (uint32_t)rowid);
+    default:
+      break;
+  }
 
-  if (idx_type == BTREE_CLUSTERED || idx_type == BTREE_UNCLUSTERED) {
-    return lookup(value, col->root, 1);
-    // Btree guarantees that the sorted_data[match_idx] <= value, so we need to find the
-    // leftmost position where value is strictly greater than previous element
-    // log_info(
-    //     "Btree: should linear search after index Left lookup? %s\n",
-    //     match_idx < num_elements - 1 && sorted_data[match_idx] < value ? "Yes" : "No");
-
-    // // Case 1: Sorted_data [ a1, ..., value ] where a1, ... < value
-    // //                       ^
-    // //                       |
-    // //                    match_idx
-    // while (match_idx < num_elements - 1 && sorted_data[match_idx] < value) {
-    //   match_idx++;
-    // }
-
-    // // Case 2: Sorted_data [ value, ..., value ] where a1, ... < value
-    // //                                      ^
-    // //                                      |
-    // //                                  match_idx
-    // while (match_idx > 0 && sorted_data[match_idx - 1] == value) {
-    //   match_idx--;
-    // }
-    // return match_idx;
-
-    // //   Worst case that the sorted_data[match_idx] = value = sorted_data[match_idx]
-    // //    we want idx s.t. col->data[i - 1] < value
-    // log_info("Optimizer: should linear search after index Left lookup? %s\n",
-    //          match_idx > 0 && sorted_data[match_idx] == value ? "Yes" : "No");
-    // while (match_idx > 0 && sorted_data[match_idx] == value) {
-    //   match_idx--;
-    // }
-    // return sorted_data[match_idx] < value ? match_idx + 1 : match_idx;
-  } else if (idx_type == SORTED_CLUSTERED || idx_type == SORTED_UNCLUSTERED) {
-    return binary_search_left(sorted_data, num_elements, value);
-  }
-  log_err("idx_lookup: Unsupported index type; start scanning from the beginning\n");
+  if (!index->sorted_data && rowid > 0) return 0;
+  size_t slot = index->sorted_data
+                    ? sorted_upper_bound(index->sorted_data, rowid, value)
+                    : 0;
+  if (slot < rowid) {
+    // Index range results read the positions as they go: copy them out before the
+    // positions shift
+    if (materialize_ranges_on(col) != 0) return -1;
+    index->clustered = 0;
+  } else if (rowid == 0) {
+    index->clustered = 1;
+  }
+  // Laying it out again costs a pass over the data: leave that to the next lookup, so a
+  // run of inserts pays for it once
+  eytzinger_drop(index);
+  if (index->file) {
+    // Mapped from disk: move the arrays to the heap so they can grow
+    int *heap_data = malloc(sizeof(int) * (rowid + 1));
+    int *heap_positions = malloc(sizeof(int) * (rowid + 1));
+    if (!heap_data || !heap_positions) {
+      free(heap_data);
+      free(heap_positions);
+      return -1;
+    }
+    memcpy(heap_data, index->sorted_data, sizeof(int) * rowid);
+    memcpy(heap_positions, index->positions, sizeof(int) * rowid);
+    index_file_unmap(index->file);
+    index->file = NULL;
+    index->sorted_data = heap_data;
+    index->positions = heap_positions;
+  }
+  int *sorted_data = realloc(index->sorted_data, sizeof(int) * (rowid + 1));
+  if (!sorted_data) return -1;
+  index->sorted_data = sorted_data;
+  int *positions = realloc(index->positions, sizeof(int) * (rowid + 1));
+  if (!positions) return -1;
+  index->positions = positions;
+  memmove(sorted_data + slot + 1, sorted_data + slot, sizeof(int) * (rowid - slot));
+  memmove(positions + slot + 1, positions + slot, sizeof(int) * (rowid - slot));
+  sorted_data[slot] = value;
+  positions[slot] = (int)rowid;
   return 0;
 }
-// TODO: Merge this function with idx_lookup_left and remove redundancy
-//
-size_t idx_lookup_right(Column *col, int value) {
-  if (!col->index || col->index->idx_type == NONE) {
-    log_err("idx_lookup: Column %s does not have an index\n", col->name);
-    return 0;
+
+#define SORTED_INDEX_MAGIC 0x53494458  // "SIDX"
+// Rows of an index file compared with the base column before it is trusted
+#define INDEX_SPOT_CHECKS 64
+
+int save_idx(Column *col, const char *path) {
+  ColumnIndex *index = col->index;
+  if (!index) return 0;
+  switch (index->idx_type) {
+    case BTREE_CLUSTERED:
+    case BTREE_UNCLUSTERED:
+      // A tree still mapped from its file is what the file already holds
+      if (!col->root || col->root->file) return 0;
+      return btree_save(col->root, path, index->clustered);
+    case SORTED_CLUSTERED:
+    case SORTED_UNCLUSTERED:
+    case SORTED_EYTZINGER: {
+      if (!index->sorted_data || index->file) return 0;
+      size_t n = col->num_elements;
+      // An Eytzinger layout is saved as is, so loading the index needn't lay it out
+      size_t layout_size = index->eytzinger ? sizeof(int) * (n + 1) : 0;
+      uint64_t meta[INDEX_FILE_META] = {n, index->clustered, 0, 0};
+      const void *sections[INDEX_FILE_SECTIONS] = {index->sorted_data, index->positions,
+                                                   index->eytzinger,
+                                                   index->eytzinger_ranks};
+      size_t sizes[INDEX_FILE_SECTIONS] = {sizeof(int) * n, sizeof(int) * n, layout_size,
+                                           layout_size};
+      return index_file_write(path, SORTED_INDEX_MAGIC, meta, sections, sizes);
+    }
+    default:
+      return 0;
   }
+}
 
-  int *sorted_data = col->index->sorted_data;
-  size_t num_elements = col->num_elements;
-  IndexType idx_type = col->index->idx_type;
-  //   ssize_t match_idx = 0;
+// Whether the (key, row id) pairs `keys[i], rowids[i]` agree with the base column
+static int index_rows_match(const Column *col, const int *keys, const uint32_t *rowids,
+                            size_t n) {
+  const int *data = (const int *)col->data;
+  for (size_t i = 0; i < n; i++) {
+    if (rowids[i] >= col->num_elements || data[rowids[i]] != keys[i]) return 0;
+  }
+  return 1;
+}
 
-  //   // Handle edge cases
-  //   if (value <= sorted_data[0]) return 0;
-  //   if (value >= sorted_data[num_elements - 1]) return num_elements - 1;
+/**
+ * @brief Spot checks a loaded index against the base column: the file is only as
+ * trustworthy as its header, so a few rows spread over the index must still be rows of
+ * the column, at the positions they claim.
+ */
+static int index_spot_check(const Column *col) {
+  size_t n = col->num_elements;
+  if (col->root) {
+    const Btree *tree = col->root;
+    if (tree->n_elts != n) return 0;
+    for (size_t s = 0; s < INDEX_SPOT_CHECKS; s++) {
+      const BtreeLeaf *leaf = &tree->leaves[s * tree->n_leaves / INDEX_SPOT_CHECKS];
+      if (leaf->n > BTREE_LEAF_KEYS ||
+          !index_rows_match(col, leaf->keys, leaf->rowids, leaf->n)) {
+        return 0;
+      }
+    }
+    return 1;
+  }
+  const ColumnIndex *index = col->index;
+  for (size_t s = 0; s < INDEX_SPOT_CHECKS && n > 0; s++) {
+    size_t i = s * n / INDEX_SPOT_CHECKS;
+    if ((i > 0 && index->sorted_data[i - 1] > index->sorted_data[i]) ||
+        !index_rows_match(col, index->sorted_data + i,
+                          (const uint32_t *)index->positions + i, 1)) {
+      return 0;
+    }
+  }
+  return 1;
+}
 
-  if (idx_type == BTREE_CLUSTERED || idx_type == BTREE_UNCLUSTERED) {
-    return lookup(value, col->root, 0);
-    // // Btree guarantees that the sorted_data[match_idx] <= value, so we need to find
-    // the
-    // // rightmost position where value is strictly less than next element
-    // log_info(
-    //     "Btree: should linear search after index Right lookup? %s\n",
-    //     match_idx < num_elements - 1 && sorted_data[match_idx] <= value ? "Yes" :
-    //     "No");
-    // while (match_idx < num_elements - 1 && sorted_data[match_idx] <= value) {
-    //   match_idx++;
-    // }
-    // log_info("Optimizer: should linear search after index Right lookup? %s\n",
-    //          (size_t)match_idx < num_elements - 1 && sorted_data[match_idx] <= value
-    //              ? "Yes"
-    //              : "No");
-    // // Find rightmost position where value is strictly less than next element
-    // while (((size_t)match_idx < num_elements - 1 && sorted_data[match_idx] <= value)) {
-    //   match_idx++;
-    // }
-    // return match_idx > 0 ? match_idx - 1 : 0;
-  } else if (idx_type == SORTED_CLUSTERED || idx_type == SORTED_UNCLUSTERED) {
-    return binary_search_right(sorted_data, num_elements, value);
+int load_idx(Column *col, const char *path) {
+  ColumnIndex *index = col->index;
+  index->sorted_data = NULL;
+  index->positions = NULL;
+  index->cracker = NULL;
+  index->file = NULL;
+  index->eytzinger = NULL;
+  index->eytzinger_ranks = NULL;
+  col->root = NULL;
+
+  uint64_t clustered = 0;
+  if (index->idx_type == BTREE_CLUSTERED || index->idx_type == BTREE_UNCLUSTERED) {
+    col->root = btree_load(path, &clustered);
+  } else if (index->idx_type == SORTED_CLUSTERED ||
+             index->idx_type == SORTED_UNCLUSTERED ||
+             index->idx_type == SORTED_EYTZINGER) {
+    index->file = index_file_map(path, SORTED_INDEX_MAGIC);
+    size_t n = col->num_elements;
+    const uint64_t *sizes = index->file ? index->file->header.section_sizes : NULL;
+    if (index->file && index->file->header.meta[0] == n && sizes[0] == sizeof(int) * n &&
+        sizes[1] == sizeof(int) * n) {
+      index->sorted_data = index->file->sections[0];
+      index->positions = index->file->sections[1];
+      clustered = index->file->header.meta[1];
+      // Without its layout (saved after inserts), the first lookup lays it out
+      if (index->idx_type == SORTED_EYTZINGER && sizes[2] == sizeof(int) * (n + 1) &&
+          sizes[3] == sizeof(uint32_t) * (n + 1)) {
+        index->eytzinger = index->file->sections[2];
+        index->eytzinger_ranks = index->file->sections[3];
+      }
+    }
+  }
+  if ((!col->root && !index->sorted_data && col->num_elements > 0) ||
+      !index_spot_check(col)) {
+    log_info("Index file %s is missing or stale; rebuilding the index\n", path);
+    free_btree(col->root);
+    col->root = NULL;
+    index_file_unmap(index->file);
+    index->file = NULL;
+    index->sorted_data = NULL;
+    index->positions = NULL;
+    index->eytzinger = NULL;
+    index->eytzinger_ranks = NULL;
+    return -1;
   }
+  index->clustered = clustered != 0;
   return 0;
 }
 
+void free_idx(Column *col) {
+  ColumnIndex *index = col->index;
+  if (!index) return;
+  free_btree(col->root);
+  col->root = NULL;
+  eytzinger_drop(index);
+  if (index->file) {
+    index_file_unmap(index->file);
+  } else {
+    free(index->sorted_data);
+    free(index->positions);
+  }
+  cracker_free(index->cracker);
+  free(index);
+  col->index = NULL;
+}
+
+// Whether lookups on `col` go through an Eytzinger layout, laying it out if inserts
+// dropped it. Like cracking, this changes the index on a lookup: selects on a column
+// don't run concurrently with each other or with inserts.
+static int has_eytzinger_layout(Column *col) {
+  ColumnIndex *index = col->index;
+  if (index->idx_type != SORTED_EYTZINGER || !index->sorted_data) return 0;
+  return index->eytzinger || eytzinger_layout(col) == 0;
+}
+
+size_t idx_lower_bound(Column *col, int value) {
+  if (!col->index || col->index->idx_type == NONE) {
+    log_err("idx_lower_bound: Column %s does not have an index\n", col->name);
+    return 0;
+  }
+  ColumnIndex *index = col->index;
+  if (has_eytzinger_layout(col)) {
+    return eytzinger_lower_bound(index->eytzinger, index->eytzinger_ranks,
+                                 col->num_elements, value);
+  }
+  return sorted_lower_bound(index->sorted_data, col->num_elements, value);
+}
+
+size_t idx_upper_bound(Column *col, int value) {
+  if (!col->index || col->index->idx_type == NONE) {
+    log_err("idx_upper_bound: Column %s does not have an index\n", col->name);
+    return col->num_elements;
+  }
+  ColumnIndex *index = col->index;
+  if (has_eytzinger_layout(col)) {
+    return eytzinger_upper_bound(index->eytzinger, index->eytzinger_ranks,
+                                 col->num_elements, value);
+  }
+  return sorted_upper_bound(index->sorted_data, col->num_elements, value);
+}
+
 void reorder_nums(int *data, size_t n_elements, int *idx_order) {
   // Handle empty array case
   if (n_elements == 0) return;
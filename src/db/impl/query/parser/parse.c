@@ -11,6 +11,7 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <errno.h>
 #include <limits.h>
 #include <stdbool.h>
 #include <stddef.h>
@@ -20,6 +21,7 @@
 #include "catalog_manager.h"
 #include "client_context.h"
 #include "handler.h"
+#include "query_exec.h"
 #include "utils.h"
 
 // Function prototypes
@@ -29,8 +31,10 @@ DbOperator *parse_select(char *select_arguments, char *handle);
 DbOperator *parse_fetch(char *fetch_arguments, char *handle);
 DbOperator *parse_aggr(char *aggr_arguments, char *handle, OperatorType type);
 DbOperator *parse_arithmetic(char *arithmetic_arguments, char *handle, OperatorType type);
+DbOperator *parse_expr(char *expr_arguments, char *handle);
 DbOperator *parse_print(char *print_arguments);
 DbOperator *parse_join(char *join_arguments, char *handle, message *send_message);
+DbOperator *parse_group_by(char *group_by_arguments, char *handle);
 
 /**
  * @brief parse_command
@@ -105,6 +109,15 @@ DbOperator *parse_command(char *query_command, message *send_message, int client
   } else if (strncmp(query_command, "add", 3) == 0) {
     query_command += 3;
     dbo = parse_arithmetic(query_command, handle, ADD);
+  } else if (strncmp(query_command, "mul", 3) == 0) {
+    query_command += 3;
+    dbo = parse_arithmetic(query_command, handle, MUL);
+  } else if (strncmp(query_command, "div", 3) == 0) {
+    query_command += 3;
+    dbo = parse_arithmetic(query_command, handle, DIV);
+  } else if (strncmp(query_command, "expr", 4) == 0) {
+    query_command += 4;
+    dbo = parse_expr(query_command, handle);
   } else if (strncmp(query_command, "print", 5) == 0) {
     query_command += 5;
     dbo = parse_print(query_command);
@@ -128,6 +141,9 @@ DbOperator *parse_command(char *query_command, message *send_message, int client
   } else if (strncmp(query_command, "join", 4) == 0) {
     query_command += 4;
     dbo = parse_join(query_command, handle, send_message);
+  } else if (strncmp(query_command, "groupby", 7) == 0) {
+    query_command += 7;
+    dbo = parse_group_by(query_command, handle);
   } else {
     send_message->status = UNKNOWN_COMMAND;
   }
@@ -300,13 +316,23 @@ DbOperator *parse_create_db(char *create_arguments) {
   }
 }
 
+// Looks up a handle for an operator that reads its data, first running the select or
+// fetch that fills it if that was deferred
+static Column *get_materialized_handle(const char *name) {
+  Column *col = get_handle(name);
+  if (col && exec_pending(col) != 0) return NULL;
+  return col;
+}
+
 Column *get_chandle_or_dbtblcol(char *name) {
   Column *col = NULL;
   // NOTE: based on project language, we can assume column names include dots
   if (strchr(name, '.') != NULL) {
     col = get_column_from_catalog(name);  // get the column from the catalog
   } else {
-    col = get_handle(name);  // from client context (variable pool)
+    col = get_materialized_handle(name);  // from client context (variable pool)
+    // Operators reached through here read `data`, so bitmap results become positions
+    if (col && materialize_positions(col) != 0) col = NULL;
   }
   return col;
 }
@@ -319,6 +345,8 @@ Column *get_chandle_or_dbtblcol(char *name) {
  * create(idx,db1.tbl4.col3,sorted,clustered)  --- Create a clustered index on col3
  * create(idx,db1.tbl4.col2,btree,unclustered) -- Create an unclustered btree index on
  * col2
+ * create(idx,db1.tbl4.col1,cracked)           --- Create an adaptive (cracking) index on
+ * col1; it can also be created after the data is loaded
  *
  * @param args: e.g. db1.tbl4.col3,sorted,clustered)
  * @return DbOperator* with col, IndexType: btree_clustered, sorted_unclustered, etc.
@@ -328,11 +356,15 @@ DbOperator *parse_create_index(char *args) {
   char **args_index = &args;
   char *db_tbl_col = next_token(args_index, &status);
   char *index_type = next_token(args_index, &status);
-  char *clustered = next_token(args_index, &status);
+  // a cracked index needs no clustering argument: it is always a separate copy
+  char *clustered = index_type && strcmp(index_type, "cracked)") == 0
+                        ? index_type + strlen("cracked")
+                        : next_token(args_index, &status);
 
   // not enough arguments
-  if (status == INCORRECT_FORMAT) {
+  if (status == INCORRECT_FORMAT || !clustered) {
     log_err("L%d: parse_create_index failed. Not enough arguments\n", __LINE__);
+    return NULL;
   }
 
   // read and chop off last char, which should be a ')'
@@ -359,6 +391,11 @@ DbOperator *parse_create_index(char *args) {
     idx_type = SORTED_CLUSTERED;
   } else if (strcmp(index_type, "sorted") == 0 && strcmp(clustered, "unclustered") == 0) {
     idx_type = SORTED_UNCLUSTERED;
+  } else if (strcmp(index_type, "eytzinger") == 0 &&
+             strcmp(clustered, "unclustered") == 0) {
+    idx_type = SORTED_EYTZINGER;
+  } else if (strcmp(index_type, "cracked") == 0) {
+    idx_type = CRACKED;
   } else {
     log_err(
         "L%d: parse_create_index failed. got bad index type: type=%s, cluster_type=%s\n",
@@ -558,14 +595,13 @@ DbOperator *parse_select(char *query_command, char *handle) {
   cs165_log(stdout, "parse_select: got column %s\n", col->name);
   dbo->operator_fields.select_operator.comparator->col = col;
   dbo->operator_fields.select_operator.comparator->ref_posns = NULL;
+  dbo->operator_fields.select_operator.comparator->ref_bitmap = NULL;
 
-  // We let the query handler decide on this before execution
-  dbo->operator_fields.select_operator.comparator->on_sorted_data = 0;
   dbo->operator_fields.select_operator.res_handle = strdup(handle);
 
   // If posn_vec is not NULL, then we have a type 2 select query
   if (posn_vec) {
-    Column *posn_col = get_handle(posn_vec);
+    Column *posn_col = get_materialized_handle(posn_vec);
     if (!posn_col) {
       db_operator_free(dbo);
       log_err("L%d: parse_select: posn_vec %s not found\n", __LINE__, posn_vec);
@@ -584,12 +620,99 @@ DbOperator *parse_select(char *query_command, char *handle) {
     //   }
     // }
     // log_info("parse_select: posn_vec sanity check passed\n");
-    dbo->operator_fields.select_operator.comparator->ref_posns = posn_col->data;
+    // An unclustered index range already is a slice of a position list; a clustered one
+    // is listed out
+    PositionRange *range = &posn_col->range;
+    if (range->col && !range->clustered) {
+      dbo->operator_fields.select_operator.comparator->ref_posns =
+          range->col->index->positions + range->start;
+    } else {
+      if (range->col && materialize_positions(posn_col) != 0) {
+        db_operator_free(dbo);
+        log_err("L%d: parse_select: could not materialize posn_vec %s\n", __LINE__,
+                posn_vec);
+        return NULL;
+      }
+      dbo->operator_fields.select_operator.comparator->ref_posns = posn_col->data;
+      dbo->operator_fields.select_operator.comparator->ref_bitmap = posn_col->bitmap;
+    }
   }
 
   return dbo;
 }
 
+/**
+ * @brief parse_multi_fetch
+ * Parses a fetch of several columns of one table at the same select result, which runs
+ * as a single pass over its positions. The i-th handle gets the values of the i-th
+ * column. Returns NULL if the arguments are invalid.
+ *
+ * Example query:
+ *     - f1,f2,f3=fetch(db1.tbl1.{col1,col2,col3},s1)
+ * @param query_command e.g. (db1.tbl1.{col1,col2,col3},s1)
+ * @param fetch_handles e.g. f1,f2,f3
+ * @return DbOperator*
+ */
+static DbOperator *parse_multi_fetch(char *query_command, char *fetch_handles) {
+  char *open_brace = strchr(query_command, '{');
+  char *close_brace = strchr(open_brace, '}');
+  if (!fetch_handles || !close_brace || close_brace[1] != ',' || close_brace[2] == '\0') {
+    log_err("L%d: parse_multi_fetch failed. incorrect format\n", __LINE__);
+    return NULL;
+  }
+  // The select handle follows the column list
+  char *select_handle = close_brace + 2;
+  int last_char = strlen(select_handle) - 1;
+  if (select_handle[last_char] != ')') {
+    log_err("L%d: parse_multi_fetch failed. incorrect format\n", __LINE__);
+    return NULL;
+  }
+  select_handle[last_char] = '\0';
+  *open_brace = '\0';
+  *close_brace = '\0';
+  char *db_tbl_name = query_command[0] == '(' ? query_command + 1 : query_command;
+  char *col_names = open_brace + 1;
+
+  size_t num_cols = 1, num_handles = 1;
+  for (char *p = col_names; *p; p++) num_cols += *p == ',';
+  for (char *p = fetch_handles; *p; p++) num_handles += *p == ',';
+  if (num_cols != num_handles) {
+    log_err("L%d: parse_multi_fetch failed. %zu handles for %zu columns\n", __LINE__,
+            num_handles, num_cols);
+    return NULL;
+  }
+
+  DbOperator *dbo = malloc(sizeof(DbOperator));
+  if (!dbo) return NULL;
+  dbo->type = MULTI_FETCH;
+  MultiFetchOperator *fetch_op = &dbo->operator_fields.multi_fetch_operator;
+  fetch_op->select_handle = select_handle;
+  fetch_op->num_cols = num_cols;
+  fetch_op->fetch_handles = malloc(sizeof(char *) * num_cols);
+  fetch_op->cols = malloc(sizeof(Column *) * num_cols);
+  if (!fetch_op->fetch_handles || !fetch_op->cols) {
+    db_operator_free(dbo);
+    return NULL;
+  }
+
+  for (size_t i = 0; i < num_cols; i++) {
+    char *col_name = strsep(&col_names, ",");
+    fetch_op->fetch_handles[i] = strsep(&fetch_handles, ",");
+
+    char db_tbl_col_name[3 * MAX_SIZE_NAME];
+    snprintf(db_tbl_col_name, sizeof(db_tbl_col_name), "%s%s", db_tbl_name, col_name);
+    fetch_op->cols[i] = get_column_from_catalog(db_tbl_col_name);
+    if (!fetch_op->cols[i]) {
+      log_err("L%d: parse_multi_fetch failed. unknown column %s\n", __LINE__,
+              db_tbl_col_name);
+      db_operator_free(dbo);
+      return NULL;
+    }
+  }
+  log_info("Successfully parsed fetch of %zu columns\n", num_cols);
+  return dbo;
+}
+
 /**
  * @brief parse_fetch
  * This method takes in a string representing the arguments to fetch from a column, parses
@@ -598,11 +721,15 @@ DbOperator *parse_select(char *query_command, char *handle) {
  * Example query (without a handle):
  *     - fetch(db1.tbl1.col2,s1)           --- where s1 is a handle to the result of a
  *                                              select query
+ *     - fetch(db1.tbl1.{col1,col2},s1)    --- several columns at once, with as many
+ *                                              handles (see parse_multi_fetch)
  * @param query_command
  * @param fetch_handle the handle to the result of this fetch query
  * @return DbOperator*
  */
 DbOperator *parse_fetch(char *query_command, char *fetch_handle) {
+  if (strchr(query_command, '{')) return parse_multi_fetch(query_command, fetch_handle);
+
   message_status status = OK_DONE;
   char **command_index = &query_command;
 
@@ -660,7 +787,9 @@ DbOperator *parse_aggr(char *query_command, char *res_handle, OperatorType type)
   char *col_handle = trim_parenthesis(query_command);
   cs165_log(stdout, "res_handle: %s, col: %s\n", res_handle, col_handle);
 
-  Column *col = get_chandle_or_dbtblcol(col_handle);
+  // A deferred fetch is aggregated without materializing it (see pipeline.c)
+  Column *col = strchr(col_handle, '.') ? NULL : get_handle(col_handle);
+  if (!col || !is_deferred_fetch(col)) col = get_chandle_or_dbtblcol(col_handle);
   if (!col) {
     log_err("L%d: parse_aggr failed. Bad column name\n", __LINE__);
     return NULL;
@@ -681,17 +810,39 @@ DbOperator *parse_aggr(char *query_command, char *res_handle, OperatorType type)
   return dbo;
 }
 
+/**
+ * @brief Parses one operand of an arithmetic operator: an integer constant, or else a
+ * handle or column name.
+ *
+ * @return 0 with `*col` set (NULL for a constant, stored in `*constant`), -1 on failure
+ */
+static int parse_arith_operand(char *operand, Column **col, int *constant) {
+  if (!operand || !*operand) return -1;
+  char *end;
+  errno = 0;
+  long value = strtol(operand, &end, 10);
+  if (*end == '\0' && errno == 0 && value >= INT_MIN && value <= INT_MAX) {
+    *col = NULL;
+    *constant = (int)value;
+    return 0;
+  }
+  *col = get_chandle_or_dbtblcol(operand);
+  *constant = 0;
+  return *col ? 0 : -1;
+}
+
 /**
  * @brief parse_arithmetic
- * Example input: (f11,f12) or (db1.tbl1.col1,db1.tbl1.col2) where f11 and f12 are
- * handles in the client context, and db1.tbl1.col1 and db1.tbl1.col2 are column names
- * in the catalog.
+ * Example input: (f11,f12), (db1.tbl1.col1,db1.tbl1.col2) or (f11,3) where f11 and f12
+ * are handles in the client context, db1.tbl1.col1 and db1.tbl1.col2 are column names
+ * in the catalog, and 3 is a constant applied to every row. At most one operand may be
+ * a constant.
  *
  * @param query_command
  * @param handle
  * @param type
- * @return DbOperator* a Db operator of type ADD or SUB, with `ArithimeticOperator`
- * fields on success, NULL on failure.
+ * @return DbOperator* a Db operator of type ADD, SUB, MUL or DIV, with
+ * `ArithimeticOperator` fields on success, NULL on failure.
  */
 DbOperator *parse_arithmetic(char *query_command, char *handle, OperatorType type) {
   cs165_log(stdout, "L%d: parse_arithmetic received: %s\n", __LINE__, query_command);
@@ -701,15 +852,15 @@ DbOperator *parse_arithmetic(char *query_command, char *handle, OperatorType typ
   char *col2_name = col1_col2;
   cs165_log(stdout, "parse_arithmetic: col1: %s, col2: %s\n", col1_name, col2_name);
 
-  Column *col1 = get_chandle_or_dbtblcol(col1_name);
-  if (!col1) {
+  Column *col1, *col2;
+  int constant1, constant2;
+  if (parse_arith_operand(col1_name, &col1, &constant1) != 0 ||
+      parse_arith_operand(col2_name, &col2, &constant2) != 0) {
     log_err("L%d: parse_arithmetic failed. Bad column name\n", __LINE__);
     return NULL;
   }
-
-  Column *col2 = get_chandle_or_dbtblcol(col2_name);
-  if (!col2) {
-    log_err("L%d: parse_arithmetic failed. Bad column name\n", __LINE__);
+  if (!col1 && !col2) {
+    log_err("L%d: parse_arithmetic failed. Both operands are constants\n", __LINE__);
     return NULL;
   }
 
@@ -723,12 +874,162 @@ DbOperator *parse_arithmetic(char *query_command, char *handle, OperatorType typ
   dbo->type = type;
   dbo->operator_fields.arithmetic_operator.col1 = col1;
   dbo->operator_fields.arithmetic_operator.col2 = col2;
+  dbo->operator_fields.arithmetic_operator.constant1 = constant1;
+  dbo->operator_fields.arithmetic_operator.constant2 = constant2;
   dbo->operator_fields.arithmetic_operator.res_handle = handle;  // handle to store result
 
   log_info("Successfully parsed arithmetic command\n");
   return dbo;
 }
 
+// Recursive descent over the body of an expr(...): `next` is the rest of the input, and
+// every operand and operator parsed is appended to `steps` in postfix order
+typedef struct ExprParser {
+  char *next;
+  ExprStep *steps;
+  Column **cols;
+  size_t num_steps;
+  size_t capacity;
+} ExprParser;
+
+static int parse_expr_sum(ExprParser *parser);
+
+static int expr_emit(ExprParser *parser, ExprStep step, Column *col) {
+  if (parser->num_steps == parser->capacity) {
+    size_t capacity = parser->capacity ? parser->capacity * 2 : 8;
+    ExprStep *steps = realloc(parser->steps, sizeof(ExprStep) * capacity);
+    if (!steps) return -1;
+    parser->steps = steps;
+    Column **cols = realloc(parser->cols, sizeof(Column *) * capacity);
+    if (!cols) return -1;
+    parser->cols = cols;
+    parser->capacity = capacity;
+  }
+  parser->steps[parser->num_steps] = step;
+  parser->cols[parser->num_steps++] = col;
+  return 0;
+}
+
+// operand: integer | name | (sum) | -operand
+static int parse_expr_operand(ExprParser *parser) {
+  char *token = parser->next;
+  if (*token == '(') {
+    parser->next++;
+    if (parse_expr_sum(parser) != 0 || *parser->next != ')') return -1;
+    parser->next++;
+    return 0;
+  }
+  if (isdigit((unsigned char)*token) ||
+      (*token == '-' && isdigit((unsigned char)token[1]))) {
+    errno = 0;
+    long value = strtol(token, &parser->next, 10);
+    if (errno != 0 || value < INT_MIN || value > INT_MAX) return -1;
+    return expr_emit(parser, (ExprStep){.kind = EXPR_CONSTANT, .constant = (int)value},
+                     NULL);
+  }
+  if (*token == '-') {
+    // -x is x * -1, which wraps the same way
+    parser->next++;
+    if (parse_expr_operand(parser) != 0) return -1;
+    if (expr_emit(parser, (ExprStep){.kind = EXPR_CONSTANT, .constant = -1}, NULL) != 0) {
+      return -1;
+    }
+    return expr_emit(parser, (ExprStep){.kind = EXPR_OP, .op = ARITH_MUL}, NULL);
+  }
+
+  char *end = token;
+  while (isalnum((unsigned char)*end) || *end == '_' || *end == '.') end++;
+  if (end == token) return -1;
+  char delimiter = *end;
+  *end = '\0';
+  Column *col = get_chandle_or_dbtblcol(token);
+  *end = delimiter;
+  parser->next = end;
+  if (!col) {
+    log_err("L%d: parse_expr failed. Bad column name\n", __LINE__);
+    return -1;
+  }
+  return expr_emit(parser, (ExprStep){.kind = EXPR_VALUES}, col);
+}
+
+// product: operand (('*' | '/') operand)*
+static int parse_expr_product(ExprParser *parser) {
+  if (parse_expr_operand(parser) != 0) return -1;
+  while (*parser->next == '*' || *parser->next == '/') {
+    ArithOp op = *parser->next++ == '*' ? ARITH_MUL : ARITH_DIV;
+    if (parse_expr_operand(parser) != 0) return -1;
+    if (expr_emit(parser, (ExprStep){.kind = EXPR_OP, .op = op}, NULL) != 0) return -1;
+  }
+  return 0;
+}
+
+// sum: product (('+' | '-') product)*
+static int parse_expr_sum(ExprParser *parser) {
+  if (parse_expr_product(parser) != 0) return -1;
+  while (*parser->next == '+' || *parser->next == '-') {
+    ArithOp op = *parser->next++ == '+' ? ARITH_ADD : ARITH_SUB;
+    if (parse_expr_product(parser) != 0) return -1;
+    if (expr_emit(parser, (ExprStep){.kind = EXPR_OP, .op = op}, NULL) != 0) return -1;
+  }
+  return 0;
+}
+
+/**
+ * @brief parse_expr
+ * Parses an arithmetic expression over handles, columns and integer constants, with +,
+ * -, *, / (usual precedence, left to right) and parentheses. The expression is evaluated
+ * in a single pass, so unlike chained add/sub/mul/div no handle is made for its
+ * intermediate results. At least one operand must be a column or handle, and all of
+ * them must be the same length.
+ *
+ * Example query:
+ *     - r=expr(f1+f2-db1.tbl1.col3*2)
+ *     - r=expr((f1-10)/-f2)
+ *
+ * @param query_command e.g. (f1+f2-db1.tbl1.col3*2)
+ * @param handle
+ * @return DbOperator* of type EXPR on success, NULL on failure.
+ */
+DbOperator *parse_expr(char *query_command, char *handle) {
+  cs165_log(stdout, "L%d: parse_expr received: %s\n", __LINE__, query_command);
+  size_t length = strlen(query_command);
+  if (!handle || length < 2 || query_command[0] != '(' ||
+      query_command[length - 1] != ')') {
+    log_err("L%d: parse_expr failed. Expected expr(<expression>)\n", __LINE__);
+    return NULL;
+  }
+  query_command[length - 1] = '\0';
+
+  ExprParser parser = {.next = query_command + 1};
+  int failed = parse_expr_sum(&parser) != 0 || *parser.next != '\0';
+  size_t num_cols = 0;
+  for (size_t i = 0; !failed && i < parser.num_steps; i++) num_cols += !!parser.cols[i];
+  if (failed || num_cols == 0 ||
+      expr_depth(parser.steps, parser.num_steps) > EXPR_MAX_DEPTH) {
+    log_err("L%d: parse_expr failed. Invalid expression, without columns, or nested "
+            "deeper than %d\n", __LINE__, EXPR_MAX_DEPTH);
+    free(parser.steps);
+    free(parser.cols);
+    return NULL;
+  }
+
+  DbOperator *dbo = malloc(sizeof(DbOperator));
+  if (!dbo) {
+    log_err("L%d: parse_expr failed. malloc for DbOperator failed\n", __LINE__);
+    free(parser.steps);
+    free(parser.cols);
+    return NULL;
+  }
+  dbo->type = EXPR;
+  dbo->operator_fields.expr_operator.steps = parser.steps;
+  dbo->operator_fields.expr_operator.cols = parser.cols;
+  dbo->operator_fields.expr_operator.num_steps = parser.num_steps;
+  dbo->operator_fields.expr_operator.res_handle = handle;
+
+  log_info("Successfully parsed expr command\n");
+  return dbo;
+}
+
 /**
  * @brief Parses a comma-separated list of column names and creates a print operator
  * Example input: (<vec_val1>,<vec_val2>,...)
@@ -779,7 +1080,7 @@ DbOperator *parse_print(char *query_command) {
     *(end + 1) = '\0';
 
     // Get column handle
-    Column *col = get_handle(trimmed);
+    Column *col = get_materialized_handle(trimmed);
     cs165_log(stdout, "handle_to_print: got column %s at %p from variable pool\n",
               trimmed, col);
     if (col == NULL) {
@@ -800,11 +1101,13 @@ DbOperator *parse_print(char *query_command) {
 /**
  * @brief
 
- Parses the following 4 types of join queries:
+ Parses the following 6 types of join queries:
     t1,t2=join(f1,p1,f2,p2,grace-hash)
     t1,t2=join(f1,p1,f2,p2,naive-hash)
     t1,t2=join(f1,p1,f2,p2,hash)
     t1,t2=join(f1,p1,f2,p2,nested-loop)
+    t1,t2=join(f1,p1,f2,p2,sort-merge)
+    t1,t2=join(f1,p1,f2,p2,auto)
 
  so example input would be:
     query_command = "f1,p1,f2,p2,grace-hash"
@@ -842,16 +1145,26 @@ DbOperator *parse_join(char *query_command, char *handle, message *send_message)
   if (status == INCORRECT_FORMAT) handle_error(send_message, error_message);
 
   // Get the columns from the catalog
-  Column *psn1_col = get_handle(psn1);
-  Column *psn2_col = get_handle(psn2);
-  Column *vals1_col = get_handle(vals1);
-  Column *vals2_col = get_handle(vals2);
+  Column *psn1_col = get_materialized_handle(psn1);
+  Column *psn2_col = get_materialized_handle(psn2);
+  // Values fetched through an index range of their own column come out sorted, which a
+  // sort-merge join can use; only the deferred fetch still knows where they come from
+  int vals1_sorted = vals1 && is_sorted_fetch(get_handle(vals1));
+  int vals2_sorted = vals2 && is_sorted_fetch(get_handle(vals2));
+  Column *vals1_column = vals1 ? fetched_column(get_handle(vals1), psn1_col) : NULL;
+  Column *vals2_column = vals2 ? fetched_column(get_handle(vals2), psn2_col) : NULL;
+  Column *vals1_col = get_materialized_handle(vals1);
+  Column *vals2_col = get_materialized_handle(vals2);
 
   if (!psn1_col || !psn2_col || !vals1_col || !vals2_col) {
     log_err("L%d: parse_join failed. one or more of the given handles are invalid\n",
             __LINE__);
     return NULL;
   }
+  if (materialize_positions(psn1_col) != 0 || materialize_positions(psn2_col) != 0) {
+    log_err("L%d: parse_join failed. could not materialize positions\n", __LINE__);
+    return NULL;
+  }
 
   // Make DbOperator for join
   DbOperator *dbo = malloc(sizeof(DbOperator));
@@ -865,6 +1178,10 @@ DbOperator *parse_join(char *query_command, char *handle, message *send_message)
   dbo->operator_fields.join_operator.posn2 = psn2_col;
   dbo->operator_fields.join_operator.vals1 = vals1_col;
   dbo->operator_fields.join_operator.vals2 = vals2_col;
+  dbo->operator_fields.join_operator.vals1_sorted = vals1_sorted;
+  dbo->operator_fields.join_operator.vals2_sorted = vals2_sorted;
+  dbo->operator_fields.join_operator.vals1_column = vals1_column;
+  dbo->operator_fields.join_operator.vals2_column = vals2_column;
 
   // split the handle into two table names
   char *handle1 = strsep(&handle, ",");
@@ -886,6 +1203,12 @@ DbOperator *parse_join(char *query_command, char *handle, message *send_message)
     case 'h':  // hash
       dbo->operator_fields.join_operator.join_type = HASH;
       break;
+    case 's':  // sort-merge
+      dbo->operator_fields.join_operator.join_type = SORT_MERGE;
+      break;
+    case 'a':  // auto
+      dbo->operator_fields.join_operator.join_type = AUTO;
+      break;
     default:
       log_err("L%d: parse_join failed. invalid join type\n", __LINE__);
       return NULL;
@@ -894,3 +1217,82 @@ DbOperator *parse_join(char *query_command, char *handle, message *send_message)
   log_info("Successfully parsed join command\n");
   return dbo;
 }
+
+/**
+ * @brief parse_group_by
+ * Parses a group-by of a value column on a key column, computing one or more of count,
+ * sum, avg, min and max per group. The first handle gets the distinct keys in ascending
+ * order, and each following handle one aggregate, in the order they are listed. Returns
+ * NULL if the arguments are invalid.
+ *
+ * Example query:
+ *     - k,s,c=groupby(f1,f2,sum,count)  --- sum and count of f2 for each value of f1
+ *
+ * @param query_command e.g. (f1,f2,sum,count)
+ * @param handle e.g. k,s,c
+ * @return DbOperator*
+ */
+DbOperator *parse_group_by(char *query_command, char *handle) {
+  message_status status = OK_DONE;
+  char *args = trim_parenthesis(query_command);
+  char *keys_name = next_token(&args, &status);
+  char *vals_name = next_token(&args, &status);
+  if (status == INCORRECT_FORMAT || !args || !handle) {
+    log_err("L%d: parse_group_by failed. Not enough arguments\n", __LINE__);
+    return NULL;
+  }
+
+  size_t num_aggs = 1, num_handles = 1;
+  for (char *p = args; *p; p++) num_aggs += *p == ',';
+  for (char *p = handle; *p; p++) num_handles += *p == ',';
+  if (num_handles != num_aggs + 1) {
+    log_err("L%d: parse_group_by failed. %zu handles for %zu aggregates\n", __LINE__,
+            num_handles, num_aggs);
+    return NULL;
+  }
+
+  DbOperator *dbo = malloc(sizeof(DbOperator));
+  if (!dbo) return NULL;
+  dbo->type = GROUP_BY;
+  GroupByOperator *group_op = &dbo->operator_fields.group_by_operator;
+  group_op->num_aggs = num_aggs;
+  group_op->aggs = malloc(sizeof(GroupAggregate) * num_aggs);
+  group_op->res_handles = malloc(sizeof(char *) * num_handles);
+  if (!group_op->aggs || !group_op->res_handles) {
+    db_operator_free(dbo);
+    return NULL;
+  }
+
+  for (size_t i = 0; i < num_handles; i++) {
+    group_op->res_handles[i] = strsep(&handle, ",");
+  }
+  for (size_t i = 0; i < num_aggs; i++) {
+    char *agg = strsep(&args, ",");
+    if (strcmp(agg, "count") == 0) {
+      group_op->aggs[i] = GROUP_COUNT;
+    } else if (strcmp(agg, "sum") == 0) {
+      group_op->aggs[i] = GROUP_SUM;
+    } else if (strcmp(agg, "avg") == 0) {
+      group_op->aggs[i] = GROUP_AVG;
+    } else if (strcmp(agg, "min") == 0) {
+      group_op->aggs[i] = GROUP_MIN;
+    } else if (strcmp(agg, "max") == 0) {
+      group_op->aggs[i] = GROUP_MAX;
+    } else {
+      log_err("L%d: parse_group_by failed. invalid aggregate %s\n", __LINE__, agg);
+      db_operator_free(dbo);
+      return NULL;
+    }
+  }
+
+  group_op->keys = get_chandle_or_dbtblcol(keys_name);
+  group_op->vals = get_chandle_or_dbtblcol(vals_name);
+  if (!group_op->keys || !group_op->vals) {
+    log_err("L%d: parse_group_by failed. invalid key or value column\n", __LINE__);
+    db_operator_free(dbo);
+    return NULL;
+  }
+
+  log_info("Successfully parsed group by command\n");
+  return dbo;
+}
@@ -50,6 +50,9 @@ Table *get_table_from_catalog(const char *table_name);
 Status load_data(const char *table_name, const char *column_name, const void *data,
                  size_t num_elements);
 
+// (Re)builds the zone maps of every loaded column in the table, e.g. after a bulk load
+void build_zone_maps(Table *table);
+
 // Shutdown the catalog manager
 Status shutdown_catalog_manager(void);
 
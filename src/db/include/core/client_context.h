@@ -21,7 +21,10 @@ extern ClientContext *g_client_context;
 
 void init_client_context(void);
 void free_client_context(void);
+int reserve_handles(size_t n);
 int create_new_handle(const char *name, Column **out_column);
 Column *get_handle(const char *name);
+int materialize_positions(Column *handle);
+int materialize_ranges_on(Column *col);
 
 #endif
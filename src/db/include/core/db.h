@@ -3,8 +3,12 @@
 
 #include <stdlib.h>
 
+#include "bitvector.h"
 #include "btree.h"
+#include "cracker.h"
 #include "common.h"
+#include "threadpool.h"
+#include "zonemap.h"
 
 /**
  * @brief ColumnIndex is the sorted copy of the base data in a column.
@@ -16,6 +20,15 @@
  * - `sorted_data`: the sorted data array
  * - `positions`: the positions of the data in the original array
  * - `idx_type`: the type of index (see `IndexType` enum)
+ * - `clustered`: the base data itself is in sorted order (e.g. after clustering on this
+ *   column), so `positions[i] == i` and a run of the sorted data is a run of the column
+ * - `cracker`: for CRACKED indexes, which have no sorted data: the cracker column, built
+ *   by the first select and refined by every select after it (NULL until then)
+ * - `file`: the index file `sorted_data` and `positions` are mapped from, if they were
+ *   loaded from disk and not changed since (NULL if they are on the heap)
+ * - `eytzinger`, `eytzinger_ranks`: for SORTED_EYTZINGER indexes, `sorted_data` laid out
+ *   in BFS order for lookups (see `eytzinger_build`); NULL after an insert, until the
+ *   next lookup lays it out again. Mapped from `file` along with the arrays, if it is set
  * The number of elements in the `sorted_data` and `positions` arrays must be the same as
  * column's `Column->num_elements`. So storing it would be redundant (maybe helpful tho)
  */
@@ -23,8 +36,26 @@ typedef struct ColumnIndex {
   int *sorted_data;
   int *positions;
   IndexType idx_type;
+  int clustered;
+  Cracker *cracker;
+  IndexFile *file;
+  int *eytzinger;
+  uint32_t *eytzinger_ranks;
 } ColumnIndex;
 
+/**
+ * @brief A select result read straight off an index: the rows whose values are at
+ * [start, end) of `col`'s sorted order. Those rows are the base positions [start, end)
+ * themselves if `clustered`, else `col->index->positions[start..end)`. Nothing is
+ * copied; consumers resolve the positions as they read them (see `range_position`).
+ */
+typedef struct PositionRange {
+  struct Column *col;
+  size_t start;
+  size_t end;
+  int clustered;
+} PositionRange;
+
 typedef struct Column {
   char name[MAX_SIZE_NAME];
   DataType data_type;
@@ -41,8 +72,22 @@ typedef struct Column {
   long min_value;
   long max_value;
   int64_t sum;
+  ZoneMap *zones;  // per-zone min/max of `data`, for skipping in scans (catalog only)
+  // Select results only: the qualifying positions as a bitvector over the scanned
+  // column, in place of a position list in `data`. `num_elements` is its set bit count.
+  Bitvector *bitmap;
+  // Select results only: an index range in place of `data`, if `range.col` is set
+  PositionRange range;
+  // Handles only: the select or fetch that fills this handle, if it has not run yet
+  struct PendingOp *pending;
 } Column;
 
+// Position `i` of an index range select result
+static inline int range_position(const PositionRange *range, size_t i) {
+  return range->clustered ? (int)(range->start + i)
+                          : range->col->index->positions[range->start + i];
+}
+
 /**
  * table
  * Defines a table structure, which is composed of multiple columns.
@@ -82,6 +127,12 @@ typedef struct Db {
 
 extern Db *current_db;
 
+// Shared pool the executor runs its parallel sections on; NULL before db_startup
+extern ThreadPool *worker_pool;
+
+// Bytes a grace hash join may build in before it spills to disk; set by db_startup
+extern size_t join_memory_budget;
+
 /*
  * Use this command to see if databases that were persisted start up properly. If
  * files don't load as expected, this can return an error.
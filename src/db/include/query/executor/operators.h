@@ -3,6 +3,7 @@
 
 #include "client_context.h"
 #include "common.h"
+#include "expr.h"
 
 /*
  * necessary fields for creation
@@ -45,13 +46,13 @@ typedef struct LoadOperator {
  * A comparator defines a comparison operation over a column.
  **/
 typedef struct Comparator {
-  Column *col;      // the column to compare against.
-  int *ref_posns;   // original positions of the values in the column.
-  long int p_low;   // used in equality and ranges.
-  long int p_high;  // used in range compares.
+  Column *col;                  // the column to compare against.
+  int *ref_posns;               // original positions of the values in the column.
+  const Bitvector *ref_bitmap;  // or, the bitmap select result holding them.
+  long int p_low;               // used in equality and ranges.
+  long int p_high;              // used in range compares.
   ComparatorType type1;
   ComparatorType type2;
-  int on_sorted_data;
 } Comparator;
 
 typedef struct SelectOperator {
@@ -65,17 +66,46 @@ typedef struct FetchOperator {
   Column *col;
 } FetchOperator;
 
+/*
+ * fetch of several columns at the same select result, in one pass over its positions:
+ * fetch_handles[i] gets the values of cols[i]
+ */
+typedef struct MultiFetchOperator {
+  char **fetch_handles;
+  char *select_handle;
+  Column **cols;
+  size_t num_cols;
+} MultiFetchOperator;
+
 typedef struct AggregateOperator {
   Column *col;
   char *res_handle;
 } AggregateOperator;
 
+/*
+ * element-wise col1 op col2; either operand (not both) may instead be a constant, in
+ * which case its column is NULL and its constant is used in every row
+ */
 typedef struct ArithmeticOperator {
   Column *col1;
   Column *col2;
+  int constant1;
+  int constant2;
   char *res_handle;
 } ArithmeticOperator;
 
+/*
+ * an arithmetic expression over columns and constants, as postfix `steps`; cols[i] is
+ * the column read by steps[i], or NULL if it reads no column. Its `values` are only
+ * filled in at execution.
+ */
+typedef struct ExprOperator {
+  ExprStep *steps;
+  Column **cols;
+  size_t num_steps;
+  char *res_handle;
+} ExprOperator;
+
 typedef struct PrintOperator {
   Column **columns;
   size_t num_columns;
@@ -89,8 +119,38 @@ typedef struct JoinOperator {
   char *res_handle1;
   char *res_handle2;
   JoinType join_type;
+  // The values are known to be in ascending order: fetched through an index range of
+  // their own column (see `is_sorted_fetch`)
+  int vals1_sorted;
+  int vals2_sorted;
+  // The base columns the values were fetched from at the positions of posn1/posn2, or
+  // NULL (see `fetched_column`): an auto join may look up their indexes instead
+  Column *vals1_column;
+  Column *vals2_column;
 } JoinOperator;
 
+// aggregates a group-by computes for each group
+typedef enum GroupAggregate {
+  GROUP_COUNT,
+  GROUP_SUM,
+  GROUP_AVG,
+  GROUP_MIN,
+  GROUP_MAX
+} GroupAggregate;
+
+/*
+ * group-by of `vals` on `keys`, which are the same length: res_handles[0] gets the
+ * distinct keys in ascending order, and res_handles[i + 1] the aggregate aggs[i] of the
+ * values of each of them
+ */
+typedef struct GroupByOperator {
+  Column *keys;
+  Column *vals;
+  GroupAggregate *aggs;
+  size_t num_aggs;
+  char **res_handles;
+} GroupByOperator;
+
 /*
  * union type holding the fields of any operator
  */
@@ -101,10 +161,13 @@ typedef union OperatorFields {
   LoadOperator load_operator;
   SelectOperator select_operator;
   FetchOperator fetch_operator;
+  MultiFetchOperator multi_fetch_operator;
   PrintOperator print_operator;
   AggregateOperator aggregate_operator;
   ArithmeticOperator arithmetic_operator;
+  ExprOperator expr_operator;
   JoinOperator join_operator;
+  GroupByOperator group_by_operator;
 } OperatorFields;
 /*
  * DbOperator holds the following fields:
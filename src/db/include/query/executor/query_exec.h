@@ -2,6 +2,12 @@
 #define SELECT_H
 
 #include "operators.h"
+#include "simd.h"
+
+// Returns the shared worker pool when an operator over `n_elements` values should run
+// its parallel section on it, or NULL to run on the calling thread (small inputs, or the
+// client asked for single_core()).
+ThreadPool *executor_pool(const DbOperator *query, size_t n_elements);
 
 // CREATE Operations
 // ------------------
@@ -15,9 +21,45 @@ void exec_create(DbOperator *query, message *send_message);
 // Executes a select query
 void exec_select(DbOperator *query, message *send_message);
 void exec_batch_select(DbOperator *query, message *send_message);
+// Runs a select into an existing, empty handle
+void select_into(DbOperator *query, Column *result, message *send_message);
+// Resolves a comparator to the scan kernel predicate that evaluates it
+ScanPredicate comparator_predicate(const Comparator *comparator);
 
 // Executes a fetch query
 void exec_fetch(DbOperator *query, message *send_message);
+// Runs a fetch of a select result into an existing, empty handle
+void fetch_into(DbOperator *query, Column *positions, Column *fetch_result,
+                message *send_message);
+// Executes a fetch of several columns with one pass over the select result
+void exec_multi_fetch(DbOperator *query, message *send_message);
+
+// PIPELINING
+//-----------
+// Selects and the fetches over them are deferred until their handles are read, so that
+// an aggregate over a fetch can run select -> fetch -> aggregate as one fused pass and
+// leave both handles unmaterialized (see pipeline.c).
+
+// Defers the select `query` into `result` if it is a plain scan; 1 if deferred
+int defer_select(DbOperator *query, Column *result);
+// Defers the fetch `query` of `positions` into `result` if `positions` is a deferred
+// select or an index range; 1 if deferred
+int defer_fetch(DbOperator *query, Column *positions, Column *result);
+// Whether `handle` is a deferred fetch, whose stats `pipeline_stats` can compute
+int is_deferred_fetch(const Column *handle);
+// Whether `handle` is a deferred fetch of a column through an index range of that same
+// column, so that its values will come out in ascending order. Runs the range's select.
+int is_sorted_fetch(Column *handle);
+// The column `handle` is a deferred fetch of, if it fetches at exactly the positions of
+// the `positions` handle, so that the column's index can stand in for its values; NULL
+// otherwise
+Column *fetched_column(const Column *handle, const Column *positions);
+// Fills in the num_elements/sum/min/max of a deferred fetch without materializing it
+int pipeline_stats(Column *handle);
+// Runs the deferred operator of `handle`, if any, so that its data can be read
+int exec_pending(Column *handle);
+// Runs every deferred operator, before the data they read is modified
+void exec_all_pending(ClientContext *context);
 
 // UPDATE Operations
 //------------------
@@ -32,11 +74,18 @@ void exec_insert(DbOperator *query, message *send_message);
 void exec_aggr(DbOperator *query, message *send_message);
 // Executes an arithmetic operation
 void exec_arithmetic(DbOperator *query, message *send_message);
+// Evaluates an arithmetic expression in one pass, without intermediate handles
+void exec_expr(DbOperator *query, message *send_message);
 
 // JOIN Operations
 //----------------
 void exec_join(DbOperator *query, message *send_message);
 
+// GROUPING Operations
+//--------------------
+// Executes a hash group-by, pre-aggregating per worker and merging the workers' groups
+void exec_group_by(DbOperator *query, message *send_message);
+
 // DELETE Operations
 //------------------
 
@@ -8,23 +8,40 @@
 void create_idx_on(Column* col, message* send_message);
 void cluster_idx_on(Table* table, Column* primary_col, message* send_message);
 
+// For keeping an index up to date with inserts
+int idx_insert(Column* col);
+
 /**
- * @brief Uses `col->index` to return the index of a value in the column's data.
- *
- * Can return 3 values:
- *
- * - Index `i` s.t. `col->data[i - 1] < value < col->data[i+1]`
- *
- *  - or -1 if `value < min_value`
- *
- *  - or -2 if `value > max_value`
+ * @brief Writes the sorted or btree index of `col` to the index file at `path`, unless
+ * it is still mapped from that file unchanged.
+ * @return 0 on success or if there is nothing to write, -1 on failure
+ */
+int save_idx(Column* col, const char* path);
+
+/**
+ * @brief Maps the sorted or btree index of `col` from the index file at `path`, instead
+ * of building it, in time independent of the column's size. The file must match the
+ * column.
+ * @return 0 on success, -1 if the index must be built (the index is left empty)
+ */
+int load_idx(Column* col, const char* path);
+
+// Frees the index of `col` and its btree, however they were made
+void free_idx(Column* col);
+
+/**
+ * @brief Uses the sorted index `col->index` to bound `value` in its sorted data: the
+ * index of the first element >= `value` (lower bound) or > `value` (upper bound), or
+ * `col->num_elements` if there is none. The values in [low, high] are exactly
+ * `sorted_data[idx_lower_bound(col, low)..idx_upper_bound(col, high))`. A
+ * SORTED_EYTZINGER index searches its Eytzinger layout instead of the sorted data.
  *
  * @param col           Column with an index
  * @param value
- * @return ssize_t
+ * @return size_t
  */
-size_t idx_lookup_left(Column* column, int value);
+size_t idx_lower_bound(Column* column, int value);
 
-size_t idx_lookup_right(Column* column, int value);
+size_t idx_upper_bound(Column* column, int value);
 
 #endif /*  OPTIMIZER_H */
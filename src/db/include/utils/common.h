@@ -13,13 +13,34 @@
 #define HANDLE_MAX_SIZE 64
 #define MAX_PATH_LEN 512
 #define NUM_ELEMENTS_TO_MULTITHREAD 10000
+// Workers in the shared thread pool started by db_startup; 0 means one per online core.
+// Can be overridden at startup through the environment variable below.
+#ifndef NUM_WORKER_THREADS
+#define NUM_WORKER_THREADS 0
+#endif
+#define WORKER_THREADS_ENV "CS165_WORKERS"
+// Memory, in MiB, a grace hash join builds its hash tables in; a larger build side is
+// spilled to partitions under STORAGE_PATH. Can be overridden at startup through the
+// environment variable below.
+#ifndef JOIN_MEMORY_BUDGET_MB
+#define JOIN_MEMORY_BUDGET_MB 1024
+#endif
+#define JOIN_MEMORY_ENV "CS165_JOIN_MEMORY_MB"
+// Values per morsel, the unit of work parallel operators hand to the worker pool
+#define MORSEL_SIZE 16384
+// Values summarized by one zone map entry; a multiple of the select block size so scans
+// can skip whole blocks
+#define ZONE_SIZE 1024
+// Estimated fraction of qualifying rows above which a select returns a bitvector instead
+// of a position list: 1 bit per row beats 32 bits per match at 1/32, and the margin
+// covers estimation error and the cost of iterating sparse words
+#define BITMAP_RESULT_SELECTIVITY 0.0625
 #define STORAGE_PATH "disk"
 
 // CSV Transfer Constants
 #define CSV_BUFFER_SIZE 1024
 #define MAX_COLUMNS 100  // TODO: Make this dynamic in upcoming milestones
 #define CSV_CHUNK_SIZE 4096
-#define BTREE_FANOUT 1024
 
 typedef struct {
   char column_name[256];  // of the form "db.table.column"
@@ -56,6 +77,7 @@ typedef enum OperatorType {
   EXEC_BATCH,
   SELECT,
   FETCH,
+  MULTI_FETCH,
   PRINT,
   AVG,
   MIN,
@@ -63,7 +85,11 @@ typedef enum OperatorType {
   SUM,
   ADD,
   SUB,
+  MUL,
+  DIV,
+  EXPR,
   JOIN,
+  GROUP_BY,
   SHUTDOWN,
 } OperatorType;
 
@@ -89,17 +115,29 @@ typedef enum IndexType {
   SORTED_CLUSTERED,
   SORTED_UNCLUSTERED,
   NONE,
+  CRACKED,  // after NONE, so that persisted index types keep their values
+  SORTED_EYTZINGER,  // unclustered sorted index searched through an Eytzinger layout
 } IndexType;
 /**
- * @brief  Parses the following 4 types of join queries:
+ * @brief  Parses the following 6 types of join queries:
 
     t1,t2=join(f1,p1,f2,p2,grace-hash)
     t1,t2=join(f1,p1,f2,p2,naive-hash)
     t1,t2=join(f1,p1,f2,p2,hash)
     t1,t2=join(f1,p1,f2,p2,nested-loop)
+    t1,t2=join(f1,p1,f2,p2,sort-merge)
+    t1,t2=join(f1,p1,f2,p2,auto)
  *
+ * AUTO picks one of the others, or an index nested loop join, by estimated cost.
  */
-typedef enum JoinType { GRACE_HASH, NAIVE_HASH, HASH, NESTED_LOOP } JoinType;
+typedef enum JoinType {
+  GRACE_HASH,
+  NAIVE_HASH,
+  HASH,
+  NESTED_LOOP,
+  SORT_MERGE,
+  AUTO
+} JoinType;
 
 /**
  * Error codes used to indicate the outcome of an API call
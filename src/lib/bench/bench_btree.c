@@ -0,0 +1,146 @@
+/*
+ * Lookup latency of the B-tree index against the alternatives it replaced: a binary
+ * search over the sorted data, and the previous tree layout (one flat key array per
+ * level, fanout 1024, binary searched); and of the same data in Eytzinger layout. Each
+ * lookup is a lower bound of a random key into a column of `n` distinct values. Then the
+ * cost of inserting random keys into the tree, and of lookups once it has grown by that
+ * many keys.
+ *
+ * Usage: make bench && ./bench_btree [n_lookups]
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "algorithms.h"
+#include "btree.h"
+#include "simd.h"
+#include "utils.h"
+
+#define LEVEL_TREE_FANOUT 1024
+
+// The previous layout: level l holds every (fanout^(depth - l))-th key
+typedef struct LevelTree {
+  int* levels[8];
+  size_t n_keys[8];
+  size_t n_levels;
+} LevelTree;
+
+static LevelTree level_tree_create(const int* data, size_t n) {
+  LevelTree tree = {.n_levels = 0};
+  size_t stride = 1;
+  while (stride * LEVEL_TREE_FANOUT < n) stride *= LEVEL_TREE_FANOUT;
+  for (; stride > 0; stride /= LEVEL_TREE_FANOUT) {
+    size_t n_keys = (n + stride - 1) / stride;
+    int* keys = malloc(sizeof(int) * n_keys);
+    for (size_t j = 0; j < n_keys; j++) keys[j] = data[j * stride];
+    tree.levels[tree.n_levels] = keys;
+    tree.n_keys[tree.n_levels++] = n_keys;
+  }
+  return tree;
+}
+
+// First key >= `key`: binary search each level within the window the level above left
+static size_t level_tree_lower_bound(const LevelTree* tree, int key) {
+  size_t lo = 0, hi = tree->n_keys[0];
+  for (size_t l = 0;; l++) {
+    const int* keys = tree->levels[l];
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (keys[mid] < key) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    if (l + 1 == tree->n_levels) return lo;
+    size_t p = lo, child_keys = tree->n_keys[l + 1];
+    lo = p > 0 ? (p - 1) * LEVEL_TREE_FANOUT + 1 : 0;
+    hi = p * LEVEL_TREE_FANOUT < child_keys ? p * LEVEL_TREE_FANOUT : child_keys;
+  }
+}
+
+static void level_tree_free(LevelTree* tree) {
+  for (size_t l = 0; l < tree->n_levels; l++) free(tree->levels[l]);
+}
+
+int main(int argc, char** argv) {
+  size_t n_lookups = argc > 1 ? strtoul(argv[1], NULL, 10) : 2000000;
+  size_t sizes[] = {1000, 100000, 1000000, 10000000, 50000000};
+  static const char* level_names[] = {"scalar", "avx2", "avx512"};
+  SimdLevel detected = simd_level();
+
+  int* probes = malloc(sizeof(int) * n_lookups);
+  printf("%12s %14s %14s %14s", "keys", "binary search", "eytzinger", "level tree");
+  for (int level = SIMD_SCALAR; level <= (int)detected; level++) {
+    printf("   btree %-6s", level_names[level]);
+  }
+  printf(" %14s %14s   (ns per operation)\n", "btree insert", "after inserts");
+
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    size_t n = sizes[s];
+    int* data = malloc(sizeof(int) * n);
+    for (size_t i = 0; i < n; i++) data[i] = (int)(i * 3);
+    for (size_t i = 0; i < n_lookups; i++) probes[i] = rand() % (int)(n * 3);
+
+    // Sum the results so the lookups cannot be optimized away
+    size_t checksum = 0, expected;
+    double t0 = get_time();
+    for (size_t i = 0; i < n_lookups; i++) {
+      checksum += sorted_lower_bound(data, n, probes[i]);
+    }
+    double binary_ns = (get_time() - t0) * 1e3 / n_lookups;
+    expected = checksum;
+
+    int* keys = aligned_alloc(64, sizeof(int) * ((n + 16) / 16 * 16));
+    uint32_t* ranks = malloc(sizeof(uint32_t) * (n + 1));
+    eytzinger_build(data, n, keys, ranks);
+    checksum = 0;
+    t0 = get_time();
+    for (size_t i = 0; i < n_lookups; i++) {
+      checksum += eytzinger_lower_bound(keys, ranks, n, probes[i]);
+    }
+    double eytzinger_ns = (get_time() - t0) * 1e3 / n_lookups;
+    free(keys);
+    free(ranks);
+    if (checksum != expected) log_err("bench_btree: eytzinger lookups disagree\n");
+
+    LevelTree level_tree = level_tree_create(data, n);
+    checksum = 0;
+    t0 = get_time();
+    for (size_t i = 0; i < n_lookups; i++) {
+      checksum += level_tree_lower_bound(&level_tree, probes[i]);
+    }
+    double level_tree_ns = (get_time() - t0) * 1e3 / n_lookups;
+    level_tree_free(&level_tree);
+    if (checksum != expected) log_err("bench_btree: level tree lookups disagree\n");
+    printf("%12zu %14.1f %14.1f %14.1f", n, binary_ns, eytzinger_ns, level_tree_ns);
+
+    Btree* tree = btree_create(data, NULL, n);
+    for (int level = SIMD_SCALAR; level <= (int)detected; level++) {
+      simd_force_level((SimdLevel)level);
+      checksum = 0;
+      t0 = get_time();
+      for (size_t i = 0; i < n_lookups; i++) {
+        checksum += btree_cursor_rowid(tree, btree_lower_bound(tree, probes[i]));
+      }
+      printf(" %15.1f", (get_time() - t0) * 1e3 / n_lookups);
+      if (checksum != expected) log_err("bench_btree: btree lookups disagree\n");
+    }
+    simd_force_level(detected);
+
+    // The probes themselves, as new rows
+    t0 = get_time();
+    for (size_t i = 0; i < n_lookups; i++) btree_insert(tree, probes[i], n + i);
+    printf(" %14.1f", (get_time() - t0) * 1e3 / n_lookups);
+    t0 = get_time();
+    for (size_t i = 0; i < n_lookups; i++) {
+      checksum += btree_cursor_rowid(tree, btree_lower_bound(tree, probes[i]));
+    }
+    printf(" %14.1f\n", (get_time() - t0) * 1e3 / n_lookups);
+    free_btree(tree);
+    free(data);
+  }
+  free(probes);
+  return 0;
+}
@@ -0,0 +1,139 @@
+/*
+ * Build and probe cost of the open-addressing hash table against the chained table it
+ * replaced (`key % num_buckets`, a malloc'd node per value and entry per key). Each
+ * table maps `n` keys, either all distinct or 16 values per key, to row ids, then is
+ * probed with `n` keys of which half are in the table: the probes of a hash join.
+ *
+ * Usage: make bench && ./bench_hash_table [max_n]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hash_table.h"
+#include "utils.h"
+
+typedef struct ChainedNode {
+  int value;
+  struct ChainedNode* next;
+} ChainedNode;
+
+typedef struct ChainedEntry {
+  int key;
+  ChainedNode* values;
+  struct ChainedEntry* next;
+} ChainedEntry;
+
+// The previous table, as it was
+typedef struct ChainedTable {
+  ChainedEntry** buckets;
+  size_t num_buckets;
+} ChainedTable;
+
+static void chained_put(ChainedTable* ht, int key, int value) {
+  size_t bucket = (unsigned int)key % ht->num_buckets;
+  ChainedNode* node = malloc(sizeof(ChainedNode));
+  node->value = value;
+  node->next = NULL;
+  for (ChainedEntry* e = ht->buckets[bucket]; e; e = e->next) {
+    if (e->key == key) {
+      node->next = e->values;
+      e->values = node;
+      return;
+    }
+  }
+  ChainedEntry* entry = malloc(sizeof(ChainedEntry));
+  entry->key = key;
+  entry->values = node;
+  entry->next = ht->buckets[bucket];
+  ht->buckets[bucket] = entry;
+}
+
+// Sum of the values of `key`
+static size_t chained_sum(const ChainedTable* ht, int key) {
+  ChainedEntry* e = ht->buckets[(unsigned int)key % ht->num_buckets];
+  for (; e; e = e->next) {
+    if (e->key != key) continue;
+    size_t sum = 0;
+    for (ChainedNode* v = e->values; v; v = v->next) sum += v->value;
+    return sum;
+  }
+  return 0;
+}
+
+static void chained_free(ChainedTable* ht) {
+  for (size_t b = 0; b < ht->num_buckets; b++) {
+    for (ChainedEntry* e = ht->buckets[b]; e;) {
+      for (ChainedNode* v = e->values; v;) {
+        ChainedNode* next = v->next;
+        free(v);
+        v = next;
+      }
+      ChainedEntry* next = e->next;
+      free(e);
+      e = next;
+    }
+  }
+  free(ht->buckets);
+}
+
+// ns per key since `t0` (in microseconds)
+static double ns_per(double t0, size_t n) { return (get_time() - t0) * 1e3 / n; }
+
+int main(int argc, char** argv) {
+  size_t max_n = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000000;
+  printf("%10s %6s | %14s %14s | %14s %14s %14s   (ns per key)\n", "keys", "dups",
+         "chained build", "chained probe", "put build", "bulk build", "probe");
+
+  for (size_t n = 10000; n <= max_n; n *= 10) {
+    for (size_t dups = 1; dups <= 16; dups *= 16) {
+      int* keys = malloc(sizeof(int) * n);
+      int* values = malloc(sizeof(int) * n);
+      int* probes = malloc(sizeof(int) * n);
+      for (size_t i = 0; i < n; i++) {
+        keys[i] = (int)((size_t)rand() % (n / dups)) * 2;
+        values[i] = (int)i;
+        probes[i] = (int)((size_t)rand() % (n / dups)) * 2 + rand() % 2;  // half miss
+      }
+
+      // Probes sum the values they match, as a join reads them, so they cannot be
+      // optimized away
+      ChainedTable chained = {calloc(n, sizeof(ChainedEntry*)), n};
+      double t0 = get_time();
+      for (size_t i = 0; i < n; i++) chained_put(&chained, keys[i], values[i]);
+      double chained_build = ns_per(t0, n);
+      size_t expected = 0;
+      t0 = get_time();
+      for (size_t i = 0; i < n; i++) expected += chained_sum(&chained, probes[i]);
+      double chained_probe = ns_per(t0, n);
+      chained_free(&chained);
+
+      hashtable* ht = NULL;
+      allocate(&ht, (int)n);
+      t0 = get_time();
+      for (size_t i = 0; i < n; i++) put(ht, keys[i], values[i]);
+      double put_build = ns_per(t0, n);
+      deallocate(ht);
+
+      allocate(&ht, (int)n);
+      t0 = get_time();
+      bulk_put(ht, keys, values, n);
+      double bulk_build = ns_per(t0, n);
+      size_t checksum = 0, count;
+      t0 = get_time();
+      for (size_t i = 0; i < n; i++) {
+        const int* run = get_values(ht, probes[i], &count);
+        for (size_t v = 0; v < count; v++) checksum += run[v];
+      }
+      double probe = ns_per(t0, n);
+      deallocate(ht);
+      if (checksum != expected) log_err("bench_hash_table: probes disagree\n");
+
+      printf("%10zu %6zu | %14.1f %14.1f | %14.1f %14.1f %14.1f\n", n, dups,
+             chained_build, chained_probe, put_build, bulk_build, probe);
+      free(keys);
+      free(values);
+      free(probes);
+    }
+  }
+  return 0;
+}
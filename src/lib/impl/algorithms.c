@@ -1,22 +1,137 @@
 #include "algorithms.h"
 
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "utils.h"
 
+// LSD radix sort: one stable counting-sort pass per 8-bit digit, low digit first
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+// Fewest keys a chunk of a parallel pass gets: below that, threads cost more than they
+// save
+#define RADIX_MIN_CHUNK 65536
+
+/**
+ * @brief One pass of `radix_sort`, shared by its chunks: scatters `keys` (and their
+ * positions, or their indexes if `posns` is NULL) into `out_keys`/`out_posns` by the
+ * digit at `shift`. `offsets[chunk * RADIX_BUCKETS + digit]` first holds the chunk's
+ * count of each digit, then where its first key of that digit goes.
+ */
 typedef struct {
-  int value;     // Data value
-  size_t index;  // Original position
-} IndexedValue;
+  const int* keys;
+  const int* posns;
+  int* out_keys;
+  int* out_posns;
+  size_t* offsets;
+  int shift;
+} RadixPass;
+
+// Digit of `key` at `shift`, with the sign bit flipped so negative keys sort first
+static inline unsigned radix_digit(int key, int shift) {
+  return (((unsigned)key ^ 0x80000000u) >> shift) & (RADIX_BUCKETS - 1);
+}
+
+static void radix_histogram(void* arg, size_t chunk, size_t start, size_t end) {
+  RadixPass* pass = (RadixPass*)arg;
+  size_t* counts = pass->offsets + chunk * RADIX_BUCKETS;
+  memset(counts, 0, sizeof(size_t) * RADIX_BUCKETS);
+  for (size_t i = start; i < end; i++) counts[radix_digit(pass->keys[i], pass->shift)]++;
+}
+
+static void radix_scatter(void* arg, size_t chunk, size_t start, size_t end) {
+  RadixPass* pass = (RadixPass*)arg;
+  size_t* offsets = pass->offsets + chunk * RADIX_BUCKETS;
+  const int* keys = pass->keys;
+  if (!pass->posns) {
+    for (size_t i = start; i < end; i++) {
+      size_t dst = offsets[radix_digit(keys[i], pass->shift)]++;
+      pass->out_keys[dst] = keys[i];
+      pass->out_posns[dst] = (int)i;
+    }
+    return;
+  }
+  for (size_t i = start; i < end; i++) {
+    size_t dst = offsets[radix_digit(keys[i], pass->shift)]++;
+    pass->out_keys[dst] = keys[i];
+    pass->out_posns[dst] = pass->posns[i];
+  }
+}
 
 /**
- * @brief Comparator function for qsort, sorts by the `value` field in ascending order.
+ * @brief Turns the chunks' digit counts into their write offsets: chunk c's keys of digit
+ * d go after every key of a smaller digit and after chunks < c's keys of digit d, which
+ * keeps the pass stable.
+ * @return 1 if every key has the same digit (the pass would only copy them), else 0
  */
-int compare_fn(const void* a, const void* b) {
-  const IndexedValue* ia = (const IndexedValue*)a;
-  const IndexedValue* ib = (const IndexedValue*)b;
-  return (ia->value > ib->value) - (ia->value < ib->value);  // Return 1, 0, or -1
+static int radix_offsets(size_t* offsets, size_t n_chunks, size_t n) {
+  size_t total = 0;
+  for (size_t d = 0; d < RADIX_BUCKETS; d++) {
+    size_t digit_start = total;
+    for (size_t c = 0; c < n_chunks; c++) {
+      size_t count = offsets[c * RADIX_BUCKETS + d];
+      offsets[c * RADIX_BUCKETS + d] = total;
+      total += count;
+    }
+    if (total - digit_start == n) return 1;
+  }
+  return 0;
+}
+
+int radix_sort(int* data, size_t n, int* positions, ThreadPool* pool) {
+  if (n == 0) return 0;
+  if (!data || !positions || n > INT_MAX) {
+    log_err("radix_sort: Invalid input; data=%p, positions=%p, n=%zu\n", data, positions,
+            n);
+    return -1;
+  }
+  size_t n_chunks = pool ? threadpool_size(pool) : 1;
+  if (n_chunks > n / RADIX_MIN_CHUNK) n_chunks = n / RADIX_MIN_CHUNK;
+  if (n_chunks == 0) n_chunks = 1;
+
+  int* tmp_keys = malloc(sizeof(int) * n);
+  int* tmp_posns = malloc(sizeof(int) * n);
+  size_t* offsets = malloc(sizeof(size_t) * RADIX_BUCKETS * n_chunks);
+  if (!tmp_keys || !tmp_posns || !offsets) {
+    log_err("radix_sort: Failed to allocate scratch space for %zu keys\n", n);
+    free(tmp_keys);
+    free(tmp_posns);
+    free(offsets);
+    return -1;
+  }
+
+  // Passes ping-pong between the caller's arrays and the scratch ones; until the first
+  // pass that moves anything, every key's position is its index
+  int* key_bufs[2] = {data, tmp_keys};
+  int* posn_bufs[2] = {positions, tmp_posns};
+  int cur = 0, moved = 0;
+  RadixPass pass = {.offsets = offsets};
+  for (int shift = 0; shift < 32; shift += RADIX_BITS) {
+    pass.keys = key_bufs[cur];
+    pass.shift = shift;
+    threadpool_parallel_for(pool, n, n_chunks, radix_histogram, &pass);
+    if (radix_offsets(offsets, n_chunks, n)) continue;
+
+    pass.posns = moved ? posn_bufs[cur] : NULL;
+    pass.out_keys = key_bufs[1 - cur];
+    pass.out_posns = posn_bufs[1 - cur];
+    threadpool_parallel_for(pool, n, n_chunks, radix_scatter, &pass);
+    cur = 1 - cur;
+    moved = 1;
+  }
+
+  if (!moved) {
+    for (size_t i = 0; i < n; i++) positions[i] = (int)i;
+  } else if (cur == 1) {
+    memcpy(data, tmp_keys, sizeof(int) * n);
+    memcpy(positions, tmp_posns, sizeof(int) * n);
+  }
+  free(tmp_keys);
+  free(tmp_posns);
+  free(offsets);
+  return 0;
 }
 
 /**
@@ -36,74 +151,88 @@ int sort(int* data, size_t n_elements, int* original_pos) {
             __LINE__, data, original_pos, n_elements);
     return -1;  // Error: Invalid input
   }
-
-  // Create an auxiliary array to store values and their original indices
-  IndexedValue* indexed_array = (IndexedValue*)malloc(n_elements * sizeof(IndexedValue));
-  if (!indexed_array) {
-    log_err("%Ld: sort: Failed to allocate memory for indexed_array\n", __LINE__);
-    return -1;
-  }
-
-  // Populate the auxiliary array
-  for (size_t i = 0; i < n_elements; i++) {
-    indexed_array[i].value = data[i];
-    indexed_array[i].index = i;
-  }
-
-  // Sort the auxiliary array using qsort
-  qsort(indexed_array, n_elements, sizeof(IndexedValue), compare_fn);
-
-  // Write sorted values back to `data` and store original positions
-  for (size_t i = 0; i < n_elements; i++) {
-    data[i] = indexed_array[i].value;
-    original_pos[i] = indexed_array[i].index;
-  }
-
-  // Free the auxiliary array
-  free(indexed_array);
-
-  return 0;
+  return radix_sort(data, n_elements, original_pos, NULL);
 }
 
 size_t binary_search_right(int* sorted_data, size_t num_elements, int value) {
-  // Binary search for sorted index
-  size_t left = 0;
-  size_t right = num_elements - 1;
+  size_t upper = sorted_upper_bound(sorted_data, num_elements, value);
+  return upper > 0 ? upper - 1 : 0;
+}
 
+size_t sorted_lower_bound(const int* sorted_data, size_t num_elements, int value) {
+  size_t left = 0, right = num_elements;
   while (left < right) {
-    size_t mid = left + (right - left) / 2;  // Floor division
+    size_t mid = left + (right - left) / 2;
+    if (sorted_data[mid] < value) {
+      left = mid + 1;
+    } else {
+      right = mid;
+    }
+  }
+  return left;
+}
 
+size_t sorted_upper_bound(const int* sorted_data, size_t num_elements, int value) {
+  size_t left = 0, right = num_elements;
+  while (left < right) {
+    size_t mid = left + (right - left) / 2;
     if (sorted_data[mid] <= value) {
       left = mid + 1;
     } else {
       right = mid;
     }
   }
+  return left;
+}
 
-  // Find rightmost position where value is strictly less than next element
-  while (((size_t)left < num_elements - 1 && sorted_data[left] <= value)) {
-    left++;
+size_t sorted_run_end(const int* sorted_data, size_t num_elements, size_t start) {
+  int value = sorted_data[start];
+  // Double the step until it overshoots the run, then search the last step
+  size_t step = 1, lo = start + 1;
+  while (lo + step <= num_elements && sorted_data[lo + step - 1] == value) {
+    lo += step;
+    step *= 2;
   }
-  return left > 0 ? left - 1 : 0;
+  size_t hi = lo + step < num_elements ? lo + step : num_elements;
+  return lo + sorted_upper_bound(sorted_data + lo, hi - lo, value);
 }
 
 size_t binary_search_left(int* sorted_data, size_t num_elements, int value) {
-  // Binary search for sorted index
-  size_t left = 0;
-  size_t right = num_elements - 1;
+  return sorted_lower_bound(sorted_data, num_elements, value);
+}
 
-  while (left < right) {
-    size_t mid = left + (right - left + 1) / 2;  // Ceiling division
+// In-order walk of the subtree at node `k`, which takes the sorted values from `next` on
+static size_t eytzinger_fill(const int* sorted_data, size_t n, int* keys, uint32_t* ranks,
+                             size_t next, size_t k) {
+  if (k > n) return next;
+  next = eytzinger_fill(sorted_data, n, keys, ranks, next, 2 * k);
+  keys[k] = sorted_data[next];
+  ranks[k] = (uint32_t)next;
+  return eytzinger_fill(sorted_data, n, keys, ranks, next + 1, 2 * k + 1);
+}
 
-    if (sorted_data[mid] <= value) {
-      left = mid;
-    } else {
-      right = mid - 1;
-    }
-  }
-  while (left > 0 && sorted_data[left] == value) {
-    left--;
+void eytzinger_build(const int* sorted_data, size_t n, int* keys, uint32_t* ranks) {
+  // Node 0 stands for "past the end": a search that only ever went right lands on it
+  keys[0] = INT_MAX;
+  ranks[0] = (uint32_t)n;
+  eytzinger_fill(sorted_data, n, keys, ranks, 0, 1);
+}
+
+size_t eytzinger_lower_bound(const int* keys, const uint32_t* ranks, size_t n,
+                             int value) {
+  size_t k = 1;
+  while (k <= n) {
+    __builtin_prefetch(keys + k * EYTZINGER_PREFETCH);
+    k = 2 * k + (keys[k] < value);
   }
+  // The path went right at every level below the answer: drop those levels, and the
+  // left turn into them
+  k >>= __builtin_ffsll(~k);
+  return ranks[k];
+}
 
-  return sorted_data[left] < value ? left + 1 : left;
+size_t eytzinger_upper_bound(const int* keys, const uint32_t* ranks, size_t n,
+                             int value) {
+  if (value == INT_MAX) return n;
+  return eytzinger_lower_bound(keys, ranks, n, value + 1);
 }
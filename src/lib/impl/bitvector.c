@@ -0,0 +1,62 @@
+#include "bitvector.h"
+
+#include <stdlib.h>
+
+#include "utils.h"
+
+Bitvector* bitvector_create(size_t num_bits) {
+  Bitvector* bv = malloc(sizeof(Bitvector));
+  if (!bv) return NULL;
+  // At least one word, so that an empty bitvector still has valid storage
+  bv->words = calloc(BITVECTOR_WORDS(num_bits) + 1, sizeof(uint64_t));
+  if (!bv->words) {
+    log_err("bitvector_create: Failed to allocate %zu bits\n", num_bits);
+    free(bv);
+    return NULL;
+  }
+  bv->num_bits = num_bits;
+  return bv;
+}
+
+size_t bitvector_count_words(const Bitvector* bv, size_t first_word, size_t end_word) {
+  size_t count = 0;
+  for (size_t w = first_word; w < end_word; w++) {
+    count += __builtin_popcountll(bv->words[w]);
+  }
+  return count;
+}
+
+size_t bitvector_count(const Bitvector* bv) {
+  return bitvector_count_words(bv, 0, BITVECTOR_WORDS(bv->num_bits));
+}
+
+size_t bitvector_next(const Bitvector* bv, size_t from) {
+  if (from >= bv->num_bits) return bv->num_bits;
+  size_t w = from / 64;
+  uint64_t word = bv->words[w] & (~0ULL << (from % 64));
+  size_t num_words = BITVECTOR_WORDS(bv->num_bits);
+  while (!word) {
+    if (++w == num_words) return bv->num_bits;
+    word = bv->words[w];
+  }
+  return w * 64 + __builtin_ctzll(word);
+}
+
+size_t bitvector_positions(const Bitvector* bv, size_t first_word, size_t end_word,
+                           int* out) {
+  size_t k = 0;
+  for (size_t w = first_word; w < end_word; w++) {
+    uint64_t word = bv->words[w];
+    while (word) {
+      out[k++] = (int)(w * 64 + __builtin_ctzll(word));
+      word &= word - 1;
+    }
+  }
+  return k;
+}
+
+void bitvector_free(Bitvector* bv) {
+  if (!bv) return;
+  free(bv->words);
+  free(bv);
+}
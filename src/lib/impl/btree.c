@@ -1,214 +1,464 @@
+#define _GNU_SOURCE
 #include "btree.h"
 
+#include <limits.h>
 #include <sys/types.h>
 
-#include "algorithms.h"
-#include "btree.h"
+#include "simd.h"
 #include "utils.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BTREE_SIMD_X86 1
+#endif
+
 /**
- * @brief Create a Btree level node
- *
- * @pre 🚨 The Caller must ensure that `data` array is sorted and has unique values!!
- *
- * @param data
- * @param n_uniques
- * @param stride
- * @param fanout
- * @param first_idxes
- * @param last_idxes
- * ️
- * @return Btree*
+ * @brief Makes room for `needed` nodes of `node_size` bytes in a node pool, doubling its
+ * capacity. Nodes keep their ids, not their addresses.
+ * @return the moved pool, or NULL on failure, leaving the pool as it was
  */
-Btree* create_level(int* data, size_t n_uniques, size_t stride, size_t fanout,
-                    size_t* first_idxes, size_t* last_idxes) {
-  size_t n_keys = stride > 0 ? (n_uniques + stride - 1) / stride : 0;
-  if (n_keys == 0) return NULL;
-
-  Btree* node = malloc(sizeof(Btree));
-  node->keys = malloc(sizeof(int) * n_keys);
-  node->n_keys = n_keys;
-  node->child_ptr = NULL;
-
-  // Global bookkeeping; see todo in btree.h
-  node->fanout = fanout;
-  node->first_unique_idxes = first_idxes;
-  node->last_unique_idxes = last_idxes;
-  node->n_uniques = n_uniques;
-
-  // Take every stride-th element
-  size_t key_idx = 0;
-  for (size_t i = 0; i < n_uniques && key_idx < n_keys; i += stride) {
-    node->keys[key_idx] = data[i];
-    key_idx++;
-  }
-
-  return node;
-}
-
-Btree* init_btree(int* data, size_t n_elts, size_t fanout) {
-  if (!data || n_elts == 0 || fanout < 2) return NULL;
-  /*
-  Some book keeping first: keep elements in `data` unique and store their first
-  and last occurrences (indices) of unique vals in the `data` array
-  If we have sample input: data[] = {2, 2, 2, 5, 5, 1, 7, 7, 7, 8}; n_elts = 10;
-                                i = [0, 1, 2, 3, 4, 5, 6, 7, 8, 9]
-   We want:
-        - unique_sorted = {2, 5, 1, 7, 8}
-        -  first_left   = {0, 3, 5, 6, 9}
-        -  first_right  = {2, 4, 5, 8, 9}
-
-  */
-  size_t* first_left = malloc(sizeof(size_t) * n_elts);
-  size_t* first_right = malloc(sizeof(size_t) * n_elts);
-  int* unique_sorted = malloc(sizeof(int) * n_elts);
-
-  unique_sorted[0] = data[0];
-  first_left[0] = 0;
-  size_t n_uniques = 0;
-
-  for (size_t i = 1; i < n_elts; i++) {
-    if (data[i] != data[i - 1]) {
-      first_right[n_uniques] = i - 1;  // Close off the current unique element
-      n_uniques++;                     // Move to the next unique index
-      first_left[n_uniques] = i;       // Start new unique element
-      unique_sorted[n_uniques] = data[i];
+static void* grow_pool(void* pool, uint32_t* capacity, size_t node_size, size_t needed) {
+  if (needed >= BTREE_NIL) return NULL;
+  size_t new_capacity = *capacity ? *capacity : 1;
+  while (new_capacity < needed) new_capacity *= 2;
+  if (new_capacity >= BTREE_NIL) new_capacity = BTREE_NIL - 1;
+  void* grown = aligned_alloc(64, node_size * new_capacity);
+  if (!grown) return NULL;
+  if (pool) memcpy(grown, pool, node_size * *capacity);
+  free(pool);
+  *capacity = new_capacity;
+  return grown;
+}
+
+// Copies the pools of a tree loaded from disk out of its file, so they can grow
+static int detach(Btree* tree) {
+  BtreeInner* inners = aligned_alloc(64, sizeof(BtreeInner) * (tree->n_inners + 1));
+  BtreeLeaf* leaves = aligned_alloc(64, sizeof(BtreeLeaf) * tree->n_leaves);
+  if (!inners || !leaves) {
+    free(inners);
+    free(leaves);
+    return -1;
+  }
+  memcpy(inners, tree->inners, sizeof(BtreeInner) * tree->n_inners);
+  memcpy(leaves, tree->leaves, sizeof(BtreeLeaf) * tree->n_leaves);
+  index_file_unmap(tree->file);
+  tree->file = NULL;
+  tree->inners = inners;
+  tree->leaves = leaves;
+  tree->inner_capacity = tree->n_inners + 1;
+  tree->leaf_capacity = tree->n_leaves;
+  return 0;
+}
+
+static int reserve(Btree* tree, size_t n_inners, size_t n_leaves) {
+  if (tree->file && detach(tree) != 0) return -1;
+  if (n_inners > tree->inner_capacity) {
+    void* inners =
+        grow_pool(tree->inners, &tree->inner_capacity, sizeof(BtreeInner), n_inners);
+    if (!inners) return -1;
+    tree->inners = inners;
+  }
+  if (n_leaves > tree->leaf_capacity) {
+    void* leaves =
+        grow_pool(tree->leaves, &tree->leaf_capacity, sizeof(BtreeLeaf), n_leaves);
+    if (!leaves) return -1;
+    tree->leaves = leaves;
+  }
+  return 0;
+}
+
+// The next free node of each pool, which must have been reserved
+static uint32_t new_inner(Btree* tree) {
+  BtreeInner* node = &tree->inners[tree->n_inners];
+  for (size_t j = 0; j < BTREE_NODE_KEYS; j++) node->keys[j] = INT_MAX;
+  node->n = 0;
+  return tree->n_inners++;
+}
+
+static uint32_t new_leaf(Btree* tree) {
+  BtreeLeaf* leaf = &tree->leaves[tree->n_leaves];
+  for (size_t j = 0; j < BTREE_LEAF_KEYS; j++) leaf->keys[j] = INT_MAX;
+  leaf->n = 0;
+  leaf->next = BTREE_NIL;
+  return tree->n_leaves++;
+}
+
+Btree* btree_create(const int* keys, const int* rowids, size_t n_elts) {
+  if ((n_elts > 0 && !keys) || n_elts >= UINT32_MAX) return NULL;
+  Btree* tree = calloc(1, sizeof(Btree));
+  if (!tree) return NULL;
+
+  // The leaves, chained in order; an empty tree is a single empty leaf
+  size_t n_leaves = n_elts ? (n_elts + BTREE_LEAF_FILL - 1) / BTREE_LEAF_FILL : 1;
+  uint32_t* level = malloc(sizeof(uint32_t) * n_leaves);
+  int* mins = malloc(sizeof(int) * n_leaves);
+  if (!level || !mins || reserve(tree, 0, n_leaves) != 0) {
+    free(level);
+    free(mins);
+    free_btree(tree);
+    return NULL;
+  }
+  for (size_t l = 0; l < n_leaves; l++) {
+    BtreeLeaf* leaf = &tree->leaves[new_leaf(tree)];
+    size_t first = l * BTREE_LEAF_FILL;
+    size_t count = n_elts - first < BTREE_LEAF_FILL ? n_elts - first : BTREE_LEAF_FILL;
+    for (size_t j = 0; j < count; j++) {
+      leaf->keys[j] = keys[first + j];
+      leaf->rowids[j] = rowids ? (uint32_t)rowids[first + j] : (uint32_t)(first + j);
     }
+    leaf->n = count;
+    leaf->next = l + 1 < n_leaves ? l + 1 : BTREE_NIL;
+    level[l] = l;
+    mins[l] = leaf->keys[0];
   }
-  first_right[n_uniques] = n_elts - 1;  // Close off the last unique element
-  // Set `n_uniques` to the actual number of unique elements
-  n_uniques++;
+  tree->n_elts = n_elts;
 
-  // Calculate number of levels needed: this is (log_{fanout} n_elts) - 1
-  //  a -1 because the last level with all values is the `data` array itself
-  size_t stride = 1;
-  size_t n_levels = 0;
-  while (stride * fanout < n_uniques) {
-    stride *= fanout;
-    n_levels++;
+  // Then the inner levels bottom up, until one node is left: `level` holds the ids of
+  // the nodes of the level below, and `mins` their smallest keys
+  size_t n_level = n_leaves;
+  while (n_level > 1) {
+    size_t n_parents = (n_level + BTREE_NODE_FILL - 1) / BTREE_NODE_FILL;
+    if (reserve(tree, tree->n_inners + n_parents, 0) != 0) {
+      free(level);
+      free(mins);
+      free_btree(tree);
+      return NULL;
+    }
+    for (size_t p = 0; p < n_parents; p++) {
+      uint32_t id = new_inner(tree);
+      BtreeInner* node = &tree->inners[id];
+      size_t first = p * BTREE_NODE_FILL;
+      size_t count =
+          n_level - first < BTREE_NODE_FILL ? n_level - first : BTREE_NODE_FILL;
+      for (size_t c = 0; c < count; c++) {
+        node->children[c] = level[first + c];
+        if (c > 0) node->keys[c - 1] = mins[first + c];
+      }
+      node->n = count;
+      level[p] = id;
+      mins[p] = mins[first];
+    }
+    n_level = n_parents;
+    tree->height++;
   }
+  tree->root = level[0];
+  free(level);
+  free(mins);
+  return tree;
+}
 
-  n_levels++;  // Add the last level
+// Number of keys of a 16-key node that are < `key`; the keys are sorted, so this is
+// the rank
+static inline __attribute__((always_inline)) size_t rank_scalar(const int* node,
+                                                                int key) {
+  size_t rank = 0;
+  for (size_t j = 0; j < BTREE_NODE_KEYS; j++) rank += node[j] < key;
+  return rank;
+}
 
-  Btree** levels = malloc(sizeof(Btree*) * (n_levels));
-  size_t current_stride = stride;
+/**
+ * @brief Slot of the first key >= `key` in the leaf it would be in. Descends from the
+ * root, one node per level: if `rank` separators of a node are < `key`, the keys of its
+ * first `rank` children all are too. The slot may be the end of the leaf.
+ */
+static inline __attribute__((always_inline)) BtreeCursor descend(
+    const Btree* tree, int key, size_t (*rank)(const int*, int)) {
+  uint32_t node = tree->root;
+  for (size_t l = 0; l < tree->height; l++) {
+    const BtreeInner* inner = &tree->inners[node];
+    node = inner->children[rank(inner->keys, key)];
+  }
+  const int* keys = tree->leaves[node].keys;
+  size_t slot = 0;
+  for (size_t j = 0; j < BTREE_LEAF_KEYS; j += BTREE_NODE_KEYS) {
+    slot += rank(keys + j, key);
+  }
+  return (BtreeCursor){node, (uint32_t)slot};
+}
+
+static BtreeCursor descend_scalar(const Btree* tree, int key) {
+  return descend(tree, key, rank_scalar);
+}
+
+#ifdef BTREE_SIMD_X86
+static inline __attribute__((always_inline, target("avx2,popcnt"))) size_t rank_avx2(
+    const int* node, int key) {
+  __m256i k = _mm256_set1_epi32(key);
+  __m256i lo = _mm256_cmpgt_epi32(k, _mm256_load_si256((const __m256i*)node));
+  __m256i hi = _mm256_cmpgt_epi32(k, _mm256_load_si256((const __m256i*)(node + 8)));
+  unsigned mask = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(lo)) |
+                  (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(hi)) << 8;
+  return (size_t)__builtin_popcount(mask);
+}
+
+__attribute__((target("avx2,popcnt"))) static BtreeCursor descend_avx2(const Btree* tree,
+                                                                      int key) {
+  return descend(tree, key, rank_avx2);
+}
+
+static inline __attribute__((always_inline, target("avx512f,popcnt"))) size_t
+rank_avx512(const int* node, int key) {
+  __mmask16 mask = _mm512_cmplt_epi32_mask(_mm512_load_si512((const void*)node),
+                                           _mm512_set1_epi32(key));
+  return (size_t)__builtin_popcount((unsigned)mask);
+}
 
-  // Create each level, starting from the root
-  for (size_t i = 0; i < n_levels; i++) {
-    levels[i] = create_level(unique_sorted, n_uniques, current_stride, fanout, first_left,
-                             first_right);
-    current_stride /= fanout;
+__attribute__((target("avx512f,popcnt"))) static BtreeCursor descend_avx512(
+    const Btree* tree, int key) {
+  return descend(tree, key, rank_avx512);
+}
+#endif
+
+// Moves a cursor past the end of its leaf to the start of the next one
+static BtreeCursor normalize(const Btree* tree, BtreeCursor cursor) {
+  while (cursor.leaf != BTREE_NIL && cursor.slot >= tree->leaves[cursor.leaf].n) {
+    cursor = (BtreeCursor){tree->leaves[cursor.leaf].next, 0};
   }
+  return cursor;
+}
 
-  // Link the levels
-  for (size_t i = 0; i < n_levels - 1; i++) {
-    levels[i]->child_ptr = levels[i + 1];
+BtreeCursor btree_lower_bound(const Btree* tree, int key) {
+  if (!tree) return btree_end();
+  switch (simd_level()) {
+#ifdef BTREE_SIMD_X86
+    case SIMD_AVX512:
+      return normalize(tree, descend_avx512(tree, key));
+    case SIMD_AVX2:
+      return normalize(tree, descend_avx2(tree, key));
+#endif
+    default:
+      return normalize(tree, descend_scalar(tree, key));
   }
+}
 
-  // Save the root and cleanup
-  Btree* root = levels[0];
-  free(levels);
+BtreeCursor btree_upper_bound(const Btree* tree, int key) {
+  // The values <= `key` are those < `key + 1`
+  return key == INT_MAX ? btree_end() : btree_lower_bound(tree, key + 1);
+}
 
-  return root;
+BtreeCursor btree_begin(const Btree* tree) {
+  return tree ? normalize(tree, (BtreeCursor){0, 0}) : btree_end();
 }
 
-size_t lookup(int key, Btree* tree, int is_left) {
-  if (!tree || tree->n_keys == 0) return 0;  // Empty tree -> would start at 0
+BtreeCursor btree_end(void) { return (BtreeCursor){BTREE_NIL, 0}; }
 
-  Btree* current = tree;
-  size_t pos = 0;
+size_t btree_cursor_rowid(const Btree* tree, BtreeCursor cursor) {
+  if (cursor.leaf == BTREE_NIL) return tree ? tree->n_elts : 0;
+  return tree->leaves[cursor.leaf].rowids[cursor.slot];
+}
 
-  cs165_log(stdout, "lookup: looking up %d in Btree\n", key);
-  // Navigate to leaf level
-  while (current && current->child_ptr) {
-    if (pos < current->n_keys &&
-        (is_left ? key > current->keys[pos] : key >= current->keys[pos])) {
-      pos = binary_search_left(current->keys + pos, current->n_keys - pos, key);
+size_t btree_range_copy(const Btree* tree, BtreeCursor from, BtreeCursor to, int* keys,
+                        int* rowids) {
+  size_t count = 0;
+  uint32_t slot = from.slot;
+  for (uint32_t id = from.leaf; id != BTREE_NIL; slot = 0) {
+    const BtreeLeaf* leaf = &tree->leaves[id];
+    uint32_t end = id == to.leaf ? to.slot : leaf->n;
+    if (end > slot) {
+      if (keys) memcpy(keys + count, leaf->keys + slot, sizeof(int) * (end - slot));
+      if (rowids) memcpy(rowids + count, leaf->rowids + slot, sizeof(int) * (end - slot));
+      count += end - slot;
     }
+    if (id == to.leaf) break;
+    id = leaf->next;
+  }
+  return count;
+}
+
+size_t btree_range_count(const Btree* tree, BtreeCursor from, BtreeCursor to) {
+  return btree_range_copy(tree, from, to, NULL, NULL);
+}
+
+static void leaf_insert(BtreeLeaf* leaf, size_t slot, int key, uint32_t rowid) {
+  memmove(leaf->keys + slot + 1, leaf->keys + slot, sizeof(int) * (leaf->n - slot));
+  memmove(leaf->rowids + slot + 1, leaf->rowids + slot,
+          sizeof(uint32_t) * (leaf->n - slot));
+  leaf->keys[slot] = key;
+  leaf->rowids[slot] = rowid;
+  leaf->n++;
+}
+
+// Adds `child` to a node that has room, right after its child `c`, with separator `sep`
+static void inner_insert(BtreeInner* node, size_t c, int sep, uint32_t child) {
+  memmove(node->children + c + 2, node->children + c + 1,
+          sizeof(uint32_t) * (node->n - c - 1));
+  memmove(node->keys + c + 1, node->keys + c, sizeof(int) * (node->n - c - 1));
+  node->children[c + 1] = child;
+  node->keys[c] = sep;
+  node->n++;
+}
+
+int btree_insert(Btree* tree, int key, uint32_t rowid) {
+  if (!tree || tree->n_elts >= UINT32_MAX - 1 || tree->height + 1 >= BTREE_MAX_LEVELS) {
+    return -1;
+  }
+  // Room for a split of every node on the path and a new root, so no node moves below
+  if (reserve(tree, (size_t)tree->n_inners + tree->height + 1, tree->n_leaves + 1) != 0) {
+    return -1;
+  }
 
-    current = current->child_ptr;
-    pos = pos * current->fanout;
+  // Descend past the keys equal to `key`, so that equal keys stay in row id order
+  uint32_t path[BTREE_MAX_LEVELS];
+  size_t slots[BTREE_MAX_LEVELS];
+  uint32_t node = tree->root;
+  for (size_t l = 0; l < tree->height; l++) {
+    const BtreeInner* inner = &tree->inners[node];
+    size_t c = 0;
+    while (c + 1 < inner->n && inner->keys[c] <= key) c++;
+    path[l] = node;
+    slots[l] = c;
+    node = inner->children[c];
+  }
+  BtreeLeaf* leaf = &tree->leaves[node];
+  size_t slot = 0;
+  while (slot < leaf->n && leaf->keys[slot] <= key) slot++;
+  tree->n_elts++;
+  if (leaf->n < BTREE_LEAF_KEYS) {
+    leaf_insert(leaf, slot, key, rowid);
+    return 0;
   }
 
-  // At leaf level, find position
-  cs165_log(stdout, "lookup: at leaf level, looking for key=%d, pos=%zu\n", key, pos);
-  pos = 0;
-  while (pos < current->n_keys &&
-         (is_left ? key > current->keys[pos] : key >= current->keys[pos])) {
-    pos++;
+  // Split the full leaf in half: the separator is the first key of the right half
+  size_t half = BTREE_LEAF_KEYS / 2;
+  uint32_t right_id = new_leaf(tree);
+  BtreeLeaf* right = &tree->leaves[right_id];
+  memcpy(right->keys, leaf->keys + half, sizeof(int) * half);
+  memcpy(right->rowids, leaf->rowids + half, sizeof(uint32_t) * half);
+  right->n = half;
+  right->next = leaf->next;
+  leaf->next = right_id;
+  leaf->n = half;
+  for (size_t j = half; j < BTREE_LEAF_KEYS; j++) leaf->keys[j] = INT_MAX;
+  int sep = right->keys[0];
+  if (slot <= half) {
+    leaf_insert(leaf, slot, key, rowid);
+  } else {
+    leaf_insert(right, slot - half, key, rowid);
   }
-  cs165_log(stdout, "lookup: at leaf level, found key=%d, pos=%zu\n", key, pos);
 
-  // If we're looking for leftmost (is_left true):
-  // - If key exists: return first occurrence index
-  // - If key doesn't exist: return index of the first element >= key
-  if (is_left) {
-    if (pos < current->n_keys && current->keys[pos] == key) {
-      cs165_log(stdout, "Left lookup: found key=%d at pos=%zu\n", key, pos);
-      log_info("returning first_unique_idxes[%zu] = %d\n", pos,
-               current->first_unique_idxes[pos]);
-      return current->first_unique_idxes[pos];
+  // Add the new node to its parent, splitting full parents up the path
+  uint32_t child = right_id;
+  for (size_t l = tree->height; l-- > 0;) {
+    BtreeInner* parent = &tree->inners[path[l]];
+    size_t c = slots[l];
+    if (parent->n < BTREE_NODE_KEYS) {
+      inner_insert(parent, c, sep, child);
+      return 0;
     }
-    cs165_log(stdout, "Right lookup: found  key=%d at pos=%zu\n", key, pos);
-    cs165_log(stdout, "returning first_unique_idxes[%zu] = %d\n", pos,
-              pos > 0 ? current->first_unique_idxes[pos - 1] : 0);
-    return pos < current->n_keys ? current->first_unique_idxes[pos] : tree->n_keys;
-  }
-
-  // If we're looking for rightmost (is_left false):
-  // - If key exists: return last occurrence index
-  // - If key doesn't exist: return index of last element less than key
-  else {
-    if (pos < current->n_keys && current->keys[pos] == key) {
-      return current->last_unique_idxes[pos];
+    // 17 children and 16 separators: the left node keeps 9 children, the right one 8,
+    // and the separator between them moves up
+    int keys[BTREE_NODE_KEYS];
+    uint32_t children[BTREE_NODE_KEYS + 1];
+    memcpy(children, parent->children, sizeof(uint32_t) * (c + 1));
+    children[c + 1] = child;
+    memcpy(children + c + 2, parent->children + c + 1,
+           sizeof(uint32_t) * (BTREE_NODE_KEYS - c - 1));
+    memcpy(keys, parent->keys, sizeof(int) * c);
+    keys[c] = sep;
+    memcpy(keys + c + 1, parent->keys + c, sizeof(int) * (BTREE_NODE_KEYS - 1 - c));
+
+    size_t left_n = BTREE_NODE_KEYS / 2 + 1;
+    uint32_t right_inner = new_inner(tree);
+    BtreeInner* split = &tree->inners[right_inner];
+    for (size_t j = 0; j < BTREE_NODE_KEYS; j++) {
+      parent->keys[j] = j + 1 < left_n ? keys[j] : INT_MAX;
     }
-    return pos > 0 ? current->last_unique_idxes[pos - 1] : 0;
+    memcpy(parent->children, children, sizeof(uint32_t) * left_n);
+    parent->n = left_n;
+    split->n = BTREE_NODE_KEYS + 1 - left_n;
+    memcpy(split->children, children + left_n, sizeof(uint32_t) * split->n);
+    memcpy(split->keys, keys + left_n, sizeof(int) * (split->n - 1));
+    sep = keys[left_n - 1];
+    child = right_inner;
   }
+
+  // The root split: a new root over its two halves
+  uint32_t root = new_inner(tree);
+  BtreeInner* top = &tree->inners[root];
+  top->children[0] = tree->root;
+  top->children[1] = child;
+  top->keys[0] = sep;
+  top->n = 2;
+  tree->root = root;
+  tree->height++;
+  return 0;
 }
 
-void print_tree_helper(Btree* tree) {
-  if (!tree) return;
-  log_info("Node:  [");
-  for (size_t i = 0; i < tree->n_keys; i++) {
-    log_info(" %d ", tree->keys[i]);
-  }
-  log_info("]\n");
+#define BTREE_MAGIC 0x42545245  // "BTRE"
 
-  if (tree->child_ptr) {
-    print_tree(tree->child_ptr);
-  }
+int btree_save(const Btree* tree, const char* path, uint64_t flags) {
+  if (!tree || !path) return -1;
+  uint64_t meta[INDEX_FILE_META] = {tree->n_elts, tree->root, tree->height, flags};
+  const void* sections[INDEX_FILE_SECTIONS] = {tree->inners, tree->leaves, NULL, NULL};
+  size_t sizes[INDEX_FILE_SECTIONS] = {sizeof(BtreeInner) * tree->n_inners,
+                                       sizeof(BtreeLeaf) * tree->n_leaves, 0, 0};
+  return index_file_write(path, BTREE_MAGIC, meta, sections, sizes);
 }
 
-void print_tree(Btree* tree) {
-  if (!tree) return;
-  print_tree_helper(tree);
-  // Print metadata
-  log_info("]\n");
-  log_info("First occurence idxes: [");
-  for (size_t i = 0; i < tree->n_uniques; i++) {
-    log_info(" %d ", tree->first_unique_idxes[i]);
+Btree* btree_load(const char* path, uint64_t* flags) {
+  IndexFile* file = index_file_map(path, BTREE_MAGIC);
+  if (!file) return NULL;
+  const IndexFileHeader* header = &file->header;
+  size_t n_inners = header->section_sizes[0] / sizeof(BtreeInner);
+  size_t n_leaves = header->section_sizes[1] / sizeof(BtreeLeaf);
+  size_t root = header->meta[1], height = header->meta[2];
+  // A tree has a root, and one leaf at least
+  if (n_inners * sizeof(BtreeInner) != header->section_sizes[0] ||
+      n_leaves * sizeof(BtreeLeaf) != header->section_sizes[1] || n_leaves == 0 ||
+      height >= BTREE_MAX_LEVELS || (height == 0 && n_inners > 0) ||
+      root >= (height ? n_inners : n_leaves)) {
+    log_err("btree_load: %s does not hold a valid tree\n", path);
+    index_file_unmap(file);
+    return NULL;
   }
-  log_info("]\n");
-  log_info("Last occurence idxes: [");
-  for (size_t i = 0; i < tree->n_uniques; i++) {
-    log_info(" %d ", tree->last_unique_idxes[i]);
+  Btree* tree = calloc(1, sizeof(Btree));
+  if (!tree) {
+    index_file_unmap(file);
+    return NULL;
   }
-  log_info("]\n");
+  tree->file = file;
+  tree->inners = file->sections[0];
+  tree->leaves = file->sections[1];
+  tree->n_inners = tree->inner_capacity = n_inners;
+  tree->n_leaves = tree->leaf_capacity = n_leaves;
+  tree->root = root;
+  tree->height = height;
+  tree->n_elts = header->meta[0];
+  if (flags) *flags = header->meta[3];
+  return tree;
 }
 
-void free_btree_nodes(Btree* tree) {
-  if (!tree) return;
-
-  if (tree->child_ptr) {
-    free_btree_nodes(tree->child_ptr);
+static void print_node(const Btree* tree, uint32_t id, size_t level) {
+  if (level == tree->height) {
+    const BtreeLeaf* leaf = &tree->leaves[id];
+    log_info("%*sleaf %u: [", (int)(2 * level), "", id);
+    for (size_t j = 0; j < leaf->n; j++) {
+      log_info(" %d@%u", leaf->keys[j], leaf->rowids[j]);
+    }
+    log_info(" ]\n");
+    return;
   }
-  free(tree->keys);
+  const BtreeInner* inner = &tree->inners[id];
+  log_info("%*snode %u: [", (int)(2 * level), "", id);
+  for (size_t j = 0; j + 1 < inner->n; j++) log_info(" %d", inner->keys[j]);
+  log_info(" ]\n");
+  for (size_t c = 0; c < inner->n; c++) print_node(tree, inner->children[c], level + 1);
 }
 
-void free_btree(Btree* tree) {
+void print_tree(Btree* tree) {
   if (!tree) return;
-  free_btree_nodes(tree);
+  log_info("%zu elements, %zu inner levels, %u inner nodes, %u leaves\n", tree->n_elts,
+           tree->height, tree->n_inners, tree->n_leaves);
+  print_node(tree, tree->root, 0);
+}
 
-  free(tree->first_unique_idxes);
-  free(tree->last_unique_idxes);
+void free_btree(Btree* tree) {
+  if (!tree) return;
+  if (tree->file) {
+    index_file_unmap(tree->file);
+  } else {
+    free(tree->inners);
+    free(tree->leaves);
+  }
   free(tree);
 }
@@ -0,0 +1,243 @@
+#include "cracker.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+
+#define CRACKER_MIN_CAPACITY 16
+
+Cracker* cracker_create(const int* data, size_t n) {
+  if (!data && n > 0) {
+    log_err("cracker_create: Invalid input; data=%p, n=%zu\n", data, n);
+    return NULL;
+  }
+  Cracker* cracker = calloc(1, sizeof(Cracker));
+  if (!cracker) return NULL;
+  cracker->capacity = n > CRACKER_MIN_CAPACITY ? n : CRACKER_MIN_CAPACITY;
+  cracker->values = malloc(sizeof(int) * cracker->capacity);
+  cracker->positions = malloc(sizeof(int) * cracker->capacity);
+  if (!cracker->values || !cracker->positions) {
+    log_err("cracker_create: Failed to allocate a cracker column of %zu values\n", n);
+    cracker_free(cracker);
+    return NULL;
+  }
+  if (n > 0) memcpy(cracker->values, data, sizeof(int) * n);
+  for (size_t i = 0; i < n; i++) cracker->positions[i] = (int)i;
+  cracker->num_elements = n;
+  return cracker;
+}
+
+// AVL tree of pivots
+// ---------------------
+
+static inline int node_height(const CrackerNode* node) { return node ? node->height : 0; }
+
+static inline void update_height(CrackerNode* node) {
+  int left = node_height(node->left), right = node_height(node->right);
+  node->height = 1 + (left > right ? left : right);
+}
+
+static CrackerNode* rotate_right(CrackerNode* node) {
+  CrackerNode* left = node->left;
+  node->left = left->right;
+  left->right = node;
+  update_height(node);
+  update_height(left);
+  return left;
+}
+
+static CrackerNode* rotate_left(CrackerNode* node) {
+  CrackerNode* right = node->right;
+  node->right = right->left;
+  right->left = node;
+  update_height(node);
+  update_height(right);
+  return right;
+}
+
+static CrackerNode* rebalance(CrackerNode* node) {
+  update_height(node);
+  int balance = node_height(node->left) - node_height(node->right);
+  if (balance > 1) {
+    if (node_height(node->left->left) < node_height(node->left->right)) {
+      node->left = rotate_left(node->left);
+    }
+    return rotate_right(node);
+  }
+  if (balance < -1) {
+    if (node_height(node->right->right) < node_height(node->right->left)) {
+      node->right = rotate_right(node->right);
+    }
+    return rotate_left(node);
+  }
+  return node;
+}
+
+static CrackerNode* avl_insert(CrackerNode* node, CrackerNode* new_node) {
+  if (!node) return new_node;
+  if (new_node->pivot < node->pivot) {
+    node->left = avl_insert(node->left, new_node);
+  } else {
+    node->right = avl_insert(node->right, new_node);
+  }
+  return rebalance(node);
+}
+
+static void free_nodes(CrackerNode* node) {
+  if (!node) return;
+  free_nodes(node->left);
+  free_nodes(node->right);
+  free(node);
+}
+
+/**
+ * @brief Finds the piece [*lo, *hi) of the cracker column that `value` falls in, between
+ * the greatest pivot <= `value` and the smallest pivot > `value`.
+ * @return the node of `value` itself if it already is a pivot, else NULL
+ */
+static CrackerNode* find_piece(const Cracker* cracker, int value, size_t* lo,
+                               size_t* hi) {
+  *lo = 0;
+  *hi = cracker->num_elements;
+  CrackerNode* node = cracker->root;
+  while (node) {
+    if (node->pivot == value) return node;
+    if (node->pivot < value) {
+      *lo = node->position;
+      node = node->right;
+    } else {
+      *hi = node->position;
+      node = node->left;
+    }
+  }
+  return NULL;
+}
+
+static void add_pivot(Cracker* cracker, int pivot, size_t position) {
+  CrackerNode* node = malloc(sizeof(CrackerNode));
+  // Without the node the piece just stays uncracked: lookups remain correct
+  if (!node) return;
+  node->pivot = pivot;
+  node->position = position;
+  node->left = node->right = NULL;
+  node->height = 1;
+  cracker->root = avl_insert(cracker->root, node);
+  cracker->num_pivots++;
+}
+
+// Partitioning
+// ---------------------
+
+static inline void swap_entries(Cracker* cracker, size_t i, size_t j) {
+  int value = cracker->values[i];
+  cracker->values[i] = cracker->values[j];
+  cracker->values[j] = value;
+  int position = cracker->positions[i];
+  cracker->positions[i] = cracker->positions[j];
+  cracker->positions[j] = position;
+}
+
+// Partitions [lo, hi) into values < pivot followed by values >= pivot
+static size_t crack_in_two(Cracker* cracker, size_t lo, size_t hi, int pivot) {
+  const int* values = cracker->values;
+  while (lo < hi) {
+    while (lo < hi && values[lo] < pivot) lo++;
+    while (lo < hi && values[hi - 1] >= pivot) hi--;
+    if (lo + 1 >= hi) break;
+    swap_entries(cracker, lo++, --hi);
+  }
+  return lo;
+}
+
+// Partitions [lo, hi) into values < low, values in [low, high], then values > high
+static void crack_in_three(Cracker* cracker, size_t lo, size_t hi, int low, int high,
+                           size_t* start, size_t* end) {
+  size_t less = lo, i = lo, greater = hi;
+  while (i < greater) {
+    int value = cracker->values[i];
+    if (value < low) {
+      swap_entries(cracker, less++, i++);
+    } else if (value > high) {
+      swap_entries(cracker, i, --greater);
+    } else {
+      i++;
+    }
+  }
+  *start = less;
+  *end = greater;
+}
+
+size_t cracker_crack(Cracker* cracker, int pivot) {
+  size_t lo, hi;
+  CrackerNode* node = find_piece(cracker, pivot, &lo, &hi);
+  if (node) return node->position;
+  size_t position = crack_in_two(cracker, lo, hi, pivot);
+  add_pivot(cracker, pivot, position);
+  return position;
+}
+
+void cracker_select(Cracker* cracker, int low, int high, size_t* start, size_t* end) {
+  if (low > high) {
+    *start = *end = 0;
+    return;
+  }
+  // Nothing is above INT_MAX, so there is no upper piece to cut off
+  if (high == INT_MAX) {
+    *start = cracker_crack(cracker, low);
+    *end = cracker->num_elements;
+    return;
+  }
+
+  size_t low_lo, low_hi, high_lo, high_hi;
+  CrackerNode* low_node = find_piece(cracker, low, &low_lo, &low_hi);
+  CrackerNode* high_node = find_piece(cracker, high + 1, &high_lo, &high_hi);
+  if (!low_node && !high_node && low_lo == high_lo && low_hi == high_hi) {
+    // Both bounds cut the same piece: split it three ways in one pass
+    crack_in_three(cracker, low_lo, low_hi, low, high, start, end);
+    add_pivot(cracker, low, *start);
+    add_pivot(cracker, high + 1, *end);
+    return;
+  }
+  *start = cracker_crack(cracker, low);
+  *end = cracker_crack(cracker, high + 1);
+}
+
+// Moves the first value of the piece of each pivot > `value`, in descending pivot order,
+// into `*hole` (just past that piece's end), leaving the hole where the new value goes
+static void ripple(Cracker* cracker, CrackerNode* node, int value, size_t* hole) {
+  if (!node) return;
+  ripple(cracker, node->right, value, hole);
+  if (node->pivot <= value) return;
+  cracker->values[*hole] = cracker->values[node->position];
+  cracker->positions[*hole] = cracker->positions[node->position];
+  *hole = node->position++;
+  ripple(cracker, node->left, value, hole);
+}
+
+int cracker_insert(Cracker* cracker, int value, int position) {
+  if (cracker->num_elements == cracker->capacity) {
+    size_t capacity = cracker->capacity * 2;
+    int* values = realloc(cracker->values, sizeof(int) * capacity);
+    if (!values) return -1;
+    cracker->values = values;
+    int* positions = realloc(cracker->positions, sizeof(int) * capacity);
+    if (!positions) return -1;
+    cracker->positions = positions;
+    cracker->capacity = capacity;
+  }
+  size_t hole = cracker->num_elements++;
+  ripple(cracker, cracker->root, value, &hole);
+  cracker->values[hole] = value;
+  cracker->positions[hole] = position;
+  return 0;
+}
+
+void cracker_free(Cracker* cracker) {
+  if (!cracker) return;
+  free_nodes(cracker->root);
+  free(cracker->values);
+  free(cracker->positions);
+  free(cracker);
+}
@@ -0,0 +1,85 @@
+#include "expr.h"
+
+#include <limits.h>
+
+#include "utils.h"
+
+int expr_depth(const ExprStep* steps, size_t num_steps) {
+  int depth = 0, max_depth = 0;
+  for (size_t i = 0; i < num_steps; i++) {
+    if (steps[i].kind == EXPR_OP) {
+      if (depth < 2) return -1;
+      depth--;
+    } else if (++depth > max_depth) {
+      max_depth = depth;
+    }
+  }
+  return depth == 1 ? max_depth : -1;
+}
+
+/**
+ * @brief Evaluates `steps` on one block of `len` rows, starting at row `offset` of the
+ * arrays, into `out`. An operand on the stack is a slice of an input array, a constant,
+ * or the temporary of its stack depth: an operator overwrites its left operand's
+ * temporary, so a block needs at most one temporary per level of the stack. The last
+ * operator writes straight to `out`.
+ */
+static int eval_block(const ExprStep* steps, size_t num_steps, size_t offset, size_t len,
+                      int (*temps)[EXPR_BLOCK_SIZE], int* out, ValueStats* stats) {
+  ArithOperand stack[EXPR_MAX_DEPTH];
+  size_t depth = 0;
+  int in_out = 0;
+  for (size_t i = 0; i < num_steps; i++) {
+    const ExprStep* step = &steps[i];
+    if (step->kind != EXPR_OP) {
+      stack[depth++] = (ArithOperand){
+          .values = step->kind == EXPR_VALUES ? step->values + offset : NULL,
+          .constant = step->constant};
+      continue;
+    }
+    ArithOperand lhs = stack[depth - 2], rhs = stack[depth - 1];
+    depth--;
+    ValueStats scratch = {0, INT_MAX, INT_MIN};
+    if (!lhs.values && !rhs.values) {
+      // Constants fold into a constant
+      int value;
+      if (simd_arith(step->op, lhs, rhs, 1, &value, &scratch) != 0) return -1;
+      stack[depth - 1] = (ArithOperand){.values = NULL, .constant = value};
+      continue;
+    }
+    in_out = i + 1 == num_steps;
+    int* dst = in_out ? out : temps[depth - 1];
+    if (simd_arith(step->op, lhs, rhs, len, dst, in_out ? stats : &scratch) != 0) {
+      return -1;
+    }
+    stack[depth - 1] = (ArithOperand){.values = dst, .constant = 0};
+  }
+  if (in_out) return 0;
+
+  // A lone array or constant (possibly folded): copy it out
+  if (stack[0].values) {
+    simd_copy(stack[0].values, len, out, stats);
+  } else {
+    for (size_t i = 0; i < len; i++) out[i] = stack[0].constant;
+    simd_copy(out, len, NULL, stats);
+  }
+  return 0;
+}
+
+int expr_eval(const ExprStep* steps, size_t num_steps, size_t offset, size_t n, int* out,
+              ValueStats* stats) {
+  int depth = expr_depth(steps, num_steps);
+  if (depth < 0 || depth > EXPR_MAX_DEPTH) {
+    log_err("expr_eval: Invalid expression; %zu steps, depth %d\n", num_steps, depth);
+    return -1;
+  }
+  // An operator's result replaces its left operand, so never sits at the deepest level
+  int temps[EXPR_MAX_DEPTH - 1][EXPR_BLOCK_SIZE];
+  for (size_t b = 0; b < n; b += EXPR_BLOCK_SIZE) {
+    size_t len = n - b < EXPR_BLOCK_SIZE ? n - b : EXPR_BLOCK_SIZE;
+    if (eval_block(steps, num_steps, offset + b, len, temps, out + b, stats) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,309 @@
+#define _GNU_SOURCE
+#include "grace_join.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "hash.h"
+#include "hash_table.h"
+#include "radix_join.h"
+#include "utils.h"
+
+// Partitions a spilling pass splits a side into. A recursion keeps both sides' files of
+// every level down to the pair it is on open, so file descriptors stay in the hundreds.
+#define GRACE_JOIN_FANOUT_BITS 5
+#define GRACE_JOIN_FANOUT (1 << GRACE_JOIN_FANOUT_BITS)
+// Partitioning levels before a partition is joined in chunks, over the budget or not
+#define GRACE_JOIN_MAX_DEPTH 4
+// Tuples a partition's write buffer holds
+#define GRACE_JOIN_WRITE_TUPLES 1024
+// Tuples a side is read in, to be partitioned or streamed past a hash table
+#define GRACE_JOIN_READ_TUPLES (1 << 18)
+// Probe tuples per morsel of a block
+#define GRACE_JOIN_PROBE_MORSEL 16384
+
+// A tuple as spill files store it
+typedef struct {
+  int key;
+  int payload;
+} GraceTuple;
+
+/**
+ * @brief A side of a pair of partitions, read front to back: either the join's input
+ * arrays, or the spill `file` of a partition.
+ */
+typedef struct {
+  const int* keys;
+  const int* payloads;
+  FILE* file;
+  size_t n;
+  size_t pos;  // tuples read so far
+} GraceSide;
+
+typedef struct {
+  size_t budget;
+  const char* spill_dir;
+  ThreadPool* pool;
+  int swapped;          // the build side is the right one
+  GraceTuple* buffer;   // GRACE_JOIN_READ_TUPLES tuples
+  JoinOutput* outputs;  // one per worker
+  size_t spilled;       // tuples written to spill files
+  int depth;            // deepest partitioning level
+} GraceJoin;
+
+// The key's hash, with a seed per partitioning level mixed into the key first, so that
+// each level splits on bits independent of the last, and of the hash table's
+static inline size_t spill_partition(int key, int depth) {
+  int seed = (int)(0x9e3779b9u * (uint32_t)(depth + 1));
+  return hash32(key ^ seed) >> (32 - GRACE_JOIN_FANOUT_BITS);
+}
+
+static int side_rewind(GraceSide* side) {
+  side->pos = 0;
+  return side->file && fseek(side->file, 0, SEEK_SET) != 0 ? -1 : 0;
+}
+
+// Reads the next (at most `max`) tuples of `side` into `tuples`
+static size_t side_read(GraceSide* side, GraceTuple* tuples, size_t max) {
+  size_t n = side->n - side->pos < max ? side->n - side->pos : max;
+  if (side->file) {
+    n = fread(tuples, sizeof(GraceTuple), n, side->file);
+  } else {
+    for (size_t i = 0; i < n; i++) {
+      tuples[i].key = side->keys[side->pos + i];
+      tuples[i].payload = side->payloads[side->pos + i];
+    }
+  }
+  side->pos += n;
+  return n;
+}
+
+// Creates a spill file, unlinked at once: it lives until it is closed
+static FILE* spill_file(const GraceJoin* gj) {
+  static size_t next_id = 0;
+  size_t id = __atomic_fetch_add(&next_id, 1, __ATOMIC_RELAXED);
+  char path[PATH_MAX];
+  snprintf(path, sizeof(path), "%s/grace_join.%d.%zu.tmp", gj->spill_dir, (int)getpid(),
+           id);
+  FILE* file = fopen(path, "w+b");
+  if (!file) {
+    log_err("grace_join: failed to create spill file %s\n", path);
+    return NULL;
+  }
+  unlink(path);
+  return file;
+}
+
+// Writes the `n` buffered tuples of partition `p` to its file, creating it if need be
+static int spill(GraceJoin* gj, FILE** files, size_t p, const GraceTuple* tuples,
+                 size_t n) {
+  if (!files[p] && !(files[p] = spill_file(gj))) return -1;
+  if (fwrite(tuples, sizeof(GraceTuple), n, files[p]) != n) {
+    log_err("grace_join: failed to write a spill file\n");
+    return -1;
+  }
+  gj->spilled += n;
+  return 0;
+}
+
+/**
+ * @brief Partitions `side` on the level `depth` bits of its keys' hash: partition p goes
+ * to `files[p]` (left NULL if it is empty), `counts[p]` tuples of it.
+ */
+static int partition_side(GraceJoin* gj, GraceSide* side, int depth, FILE** files,
+                          size_t* counts) {
+  GraceTuple* out = malloc(sizeof(GraceTuple) * GRACE_JOIN_FANOUT *
+                           GRACE_JOIN_WRITE_TUPLES);
+  if (!out || side_rewind(side) != 0) {
+    free(out);
+    return -1;
+  }
+  memset(counts, 0, sizeof(size_t) * GRACE_JOIN_FANOUT);
+  size_t fill[GRACE_JOIN_FANOUT] = {0};
+  int status = 0;
+  size_t n;
+  while (status == 0 && (n = side_read(side, gj->buffer, GRACE_JOIN_READ_TUPLES)) > 0) {
+    for (size_t i = 0; i < n && status == 0; i++) {
+      size_t p = spill_partition(gj->buffer[i].key, depth);
+      GraceTuple* buffered = out + p * GRACE_JOIN_WRITE_TUPLES;
+      buffered[fill[p]++] = gj->buffer[i];
+      counts[p]++;
+      if (fill[p] == GRACE_JOIN_WRITE_TUPLES) {
+        status = spill(gj, files, p, buffered, fill[p]);
+        fill[p] = 0;
+      }
+    }
+  }
+  if (side->pos != side->n) status = -1;  // the side's file came up short
+  for (size_t p = 0; p < GRACE_JOIN_FANOUT && status == 0; p++) {
+    if (fill[p]) status = spill(gj, files, p, out + p * GRACE_JOIN_WRITE_TUPLES, fill[p]);
+  }
+  free(out);
+  return status;
+}
+
+// Shared by every morsel of a probe block; worker w writes its pairs to `outputs[w]`
+typedef struct {
+  const hashtable* ht;
+  const GraceTuple* tuples;
+  int swapped;
+  JoinOutput* outputs;
+  int failed;
+} GraceProbeArgs;
+
+static void probe_morsel(void* arg, size_t worker, size_t morsel, size_t start,
+                         size_t end) {
+  (void)morsel;
+  GraceProbeArgs* args = (GraceProbeArgs*)arg;
+  JoinOutput* out = &args->outputs[worker];
+  size_t num_matches;
+  for (size_t j = start; j < end; j++) {
+    int probe = args->tuples[j].payload;
+    const int* matches = get_values(args->ht, args->tuples[j].key, &num_matches);
+    for (size_t m = 0; m < num_matches; m++) {
+      int left = args->swapped ? probe : matches[m];
+      int right = args->swapped ? matches[m] : probe;
+      if (join_output_emit(out, left, right) != 0) {
+        __atomic_store_n(&args->failed, 1, __ATOMIC_RELAXED);
+        return;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Joins a pair of partitions in memory, `build` in chunks of as many tuples as
+ * fit in the budget (all of it, unless it cannot be split any further): each chunk goes
+ * into a hash table that the whole of `probe` then streams past.
+ */
+static int join_chunks(GraceJoin* gj, GraceSide* build, GraceSide* probe) {
+  size_t chunk = gj->budget / GRACE_JOIN_BUILD_BYTES;
+  if (chunk == 0) chunk = 1;
+  if (chunk > build->n) chunk = build->n;
+  int* keys = malloc(sizeof(int) * chunk);
+  int* payloads = malloc(sizeof(int) * chunk);
+  int status = keys && payloads && side_rewind(build) == 0 ? 0 : -1;
+
+  while (status == 0 && build->pos < build->n) {
+    size_t m = 0, n;
+    while (m < chunk) {
+      size_t want = chunk - m;
+      if (want > GRACE_JOIN_READ_TUPLES) want = GRACE_JOIN_READ_TUPLES;
+      if ((n = side_read(build, gj->buffer, want)) == 0) break;
+      for (size_t i = 0; i < n; i++, m++) {
+        keys[m] = gj->buffer[i].key;
+        payloads[m] = gj->buffer[i].payload;
+      }
+    }
+    hashtable* ht = NULL;
+    if (m == 0 || allocate(&ht, (int)m) != 0 || bulk_put(ht, keys, payloads, m) != 0) {
+      deallocate(ht);
+      status = -1;
+      break;
+    }
+    GraceProbeArgs args = {.ht = ht,
+                           .tuples = gj->buffer,
+                           .swapped = gj->swapped,
+                           .outputs = gj->outputs};
+    status = side_rewind(probe);
+    while (status == 0 &&
+           (n = side_read(probe, gj->buffer, GRACE_JOIN_READ_TUPLES)) > 0) {
+      threadpool_parallel_morsels(gj->pool, n, GRACE_JOIN_PROBE_MORSEL, probe_morsel,
+                                  &args);
+      if (args.failed) status = -1;
+    }
+    if (probe->pos != probe->n) status = -1;
+    deallocate(ht);
+  }
+  free(keys);
+  free(payloads);
+  return status;
+}
+
+static int join_pair(GraceJoin* gj, GraceSide* build, GraceSide* probe, int depth);
+
+/**
+ * @brief Partitions both sides of a pair on the level `depth` bits of the hash, and
+ * joins the pairs of partitions one by one.
+ */
+static int repartition(GraceJoin* gj, GraceSide* build, GraceSide* probe, int depth) {
+  FILE* build_files[GRACE_JOIN_FANOUT] = {0};
+  FILE* probe_files[GRACE_JOIN_FANOUT] = {0};
+  size_t build_counts[GRACE_JOIN_FANOUT], probe_counts[GRACE_JOIN_FANOUT];
+  if (depth + 1 > gj->depth) gj->depth = depth + 1;
+  int status = partition_side(gj, build, depth, build_files, build_counts);
+  if (status == 0) status = partition_side(gj, probe, depth, probe_files, probe_counts);
+
+  for (size_t p = 0; p < GRACE_JOIN_FANOUT && status == 0; p++) {
+    GraceSide b = {.file = build_files[p], .n = build_counts[p]};
+    GraceSide q = {.file = probe_files[p], .n = probe_counts[p]};
+    if (b.n == 0 || q.n == 0) continue;
+    // Nothing split off: the keys are too few (or too skewed) for their hash to split
+    // them, and another level would only copy the partition again
+    status = b.n == build->n ? join_chunks(gj, &b, &q) : join_pair(gj, &b, &q, depth + 1);
+  }
+  for (size_t p = 0; p < GRACE_JOIN_FANOUT; p++) {
+    if (build_files[p]) fclose(build_files[p]);
+    if (probe_files[p]) fclose(probe_files[p]);
+  }
+  return status;
+}
+
+static int join_pair(GraceJoin* gj, GraceSide* build, GraceSide* probe, int depth) {
+  if (build->n == 0 || probe->n == 0) return 0;
+  if (build->n > gj->budget / GRACE_JOIN_BUILD_BYTES && depth < GRACE_JOIN_MAX_DEPTH) {
+    return repartition(gj, build, probe, depth);
+  }
+  return join_chunks(gj, build, probe);
+}
+
+int grace_join(const int* l_keys, const int* l_payloads, size_t l_n, const int* r_keys,
+               const int* r_payloads, size_t r_n, size_t memory_budget,
+               const char* spill_dir, ThreadPool* pool, JoinResult* result) {
+  *result = (JoinResult){NULL, NULL, 0};
+  int swapped = r_n < l_n;
+  size_t nb = swapped ? r_n : l_n;
+  if (nb <= memory_budget / GRACE_JOIN_BUILD_BYTES) {
+    // Fits: partition in memory instead, at least one full pass, as a grace join does
+    size_t radix_bits = radix_join_bits(nb);
+    if (radix_bits < RADIX_JOIN_PASS_BITS) radix_bits = RADIX_JOIN_PASS_BITS;
+    return radix_join(l_keys, l_payloads, l_n, r_keys, r_payloads, r_n, radix_bits, pool,
+                      result);
+  }
+  if (l_n > INT_MAX || r_n > INT_MAX) {
+    log_err("grace_join: %zu x %zu tuples is too many for 32-bit positions\n", l_n, r_n);
+    return -1;
+  }
+
+  size_t n_workers = threadpool_morsel_workers(pool);
+  GraceJoin gj = {.budget = memory_budget,
+                  .spill_dir = spill_dir,
+                  .pool = pool,
+                  .swapped = swapped,
+                  .buffer = malloc(sizeof(GraceTuple) * GRACE_JOIN_READ_TUPLES),
+                  .outputs = calloc(n_workers, sizeof(JoinOutput))};
+  GraceSide build = {.keys = swapped ? r_keys : l_keys,
+                     .payloads = swapped ? r_payloads : l_payloads,
+                     .n = nb};
+  GraceSide probe = {.keys = swapped ? l_keys : r_keys,
+                     .payloads = swapped ? l_payloads : r_payloads,
+                     .n = swapped ? l_n : r_n};
+  int status = -1;
+  if (gj.buffer && gj.outputs && join_pair(&gj, &build, &probe, 0) == 0) {
+    status = join_output_concat(gj.outputs, n_workers, result);
+  }
+  if (status) {
+    log_err("grace_join: failed to join %zu x %zu tuples\n", l_n, r_n);
+  } else {
+    log_debug("grace_join: spilled %zu tuples to %s, %d levels deep, for a %zu byte "
+             "budget\n", gj.spilled, spill_dir, gj.depth, memory_budget);
+  }
+  for (size_t w = 0; gj.outputs && w < n_workers; w++) join_output_free(&gj.outputs[w]);
+  free(gj.outputs);
+  free(gj.buffer);
+  return status;
+}
@@ -0,0 +1,117 @@
+#include "group_table.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+
+#define GROUP_TABLE_MIN_CAPACITY 64
+
+static inline size_t group_slot(const GroupTable* gt, int key) {
+  return ((uint32_t)key * 2654435761u) >> gt->shift;
+}
+
+static int group_table_init(GroupTable* gt, size_t capacity) {
+  gt->entries = calloc(capacity, sizeof(GroupEntry));
+  if (!gt->entries) return -1;
+  gt->capacity = capacity;
+  gt->num_groups = 0;
+  gt->shift = 32;
+  for (size_t c = capacity; c > 1; c >>= 1) gt->shift--;
+  return 0;
+}
+
+GroupTable* group_table_create(size_t expected_groups) {
+  GroupTable* gt = malloc(sizeof(GroupTable));
+  if (!gt) return NULL;
+  // Room for twice the expected groups keeps the table at most half full
+  size_t capacity = GROUP_TABLE_MIN_CAPACITY;
+  while (capacity < 2 * expected_groups) capacity *= 2;
+  if (group_table_init(gt, capacity) != 0) {
+    log_err("group_table_create: Failed to allocate %zu slots\n", capacity);
+    free(gt);
+    return NULL;
+  }
+  return gt;
+}
+
+// Finds the slot of `key`, claiming a free one for it if it is a new group
+static inline GroupEntry* group_find(GroupTable* gt, int key) {
+  size_t mask = gt->capacity - 1;
+  for (size_t slot = group_slot(gt, key);; slot = (slot + 1) & mask) {
+    GroupEntry* entry = &gt->entries[slot];
+    if (!entry->used) {
+      entry->used = 1;
+      entry->key = key;
+      entry->min = INT_MAX;
+      entry->max = INT_MIN;
+      gt->num_groups++;
+      return entry;
+    }
+    if (entry->key == key) return entry;
+  }
+}
+
+static int group_table_grow(GroupTable* gt) {
+  GroupTable old = *gt;
+  if (group_table_init(gt, old.capacity * 2) != 0) {
+    *gt = old;
+    log_err("group_table_grow: Failed to allocate %zu slots\n", old.capacity * 2);
+    return -1;
+  }
+  for (size_t i = 0; i < old.capacity; i++) {
+    if (old.entries[i].used) *group_find(gt, old.entries[i].key) = old.entries[i];
+  }
+  free(old.entries);
+  return 0;
+}
+
+int group_table_add(GroupTable* gt, const int* keys, const int* values, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    if (2 * (gt->num_groups + 1) > gt->capacity && group_table_grow(gt) != 0) return -1;
+    GroupEntry* entry = group_find(gt, keys[i]);
+    int value = values[i];
+    entry->count++;
+    entry->sum += value;
+    if (value < entry->min) entry->min = value;
+    if (value > entry->max) entry->max = value;
+  }
+  return 0;
+}
+
+int group_table_merge(GroupTable* dst, const GroupTable* src) {
+  for (size_t i = 0; i < src->capacity; i++) {
+    const GroupEntry* from = &src->entries[i];
+    if (!from->used) continue;
+    if (2 * (dst->num_groups + 1) > dst->capacity && group_table_grow(dst) != 0) {
+      return -1;
+    }
+    GroupEntry* entry = group_find(dst, from->key);
+    entry->count += from->count;
+    entry->sum += from->sum;
+    if (from->min < entry->min) entry->min = from->min;
+    if (from->max > entry->max) entry->max = from->max;
+  }
+  return 0;
+}
+
+static int compare_group_keys(const void* a, const void* b) {
+  int key_a = ((const GroupEntry*)a)->key, key_b = ((const GroupEntry*)b)->key;
+  return (key_a > key_b) - (key_a < key_b);
+}
+
+size_t group_table_sorted(const GroupTable* gt, GroupEntry* out) {
+  size_t k = 0;
+  for (size_t i = 0; i < gt->capacity; i++) {
+    if (gt->entries[i].used) out[k++] = gt->entries[i];
+  }
+  qsort(out, k, sizeof(GroupEntry), compare_group_keys);
+  return k;
+}
+
+void group_table_free(GroupTable* gt) {
+  if (!gt) return;
+  free(gt->entries);
+  free(gt);
+}
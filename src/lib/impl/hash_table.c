@@ -1,78 +1,157 @@
 #include "hash_table.h"
 
 #include <stdlib.h>
+#include <string.h>
 
-// TODO: Improve the hash function
-static unsigned int hash(keyType key, int num_buckets) {
-  return (unsigned int)key % num_buckets;
+#include "hash.h"
+
+// Values the arena starts with room for, at least
+#define HASH_TABLE_MIN_ARENA 64
+
+static inline size_t home_slot(const hashtable* ht, keyType key) {
+  return hash32(key) >> ht->shift;
+}
+
+// Slot of `key`, or the empty slot where it would go
+static inline size_t find_slot(const hashtable* ht, keyType key) {
+  size_t mask = ht->num_slots - 1;
+  size_t i = home_slot(ht, key);
+  while (ht->slots[i].capacity && ht->slots[i].key != key) i = (i + 1) & mask;
+  return i;
+}
+
+// Resizes the slots to `num_slots` (a power of two), moving the used ones over
+static int resize_slots(hashtable* ht, size_t num_slots) {
+  hashslot* old = ht->slots;
+  size_t old_num = ht->num_slots;
+  ht->slots = calloc(num_slots, sizeof(hashslot));
+  if (!ht->slots) {
+    ht->slots = old;
+    return -1;
+  }
+  ht->num_slots = num_slots;
+  ht->shift = 32;
+  for (size_t n = num_slots; n > 1; n >>= 1) ht->shift--;
+  for (size_t i = 0; i < old_num; i++) {
+    if (old[i].capacity) ht->slots[find_slot(ht, old[i].key)] = old[i];
+  }
+  free(old);
+  return 0;
+}
+
+// Makes room for `n` more keys, keeping the table at most half full
+static int reserve_keys(hashtable* ht, size_t n) {
+  size_t num_slots = ht->num_slots;
+  while ((ht->size + n) * 2 > num_slots) num_slots *= 2;
+  return num_slots == ht->num_slots ? 0 : resize_slots(ht, num_slots);
+}
+
+// Makes room for `n` more values at the end of the arena
+static int reserve_arena(hashtable* ht, size_t n) {
+  if (ht->arena_size + n <= ht->arena_capacity) return 0;
+  if (ht->arena_size + n > UINT32_MAX) return -1;
+  size_t capacity = ht->arena_capacity ? ht->arena_capacity : HASH_TABLE_MIN_ARENA;
+  while (capacity < ht->arena_size + n) capacity *= 2;
+  valType* arena = realloc(ht->arena, sizeof(valType) * capacity);
+  if (!arena) return -1;
+  ht->arena = arena;
+  ht->arena_capacity = capacity;
+  return 0;
 }
 
 int allocate(hashtable** ht, int size) {
   if (ht == NULL || size <= 0) {
     return -1;
   }
-
-  // Allocate the hash table structure
-  *ht = (hashtable*)malloc(sizeof(hashtable));
+  *ht = calloc(1, sizeof(hashtable));
   if (*ht == NULL) {
     return -1;
   }
-
-  // Use size as number of buckets for simplicity
-  (*ht)->num_buckets = size;
-  (*ht)->size = 0;
-
-  // Allocate the buckets array
-  (*ht)->buckets = (entry**)calloc(size, sizeof(entry*));
-  if ((*ht)->buckets == NULL) {
+  size_t num_slots = 2;
+  while (num_slots < (size_t)size * 2) num_slots *= 2;
+  if (resize_slots(*ht, num_slots) != 0) {
     free(*ht);
     *ht = NULL;
     return -1;
   }
-
   return 0;
 }
 
 int put(hashtable* ht, keyType key, valType value) {
-  if (ht == NULL) {
+  if (ht == NULL || reserve_keys(ht, 1) != 0) {
     return -1;
   }
+  hashslot* slot = &ht->slots[find_slot(ht, key)];
+  int is_new = slot->capacity == 0;
+  if (slot->count == slot->capacity) {
+    // Out of room (or a new key): the run grows in place at the end of the arena, or
+    // moves there with twice the room
+    size_t capacity = slot->capacity ? slot->capacity * 2 : 1;
+    int at_end = slot->capacity && slot->offset + slot->capacity == ht->arena_size;
+    size_t grow = at_end ? capacity - slot->capacity : capacity;
+    if (reserve_arena(ht, grow) != 0) {
+      return -1;
+    }
+    if (!at_end) {
+      memcpy(ht->arena + ht->arena_size, ht->arena + slot->offset,
+             sizeof(valType) * slot->count);
+      slot->offset = (uint32_t)ht->arena_size;
+    }
+    ht->arena_size += grow;
+    slot->capacity = (uint32_t)capacity;
+  }
+  if (is_new) {
+    slot->key = key;
+    ht->size++;
+  }
+  ht->arena[slot->offset + slot->count++] = value;
+  return 0;
+}
 
-  unsigned int bucket = hash(key, ht->num_buckets);
-
-  // Create new value node
-  node* new_value = (node*)malloc(sizeof(node));
-  if (new_value == NULL) {
+int bulk_put(hashtable* ht, const keyType* keys, const valType* values, size_t n) {
+  if (ht == NULL || (n > 0 && (keys == NULL || values == NULL))) {
     return -1;
   }
-  new_value->value = value;
-  new_value->next = NULL;
-
-  // Find or create entry for this key
-  entry* current = ht->buckets[bucket];
-  while (current != NULL) {
-    if (current->key == key) {
-      // Add value to existing key's list
-      new_value->next = current->values;
-      current->values = new_value;
-      return 0;
+  if (ht->size > 0) {
+    for (size_t i = 0; i < n; i++) {
+      if (put(ht, keys[i], values[i]) != 0) return -1;
     }
-    current = current->next;
+    return 0;
   }
-
-  // Create new entry
-  entry* new_entry = (entry*)malloc(sizeof(entry));
-  if (new_entry == NULL) {
-    free(new_value);
+  ht->arena_size = 0;  // no run is live, not even an erased key's
+  if (reserve_arena(ht, n) != 0) {
     return -1;
   }
 
-  new_entry->key = key;
-  new_entry->values = new_value;
-  new_entry->next = ht->buckets[bucket];
-  ht->buckets[bucket] = new_entry;
-  ht->size++;
-
+  // Count each key's values, growing the slots for the keys seen so far; a room of 1
+  // marks a slot used until the runs are laid out
+  for (size_t i = 0; i < n; i++) {
+    if (reserve_keys(ht, 1) != 0) {
+      return -1;
+    }
+    hashslot* slot = &ht->slots[find_slot(ht, keys[i])];
+    if (slot->capacity == 0) {
+      slot->key = keys[i];
+      slot->capacity = 1;
+      ht->size++;
+    }
+    slot->count++;
+  }
+  // Lay the runs out in slot order, then place the values, counting them again
+  size_t offset = 0;
+  for (size_t s = 0; s < ht->num_slots; s++) {
+    hashslot* slot = &ht->slots[s];
+    if (!slot->capacity) continue;
+    slot->offset = (uint32_t)offset;
+    slot->capacity = slot->count;
+    offset += slot->count;
+    slot->count = 0;
+  }
+  for (size_t i = 0; i < n; i++) {
+    hashslot* slot = &ht->slots[find_slot(ht, keys[i])];
+    ht->arena[slot->offset + slot->count++] = values[i];
+  }
+  ht->arena_size = n;
   return 0;
 }
 
@@ -80,65 +159,43 @@ int get(hashtable* ht, keyType key, valType* values, int num_values, int* num_re
   if (ht == NULL || values == NULL || num_results == NULL || num_values <= 0) {
     return -1;
   }
-
-  *num_results = 0;
-  unsigned int bucket = hash(key, ht->num_buckets);
-
-  // Find entry with matching key
-  entry* current = ht->buckets[bucket];
-  while (current != NULL) {
-    if (current->key == key) {
-      // Copy values to output array
-      node* val = current->values;
-      while (val != NULL) {
-        if (*num_results < num_values) {
-          values[*num_results] = val->value;
-        }
-        (*num_results)++;
-        val = val->next;
-      }
-      return 0;
-    }
-    current = current->next;
+  size_t count = 0;
+  const valType* run = get_values(ht, key, &count);
+  if (run) {
+    size_t n = count < (size_t)num_values ? count : (size_t)num_values;
+    memcpy(values, run, sizeof(valType) * n);
   }
-
+  *num_results = (int)count;
   return 0;
 }
 
+const valType* get_values(const hashtable* ht, keyType key, size_t* num_results) {
+  const hashslot* slot = &ht->slots[find_slot(ht, key)];
+  *num_results = slot->count;
+  return slot->capacity ? ht->arena + slot->offset : NULL;
+}
+
 int erase(hashtable* ht, keyType key) {
   if (ht == NULL) {
     return -1;
   }
-
-  unsigned int bucket = hash(key, ht->num_buckets);
-  entry* current = ht->buckets[bucket];
-  entry* prev = NULL;
-
-  while (current != NULL) {
-    if (current->key == key) {
-      // Free all value nodes
-      node* val = current->values;
-      while (val != NULL) {
-        node* temp = val;
-        val = val->next;
-        free(temp);
-      }
-
-      // Remove entry from bucket list
-      if (prev == NULL) {
-        ht->buckets[bucket] = current->next;
-      } else {
-        prev->next = current->next;
-      }
-
-      free(current);
-      ht->size--;
-      return 0;
+  size_t mask = ht->num_slots - 1;
+  size_t hole = find_slot(ht, key);
+  if (!ht->slots[hole].capacity) {
+    return 0;
+  }
+  ht->size--;
+  // Backward shift: pull each later key of the probe run back into the hole, unless the
+  // hole lies before its home slot (it could not be found there), so no probe run ever
+  // has a gap and no tombstones are needed
+  for (size_t i = (hole + 1) & mask; ht->slots[i].capacity; i = (i + 1) & mask) {
+    size_t home = home_slot(ht, ht->slots[i].key);
+    if (((i - home) & mask) >= ((i - hole) & mask)) {
+      ht->slots[hole] = ht->slots[i];
+      hole = i;
     }
-    prev = current;
-    current = current->next;
   }
-
+  memset(&ht->slots[hole], 0, sizeof(hashslot));
   return 0;
 }
 
@@ -146,29 +203,8 @@ int deallocate(hashtable* ht) {
   if (ht == NULL) {
     return -1;
   }
-
-  // Free all entries and their value lists
-  for (int i = 0; i < ht->num_buckets; i++) {
-    entry* current = ht->buckets[i];
-    while (current != NULL) {
-      // Free value list
-      node* val = current->values;
-      while (val != NULL) {
-        node* temp_val = val;
-        val = val->next;
-        free(temp_val);
-      }
-
-      // Free entry
-      entry* temp_entry = current;
-      current = current->next;
-      free(temp_entry);
-    }
-  }
-
-  // Free buckets array and hash table structure
-  free(ht->buckets);
+  free(ht->slots);
+  free(ht->arena);
   free(ht);
-
   return 0;
 }
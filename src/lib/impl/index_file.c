@@ -0,0 +1,118 @@
+#define _GNU_SOURCE
+#include "index_file.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils.h"
+
+static size_t aligned(size_t offset) {
+  return (offset + INDEX_FILE_ALIGN - 1) / INDEX_FILE_ALIGN * INDEX_FILE_ALIGN;
+}
+
+// FNV-1a over the header fields before the checksum
+static uint64_t header_checksum(const IndexFileHeader* header) {
+  const unsigned char* bytes = (const unsigned char*)header;
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < offsetof(IndexFileHeader, checksum); i++) {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+int index_file_write(const char* path, uint32_t magic,
+                     const uint64_t meta[INDEX_FILE_META],
+                     const void* const sections[INDEX_FILE_SECTIONS],
+                     const size_t sizes[INDEX_FILE_SECTIONS]) {
+  IndexFileHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = magic;
+  header.version = INDEX_FILE_VERSION;
+  for (size_t m = 0; m < INDEX_FILE_META; m++) header.meta[m] = meta[m];
+  for (size_t s = 0; s < INDEX_FILE_SECTIONS; s++) header.section_sizes[s] = sizes[s];
+  header.checksum = header_checksum(&header);
+
+  char tmp_path[MAX_PATH_LEN + 8];
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+  FILE* file = fopen(tmp_path, "wb");
+  if (!file) {
+    log_err("index_file_write: Failed to open %s for writing\n", tmp_path);
+    return -1;
+  }
+  static const char padding[INDEX_FILE_ALIGN] = {0};
+  int ok = fwrite(&header, sizeof(header), 1, file) == 1;
+  size_t offset = sizeof(header);
+  for (size_t s = 0; s < INDEX_FILE_SECTIONS && ok; s++) {
+    if (sizes[s] == 0) continue;
+    size_t pad = aligned(offset) - offset;
+    ok = fwrite(padding, 1, pad, file) == pad &&
+         fwrite(sections[s], 1, sizes[s], file) == sizes[s];
+    offset += pad + sizes[s];
+  }
+  if (fclose(file) != 0) ok = 0;
+  if (!ok || rename(tmp_path, path) != 0) {
+    log_err("index_file_write: Failed to write %s\n", path);
+    unlink(tmp_path);
+    return -1;
+  }
+  return 0;
+}
+
+IndexFile* index_file_map(const char* path, uint32_t magic) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return NULL;
+
+  IndexFile* file = NULL;
+  struct stat st;
+  IndexFileHeader header;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(header) ||
+      pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+      header.magic != magic || header.version != INDEX_FILE_VERSION ||
+      header.checksum != header_checksum(&header)) {
+    log_err("index_file_map: %s is not a valid index file\n", path);
+    goto done;
+  }
+  size_t size = sizeof(header);
+  for (size_t s = 0; s < INDEX_FILE_SECTIONS; s++) {
+    if (header.section_sizes[s]) size = aligned(size) + header.section_sizes[s];
+  }
+  if (size != (size_t)st.st_size) {
+    log_err("index_file_map: %s is truncated or too long\n", path);
+    goto done;
+  }
+
+  void* base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  if (base == MAP_FAILED) {
+    log_err("index_file_map: Failed to map %s\n", path);
+    goto done;
+  }
+  file = calloc(1, sizeof(IndexFile));
+  if (!file) {
+    munmap(base, size);
+    goto done;
+  }
+  file->base = base;
+  file->size = size;
+  file->header = header;
+  size_t offset = sizeof(header);
+  for (size_t s = 0; s < INDEX_FILE_SECTIONS; s++) {
+    if (header.section_sizes[s] == 0) continue;
+    offset = aligned(offset);
+    file->sections[s] = (char*)base + offset;
+    offset += header.section_sizes[s];
+  }
+
+done:
+  close(fd);
+  return file;
+}
+
+void index_file_unmap(IndexFile* file) {
+  if (!file) return;
+  munmap(file->base, file->size);
+  free(file);
+}
@@ -0,0 +1,63 @@
+#include "join_output.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+int join_output_grow(JoinOutput* out) {
+  if (out->n_chunks == JOIN_OUTPUT_MAX_CHUNKS) return -1;
+  size_t capacity = out->capacity ? out->capacity * 2 : JOIN_OUTPUT_FIRST_CHUNK;
+  int* left = malloc(sizeof(int) * capacity);
+  int* right = malloc(sizeof(int) * capacity);
+  if (!left || !right) {
+    free(left);
+    free(right);
+    return -1;
+  }
+  out->left[out->n_chunks] = left;
+  out->right[out->n_chunks] = right;
+  out->n_chunks++;
+  out->total += out->n;
+  out->n = 0;
+  out->capacity = capacity;
+  return 0;
+}
+
+void join_output_free(JoinOutput* out) {
+  for (size_t c = 0; c < out->n_chunks; c++) {
+    free(out->left[c]);
+    free(out->right[c]);
+  }
+  memset(out, 0, sizeof(JoinOutput));
+}
+
+int join_output_concat(JoinOutput* outputs, size_t n_outputs, JoinResult* result) {
+  size_t total = 0;
+  for (size_t o = 0; o < n_outputs; o++) total += join_output_size(&outputs[o]);
+  result->left = malloc(sizeof(int) * (total ? total : 1));
+  result->right = malloc(sizeof(int) * (total ? total : 1));
+  result->n = 0;
+  int status = result->left && result->right ? 0 : -1;
+  if (status) join_result_free(result);
+
+  for (size_t o = 0; o < n_outputs; o++) {
+    JoinOutput* out = &outputs[o];
+    // Every chunk but the last is full
+    size_t room = JOIN_OUTPUT_FIRST_CHUNK;
+    for (size_t c = 0; c < out->n_chunks && status == 0; c++, room *= 2) {
+      size_t n = c + 1 == out->n_chunks ? out->n : room;
+      memcpy(result->left + result->n, out->left[c], sizeof(int) * n);
+      memcpy(result->right + result->n, out->right[c], sizeof(int) * n);
+      result->n += n;
+    }
+    join_output_free(out);
+  }
+  return status;
+}
+
+void join_result_free(JoinResult* result) {
+  free(result->left);
+  free(result->right);
+  result->left = NULL;
+  result->right = NULL;
+  result->n = 0;
+}
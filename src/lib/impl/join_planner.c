@@ -0,0 +1,162 @@
+#include "join_planner.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "grace_join.h"
+#include "radix_join.h"
+
+// Costs in nanoseconds per tuple on one core, measured on joins of 4M random keys. Only
+// their ratios matter.
+// Every algorithm but the nested loop allocates tables or outputs per morsel up front
+#define COST_SETUP 20000.0
+#define COST_NESTED_LOOP_PAIR 0.5
+// Per build or probe tuple of one table: in the cache; with only its slots in the cache
+// (each key's values are still a miss); and with neither
+#define COST_HASH_CACHED 20.0
+#define COST_HASH_SLOTS_CACHED 35.0
+#define COST_HASH_MEMORY 130.0
+// Bytes a distinct key of a table takes in its slots (kept at most half full), and a
+// value in its arena
+#define HASH_KEY_BYTES 32
+#define HASH_VALUE_BYTES 4
+#define COST_RADIX 60.0
+// Each partition is written to and read back from disk once more than a radix join
+#define COST_GRACE 100.0
+#define COST_SORT 65.0
+#define COST_MERGE 15.0
+// Bytes a side sorted for a merge takes: copies of its keys and payloads, and the
+// sort's buffers for them
+#define SORT_TUPLE_BYTES 16
+// Per level of an index lookup's binary search, most of them cache misses
+#define COST_INDEX_LEVEL 25.0
+// Marking a tuple of the indexed side in a bitmap of the index's rows, and checking a
+// row an index lookup finds against it
+#define COST_BITMAP_SET 3.0
+#define COST_BITMAP_TEST 5.0
+
+static int compare_ints(const void* a, const void* b) {
+  int x = *(const int*)a, y = *(const int*)b;
+  return (x > y) - (x < y);
+}
+
+// Levels of a binary search over `n` elements: ceil(log2(n + 1))
+static size_t search_levels(size_t n) {
+  size_t levels = 0;
+  while (n) {
+    levels++;
+    n >>= 1;
+  }
+  return levels;
+}
+
+size_t estimate_distinct(const int* keys, size_t n) {
+  if (n == 0) return 0;
+  size_t s = n < JOIN_PLANNER_SAMPLE ? n : JOIN_PLANNER_SAMPLE;
+  int sample[JOIN_PLANNER_SAMPLE];
+  for (size_t i = 0; i < s; i++) sample[i] = keys[i * n / s];
+  qsort(sample, s, sizeof(int), compare_ints);
+
+  // Distinct values of the sample, and how many of them it has just once
+  size_t distinct = 0, singletons = 0;
+  for (size_t i = 0; i < s;) {
+    size_t end = i + 1;
+    while (end < s && sample[end] == sample[i]) end++;
+    distinct++;
+    singletons += end - i == 1;
+    i = end;
+  }
+  if (s == n) return distinct;
+  // distinct / (1 - (1 - s / n) * singletons / s)
+  double unseen = (1.0 - (double)s / n) * singletons / s;
+  size_t estimate = (size_t)(distinct / (1.0 - unseen));
+  return estimate < distinct ? distinct : estimate > n ? n : estimate;
+}
+
+// Whether a table of `bytes` stays in the cache, by the same measure `radix_join` uses to
+// keep a build side in one partition
+static int fits_cache(size_t bytes) {
+  return radix_join_bits(bytes / RADIX_JOIN_TUPLE_BYTES) == 0;
+}
+
+// Cost of one table over `build`, probed by `probe` tuples
+static double hash_cost(const JoinSideStats* build, size_t probe) {
+  size_t slot_bytes = build->distinct * HASH_KEY_BYTES;
+  size_t bytes = slot_bytes + build->n * HASH_VALUE_BYTES;
+  double per_tuple = fits_cache(bytes)        ? COST_HASH_CACHED
+                     : fits_cache(slot_bytes) ? COST_HASH_SLOTS_CACHED
+                                              : COST_HASH_MEMORY;
+  return COST_SETUP + per_tuple * (double)(build->n + probe);
+}
+
+// Cost of looking up every tuple of `probe` in the index of `indexed`
+static double index_nested_loop_cost(const JoinSideStats* indexed,
+                                     const JoinSideStats* probe, double output) {
+  if (!indexed->index_n) return INFINITY;
+  // Matches outside the indexed side are looked up and checked too: as many, relative to
+  // the results, as the index has rows for each of the side's
+  double checked = indexed->n ? output * indexed->index_n / indexed->n : 0;
+  return COST_SETUP + COST_BITMAP_SET * indexed->n +
+         COST_INDEX_LEVEL * search_levels(indexed->index_n) * probe->n +
+         COST_BITMAP_TEST * checked;
+}
+
+JoinPlan plan_join(const JoinSideStats* left, const JoinSideStats* right,
+                   size_t memory_budget) {
+  JoinPlan plan = {.algorithm = JOIN_ALGO_NESTED_LOOP, .build_side = 0};
+  size_t l_n = left->n, r_n = right->n;
+  int smaller = r_n < l_n;
+  const JoinSideStats* build = smaller ? right : left;
+  size_t probe_n = smaller ? l_n : r_n;
+  size_t max_distinct =
+      left->distinct > right->distinct ? left->distinct : right->distinct;
+  plan.output = (double)l_n * r_n / (max_distinct ? max_distinct : 1);
+
+  plan.costs[JOIN_ALGO_NESTED_LOOP] = COST_NESTED_LOOP_PAIR * l_n * r_n;
+  int fits_memory = build->n <= memory_budget / GRACE_JOIN_BUILD_BYTES;
+  plan.costs[JOIN_ALGO_HASH] = fits_memory ? hash_cost(build, probe_n) : INFINITY;
+  plan.costs[JOIN_ALGO_RADIX] =
+      fits_memory ? COST_SETUP + COST_RADIX * (l_n + r_n) : INFINITY;
+  // Within the budget, a grace join is a radix join
+  plan.costs[JOIN_ALGO_GRACE] =
+      fits_memory ? INFINITY : COST_SETUP + COST_GRACE * (l_n + r_n);
+
+  size_t unsorted = (left->sorted ? 0 : l_n) + (right->sorted ? 0 : r_n);
+  plan.costs[JOIN_ALGO_SORT_MERGE] =
+      unsorted <= memory_budget / SORT_TUPLE_BYTES
+          ? COST_SETUP + COST_SORT * unsorted + COST_MERGE * (l_n + r_n)
+          : INFINITY;
+
+  double l_index = index_nested_loop_cost(left, right, plan.output);
+  double r_index = index_nested_loop_cost(right, left, plan.output);
+  plan.costs[JOIN_ALGO_INDEX_NESTED_LOOP] = r_index < l_index ? r_index : l_index;
+
+  for (int a = 0; a < JOIN_ALGO_COUNT; a++) {
+    if (plan.costs[a] < plan.costs[plan.algorithm]) plan.algorithm = (JoinAlgorithm)a;
+  }
+  if (plan.algorithm == JOIN_ALGO_INDEX_NESTED_LOOP) {
+    plan.build_side = r_index < l_index;
+  } else {
+    plan.build_side = smaller;
+  }
+  return plan;
+}
+
+const char* join_algorithm_name(JoinAlgorithm algorithm) {
+  switch (algorithm) {
+    case JOIN_ALGO_NESTED_LOOP:
+      return "nested-loop";
+    case JOIN_ALGO_HASH:
+      return "hash";
+    case JOIN_ALGO_RADIX:
+      return "radix-hash";
+    case JOIN_ALGO_GRACE:
+      return "grace-hash";
+    case JOIN_ALGO_SORT_MERGE:
+      return "sort-merge";
+    case JOIN_ALGO_INDEX_NESTED_LOOP:
+      return "index-nested-loop";
+    default:
+      return "unknown";
+  }
+}
@@ -0,0 +1,375 @@
+#define _GNU_SOURCE
+#include "radix_join.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "hash.h"
+#include "utils.h"
+
+// L2 cache size assumed when the system doesn't report one
+#define RADIX_JOIN_DEFAULT_L2 (256 * 1024)
+// Fewest tuples a chunk of the first partitioning pass gets
+#define RADIX_JOIN_MIN_CHUNK 65536
+// Probe tuples per morsel when the build side is a single table
+#define RADIX_JOIN_PROBE_MORSEL 16384
+
+size_t radix_join_bits(size_t build_n) {
+  long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+  size_t cache = l2 > 0 ? (size_t)l2 : RADIX_JOIN_DEFAULT_L2;
+  size_t bytes = build_n * RADIX_JOIN_TUPLE_BYTES, bits = 0;
+  while (bits < RADIX_JOIN_MAX_BITS && (bytes >> bits) > cache) bits++;
+  return bits;
+}
+
+/**
+ * @brief One partitioning pass over a side, shared by its chunks: scatters `keys` and
+ * their `payloads` into `out_keys`/`out_payloads` by the `fanout` bits of their hash
+ * at `shift`. `offsets[chunk * fanout + p]` first holds the chunk's count of partition
+ * `p`, then where its first tuple of `p` goes.
+ */
+typedef struct {
+  const int* keys;
+  const int* payloads;
+  int* out_keys;
+  int* out_payloads;
+  size_t* offsets;
+  size_t fanout;
+  int shift;
+} PartitionPass;
+
+// Partitioning passes split on the top bits of a key's hash, and a partition's table on
+// the bits below
+static inline size_t partition_of(int key, int shift, size_t fanout) {
+  return (hash32(key) >> shift) & (fanout - 1);
+}
+
+static void partition_histogram(void* arg, size_t chunk, size_t start, size_t end) {
+  PartitionPass* pass = (PartitionPass*)arg;
+  size_t* counts = pass->offsets + chunk * pass->fanout;
+  memset(counts, 0, sizeof(size_t) * pass->fanout);
+  for (size_t i = start; i < end; i++) {
+    counts[partition_of(pass->keys[i], pass->shift, pass->fanout)]++;
+  }
+}
+
+static void partition_scatter(void* arg, size_t chunk, size_t start, size_t end) {
+  PartitionPass* pass = (PartitionPass*)arg;
+  size_t* offsets = pass->offsets + chunk * pass->fanout;
+  for (size_t i = start; i < end; i++) {
+    size_t dst = offsets[partition_of(pass->keys[i], pass->shift, pass->fanout)]++;
+    pass->out_keys[dst] = pass->keys[i];
+    pass->out_payloads[dst] = pass->payloads[i];
+  }
+}
+
+/**
+ * @brief Runs `pass` over `n` tuples in `n_chunks` chunks on `pool`, and sets `starts[p]`
+ * to the start of partition `p` in the output (`starts[fanout]` to `n`).
+ */
+static void partition(PartitionPass* pass, size_t n, size_t n_chunks, ThreadPool* pool,
+                      size_t* starts) {
+  threadpool_parallel_for(pool, n, n_chunks, partition_histogram, pass);
+  size_t total = 0;
+  for (size_t p = 0; p < pass->fanout; p++) {
+    starts[p] = total;
+    for (size_t c = 0; c < n_chunks; c++) {
+      size_t count = pass->offsets[c * pass->fanout + p];
+      pass->offsets[c * pass->fanout + p] = total;
+      total += count;
+    }
+  }
+  starts[pass->fanout] = total;
+  threadpool_parallel_for(pool, n, n_chunks, partition_scatter, pass);
+}
+
+/**
+ * @brief A worker's scratch space: the second-pass partitions of the pair of partitions
+ * it is joining (build side first), and the hash table of the one it is on. Tables chain
+ * build tuples through `next`, by index + 1, from `heads` (0 ends a chain).
+ */
+typedef struct {
+  int* keys;
+  size_t n_keys;
+  int* payloads;
+  size_t n_payloads;
+  uint32_t* heads;
+  size_t n_heads;
+  uint32_t* next;
+  size_t n_next;
+  size_t offsets[1 << RADIX_JOIN_PASS_BITS];
+  size_t starts[2][(1 << RADIX_JOIN_PASS_BITS) + 1];
+} JoinScratch;
+
+// Grows `*array` of `elt_size`-byte elements to room for at least `n` of them
+static int reserve(void** array, size_t* capacity, size_t n, size_t elt_size) {
+  if (n <= *capacity) return 0;
+  size_t grown = *capacity * 2 > n ? *capacity * 2 : n;
+  void* p = realloc(*array, elt_size * grown);
+  if (!p) return -1;
+  *array = p;
+  *capacity = grown;
+  return 0;
+}
+
+/**
+ * @brief A hash table over `n` build tuples, indexed by the `bits` bits of their hash
+ * below the `used_bits` top bits the partitioning passes split on.
+ */
+typedef struct {
+  const int* keys;
+  const int* payloads;
+  const uint32_t* heads;
+  const uint32_t* next;
+  int used_bits;
+  int shift;
+} JoinTable;
+
+static inline size_t bucket_of(const JoinTable* table, int key) {
+  return (size_t)((hash32(key) << table->used_bits) >> table->shift);
+}
+
+static int build_table(JoinScratch* scratch, const int* keys, const int* payloads,
+                       size_t n, int used_bits, JoinTable* table) {
+  int bits = 1;  // at least one bucket bit, so the shift stays below 32
+  while (bits < 31 && ((size_t)1 << bits) < n) bits++;
+  size_t n_buckets = (size_t)1 << bits;
+  if (reserve((void**)&scratch->heads, &scratch->n_heads, n_buckets, sizeof(uint32_t)) ||
+      reserve((void**)&scratch->next, &scratch->n_next, n, sizeof(uint32_t))) {
+    return -1;
+  }
+  *table = (JoinTable){keys, payloads, scratch->heads, scratch->next, used_bits,
+                       32 - bits};
+  memset(scratch->heads, 0, sizeof(uint32_t) * n_buckets);
+  // Tuples go in back to front, so each chain lists its tuples in input order
+  for (size_t i = n; i-- > 0;) {
+    size_t b = bucket_of(table, keys[i]);
+    scratch->next[i] = scratch->heads[b];
+    scratch->heads[b] = (uint32_t)(i + 1);
+  }
+  return 0;
+}
+
+// Probes `table` with `n` tuples; pairs are (build, probe) payloads, or (probe, build)
+// if `swapped`
+static int probe_table(const JoinTable* table, const int* keys, const int* payloads,
+                       size_t n, int swapped, JoinOutput* out) {
+  for (size_t j = 0; j < n; j++) {
+    int key = keys[j];
+    for (uint32_t e = table->heads[bucket_of(table, key)]; e; e = table->next[e - 1]) {
+      if (table->keys[e - 1] != key) continue;
+      int build = table->payloads[e - 1], probe = payloads[j];
+      if (join_output_emit(out, swapped ? probe : build, swapped ? build : probe)) {
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Shared by every morsel of a join. After the first pass, morsel `p` joins the
+ * pair of partitions `p` (splitting them on `pass2_bits` more bits first, if any);
+ * without partitioning, a morsel is a range of probe tuples for the single `table`.
+ * Morsel `m` writes its pairs to `outputs[m]`.
+ */
+typedef struct {
+  const int* build_keys;
+  const int* build_payloads;
+  const int* probe_keys;
+  const int* probe_payloads;
+  const size_t* build_starts;
+  const size_t* probe_starts;
+  int pass1_bits;
+  int pass2_bits;
+  int swapped;
+  const JoinTable* table;
+  JoinScratch* scratch;  // one per worker
+  JoinOutput* outputs;
+  int failed;
+} RadixJoinArgs;
+
+static void probe_morsel(void* arg, size_t worker, size_t morsel, size_t start,
+                         size_t end) {
+  (void)worker;
+  RadixJoinArgs* args = (RadixJoinArgs*)arg;
+  if (probe_table(args->table, args->probe_keys + start, args->probe_payloads + start,
+                  end - start, args->swapped, &args->outputs[morsel])) {
+    __atomic_store_n(&args->failed, 1, __ATOMIC_RELAXED);
+  }
+}
+
+// Joins `nb` build tuples with `np` probe tuples of the same partition
+static int join_partitions(RadixJoinArgs* args, JoinScratch* scratch, const int* b_keys,
+                           const int* b_payloads, size_t nb, const int* p_keys,
+                           const int* p_payloads, size_t np, int used_bits,
+                           size_t morsel) {
+  if (nb == 0 || np == 0) return 0;
+  JoinTable table;
+  if (build_table(scratch, b_keys, b_payloads, nb, used_bits, &table)) return -1;
+  return probe_table(&table, p_keys, p_payloads, np, args->swapped,
+                     &args->outputs[morsel]);
+}
+
+static void partition_morsel(void* arg, size_t worker, size_t morsel, size_t start,
+                             size_t end) {
+  (void)end;
+  RadixJoinArgs* args = (RadixJoinArgs*)arg;
+  JoinScratch* scratch = &args->scratch[worker];
+  size_t b0 = args->build_starts[start], nb = args->build_starts[start + 1] - b0;
+  size_t p0 = args->probe_starts[start], np = args->probe_starts[start + 1] - p0;
+  const int* b_keys = args->build_keys + b0;
+  const int* b_payloads = args->build_payloads + b0;
+  const int* p_keys = args->probe_keys + p0;
+  const int* p_payloads = args->probe_payloads + p0;
+  int status = 0;
+  if (args->pass2_bits == 0 || nb == 0 || np == 0) {
+    status = join_partitions(args, scratch, b_keys, b_payloads, nb, p_keys, p_payloads,
+                             np, args->pass1_bits, morsel);
+    goto done;
+  }
+
+  // Second pass, within the worker: both partitions are split the same way into the
+  // scratch space, build side first, and each pair of sub-partitions is then joined
+  if (reserve((void**)&scratch->keys, &scratch->n_keys, nb + np, sizeof(int)) ||
+      reserve((void**)&scratch->payloads, &scratch->n_payloads, nb + np, sizeof(int))) {
+    status = -1;
+    goto done;
+  }
+  size_t fanout = (size_t)1 << args->pass2_bits;
+  int used_bits = args->pass1_bits + args->pass2_bits;
+  PartitionPass pass = {.offsets = scratch->offsets,
+                        .fanout = fanout,
+                        .shift = 32 - used_bits};
+  const int* side_keys[2] = {b_keys, p_keys};
+  const int* side_payloads[2] = {b_payloads, p_payloads};
+  size_t side_n[2] = {nb, np};
+  for (int side = 0; side < 2; side++) {
+    pass.keys = side_keys[side];
+    pass.payloads = side_payloads[side];
+    pass.out_keys = scratch->keys + (side ? nb : 0);
+    pass.out_payloads = scratch->payloads + (side ? nb : 0);
+    partition(&pass, side_n[side], 1, NULL, scratch->starts[side]);
+  }
+  const size_t* b_starts = scratch->starts[0];
+  const size_t* p_starts = scratch->starts[1];
+  for (size_t q = 0; q < fanout && status == 0; q++) {
+    status = join_partitions(
+        args, scratch, scratch->keys + b_starts[q], scratch->payloads + b_starts[q],
+        b_starts[q + 1] - b_starts[q], scratch->keys + nb + p_starts[q],
+        scratch->payloads + nb + p_starts[q], p_starts[q + 1] - p_starts[q], used_bits,
+        morsel);
+  }
+done:
+  if (status) __atomic_store_n(&args->failed, 1, __ATOMIC_RELAXED);
+}
+
+// Number of chunks for a parallel pass over `n` tuples on `pool`
+static size_t pass_chunks(ThreadPool* pool, size_t n) {
+  size_t n_chunks = pool ? threadpool_size(pool) : 1;
+  if (n_chunks > n / RADIX_JOIN_MIN_CHUNK) n_chunks = n / RADIX_JOIN_MIN_CHUNK;
+  return n_chunks ? n_chunks : 1;
+}
+
+int radix_join(const int* l_keys, const int* l_payloads, size_t l_n, const int* r_keys,
+               const int* r_payloads, size_t r_n, size_t radix_bits, ThreadPool* pool,
+               JoinResult* result) {
+  *result = (JoinResult){NULL, NULL, 0};
+  if (l_n > INT_MAX || r_n > INT_MAX) {
+    log_err("radix_join: %zu x %zu tuples is too many for 32-bit positions\n", l_n, r_n);
+    return -1;
+  }
+  if (radix_bits > RADIX_JOIN_MAX_BITS) radix_bits = RADIX_JOIN_MAX_BITS;
+
+  // The smaller side is the one hash tables are built over
+  int swapped = r_n < l_n;
+  RadixJoinArgs args = {.build_keys = swapped ? r_keys : l_keys,
+                        .build_payloads = swapped ? r_payloads : l_payloads,
+                        .probe_keys = swapped ? l_keys : r_keys,
+                        .probe_payloads = swapped ? l_payloads : r_payloads,
+                        .swapped = swapped};
+  size_t nb = swapped ? r_n : l_n, np = swapped ? l_n : r_n;
+  if (nb == 0 || np == 0) return join_output_concat(NULL, 0, result);
+
+  // Split the bits between the passes, so neither has more than RADIX_JOIN_PASS_BITS
+  args.pass1_bits = (int)(radix_bits <= RADIX_JOIN_PASS_BITS ? radix_bits
+                                                              : (radix_bits + 1) / 2);
+  args.pass2_bits = (int)radix_bits - args.pass1_bits;
+  size_t fanout = (size_t)1 << args.pass1_bits;
+  size_t n_morsels = args.pass1_bits
+                         ? fanout
+                         : threadpool_num_morsels(np, RADIX_JOIN_PROBE_MORSEL);
+  size_t n_workers = threadpool_morsel_workers(pool);
+
+  int status = -1;
+  int* part_keys = NULL;
+  int* part_payloads = NULL;
+  size_t* offsets = NULL;
+  size_t* starts = malloc(sizeof(size_t) * 2 * (fanout + 1));
+  JoinScratch* scratch = calloc(n_workers, sizeof(JoinScratch));
+  args.outputs = calloc(n_morsels, sizeof(JoinOutput));
+  if (!starts || !scratch || !args.outputs) goto cleanup;
+  args.scratch = scratch;
+
+  if (args.pass1_bits == 0) {
+    // The build side fits in the cache as it is: one table, probed in parallel
+    JoinTable table;
+    if (build_table(&scratch[0], args.build_keys, args.build_payloads, nb, 0, &table)) {
+      goto cleanup;
+    }
+    args.table = &table;
+    threadpool_parallel_morsels(pool, np, RADIX_JOIN_PROBE_MORSEL, probe_morsel, &args);
+  } else {
+    // First pass over each side in parallel chunks, into one buffer for both sides
+    size_t n_chunks = pass_chunks(pool, np);
+    part_keys = malloc(sizeof(int) * (nb + np));
+    part_payloads = malloc(sizeof(int) * (nb + np));
+    offsets = malloc(sizeof(size_t) * fanout * n_chunks);
+    if (!part_keys || !part_payloads || !offsets) goto cleanup;
+    PartitionPass pass = {.offsets = offsets,
+                          .fanout = fanout,
+                          .shift = 32 - args.pass1_bits};
+    pass.keys = args.build_keys;
+    pass.payloads = args.build_payloads;
+    pass.out_keys = part_keys;
+    pass.out_payloads = part_payloads;
+    partition(&pass, nb, pass_chunks(pool, nb), pool, starts);
+    pass.keys = args.probe_keys;
+    pass.payloads = args.probe_payloads;
+    pass.out_keys = part_keys + nb;
+    pass.out_payloads = part_payloads + nb;
+    partition(&pass, np, n_chunks, pool, starts + fanout + 1);
+
+    args.build_keys = part_keys;
+    args.build_payloads = part_payloads;
+    args.probe_keys = part_keys + nb;
+    args.probe_payloads = part_payloads + nb;
+    args.build_starts = starts;
+    args.probe_starts = starts + fanout + 1;
+    // Partitions are independent: workers steal them as they go, which evens out skew
+    threadpool_parallel_morsels(pool, fanout, 1, partition_morsel, &args);
+  }
+  if (!args.failed) status = join_output_concat(args.outputs, n_morsels, result);
+
+cleanup:
+  if (status) log_err("radix_join: Failed to join %zu x %zu tuples\n", l_n, r_n);
+  for (size_t m = 0; args.outputs && m < n_morsels; m++) {
+    join_output_free(&args.outputs[m]);
+  }
+  for (size_t w = 0; scratch && w < n_workers; w++) {
+    free(scratch[w].keys);
+    free(scratch[w].payloads);
+    free(scratch[w].heads);
+    free(scratch[w].next);
+  }
+  free(scratch);
+  free(args.outputs);
+  free(starts);
+  free(offsets);
+  free(part_keys);
+  free(part_payloads);
+  return status;
+}
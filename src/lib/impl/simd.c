@@ -0,0 +1,870 @@
+#include "simd.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_X86 1
+#endif
+
+static SimdLevel supported_level = SIMD_SCALAR;
+static SimdLevel active_level = SIMD_SCALAR;
+static pthread_once_t simd_once = PTHREAD_ONCE_INIT;
+
+#ifdef SIMD_X86
+// compress_lut[m] lists the lanes set in the 8-bit mask `m`, in order; used by the AVX2
+// kernel to pack qualifying positions to the front of a vector with one permute.
+static int compress_lut[256][8] __attribute__((aligned(32)));
+#endif
+
+static void simd_init(void) {
+#ifdef SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("popcnt")) {
+    supported_level = SIMD_AVX512;
+  } else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+    supported_level = SIMD_AVX2;
+  }
+
+  for (int m = 0; m < 256; m++) {
+    int k = 0;
+    for (int lane = 0; lane < 8; lane++) {
+      if (m & (1 << lane)) compress_lut[m][k++] = lane;
+    }
+    while (k < 8) compress_lut[m][k++] = 0;
+  }
+#endif
+  active_level = supported_level;
+}
+
+SimdLevel simd_level(void) {
+  pthread_once(&simd_once, simd_init);
+  return active_level;
+}
+
+SimdLevel simd_force_level(SimdLevel level) {
+  pthread_once(&simd_once, simd_init);
+  active_level = level > supported_level ? supported_level : level;
+  return active_level;
+}
+
+ScanPredicate scan_predicate(long low, long high) {
+  if (low < INT_MIN) low = INT_MIN;
+  if (high > INT_MAX) high = INT_MAX;
+  if (low > high) return (ScanPredicate){SCAN_NONE, 0, 0};
+  if (low == high) return (ScanPredicate){SCAN_EQ, (int)low, (int)high};
+  if (low == INT_MIN) return (ScanPredicate){SCAN_LE, (int)low, (int)high};
+  if (high == INT_MAX) return (ScanPredicate){SCAN_GE, (int)low, (int)high};
+  return (ScanPredicate){SCAN_BETWEEN, (int)low, (int)high};
+}
+
+// Whether `x` qualifies; called with a constant `shape` so the switch folds away
+static inline __attribute__((always_inline)) int scalar_keep(ScanShape shape, int x,
+                                                             int low, int high) {
+  switch (shape) {
+    case SCAN_LE:
+      return x <= high;
+    case SCAN_GE:
+      return x >= low;
+    case SCAN_BETWEEN:
+      return (x >= low) & (x <= high);
+    case SCAN_EQ:
+      return x == low;
+    default:
+      return 0;
+  }
+}
+
+/**
+ * @brief Branch-free scalar kernel: every position is written unconditionally and the
+ * output cursor only advances when the value qualifies. Called with a constant `shape`
+ * so that the predicate switch is resolved at compile time.
+ */
+static inline __attribute__((always_inline)) size_t select_scalar_shape(
+    ScanShape shape, const int* data, size_t n, int low, int high, const int* posns,
+    size_t base, int* out) {
+  size_t k = 0;
+  for (size_t i = 0; i < n; i++) {
+    out[k] = posns ? posns[i] : (int)(base + i);
+    k += scalar_keep(shape, data[i], low, high);
+  }
+  return k;
+}
+
+// Scalar bitmap kernel: packs the keep flags of up to 64 values into each word
+static inline __attribute__((always_inline)) size_t bitmap_scalar_shape(
+    ScanShape shape, const int* data, size_t n, int low, int high, uint64_t* words) {
+  size_t count = 0;
+  for (size_t i = 0; i < n; i += 64) {
+    size_t len = n - i < 64 ? n - i : 64;
+    uint64_t word = 0;
+    for (size_t j = 0; j < len; j++) {
+      word |= (uint64_t)scalar_keep(shape, data[i + j], low, high) << j;
+    }
+    words[i / 64] = word;
+    count += __builtin_popcountll(word);
+  }
+  return count;
+}
+
+static size_t select_scalar(const int* data, size_t n, const ScanPredicate* pred,
+                            const int* posns, size_t base, int* out) {
+  int lo = pred->low, hi = pred->high;
+  switch (pred->shape) {
+    case SCAN_LE:
+      return select_scalar_shape(SCAN_LE, data, n, lo, hi, posns, base, out);
+    case SCAN_GE:
+      return select_scalar_shape(SCAN_GE, data, n, lo, hi, posns, base, out);
+    case SCAN_BETWEEN:
+      return select_scalar_shape(SCAN_BETWEEN, data, n, lo, hi, posns, base, out);
+    case SCAN_EQ:
+      return select_scalar_shape(SCAN_EQ, data, n, lo, hi, posns, base, out);
+    default:
+      return 0;
+  }
+}
+
+static size_t bitmap_scalar(const int* data, size_t n, const ScanPredicate* pred,
+                            uint64_t* words) {
+  int lo = pred->low, hi = pred->high;
+  switch (pred->shape) {
+    case SCAN_LE:
+      return bitmap_scalar_shape(SCAN_LE, data, n, lo, hi, words);
+    case SCAN_GE:
+      return bitmap_scalar_shape(SCAN_GE, data, n, lo, hi, words);
+    case SCAN_BETWEEN:
+      return bitmap_scalar_shape(SCAN_BETWEEN, data, n, lo, hi, words);
+    case SCAN_EQ:
+      return bitmap_scalar_shape(SCAN_EQ, data, n, lo, hi, words);
+    default:
+      return 0;
+  }
+}
+
+#ifdef SIMD_X86
+// 8-bit mask of the lanes of `x` that qualify
+static inline __attribute__((always_inline, target("avx2"))) unsigned int mask_avx2(
+    ScanShape shape, __m256i x, __m256i lo, __m256i hi) {
+  switch (shape) {
+    case SCAN_LE:
+      return ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(x, hi))) & 0xFF;
+    case SCAN_GE:
+      return ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(lo, x))) & 0xFF;
+    case SCAN_BETWEEN:
+      return ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_or_si256(
+                 _mm256_cmpgt_epi32(lo, x), _mm256_cmpgt_epi32(x, hi)))) &
+             0xFF;
+    case SCAN_EQ:
+      return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(x, lo)));
+    default:
+      return 0;
+  }
+}
+
+/**
+ * @brief AVX2 kernel: compares 8 ints per instruction, turns the comparison into an
+ * 8-bit mask and packs the qualifying positions with a permute from `compress_lut`.
+ * A full vector is stored at `out + k`, which is safe since `k <= i` always holds.
+ */
+static inline __attribute__((always_inline, target("avx2,popcnt"))) size_t
+select_avx2_shape(ScanShape shape, const int* data, size_t n, int low, int high,
+                  const int* posns, size_t base, int* out) {
+  const __m256i lo = _mm256_set1_epi32(low);
+  const __m256i hi = _mm256_set1_epi32(high);
+  const __m256i step = _mm256_set1_epi32(8);
+  __m256i idx = _mm256_add_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                 _mm256_set1_epi32((int)base));
+  size_t i = 0, k = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i x = _mm256_loadu_si256((const __m256i*)(data + i));
+    unsigned int mask = mask_avx2(shape, x, lo, hi);
+
+    __m256i p = posns ? _mm256_loadu_si256((const __m256i*)(posns + i)) : idx;
+    __m256i perm = _mm256_load_si256((const __m256i*)compress_lut[mask]);
+    _mm256_storeu_si256((__m256i*)(out + k), _mm256_permutevar8x32_epi32(p, perm));
+    k += __builtin_popcount(mask);
+    idx = _mm256_add_epi32(idx, step);
+  }
+  return k + select_scalar_shape(shape, data + i, n - i, low, high,
+                                 posns ? posns + i : NULL, base + i, out + k);
+}
+
+__attribute__((target("avx2,popcnt"))) static size_t select_avx2(
+    const int* data, size_t n, const ScanPredicate* pred, const int* posns, size_t base,
+    int* out) {
+  int lo = pred->low, hi = pred->high;
+  switch (pred->shape) {
+    case SCAN_LE:
+      return select_avx2_shape(SCAN_LE, data, n, lo, hi, posns, base, out);
+    case SCAN_GE:
+      return select_avx2_shape(SCAN_GE, data, n, lo, hi, posns, base, out);
+    case SCAN_BETWEEN:
+      return select_avx2_shape(SCAN_BETWEEN, data, n, lo, hi, posns, base, out);
+    case SCAN_EQ:
+      return select_avx2_shape(SCAN_EQ, data, n, lo, hi, posns, base, out);
+    default:
+      return 0;
+  }
+}
+
+// AVX2 bitmap kernel: eight 8-lane compares fill one 64-bit word
+static inline __attribute__((always_inline, target("avx2,popcnt"))) size_t
+bitmap_avx2_shape(ScanShape shape, const int* data, size_t n, int low, int high,
+                  uint64_t* words) {
+  const __m256i lo = _mm256_set1_epi32(low);
+  const __m256i hi = _mm256_set1_epi32(high);
+  size_t i = 0, count = 0;
+  for (; i + 64 <= n; i += 64) {
+    uint64_t word = 0;
+    for (int v = 0; v < 8; v++) {
+      __m256i x = _mm256_loadu_si256((const __m256i*)(data + i + 8 * v));
+      word |= (uint64_t)mask_avx2(shape, x, lo, hi) << (8 * v);
+    }
+    words[i / 64] = word;
+    count += __builtin_popcountll(word);
+  }
+  return count + bitmap_scalar_shape(shape, data + i, n - i, low, high, words + i / 64);
+}
+
+__attribute__((target("avx2,popcnt"))) static size_t bitmap_avx2(
+    const int* data, size_t n, const ScanPredicate* pred, uint64_t* words) {
+  int lo = pred->low, hi = pred->high;
+  switch (pred->shape) {
+    case SCAN_LE:
+      return bitmap_avx2_shape(SCAN_LE, data, n, lo, hi, words);
+    case SCAN_GE:
+      return bitmap_avx2_shape(SCAN_GE, data, n, lo, hi, words);
+    case SCAN_BETWEEN:
+      return bitmap_avx2_shape(SCAN_BETWEEN, data, n, lo, hi, words);
+    case SCAN_EQ:
+      return bitmap_avx2_shape(SCAN_EQ, data, n, lo, hi, words);
+    default:
+      return 0;
+  }
+}
+
+// 16-bit mask of the lanes of `x` that qualify
+static inline __attribute__((always_inline, target("avx512f"))) __mmask16 mask_avx512(
+    ScanShape shape, __m512i x, __m512i lo, __m512i hi) {
+  switch (shape) {
+    case SCAN_LE:
+      return _mm512_cmple_epi32_mask(x, hi);
+    case SCAN_GE:
+      return _mm512_cmpge_epi32_mask(x, lo);
+    case SCAN_BETWEEN:
+      return _mm512_mask_cmple_epi32_mask(_mm512_cmpge_epi32_mask(x, lo), x, hi);
+    case SCAN_EQ:
+      return _mm512_cmpeq_epi32_mask(x, lo);
+    default:
+      return 0;
+  }
+}
+
+/**
+ * @brief AVX-512 kernel: 16 ints per compare straight into a mask register, packed with
+ * the native compress instruction (to a register, then one full store, which is much
+ * cheaper than a masked compress-store on some cores).
+ */
+static inline __attribute__((always_inline, target("avx512f,popcnt"))) size_t
+select_avx512_shape(ScanShape shape, const int* data, size_t n, int low, int high,
+                    const int* posns, size_t base, int* out) {
+  const __m512i lo = _mm512_set1_epi32(low);
+  const __m512i hi = _mm512_set1_epi32(high);
+  const __m512i step = _mm512_set1_epi32(16);
+  __m512i idx = _mm512_add_epi32(
+      _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+      _mm512_set1_epi32((int)base));
+  size_t i = 0, k = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m512i x = _mm512_loadu_si512((const void*)(data + i));
+    __mmask16 mask = mask_avx512(shape, x, lo, hi);
+
+    __m512i p = posns ? _mm512_loadu_si512((const void*)(posns + i)) : idx;
+    _mm512_storeu_si512((void*)(out + k), _mm512_maskz_compress_epi32(mask, p));
+    k += __builtin_popcount(mask);
+    idx = _mm512_add_epi32(idx, step);
+  }
+  return k + select_scalar_shape(shape, data + i, n - i, low, high,
+                                 posns ? posns + i : NULL, base + i, out + k);
+}
+
+__attribute__((target("avx512f,popcnt"))) static size_t select_avx512(
+    const int* data, size_t n, const ScanPredicate* pred, const int* posns, size_t base,
+    int* out) {
+  int lo = pred->low, hi = pred->high;
+  switch (pred->shape) {
+    case SCAN_LE:
+      return select_avx512_shape(SCAN_LE, data, n, lo, hi, posns, base, out);
+    case SCAN_GE:
+      return select_avx512_shape(SCAN_GE, data, n, lo, hi, posns, base, out);
+    case SCAN_BETWEEN:
+      return select_avx512_shape(SCAN_BETWEEN, data, n, lo, hi, posns, base, out);
+    case SCAN_EQ:
+      return select_avx512_shape(SCAN_EQ, data, n, lo, hi, posns, base, out);
+    default:
+      return 0;
+  }
+}
+
+// AVX-512 bitmap kernel: the compare masks are the bitmap, four of them per word
+static inline __attribute__((always_inline, target("avx512f,popcnt"))) size_t
+bitmap_avx512_shape(ScanShape shape, const int* data, size_t n, int low, int high,
+                    uint64_t* words) {
+  const __m512i lo = _mm512_set1_epi32(low);
+  const __m512i hi = _mm512_set1_epi32(high);
+  size_t i = 0, count = 0;
+  for (; i + 64 <= n; i += 64) {
+    uint64_t word = 0;
+    for (int v = 0; v < 4; v++) {
+      __m512i x = _mm512_loadu_si512((const void*)(data + i + 16 * v));
+      word |= (uint64_t)mask_avx512(shape, x, lo, hi) << (16 * v);
+    }
+    words[i / 64] = word;
+    count += __builtin_popcountll(word);
+  }
+  return count + bitmap_scalar_shape(shape, data + i, n - i, low, high, words + i / 64);
+}
+
+__attribute__((target("avx512f,popcnt"))) static size_t bitmap_avx512(
+    const int* data, size_t n, const ScanPredicate* pred, uint64_t* words) {
+  int lo = pred->low, hi = pred->high;
+  switch (pred->shape) {
+    case SCAN_LE:
+      return bitmap_avx512_shape(SCAN_LE, data, n, lo, hi, words);
+    case SCAN_GE:
+      return bitmap_avx512_shape(SCAN_GE, data, n, lo, hi, words);
+    case SCAN_BETWEEN:
+      return bitmap_avx512_shape(SCAN_BETWEEN, data, n, lo, hi, words);
+    case SCAN_EQ:
+      return bitmap_avx512_shape(SCAN_EQ, data, n, lo, hi, words);
+    default:
+      return 0;
+  }
+}
+#endif
+
+size_t simd_select_bitmap(const int* data, size_t n, const ScanPredicate* pred,
+                          uint64_t* words) {
+  if (!words || n == 0) return 0;
+  if (!data || pred->shape == SCAN_NONE) {
+    memset(words, 0, sizeof(uint64_t) * ((n + 63) / 64));
+    return 0;
+  }
+  switch (simd_level()) {
+#ifdef SIMD_X86
+    case SIMD_AVX512:
+      return bitmap_avx512(data, n, pred, words);
+    case SIMD_AVX2:
+      return bitmap_avx2(data, n, pred, words);
+#endif
+    default:
+      return bitmap_scalar(data, n, pred, words);
+  }
+}
+
+size_t simd_select(const int* data, size_t n, const ScanPredicate* pred, const int* posns,
+                   size_t base, int* out) {
+  if (!data || !out || n == 0 || pred->shape == SCAN_NONE) return 0;
+  switch (simd_level()) {
+#ifdef SIMD_X86
+    case SIMD_AVX512:
+      return select_avx512(data, n, pred, posns, base, out);
+    case SIMD_AVX2:
+      return select_avx2(data, n, pred, posns, base, out);
+#endif
+    default:
+      return select_scalar(data, n, pred, posns, base, out);
+  }
+}
+
+// Gathers
+// ---------------------
+
+// How many positions ahead of the one being gathered to prefetch: far enough for a
+// cache miss to resolve by the time its value is needed, near enough to stay in L1
+#define GATHER_PREFETCH_DISTANCE 64
+
+static inline __attribute__((always_inline)) void fold_stats(int value, int64_t* sum,
+                                                             int* min_value,
+                                                             int* max_value) {
+  *sum += value;
+  if (value < *min_value) *min_value = value;
+  if (value > *max_value) *max_value = value;
+}
+
+static void gather_scalar(const int* values, const int* posns, size_t n, int* out,
+                          ValueStats* stats) {
+  int64_t sum = 0;
+  int min_value = stats->min, max_value = stats->max;
+  for (size_t i = 0; i < n; i++) {
+    if (i + GATHER_PREFETCH_DISTANCE < n) {
+      __builtin_prefetch(values + posns[i + GATHER_PREFETCH_DISTANCE]);
+    }
+    int value = values[posns[i]];
+    if (out) out[i] = value;
+    fold_stats(value, &sum, &min_value, &max_value);
+  }
+  stats->sum += sum;
+  stats->min = min_value;
+  stats->max = max_value;
+}
+
+static void copy_scalar(const int* values, size_t n, int* out, ValueStats* stats) {
+  int64_t sum = 0;
+  int min_value = stats->min, max_value = stats->max;
+  for (size_t i = 0; i < n; i++) {
+    if (out) out[i] = values[i];
+    fold_stats(values[i], &sum, &min_value, &max_value);
+  }
+  stats->sum += sum;
+  stats->min = min_value;
+  stats->max = max_value;
+}
+
+#ifdef SIMD_X86
+/**
+ * @brief AVX2 kernels: 8 values per step, folded into vector min/max and two 64-bit
+ * vector sums. The gather prefetches the group of 8 positions a fixed distance ahead,
+ * and loads a group of consecutive positions (a dense run) with a plain load instead.
+ */
+static inline __attribute__((always_inline, target("avx2"))) void fold_avx2(
+    __m256i v, __m256i* vsum, __m256i* vmin, __m256i* vmax) {
+  *vmin = _mm256_min_epi32(*vmin, v);
+  *vmax = _mm256_max_epi32(*vmax, v);
+  *vsum = _mm256_add_epi64(*vsum, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+  *vsum = _mm256_add_epi64(*vsum, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+}
+
+static inline __attribute__((always_inline, target("avx2"))) void reduce_avx2(
+    __m256i vsum, __m256i vmin, __m256i vmax, ValueStats* stats) {
+  int64_t sums[4];
+  int mins[8], maxs[8];
+  _mm256_storeu_si256((__m256i*)sums, vsum);
+  _mm256_storeu_si256((__m256i*)mins, vmin);
+  _mm256_storeu_si256((__m256i*)maxs, vmax);
+  stats->sum += sums[0] + sums[1] + sums[2] + sums[3];
+  for (int lane = 0; lane < 8; lane++) {
+    if (mins[lane] < stats->min) stats->min = mins[lane];
+    if (maxs[lane] > stats->max) stats->max = maxs[lane];
+  }
+}
+
+__attribute__((target("avx2"))) static void gather_avx2(const int* values,
+                                                        const int* posns, size_t n,
+                                                        int* out, ValueStats* stats) {
+  const __m256i iota = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  __m256i vsum = _mm256_setzero_si256();
+  __m256i vmin = _mm256_set1_epi32(stats->min);
+  __m256i vmax = _mm256_set1_epi32(stats->max);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    if (i + GATHER_PREFETCH_DISTANCE + 8 <= n) {
+      const int* ahead = posns + i + GATHER_PREFETCH_DISTANCE;
+      for (int lane = 0; lane < 8; lane++) __builtin_prefetch(values + ahead[lane]);
+    }
+    __m256i idx = _mm256_loadu_si256((const __m256i*)(posns + i));
+    __m256i dense = _mm256_add_epi32(_mm256_set1_epi32(posns[i]), iota);
+    __m256i v = _mm256_movemask_epi8(_mm256_cmpeq_epi32(idx, dense)) == -1
+                    ? _mm256_loadu_si256((const __m256i*)(values + posns[i]))
+                    : _mm256_i32gather_epi32(values, idx, 4);
+    if (out) _mm256_storeu_si256((__m256i*)(out + i), v);
+    fold_avx2(v, &vsum, &vmin, &vmax);
+  }
+  reduce_avx2(vsum, vmin, vmax, stats);
+  gather_scalar(values, posns + i, n - i, out ? out + i : NULL, stats);
+}
+
+__attribute__((target("avx2"))) static void copy_avx2(const int* values, size_t n,
+                                                      int* out, ValueStats* stats) {
+  __m256i vsum = _mm256_setzero_si256();
+  __m256i vmin = _mm256_set1_epi32(stats->min);
+  __m256i vmax = _mm256_set1_epi32(stats->max);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(values + i));
+    if (out) _mm256_storeu_si256((__m256i*)(out + i), v);
+    fold_avx2(v, &vsum, &vmin, &vmax);
+  }
+  reduce_avx2(vsum, vmin, vmax, stats);
+  copy_scalar(values + i, n - i, out ? out + i : NULL, stats);
+}
+
+// AVX-512 kernels: as the AVX2 ones, 16 values per step
+static inline __attribute__((always_inline, target("avx512f"))) void fold_avx512(
+    __m512i v, __m512i* vsum, __m512i* vmin, __m512i* vmax) {
+  *vmin = _mm512_min_epi32(*vmin, v);
+  *vmax = _mm512_max_epi32(*vmax, v);
+  *vsum = _mm512_add_epi64(*vsum, _mm512_cvtepi32_epi64(_mm512_castsi512_si256(v)));
+  *vsum = _mm512_add_epi64(*vsum, _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(v, 1)));
+}
+
+static inline __attribute__((always_inline, target("avx512f"))) void reduce_avx512(
+    __m512i vsum, __m512i vmin, __m512i vmax, ValueStats* stats) {
+  stats->sum += _mm512_reduce_add_epi64(vsum);
+  int min_value = _mm512_reduce_min_epi32(vmin);
+  int max_value = _mm512_reduce_max_epi32(vmax);
+  if (min_value < stats->min) stats->min = min_value;
+  if (max_value > stats->max) stats->max = max_value;
+}
+
+__attribute__((target("avx512f"))) static void gather_avx512(const int* values,
+                                                             const int* posns, size_t n,
+                                                             int* out,
+                                                             ValueStats* stats) {
+  const __m512i iota =
+      _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  __m512i vsum = _mm512_setzero_si512();
+  __m512i vmin = _mm512_set1_epi32(stats->min);
+  __m512i vmax = _mm512_set1_epi32(stats->max);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    if (i + GATHER_PREFETCH_DISTANCE + 16 <= n) {
+      const int* ahead = posns + i + GATHER_PREFETCH_DISTANCE;
+      for (int lane = 0; lane < 16; lane++) __builtin_prefetch(values + ahead[lane]);
+    }
+    __m512i idx = _mm512_loadu_si512((const void*)(posns + i));
+    __m512i dense = _mm512_add_epi32(_mm512_set1_epi32(posns[i]), iota);
+    __m512i v = _mm512_cmpeq_epi32_mask(idx, dense) == 0xFFFF
+                    ? _mm512_loadu_si512((const void*)(values + posns[i]))
+                    : _mm512_i32gather_epi32(idx, (const void*)values, 4);
+    if (out) _mm512_storeu_si512((void*)(out + i), v);
+    fold_avx512(v, &vsum, &vmin, &vmax);
+  }
+  reduce_avx512(vsum, vmin, vmax, stats);
+  gather_scalar(values, posns + i, n - i, out ? out + i : NULL, stats);
+}
+
+__attribute__((target("avx512f"))) static void copy_avx512(const int* values, size_t n,
+                                                           int* out, ValueStats* stats) {
+  __m512i vsum = _mm512_setzero_si512();
+  __m512i vmin = _mm512_set1_epi32(stats->min);
+  __m512i vmax = _mm512_set1_epi32(stats->max);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m512i v = _mm512_loadu_si512((const void*)(values + i));
+    if (out) _mm512_storeu_si512((void*)(out + i), v);
+    fold_avx512(v, &vsum, &vmin, &vmax);
+  }
+  reduce_avx512(vsum, vmin, vmax, stats);
+  copy_scalar(values + i, n - i, out ? out + i : NULL, stats);
+}
+#endif
+
+void simd_gather(const int* values, const int* posns, size_t n, int* out,
+                 ValueStats* stats) {
+  if (!values || !posns || n == 0) return;
+  switch (simd_level()) {
+#ifdef SIMD_X86
+    case SIMD_AVX512:
+      gather_avx512(values, posns, n, out, stats);
+      return;
+    case SIMD_AVX2:
+      gather_avx2(values, posns, n, out, stats);
+      return;
+#endif
+    default:
+      gather_scalar(values, posns, n, out, stats);
+  }
+}
+
+void simd_copy(const int* values, size_t n, int* out, ValueStats* stats) {
+  if (!values || n == 0) return;
+  switch (simd_level()) {
+#ifdef SIMD_X86
+    case SIMD_AVX512:
+      copy_avx512(values, n, out, stats);
+      return;
+    case SIMD_AVX2:
+      copy_avx2(values, n, out, stats);
+      return;
+#endif
+    default:
+      copy_scalar(values, n, out, stats);
+  }
+}
+
+// Multi-column gathers
+// ---------------------
+
+// Columns gathered together per pass; their vector stats accumulators stay in L1
+#define GATHER_MAX_COLUMNS 8
+
+static void gather_columns_scalar(const int* const* columns, size_t num_columns,
+                                  const int* posns, size_t n, int* const* outs,
+                                  ValueStats* stats) {
+  for (size_t i = 0; i < n; i++) {
+    if (i + GATHER_PREFETCH_DISTANCE < n) {
+      int ahead = posns[i + GATHER_PREFETCH_DISTANCE];
+      for (size_t c = 0; c < num_columns; c++) __builtin_prefetch(columns[c] + ahead);
+    }
+    for (size_t c = 0; c < num_columns; c++) {
+      int value = columns[c][posns[i]];
+      if (outs) outs[c][i] = value;
+      fold_stats(value, &stats[c].sum, &stats[c].min, &stats[c].max);
+    }
+  }
+}
+
+#ifdef SIMD_X86
+/**
+ * @brief As `gather_avx2`, but each group of 8 positions is loaded and checked for a
+ * dense run once, then gathered from every column in turn, so the columns' misses are
+ * in flight together.
+ */
+__attribute__((target("avx2"))) static void gather_columns_avx2(
+    const int* const* columns, size_t num_columns, const int* posns, size_t n,
+    int* const* outs, ValueStats* stats) {
+  const __m256i iota = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  __m256i vsum[GATHER_MAX_COLUMNS], vmin[GATHER_MAX_COLUMNS], vmax[GATHER_MAX_COLUMNS];
+  for (size_t c = 0; c < num_columns; c++) {
+    vsum[c] = _mm256_setzero_si256();
+    vmin[c] = _mm256_set1_epi32(stats[c].min);
+    vmax[c] = _mm256_set1_epi32(stats[c].max);
+  }
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    if (i + GATHER_PREFETCH_DISTANCE + 8 <= n) {
+      const int* ahead = posns + i + GATHER_PREFETCH_DISTANCE;
+      for (size_t c = 0; c < num_columns; c++) {
+        for (int lane = 0; lane < 8; lane++) __builtin_prefetch(columns[c] + ahead[lane]);
+      }
+    }
+    __m256i idx = _mm256_loadu_si256((const __m256i*)(posns + i));
+    __m256i dense = _mm256_add_epi32(_mm256_set1_epi32(posns[i]), iota);
+    int is_dense = _mm256_movemask_epi8(_mm256_cmpeq_epi32(idx, dense)) == -1;
+    for (size_t c = 0; c < num_columns; c++) {
+      __m256i v = is_dense ? _mm256_loadu_si256((const __m256i*)(columns[c] + posns[i]))
+                           : _mm256_i32gather_epi32(columns[c], idx, 4);
+      if (outs) _mm256_storeu_si256((__m256i*)(outs[c] + i), v);
+      fold_avx2(v, &vsum[c], &vmin[c], &vmax[c]);
+    }
+  }
+  for (size_t c = 0; c < num_columns; c++) {
+    reduce_avx2(vsum[c], vmin[c], vmax[c], &stats[c]);
+    gather_scalar(columns[c], posns + i, n - i, outs ? outs[c] + i : NULL, &stats[c]);
+  }
+}
+
+// AVX-512 kernel: as the AVX2 one, 16 positions per step
+__attribute__((target("avx512f"))) static void gather_columns_avx512(
+    const int* const* columns, size_t num_columns, const int* posns, size_t n,
+    int* const* outs, ValueStats* stats) {
+  const __m512i iota =
+      _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  __m512i vsum[GATHER_MAX_COLUMNS], vmin[GATHER_MAX_COLUMNS], vmax[GATHER_MAX_COLUMNS];
+  for (size_t c = 0; c < num_columns; c++) {
+    vsum[c] = _mm512_setzero_si512();
+    vmin[c] = _mm512_set1_epi32(stats[c].min);
+    vmax[c] = _mm512_set1_epi32(stats[c].max);
+  }
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    if (i + GATHER_PREFETCH_DISTANCE + 16 <= n) {
+      const int* ahead = posns + i + GATHER_PREFETCH_DISTANCE;
+      for (size_t c = 0; c < num_columns; c++) {
+        for (int lane = 0; lane < 16; lane++) {
+          __builtin_prefetch(columns[c] + ahead[lane]);
+        }
+      }
+    }
+    __m512i idx = _mm512_loadu_si512((const void*)(posns + i));
+    __m512i dense = _mm512_add_epi32(_mm512_set1_epi32(posns[i]), iota);
+    int is_dense = _mm512_cmpeq_epi32_mask(idx, dense) == 0xFFFF;
+    for (size_t c = 0; c < num_columns; c++) {
+      __m512i v = is_dense ? _mm512_loadu_si512((const void*)(columns[c] + posns[i]))
+                           : _mm512_i32gather_epi32(idx, (const void*)columns[c], 4);
+      if (outs) _mm512_storeu_si512((void*)(outs[c] + i), v);
+      fold_avx512(v, &vsum[c], &vmin[c], &vmax[c]);
+    }
+  }
+  for (size_t c = 0; c < num_columns; c++) {
+    reduce_avx512(vsum[c], vmin[c], vmax[c], &stats[c]);
+    gather_scalar(columns[c], posns + i, n - i, outs ? outs[c] + i : NULL, &stats[c]);
+  }
+}
+#endif
+
+void simd_gather_columns(const int* const* columns, size_t num_columns, const int* posns,
+                         size_t n, int* const* outs, ValueStats* stats) {
+  if (!columns || !posns || n == 0) return;
+  for (size_t first = 0; first < num_columns; first += GATHER_MAX_COLUMNS) {
+    size_t k = num_columns - first < GATHER_MAX_COLUMNS ? num_columns - first
+                                                         : GATHER_MAX_COLUMNS;
+    int* const* group_outs = outs ? outs + first : NULL;
+    switch (simd_level()) {
+#ifdef SIMD_X86
+      case SIMD_AVX512:
+        gather_columns_avx512(columns + first, k, posns, n, group_outs, stats + first);
+        break;
+      case SIMD_AVX2:
+        gather_columns_avx2(columns + first, k, posns, n, group_outs, stats + first);
+        break;
+#endif
+      default:
+        gather_columns_scalar(columns + first, k, posns, n, group_outs, stats + first);
+    }
+  }
+}
+
+// Arithmetic
+// ---------------------
+
+static inline ArithOperand operand_from(ArithOperand operand, size_t i) {
+  if (operand.values) operand.values += i;
+  return operand;
+}
+
+// Unsigned math wraps where signed overflow would be undefined
+static inline int arith_value(ArithOp op, int a, int b) {
+  switch (op) {
+    case ARITH_ADD:
+      return (int)((unsigned)a + (unsigned)b);
+    case ARITH_SUB:
+      return (int)((unsigned)a - (unsigned)b);
+    case ARITH_MUL:
+      return (int)((unsigned)a * (unsigned)b);
+    default:
+      return b == -1 ? (int)(0u - (unsigned)a) : a / b;
+  }
+}
+
+static int arith_scalar(ArithOp op, ArithOperand lhs, ArithOperand rhs, size_t n,
+                        int* out, ValueStats* stats) {
+  int64_t sum = 0;
+  int min_value = stats->min, max_value = stats->max;
+  for (size_t i = 0; i < n; i++) {
+    int a = lhs.values ? lhs.values[i] : lhs.constant;
+    int b = rhs.values ? rhs.values[i] : rhs.constant;
+    if (op == ARITH_DIV && b == 0) return -1;
+    out[i] = arith_value(op, a, b);
+    fold_stats(out[i], &sum, &min_value, &max_value);
+  }
+  stats->sum += sum;
+  stats->min = min_value;
+  stats->max = max_value;
+  return 0;
+}
+
+#ifdef SIMD_X86
+/**
+ * @brief AVX2 kernel: 8 rows per step, folded into the stats as by the gathers. Division
+ * converts each half of the lanes to doubles, divides, and truncates back; zero divisors
+ * are only flagged, and reported once the loop is done.
+ */
+static inline __attribute__((always_inline, target("avx2"))) __m256i div_avx2(
+    __m256i a, __m256i b) {
+  __m256d lo = _mm256_div_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(a)),
+                             _mm256_cvtepi32_pd(_mm256_castsi256_si128(b)));
+  __m256d hi = _mm256_div_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(a, 1)),
+                             _mm256_cvtepi32_pd(_mm256_extracti128_si256(b, 1)));
+  return _mm256_set_m128i(_mm256_cvttpd_epi32(hi), _mm256_cvttpd_epi32(lo));
+}
+
+__attribute__((target("avx2"))) static int arith_avx2(ArithOp op, ArithOperand lhs,
+                                                      ArithOperand rhs, size_t n,
+                                                      int* out, ValueStats* stats) {
+  const __m256i lhs_constant = _mm256_set1_epi32(lhs.constant);
+  const __m256i rhs_constant = _mm256_set1_epi32(rhs.constant);
+  __m256i zero_divisors = _mm256_setzero_si256();
+  __m256i vsum = _mm256_setzero_si256();
+  __m256i vmin = _mm256_set1_epi32(stats->min);
+  __m256i vmax = _mm256_set1_epi32(stats->max);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i a =
+        lhs.values ? _mm256_loadu_si256((const __m256i*)(lhs.values + i)) : lhs_constant;
+    __m256i b =
+        rhs.values ? _mm256_loadu_si256((const __m256i*)(rhs.values + i)) : rhs_constant;
+    __m256i v;
+    switch (op) {
+      case ARITH_ADD:
+        v = _mm256_add_epi32(a, b);
+        break;
+      case ARITH_SUB:
+        v = _mm256_sub_epi32(a, b);
+        break;
+      case ARITH_MUL:
+        v = _mm256_mullo_epi32(a, b);
+        break;
+      default:
+        zero_divisors = _mm256_or_si256(
+            zero_divisors, _mm256_cmpeq_epi32(b, _mm256_setzero_si256()));
+        v = div_avx2(a, b);
+    }
+    _mm256_storeu_si256((__m256i*)(out + i), v);
+    fold_avx2(v, &vsum, &vmin, &vmax);
+  }
+  reduce_avx2(vsum, vmin, vmax, stats);
+  if (!_mm256_testz_si256(zero_divisors, zero_divisors)) return -1;
+  return arith_scalar(op, operand_from(lhs, i), operand_from(rhs, i), n - i, out + i,
+                      stats);
+}
+
+// AVX-512 kernel: as the AVX2 one, 16 rows per step
+static inline __attribute__((always_inline, target("avx512f"))) __m512i div_avx512(
+    __m512i a, __m512i b) {
+  __m512d lo = _mm512_div_pd(_mm512_cvtepi32_pd(_mm512_castsi512_si256(a)),
+                             _mm512_cvtepi32_pd(_mm512_castsi512_si256(b)));
+  __m512d hi = _mm512_div_pd(_mm512_cvtepi32_pd(_mm512_extracti64x4_epi64(a, 1)),
+                             _mm512_cvtepi32_pd(_mm512_extracti64x4_epi64(b, 1)));
+  return _mm512_inserti64x4(_mm512_castsi256_si512(_mm512_cvttpd_epi32(lo)),
+                            _mm512_cvttpd_epi32(hi), 1);
+}
+
+__attribute__((target("avx512f"))) static int arith_avx512(ArithOp op, ArithOperand lhs,
+                                                           ArithOperand rhs, size_t n,
+                                                           int* out, ValueStats* stats) {
+  const __m512i lhs_constant = _mm512_set1_epi32(lhs.constant);
+  const __m512i rhs_constant = _mm512_set1_epi32(rhs.constant);
+  __mmask16 zero_divisors = 0;
+  __m512i vsum = _mm512_setzero_si512();
+  __m512i vmin = _mm512_set1_epi32(stats->min);
+  __m512i vmax = _mm512_set1_epi32(stats->max);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m512i a =
+        lhs.values ? _mm512_loadu_si512((const void*)(lhs.values + i)) : lhs_constant;
+    __m512i b =
+        rhs.values ? _mm512_loadu_si512((const void*)(rhs.values + i)) : rhs_constant;
+    __m512i v;
+    switch (op) {
+      case ARITH_ADD:
+        v = _mm512_add_epi32(a, b);
+        break;
+      case ARITH_SUB:
+        v = _mm512_sub_epi32(a, b);
+        break;
+      case ARITH_MUL:
+        v = _mm512_mullo_epi32(a, b);
+        break;
+      default:
+        zero_divisors |= _mm512_cmpeq_epi32_mask(b, _mm512_setzero_si512());
+        v = div_avx512(a, b);
+    }
+    _mm512_storeu_si512((void*)(out + i), v);
+    fold_avx512(v, &vsum, &vmin, &vmax);
+  }
+  reduce_avx512(vsum, vmin, vmax, stats);
+  if (zero_divisors) return -1;
+  return arith_scalar(op, operand_from(lhs, i), operand_from(rhs, i), n - i, out + i,
+                      stats);
+}
+#endif
+
+int simd_arith(ArithOp op, ArithOperand lhs, ArithOperand rhs, size_t n, int* out,
+               ValueStats* stats) {
+  if (!out || n == 0) return 0;
+  switch (simd_level()) {
+#ifdef SIMD_X86
+    case SIMD_AVX512:
+      return arith_avx512(op, lhs, rhs, n, out, stats);
+    case SIMD_AVX2:
+      return arith_avx2(op, lhs, rhs, n, out, stats);
+#endif
+    default:
+      return arith_scalar(op, lhs, rhs, n, out, stats);
+  }
+}
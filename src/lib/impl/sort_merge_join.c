@@ -0,0 +1,152 @@
+#include "sort_merge_join.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "algorithms.h"
+#include "utils.h"
+
+/**
+ * @brief A side of the join in ascending order of its keys. `keys` and `payloads` are
+ * either the input itself, or sorted copies of it the side owns (`owned`).
+ */
+typedef struct {
+  const int* keys;
+  const int* payloads;
+  size_t n;
+  int* owned_keys;
+  int* owned_payloads;
+} MergeSide;
+
+static int is_ascending(const int* keys, size_t n) {
+  for (size_t i = 1; i < n; i++) {
+    if (keys[i] < keys[i - 1]) return 0;
+  }
+  return 1;
+}
+
+// Shared by the chunks of a gather that replaces each of `positions` by its payload
+typedef struct {
+  const int* payloads;
+  int* positions;
+} GatherArgs;
+
+static void gather_chunk(void* arg, size_t chunk, size_t start, size_t end) {
+  (void)chunk;
+  GatherArgs* args = (GatherArgs*)arg;
+  for (size_t i = start; i < end; i++) {
+    args->positions[i] = args->payloads[args->positions[i]];
+  }
+}
+
+// Sets up `side` over the `n` tuples, sorting a copy of them unless they are in order
+static int merge_side(MergeSide* side, const int* keys, const int* payloads, size_t n,
+                      int sorted, ThreadPool* pool) {
+  *side = (MergeSide){keys, payloads, n, NULL, NULL};
+  if (sorted || is_ascending(keys, n)) return 0;
+
+  side->owned_keys = malloc(sizeof(int) * n);
+  side->owned_payloads = malloc(sizeof(int) * n);
+  if (!side->owned_keys || !side->owned_payloads) return -1;
+  memcpy(side->owned_keys, keys, sizeof(int) * n);
+  // The sort leaves each key's original position, which the gather swaps for its payload
+  if (radix_sort(side->owned_keys, n, side->owned_payloads, pool) != 0) return -1;
+  GatherArgs gather = {payloads, side->owned_payloads};
+  size_t n_chunks = pool ? threadpool_size(pool) : 1;
+  threadpool_parallel_for(pool, n, n_chunks, gather_chunk, &gather);
+  side->keys = side->owned_keys;
+  side->payloads = side->owned_payloads;
+  return 0;
+}
+
+static void merge_side_free(MergeSide* side) {
+  free(side->owned_keys);
+  free(side->owned_payloads);
+}
+
+/**
+ * @brief Shared by every piece of the merge. Piece `m` is a range of the `outer` (larger)
+ * side and writes its pairs to `outputs[m]`; pairs are (outer, inner) payloads, or
+ * (inner, outer) if `swapped`.
+ */
+typedef struct {
+  const MergeSide* outer;
+  const MergeSide* inner;
+  int swapped;
+  JoinOutput* outputs;
+  int failed;
+} MergeArgs;
+
+static void merge_morsel(void* arg, size_t worker, size_t morsel, size_t start,
+                         size_t end) {
+  (void)worker;
+  MergeArgs* args = (MergeArgs*)arg;
+  const int* outer = args->outer->keys;
+  const int* inner = args->inner->keys;
+  const int* o_payloads = args->outer->payloads;
+  const int* i_payloads = args->inner->payloads;
+  size_t n = args->inner->n;
+  JoinOutput* out = &args->outputs[morsel];
+
+  // [j, j_end) is the inner run of the current outer key (empty if it has none)
+  size_t j = sorted_lower_bound(inner, n, outer[start]), j_end = j;
+  for (size_t i = start; i < end; i++) {
+    int key = outer[i];
+    if (i == start || key != outer[i - 1]) {
+      j = j_end;
+      while (j < n && inner[j] < key) j++;
+      j_end = j < n && inner[j] == key ? sorted_run_end(inner, n, j) : j;
+    }
+    for (size_t k = j; k < j_end; k++) {
+      int left = args->swapped ? i_payloads[k] : o_payloads[i];
+      int right = args->swapped ? o_payloads[i] : i_payloads[k];
+      if (join_output_emit(out, left, right) != 0) {
+        __atomic_store_n(&args->failed, 1, __ATOMIC_RELAXED);
+        return;
+      }
+    }
+  }
+}
+
+int sort_merge_join(const int* l_keys, const int* l_payloads, size_t l_n, int l_sorted,
+                    const int* r_keys, const int* r_payloads, size_t r_n, int r_sorted,
+                    ThreadPool* pool, JoinResult* result) {
+  *result = (JoinResult){NULL, NULL, 0};
+  if (l_n > INT_MAX || r_n > INT_MAX) {
+    log_err("sort_merge_join: %zu x %zu tuples is too many for 32-bit positions\n", l_n,
+            r_n);
+    return -1;
+  }
+  if (l_n == 0 || r_n == 0) return join_output_concat(NULL, 0, result);
+
+  int status = -1;
+  JoinOutput* outputs = NULL;
+  MergeSide left = {NULL}, right = {NULL};
+  if (merge_side(&left, l_keys, l_payloads, l_n, l_sorted, pool) != 0 ||
+      merge_side(&right, r_keys, r_payloads, r_n, r_sorted, pool) != 0) {
+    goto cleanup;
+  }
+
+  // Pieces split the larger side, so they stay even however lopsided the join is
+  int swapped = r_n > l_n;
+  MergeArgs args = {.outer = swapped ? &right : &left,
+                    .inner = swapped ? &left : &right,
+                    .swapped = swapped};
+  size_t n_morsels = threadpool_num_morsels(args.outer->n, SORT_MERGE_JOIN_MORSEL);
+  outputs = calloc(n_morsels, sizeof(JoinOutput));
+  if (!outputs) goto cleanup;
+  args.outputs = outputs;
+  threadpool_parallel_morsels(pool, args.outer->n, SORT_MERGE_JOIN_MORSEL, merge_morsel,
+                              &args);
+  // Pieces are in key order, so their outputs are too
+  if (!args.failed) status = join_output_concat(outputs, n_morsels, result);
+  for (size_t m = 0; m < n_morsels; m++) join_output_free(&outputs[m]);
+
+cleanup:
+  if (status) log_err("sort_merge_join: failed to join %zu x %zu tuples\n", l_n, r_n);
+  merge_side_free(&left);
+  merge_side_free(&right);
+  free(outputs);
+  return status;
+}
@@ -1 +1,388 @@
-void placeholder_threadpool_c(void) {}
+#define _GNU_SOURCE
+#include "threadpool.h"
+
+#include <stdlib.h>
+#include <unistd.h>  // for sysconf
+
+#include "utils.h"
+
+// Pops the oldest queued task; the caller must hold `pool->lock`
+static Task* dequeue_locked(ThreadPool* pool) {
+  Task* task = pool->head;
+  if (task) {
+    pool->head = task->next;
+    if (!pool->head) pool->tail = NULL;
+  }
+  return task;
+}
+
+static void run_task(Task* task) {
+  task->fn(task->arg);
+
+  TaskGroup* group = task->group;
+  if (group) {
+    pthread_mutex_lock(&group->lock);
+    if (--group->pending == 0) pthread_cond_broadcast(&group->all_done);
+    pthread_mutex_unlock(&group->lock);
+  }
+  free(task);
+}
+
+static void* worker_loop(void* arg) {
+  ThreadPool* pool = (ThreadPool*)arg;
+
+  while (1) {
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->head && !pool->shutting_down) {
+      pthread_cond_wait(&pool->has_tasks, &pool->lock);
+    }
+    Task* task = dequeue_locked(pool);
+    pthread_mutex_unlock(&pool->lock);
+
+    // Queue drained and shutdown requested
+    if (!task) break;
+    run_task(task);
+  }
+  return NULL;
+}
+
+ThreadPool* threadpool_create(size_t n_workers) {
+  if (n_workers == 0) {
+    long n_cores = sysconf(_SC_NPROCESSORS_ONLN);
+    n_workers = n_cores > 0 ? (size_t)n_cores : 1;
+  }
+
+  ThreadPool* pool = calloc(1, sizeof(ThreadPool));
+  if (!pool) return NULL;
+  pool->workers = malloc(sizeof(pthread_t) * n_workers);
+  if (!pool->workers) {
+    free(pool);
+    return NULL;
+  }
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->has_tasks, NULL);
+
+  for (size_t i = 0; i < n_workers; i++) {
+    if (pthread_create(&pool->workers[i], NULL, worker_loop, pool) != 0) {
+      log_err("threadpool_create: failed to start worker %zu\n", i);
+      pool->n_workers = i;
+      threadpool_destroy(pool);
+      return NULL;
+    }
+  }
+  pool->n_workers = n_workers;
+  return pool;
+}
+
+void threadpool_destroy(ThreadPool* pool) {
+  if (!pool) return;
+
+  pthread_mutex_lock(&pool->lock);
+  pool->shutting_down = 1;
+  pthread_cond_broadcast(&pool->has_tasks);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (size_t i = 0; i < pool->n_workers; i++) {
+    pthread_join(pool->workers[i], NULL);
+  }
+
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->has_tasks);
+  free(pool->workers);
+  free(pool);
+}
+
+size_t threadpool_size(const ThreadPool* pool) { return pool ? pool->n_workers : 1; }
+
+void taskgroup_init(TaskGroup* group, ThreadPool* pool) {
+  group->pool = pool;
+  group->pending = 0;
+  pthread_mutex_init(&group->lock, NULL);
+  pthread_cond_init(&group->all_done, NULL);
+}
+
+void taskgroup_wait(TaskGroup* group) {
+  ThreadPool* pool = group->pool;
+
+  while (1) {
+    pthread_mutex_lock(&group->lock);
+    size_t pending = group->pending;
+    pthread_mutex_unlock(&group->lock);
+    if (pending == 0) return;
+
+    // Help out instead of blocking, so waiting inside a task can't deadlock the pool
+    Task* task = NULL;
+    if (pool) {
+      pthread_mutex_lock(&pool->lock);
+      task = dequeue_locked(pool);
+      pthread_mutex_unlock(&pool->lock);
+    }
+    if (task) {
+      run_task(task);
+      continue;
+    }
+
+    // Nothing left to help with; our tasks are running on other workers
+    pthread_mutex_lock(&group->lock);
+    while (group->pending > 0) pthread_cond_wait(&group->all_done, &group->lock);
+    pthread_mutex_unlock(&group->lock);
+    return;
+  }
+}
+
+void taskgroup_destroy(TaskGroup* group) {
+  pthread_mutex_destroy(&group->lock);
+  pthread_cond_destroy(&group->all_done);
+}
+
+int threadpool_submit(ThreadPool* pool, TaskGroup* group, TaskFn fn, void* arg) {
+  if (!fn) return -1;
+
+  // Without a pool, tasks run synchronously on the caller
+  if (!pool) {
+    fn(arg);
+    return 0;
+  }
+
+  Task* task = malloc(sizeof(Task));
+  if (!task) return -1;
+  task->fn = fn;
+  task->arg = arg;
+  task->group = group;
+  task->next = NULL;
+
+  if (group) {
+    pthread_mutex_lock(&group->lock);
+    group->pending++;
+    pthread_mutex_unlock(&group->lock);
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  if (pool->tail) {
+    pool->tail->next = task;
+  } else {
+    pool->head = task;
+  }
+  pool->tail = task;
+  pthread_cond_signal(&pool->has_tasks);
+  pthread_mutex_unlock(&pool->lock);
+  return 0;
+}
+
+static void run_future(void* arg) {
+  Future* future = (Future*)arg;
+  future->result = future->fn(future->arg);
+}
+
+Future* threadpool_async(ThreadPool* pool, FutureFn fn, void* arg) {
+  Future* future = malloc(sizeof(Future));
+  if (!future) return NULL;
+  future->fn = fn;
+  future->arg = arg;
+  future->result = NULL;
+  taskgroup_init(&future->group, pool);
+
+  if (threadpool_submit(pool, &future->group, run_future, future) != 0) {
+    taskgroup_destroy(&future->group);
+    free(future);
+    return NULL;
+  }
+  return future;
+}
+
+void* future_get(Future* future) {
+  if (!future) return NULL;
+  taskgroup_wait(&future->group);
+  void* result = future->result;
+  taskgroup_destroy(&future->group);
+  free(future);
+  return result;
+}
+
+typedef struct {
+  RangeFn fn;
+  void* arg;
+  size_t chunk;
+  size_t start;
+  size_t end;
+} RangeTask;
+
+static void run_range(void* arg) {
+  RangeTask* range = (RangeTask*)arg;
+  range->fn(range->arg, range->chunk, range->start, range->end);
+}
+
+void threadpool_parallel_for(ThreadPool* pool, size_t n, size_t n_chunks, RangeFn fn,
+                             void* arg) {
+  if (n_chunks == 0) n_chunks = 1;
+  size_t chunk_size = (n + n_chunks - 1) / n_chunks;
+
+  RangeTask* ranges = NULL;
+  if (pool && n_chunks > 1) ranges = malloc(sizeof(RangeTask) * n_chunks);
+
+  if (!ranges) {
+    for (size_t c = 0; c < n_chunks; c++) {
+      size_t start = c * chunk_size < n ? c * chunk_size : n;
+      size_t end = start + chunk_size < n ? start + chunk_size : n;
+      fn(arg, c, start, end);
+    }
+    return;
+  }
+
+  TaskGroup group;
+  taskgroup_init(&group, pool);
+  for (size_t c = 0; c < n_chunks; c++) {
+    size_t start = c * chunk_size < n ? c * chunk_size : n;
+    size_t end = start + chunk_size < n ? start + chunk_size : n;
+    ranges[c] = (RangeTask){fn, arg, c, start, end};
+    if (threadpool_submit(pool, &group, run_range, &ranges[c]) != 0) {
+      // Could not queue it; run it here rather than dropping part of the range
+      fn(arg, c, start, end);
+    }
+  }
+  taskgroup_wait(&group);
+  taskgroup_destroy(&group);
+  free(ranges);
+}
+
+size_t threadpool_morsel_workers(const ThreadPool* pool) {
+  return pool ? pool->n_workers + 1 : 1;
+}
+
+size_t threadpool_num_morsels(size_t n, size_t morsel_size) {
+  if (morsel_size == 0) morsel_size = 1;
+  return (n + morsel_size - 1) / morsel_size;
+}
+
+// Owner side: takes the morsel at the bottom of its own deque, or returns -1 if empty.
+// Only a race for the very last morsel needs a CAS against the thieves.
+static long deque_pop(MorselDeque* deque) {
+  long b = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+  __atomic_store_n(&deque->bottom, b, __ATOMIC_SEQ_CST);
+  long t = __atomic_load_n(&deque->top, __ATOMIC_SEQ_CST);
+
+  if (t > b) {
+    __atomic_store_n(&deque->bottom, b + 1, __ATOMIC_RELAXED);
+    return -1;
+  }
+  if (t == b) {
+    if (!__atomic_compare_exchange_n(&deque->top, &t, t + 1, 0, __ATOMIC_SEQ_CST,
+                                     __ATOMIC_RELAXED)) {
+      b = -1;  // a thief got it first
+    }
+    __atomic_store_n(&deque->bottom, t + 1, __ATOMIC_RELAXED);
+  }
+  return b;
+}
+
+// Thief side: takes the morsel at the top of someone else's deque. Returns -1 if the
+// deque is empty and -2 if another thread won the race, in which case it may be retried.
+static long deque_steal(MorselDeque* deque) {
+  long t = __atomic_load_n(&deque->top, __ATOMIC_SEQ_CST);
+  long b = __atomic_load_n(&deque->bottom, __ATOMIC_SEQ_CST);
+  if (t >= b) return -1;
+  if (!__atomic_compare_exchange_n(&deque->top, &t, t + 1, 0, __ATOMIC_SEQ_CST,
+                                   __ATOMIC_RELAXED)) {
+    return -2;
+  }
+  return t;
+}
+
+typedef struct {
+  MorselFn fn;
+  void* arg;
+  size_t n;
+  size_t morsel_size;
+  MorselDeque* deques;
+  size_t n_deques;
+} MorselJob;
+
+typedef struct {
+  MorselJob* job;
+  size_t worker;
+} MorselWorker;
+
+static void run_morsel(MorselJob* job, size_t worker, MorselDeque* deque, long slot) {
+  size_t m = (size_t)(deque->first + deque->last - 1 - slot);
+  size_t start = m * job->morsel_size;
+  size_t end = start + job->morsel_size < job->n ? start + job->morsel_size : job->n;
+  job->fn(job->arg, worker, m, start, end);
+}
+
+static void morsel_worker(void* arg) {
+  MorselWorker* self = (MorselWorker*)arg;
+  MorselJob* job = self->job;
+  size_t worker = self->worker;
+
+  // Drain our own run first
+  MorselDeque* own = &job->deques[worker];
+  long slot;
+  while ((slot = deque_pop(own)) >= 0) run_morsel(job, worker, own, slot);
+
+  // Then steal from the others until every deque is empty
+  int found_work = 1;
+  while (found_work) {
+    found_work = 0;
+    for (size_t v = 1; v < job->n_deques; v++) {
+      MorselDeque* victim = &job->deques[(worker + v) % job->n_deques];
+      while ((slot = deque_steal(victim)) != -1) {
+        found_work = 1;
+        if (slot >= 0) run_morsel(job, worker, victim, slot);
+      }
+    }
+  }
+}
+
+void threadpool_parallel_morsels(ThreadPool* pool, size_t n, size_t morsel_size,
+                                 MorselFn fn, void* arg) {
+  if (morsel_size == 0) morsel_size = 1;
+  size_t n_morsels = threadpool_num_morsels(n, morsel_size);
+  size_t n_workers = threadpool_morsel_workers(pool);
+  if (n_workers > n_morsels) n_workers = n_morsels;
+
+  MorselDeque* deques = NULL;
+  MorselWorker* workers = NULL;
+  if (pool && n_workers > 1) {
+    deques = aligned_alloc(64, sizeof(MorselDeque) * n_workers);
+    workers = malloc(sizeof(MorselWorker) * n_workers);
+  }
+
+  if (!deques || !workers) {
+    free(deques);
+    free(workers);
+    for (size_t m = 0; m < n_morsels; m++) {
+      size_t start = m * morsel_size;
+      size_t end = start + morsel_size < n ? start + morsel_size : n;
+      fn(arg, 0, m, start, end);
+    }
+    return;
+  }
+
+  // Hand each participant an equal contiguous run of morsels
+  MorselJob job = {fn, arg, n, morsel_size, deques, n_workers};
+  size_t per_worker = n_morsels / n_workers, extra = n_morsels % n_workers;
+  long first = 0;
+  for (size_t w = 0; w < n_workers; w++) {
+    long run = (long)(per_worker + (w < extra ? 1 : 0));
+    deques[w] = (MorselDeque){.top = first, .bottom = first + run, .first = first,
+                              .last = first + run};
+    first += run;
+    workers[w] = (MorselWorker){&job, w};
+  }
+
+  // Participant 0 is the caller; the others are queued on the pool
+  TaskGroup group;
+  taskgroup_init(&group, pool);
+  for (size_t w = 1; w < n_workers; w++) {
+    if (threadpool_submit(pool, &group, morsel_worker, &workers[w]) != 0) {
+      // Its run is still stealable, so the job completes without it
+      log_err("threadpool_parallel_morsels: failed to queue worker %zu\n", w);
+    }
+  }
+  morsel_worker(&workers[0]);
+  taskgroup_wait(&group);
+  taskgroup_destroy(&group);
+
+  free(deques);
+  free(workers);
+}
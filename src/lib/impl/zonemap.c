@@ -0,0 +1,157 @@
+#include "zonemap.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "utils.h"
+
+#define ZONEMAP_MAGIC 0x5a4d4150  // "ZMAP"
+
+// On-disk header, followed by `num_zones` mins and then `num_zones` maxs
+typedef struct {
+  uint32_t magic;
+  uint32_t zone_size;
+  uint64_t num_elements;
+  uint64_t num_zones;
+} ZoneMapHeader;
+
+static int zonemap_reserve(ZoneMap* zm, size_t num_zones) {
+  if (num_zones <= zm->capacity) return 0;
+  size_t capacity = zm->capacity ? zm->capacity : 16;
+  while (capacity < num_zones) capacity *= 2;
+
+  int* mins = realloc(zm->mins, sizeof(int) * capacity);
+  if (!mins) return -1;
+  zm->mins = mins;
+  int* maxs = realloc(zm->maxs, sizeof(int) * capacity);
+  if (!maxs) return -1;
+  zm->maxs = maxs;
+  zm->capacity = capacity;
+  return 0;
+}
+
+ZoneMap* zonemap_build(const int* data, size_t n, size_t zone_size) {
+  if ((!data && n > 0) || zone_size == 0) {
+    log_err("zonemap_build: Invalid input; data=%p, n=%zu, zone_size=%zu\n", data, n,
+            zone_size);
+    return NULL;
+  }
+
+  ZoneMap* zm = calloc(1, sizeof(ZoneMap));
+  if (!zm) return NULL;
+  zm->zone_size = zone_size;
+  zm->num_zones = (n + zone_size - 1) / zone_size;
+  if (zonemap_reserve(zm, zm->num_zones) != 0) {
+    zonemap_free(zm);
+    return NULL;
+  }
+
+  for (size_t z = 0; z < zm->num_zones; z++) {
+    size_t start = z * zone_size;
+    size_t end = start + zone_size < n ? start + zone_size : n;
+    int min_value = INT_MAX, max_value = INT_MIN;
+    for (size_t i = start; i < end; i++) {
+      min_value = data[i] < min_value ? data[i] : min_value;
+      max_value = data[i] > max_value ? data[i] : max_value;
+    }
+    zm->mins[z] = min_value;
+    zm->maxs[z] = max_value;
+  }
+  zm->num_elements = n;
+  return zm;
+}
+
+int zonemap_append(ZoneMap* zm, int value) {
+  if (!zm) return -1;
+
+  size_t z = zm->num_elements / zm->zone_size;
+  if (z == zm->num_zones) {
+    if (zonemap_reserve(zm, z + 1) != 0) return -1;
+    zm->mins[z] = value;
+    zm->maxs[z] = value;
+    zm->num_zones++;
+  } else {
+    zm->mins[z] = value < zm->mins[z] ? value : zm->mins[z];
+    zm->maxs[z] = value > zm->maxs[z] ? value : zm->maxs[z];
+  }
+  zm->num_elements++;
+  return 0;
+}
+
+int zonemap_range_may_match(const ZoneMap* zm, size_t start, size_t end, int low,
+                            int high) {
+  if (!zm) return 1;
+  if (low > high || start >= end) return 0;
+
+  // Positions past the summarized values are unknown, so they may match
+  if (end > zm->num_elements) return 1;
+
+  size_t last = (end - 1) / zm->zone_size;
+  for (size_t z = start / zm->zone_size; z <= last; z++) {
+    if (zm->mins[z] <= high && zm->maxs[z] >= low) return 1;
+  }
+  return 0;
+}
+
+int zonemap_save(const ZoneMap* zm, const char* path) {
+  if (!zm || !path) return -1;
+
+  FILE* file = fopen(path, "wb");
+  if (!file) {
+    log_err("zonemap_save: Failed to open %s for writing\n", path);
+    return -1;
+  }
+
+  ZoneMapHeader header = {ZONEMAP_MAGIC, (uint32_t)zm->zone_size, zm->num_elements,
+                          zm->num_zones};
+  int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+           fwrite(zm->mins, sizeof(int), zm->num_zones, file) == zm->num_zones &&
+           fwrite(zm->maxs, sizeof(int), zm->num_zones, file) == zm->num_zones;
+  if (fclose(file) != 0) ok = 0;
+  if (!ok) {
+    log_err("zonemap_save: Failed to write %s\n", path);
+    return -1;
+  }
+  return 0;
+}
+
+ZoneMap* zonemap_load(const char* path) {
+  FILE* file = fopen(path, "rb");
+  if (!file) return NULL;
+
+  ZoneMapHeader header;
+  ZoneMap* zm = NULL;
+  if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != ZONEMAP_MAGIC ||
+      header.zone_size == 0 ||
+      header.num_zones !=
+          (header.num_elements + header.zone_size - 1) / header.zone_size) {
+    log_err("zonemap_load: %s is not a valid zone map\n", path);
+    goto done;
+  }
+
+  zm = calloc(1, sizeof(ZoneMap));
+  if (!zm) goto done;
+  zm->zone_size = header.zone_size;
+  zm->num_elements = header.num_elements;
+  zm->num_zones = header.num_zones;
+  if (zonemap_reserve(zm, zm->num_zones) != 0 ||
+      fread(zm->mins, sizeof(int), zm->num_zones, file) != zm->num_zones ||
+      fread(zm->maxs, sizeof(int), zm->num_zones, file) != zm->num_zones) {
+    log_err("zonemap_load: Failed to read %s\n", path);
+    zonemap_free(zm);
+    zm = NULL;
+  }
+
+done:
+  fclose(file);
+  return zm;
+}
+
+void zonemap_free(ZoneMap* zm) {
+  if (!zm) return;
+  free(zm->mins);
+  free(zm->maxs);
+  free(zm);
+}
@@ -2,9 +2,51 @@
 #define ALGORITHMS_H
 
 #include <stddef.h>
+#include <stdint.h>
 
+#include "threadpool.h"
+
+// Ints per cache line: an Eytzinger search prefetches the 16 nodes 4 levels below it
+#define EYTZINGER_PREFETCH 16
+
+/**
+ * @brief Index of the first occurrence of `value` in `sorted_data` (or where it would
+ * go), and of the last value <= `value` (0 if there is none). Both are O(log n) however
+ * long the run of `value` is.
+ */
 size_t binary_search_left(int* sorted_data, size_t num_elements, int value);
 size_t binary_search_right(int* sorted_data, size_t num_elements, int value);
+
+/**
+ * @brief Index of the first value in `sorted_data` that is >= `value` (lower bound), or
+ * `num_elements` if there is none. With `sorted_upper_bound` (first value > `value`),
+ * the values in [low, high] are exactly [lower_bound(low), upper_bound(high)).
+ */
+size_t sorted_lower_bound(const int* sorted_data, size_t num_elements, int value);
+size_t sorted_upper_bound(const int* sorted_data, size_t num_elements, int value);
+
+/**
+ * @brief End of the run of values equal to `sorted_data[start]`: the index of the first
+ * value after `start` that differs from it, or `num_elements`. Gallops ahead and then
+ * binary searches, so finding every run costs O(log(run length)) per run.
+ */
+size_t sorted_run_end(const int* sorted_data, size_t num_elements, size_t start);
+
+/**
+ * @brief Lays out `sorted_data[0..n)` in Eytzinger (BFS) order: node `k` (from 1) has
+ * children `2k` and `2k + 1`, and `keys[k]` gets the key of node `k` of a search tree
+ * over the data, `ranks[k]` its index in `sorted_data`. Both arrays hold `n + 1`
+ * entries, and `keys` should be 64-byte aligned so the prefetches hit whole lines.
+ */
+void eytzinger_build(const int* sorted_data, size_t n, int* keys, uint32_t* ranks);
+
+/**
+ * @brief `sorted_lower_bound` / `sorted_upper_bound` over an Eytzinger layout of the
+ * data, returning indexes in the sorted data. The search is branch-free and prefetches
+ * the nodes it visits next, and finds either end of a run of duplicates in O(log n).
+ */
+size_t eytzinger_lower_bound(const int* keys, const uint32_t* ranks, size_t n, int value);
+size_t eytzinger_upper_bound(const int* keys, const uint32_t* ranks, size_t n, int value);
 /**
  * @brief sorts the `data` in ascending order and keeps track of their original positions.
  *
@@ -17,6 +59,16 @@ size_t binary_search_right(int* sorted_data, size_t num_elements, int value);
  * @return int
  */
 int sort(int* data, size_t n_elements, int* original_pos);
+
+/**
+ * @brief Stable LSD radix sort of `data[0..n)` in ascending order, writing the original
+ * position of each sorted value to `positions` (as `sort`). Sorts one byte of the keys
+ * per pass, skipping the bytes all keys share, so it runs in O(n) with 8 bytes of scratch
+ * per key. On `pool`, each pass splits the keys into contiguous chunks that count and
+ * then scatter their keys in parallel; runs single-threaded if `pool` is NULL.
+ * @return 0 on success, -1 on failure
+ */
+int radix_sort(int* data, size_t n, int* positions, ThreadPool* pool);
 void test_sort(void);
 
 #endif
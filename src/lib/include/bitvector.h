@@ -0,0 +1,60 @@
+#ifndef BITVECTOR_H
+#define BITVECTOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief A fixed-size set of positions [0, num_bits), one bit per position: bit `i` lives
+ * in `words[i / 64]` at `1 << (i % 64)`. Bits past `num_bits` in the last word are
+ * always clear, so whole-word operations (popcount, iteration) need no masking.
+ */
+typedef struct Bitvector {
+  uint64_t* words;
+  size_t num_bits;
+} Bitvector;
+
+#define BITVECTOR_WORDS(num_bits) (((num_bits) + 63) / 64)
+
+/**
+ * @brief Creates a bitvector of `num_bits` clear bits.
+ * @return Bitvector* or NULL on failure
+ */
+Bitvector* bitvector_create(size_t num_bits);
+
+static inline void bitvector_set(Bitvector* bv, size_t i) {
+  bv->words[i / 64] |= 1ULL << (i % 64);
+}
+
+static inline int bitvector_test(const Bitvector* bv, size_t i) {
+  return (bv->words[i / 64] >> (i % 64)) & 1;
+}
+
+/**
+ * @brief Number of set bits in words [first_word, end_word).
+ */
+size_t bitvector_count_words(const Bitvector* bv, size_t first_word, size_t end_word);
+
+/**
+ * @brief Number of set bits.
+ */
+size_t bitvector_count(const Bitvector* bv);
+
+/**
+ * @brief Smallest set bit at or after `from`, or `num_bits` if there is none.
+ */
+size_t bitvector_next(const Bitvector* bv, size_t from);
+
+/**
+ * @brief Writes the set positions of words [first_word, end_word) to `out`, in
+ * increasing order.
+ * @return the number of positions written
+ */
+size_t bitvector_positions(const Bitvector* bv, size_t first_word, size_t end_word,
+                           int* out);
+
+void bitvector_free(Bitvector* bv);
+
+void test_bitvector(void);
+
+#endif
@@ -2,71 +2,145 @@
 #define BTREE_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
 
+#include "index_file.h"
+
+// Keys per inner node: a node's keys are exactly one 64-byte cache line
+#define BTREE_NODE_KEYS 16
+// Keys per leaf: four cache lines, searched like four inner nodes
+#define BTREE_LEAF_KEYS 64
+// Entries per node when bulk loading (75%), leaving slack for inserts before splits
+#define BTREE_NODE_FILL 12
+#define BTREE_LEAF_FILL 48
+// Inner levels, at 8 children per node at least, cover every 32-bit row id
+#define BTREE_MAX_LEVELS 12
+// Node id of no node (the end of the leaf chain)
+#define BTREE_NIL UINT32_MAX
+
 /**
- * @brief Btree node structure
- *
- * This represents an internal node in the B-tree.
- *
- * Since, we're optimizing for just lookups, we decided to:
- * - Fill factor = 100% (all internal nodes are full)
- * - internal nodes are contiguous in memory
- *      - store the keys in an array of integers
- *      - a pointer to the next level of the tree (the first element of the next level)
- * - The last level's child_ptr always points to the `data` array
- *
- * Since during lookups, we need all values to compare against, and only follow one
- * pointer (see CS165_FALL2024_Class13 slide 26 & 27).
- *
+ * @brief Inner node: `n` children, and the `n - 1` separators between them. Separator
+ * `j` lies between the keys of child `j` and those of child `j + 1` (duplicates of it
+ * can be on either side); the keys past it are INT_MAX, so a search can compare the
+ * whole cache line at once.
+ */
+typedef struct BtreeInner {
+  int keys[BTREE_NODE_KEYS] __attribute__((aligned(64)));
+  uint32_t children[BTREE_NODE_KEYS];
+  uint32_t n;
+} BtreeInner;
+
+/**
+ * @brief Leaf: `n` sorted keys with the row id of each, INT_MAX past them. Leaves are
+ * chained in key order; equal keys are in ascending row id order.
+ */
+typedef struct BtreeLeaf {
+  int keys[BTREE_LEAF_KEYS] __attribute__((aligned(64)));
+  uint32_t rowids[BTREE_LEAF_KEYS];
+  uint32_t n;
+  uint32_t next;
+} BtreeLeaf;
+
+/**
+ * @brief Btree structure
  *
+ * A cache-conscious B+-tree over (key, row id) pairs that supports inserts:
+ * - Nodes live in two pools, `inners` and `leaves`, and refer to each other by their
+ *   index in the pool instead of a pointer; the pools grow by doubling. Leaf 0 is
+ *   always the first leaf.
+ * - A bulk load fills nodes to 75%, so inserts rarely split; a full node splits in
+ *   half, and a split of the root adds a level.
+ * - A lookup touches one cache line of keys per inner level, and compares the search
+ *   key with a whole node at once (SIMD).
+ * `height` is the number of inner levels; at 0, `root` is a leaf. Row ids are 32-bit.
+ * A tree loaded from disk has its pools in `file` until its first insert copies them.
  */
 typedef struct Btree {
-  struct Btree* child_ptr;
-  int* keys;
-  size_t n_keys;
-
-  // Global bookkeeping for unique values, etc.
-  size_t fanout;
-  size_t n_uniques;
-  size_t* first_unique_idxes;
-  size_t* last_unique_idxes;
+  BtreeInner* inners;
+  BtreeLeaf* leaves;
+  uint32_t n_inners, inner_capacity;
+  uint32_t n_leaves, leaf_capacity;
+  uint32_t root;
+  size_t height;
+  size_t n_elts;
+  IndexFile* file;
 } Btree;
 
-// TODO: refactor the above by moving global bookkeeping to a separate struct, say
-// BtreeIndex below, time permitting. they don't change per level node
-// typedef struct BtreeIndex {
-//   Btree* root;
-//   size_t fanout;
-//   size_t n_uniques;
-//   size_t* first_unique_idxes;
-//   size_t* last_unique_idxes;
-// };
+/**
+ * @brief A position in the tree's key order: slot `slot` of leaf `leaf`, or the end of
+ * the tree if `leaf` is BTREE_NIL.
+ */
+typedef struct BtreeCursor {
+  uint32_t leaf;
+  uint32_t slot;
+} BtreeCursor;
 
-Btree* init_btree(int* data, size_t n_elts, size_t fanout);
+/**
+ * @brief Bulk loads the tree from the sorted array `keys[0..n_elts)`, where `rowids[i]`
+ * is the row id of `keys[i]` (or `i`, if `rowids` is NULL). Equal keys must be in
+ * ascending row id order.
+ * @return Btree* or NULL on failure, or if `n_elts` is too large for 32-bit ids
+ */
+Btree* btree_create(const int* keys, const int* rowids, size_t n_elts);
 
 /**
- * @brief Lookup a key in the B-tree.
- *
- * @param key The key to search for.
- * @param tree The root of the B-tree.
- * @param is_left indicator for whether the caller is looking for first or last occurence
- * @return an index `i` in the `data` array such that
- *      `data[i - 1] < data[i] <= key` for i > 0 else 0,      if `is_left` is true (1)
- * OR
- *      `data[i] >= key > data[i + 1]` for i < n_elts,        if `is_left` is false (0)
+ * @brief Inserts `key` with row id `rowid`, after any equal keys.
+ * @return 0 on success, -1 on failure (the tree is unchanged)
+ */
+int btree_insert(Btree* tree, int key, uint32_t rowid);
+
+/**
+ * @brief Half-open bounds of `key`: the first element >= `key` (lower bound) or > `key`
+ * (upper bound), or the end. The elements in [low, high] are [lower(low), upper(high)).
+ */
+BtreeCursor btree_lower_bound(const Btree* tree, int key);
+BtreeCursor btree_upper_bound(const Btree* tree, int key);
+
+/**
+ * @brief Number of elements in [from, to).
+ */
+size_t btree_range_count(const Btree* tree, BtreeCursor from, BtreeCursor to);
+
+/**
+ * @brief Copies the keys and/or row ids of [from, to) to `keys` and `rowids`, either of
+ * which may be NULL.
+ * @return the number of elements copied
+ */
+size_t btree_range_copy(const Btree* tree, BtreeCursor from, BtreeCursor to, int* keys,
+                        int* rowids);
+
+/**
+ * @brief Row id of the element at `cursor`, or the number of elements at the end.
+ */
+size_t btree_cursor_rowid(const Btree* tree, BtreeCursor cursor);
+
+BtreeCursor btree_begin(const Btree* tree);
+BtreeCursor btree_end(void);
+
+/**
+ * @brief Writes the tree to `path` as an index file, node pools as they are, along with
+ * the caller's `flags`.
+ * @return 0 on success, -1 on failure
+ */
+int btree_save(const Btree* tree, const char* path, uint64_t flags);
+
+/**
+ * @brief Maps a tree written by `btree_save`, without reading its nodes, and reads
+ * back its flags into `flags` (if not NULL).
+ * @return Btree* or NULL if the file is missing or invalid
  */
-size_t lookup(int key, Btree* tree, int is_left);
+Btree* btree_load(const char* path, uint64_t* flags);
 
 void print_tree(Btree* tree);
 
 /**
- * @brief Free all memory allocated for the B-tree; not the data array.
+ * @brief Free all memory allocated for the B-tree.
  *
- * @param tree The root of the B-tree.
+ * @param tree The B-tree.
  */
 void free_btree(Btree* tree);
 
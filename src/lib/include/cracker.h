@@ -0,0 +1,68 @@
+#ifndef CRACKER_H
+#define CRACKER_H
+
+#include <stddef.h>
+
+/**
+ * @brief A pivot of the cracker index: every value before `position` in the cracker
+ * column is < `pivot`, and every value from `position` on is >= `pivot`.
+ */
+typedef struct CrackerNode {
+  int pivot;
+  size_t position;
+  struct CrackerNode* left;
+  struct CrackerNode* right;
+  int height;
+} CrackerNode;
+
+/**
+ * @brief An adaptive index built by database cracking: a copy of a column (the cracker
+ * column) that each range select partitions a little further. The pivots cut the cracker
+ * column into pieces, and a select only reorders the (at most two) pieces holding its
+ * bounds, so repeated queries converge toward sorted order with no upfront sort.
+ *
+ * - `values`: the cracker column, ordered by the pivots but not within a piece
+ * - `positions`: the base position of each value in `values`
+ * - `root`: the cracker index, an AVL tree of pivots
+ */
+typedef struct Cracker {
+  int* values;
+  int* positions;
+  size_t num_elements;
+  size_t capacity;
+  CrackerNode* root;
+  size_t num_pivots;
+} Cracker;
+
+/**
+ * @brief Creates a cracker column over a copy of `data[0..n)`, in base order.
+ * @return Cracker* or NULL on failure
+ */
+Cracker* cracker_create(const int* data, size_t n);
+
+/**
+ * @brief Index of the first value >= `pivot` in the cracker column, partitioning the
+ * piece holding `pivot` around it if it is not a pivot yet.
+ */
+size_t cracker_crack(Cracker* cracker, int pivot);
+
+/**
+ * @brief Cracks on the bounds of the inclusive range [low, high] (in one pass when both
+ * fall in the same piece) and returns the run of the cracker column holding exactly the
+ * values in it, as [*start, *end). `positions[*start..*end)` are then the qualifying
+ * base positions, in no particular order.
+ */
+void cracker_select(Cracker* cracker, int low, int high, size_t* start, size_t* end);
+
+/**
+ * @brief Adds `value`, at base position `position`, to the piece it belongs in by
+ * shifting one value of each later piece ("ripple" insert).
+ * @return 0 on success, -1 on failure
+ */
+int cracker_insert(Cracker* cracker, int value, int position);
+
+void cracker_free(Cracker* cracker);
+
+void test_cracker(void);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef EXPR_H
+#define EXPR_H
+
+#include <stddef.h>
+
+#include "simd.h"
+
+// Rows per block of `expr_eval`: the temporaries of a block stay in L1
+#define EXPR_BLOCK_SIZE 1024
+// Deepest operand stack of an expression, i.e. temporaries live at once
+#define EXPR_MAX_DEPTH 8
+
+typedef enum ExprStepKind { EXPR_VALUES, EXPR_CONSTANT, EXPR_OP } ExprStepKind;
+
+/**
+ * @brief One step of an expression in postfix order: push the array `values` or the
+ * constant `constant`, or pop two operands and push `lhs op rhs`. E.g. `a+b-c*2` is
+ * [a, b, +, c, 2, *, -].
+ */
+typedef struct ExprStep {
+  ExprStepKind kind;
+  ArithOp op;
+  const int* values;
+  int constant;
+} ExprStep;
+
+/**
+ * @brief The deepest the operand stack of `steps` gets.
+ * @return the depth, or -1 if `steps` do not leave exactly one operand (malformed)
+ */
+int expr_depth(const ExprStep* steps, size_t num_steps);
+
+/**
+ * @brief Evaluates the expression `steps` (at most EXPR_MAX_DEPTH deep) on rows
+ * [offset, offset + n) of its arrays into `out[0..n)`, folding the results into `stats`.
+ * Rows are processed EXPR_BLOCK_SIZE at a time, each operator a `simd_arith` pass over
+ * the block, so intermediate results only ever occupy a few cache-resident blocks.
+ * Arithmetic is that of `simd_arith`.
+ * @return 0 on success, -1 if a divisor is zero
+ */
+int expr_eval(const ExprStep* steps, size_t num_steps, size_t offset, size_t n, int* out,
+              ValueStats* stats);
+
+void test_expr(void);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef GRACE_JOIN_H
+#define GRACE_JOIN_H
+
+#include <stddef.h>
+
+#include "join_output.h"
+#include "threadpool.h"
+
+// Memory a build tuple takes while its partition is joined: the tuple itself, its share
+// of the hash table's slots (kept at most half full) and its value in the table's arena
+#define GRACE_JOIN_BUILD_BYTES 64
+
+/**
+ * @brief Grace hash join of the tuples (`l_keys[i]`, `l_payloads[i]`) with (`r_keys[j]`,
+ * `r_payloads[j]`) that keeps the memory it joins in to `memory_budget` bytes: every pair
+ * with equal keys is written to `result` as (`l_payloads[i]`, `r_payloads[j]`), in no
+ * particular order. The caller frees the result with `join_result_free`.
+ *
+ * If the smaller (build) side fits in the budget, at `GRACE_JOIN_BUILD_BYTES` per tuple,
+ * this is an in-memory `radix_join`. Otherwise both sides are partitioned on their keys'
+ * hash into temporary files in `spill_dir`, and the pairs of partitions are joined one
+ * at a time: the build partition goes into a hash table, and the probe partition streams
+ * past it in blocks, probed in parallel on `pool` (single-threaded if NULL). A build
+ * partition still over the budget is partitioned again, on other bits of the hash; one
+ * that cannot be split (its keys are too few or too skewed) is joined in budget-sized
+ * chunks, streaming the probe partition past each. The files are unlinked as soon as they
+ * are created, so none are left behind, even by a crash.
+ * @return 0 on success, -1 on failure (`result` is then empty)
+ */
+int grace_join(const int* l_keys, const int* l_payloads, size_t l_n, const int* r_keys,
+               const int* r_payloads, size_t r_n, size_t memory_budget,
+               const char* spill_dir, ThreadPool* pool, JoinResult* result);
+
+void test_grace_join(void);
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef GROUP_TABLE_H
+#define GROUP_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief The running aggregates of one group: the count, sum, min and max of the values
+ * added under `key`.
+ */
+typedef struct GroupEntry {
+  int64_t sum;
+  int64_t count;
+  int key;
+  int min;
+  int max;
+  int used;
+} GroupEntry;
+
+/**
+ * @brief An open-addressing (linear probing) hash table from an int key to the
+ * aggregates of its group, for hash group-by. An entry is one 32-byte slot, so a group's
+ * update touches a single cache line, and the table stays cache resident for the
+ * low-cardinality keys group-by is used on. It doubles once half full.
+ *
+ * - `entries`: `capacity` slots, a power of two; free slots have `used` == 0
+ * - `num_groups`: the number of used slots
+ */
+typedef struct GroupTable {
+  GroupEntry* entries;
+  size_t capacity;
+  size_t num_groups;
+  int shift;  // 32 - log2(capacity): keeps the top bits of the multiplicative hash
+} GroupTable;
+
+/**
+ * @brief Creates an empty table with room for `expected_groups` groups before it grows.
+ * @return GroupTable* or NULL on failure
+ */
+GroupTable* group_table_create(size_t expected_groups);
+
+/**
+ * @brief Folds `values[i]` into the group of `keys[i]` for i in [0, n).
+ * @return 0 on success, -1 if the table failed to grow
+ */
+int group_table_add(GroupTable* gt, const int* keys, const int* values, size_t n);
+
+/**
+ * @brief Folds every group of `src` into `dst`, e.g. to merge thread-local tables.
+ * @return 0 on success, -1 if `dst` failed to grow
+ */
+int group_table_merge(GroupTable* dst, const GroupTable* src);
+
+/**
+ * @brief Copies the groups of the table to `out` (room for `num_groups` entries) in
+ * ascending key order.
+ * @return the number of groups
+ */
+size_t group_table_sorted(const GroupTable* gt, GroupEntry* out);
+
+void group_table_free(GroupTable* gt);
+
+void test_group_table(void);
+
+#endif
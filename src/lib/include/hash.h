@@ -0,0 +1,19 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdint.h>
+
+/**
+ * @brief Murmur3's finalizer: every bit of the hash depends on every bit of the key, so
+ * any slice of it spreads keys evenly, even keys with patterns in their low or high bits.
+ */
+static inline uint32_t hash32(int key) {
+  uint32_t h = (uint32_t)key;
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  return h ^ (h >> 16);
+}
+
+#endif
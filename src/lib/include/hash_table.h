@@ -1,32 +1,79 @@
 #ifndef HASH_TABLE_H
 #define HASH_TABLE_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 typedef int keyType;
 typedef int valType;
 
-// Node structure for the linked list of values
-typedef struct node {
-  valType value;
-  struct node* next;
-} node;
-
-// Entry structure for each key-value pair
-typedef struct entry {
+/**
+ * @brief A slot of the table: a key and where its values are in the arena. A key's
+ * values are `arena[offset..offset + count)`, contiguous, with room for `capacity` of
+ * them before the run has to move. An empty slot has `capacity` 0.
+ */
+typedef struct hashslot {
   keyType key;
-  node* values;
-  struct entry* next;
-} entry;
+  uint32_t count;
+  uint32_t offset;
+  uint32_t capacity;
+} hashslot;
 
-// Hash table structure
+/**
+ * @brief Multimap from int keys to int values, with open addressing (linear probing)
+ * over a flat array of slots and every key's values stored together in one arena, so a
+ * lookup is a probe of a few adjacent slots and a read of one run of values; nothing is
+ * allocated per key or value.
+ *
+ * - `slots`: `num_slots` slots, a power of two, at most half of them used
+ * - `size`: the number of distinct keys
+ * - `arena`: the values; a run that outgrows its room moves to the end of the arena,
+ *   doubling its room. The room a moved or erased run leaves is not reused.
+ */
 typedef struct hashtable {
-  entry** buckets;
-  int size;
-  int num_buckets;
+  hashslot* slots;
+  size_t num_slots;
+  int shift;  // 32 - log2(num_slots): keeps the top bits of the hash
+  size_t size;
+  valType* arena;
+  size_t arena_size;
+  size_t arena_capacity;
 } hashtable;
 
+/**
+ * @brief Creates an empty table with room for `size` keys before it grows.
+ * @return 0 on success, -1 on failure
+ */
 int allocate(hashtable** ht, int size);
+
+/**
+ * @brief Adds `value` to the values of `key`.
+ * @return 0 on success, -1 on failure
+ */
 int put(hashtable* ht, keyType key, valType value);
+
+/**
+ * @brief Adds `values[i]` to the values of `keys[i]` for i in [0, n). Into an empty
+ * table, the values are counted per key first and then placed straight into runs of
+ * exactly their size; in insertion order, as with `put`.
+ * @return 0 on success, -1 on failure
+ */
+int bulk_put(hashtable* ht, const keyType* keys, const valType* values, size_t n);
+
+/**
+ * @brief Copies up to `num_values` values of `key` to `values`, in insertion order, and
+ * sets `num_results` to the number of values `key` has (which may be more).
+ * @return 0 on success, -1 on invalid arguments
+ */
 int get(hashtable* ht, keyType key, valType* values, int num_values, int* num_results);
+
+/**
+ * @brief The values of `key` in place, without copying them: `*num_results` of them, in
+ * insertion order. They stay valid until the next change to the table.
+ * @return the values, or NULL if `key` has none
+ */
+const valType* get_values(const hashtable* ht, keyType key, size_t* num_results);
+
 int erase(hashtable* ht, keyType key);
 int deallocate(hashtable* ht);
 
@@ -0,0 +1,61 @@
+#ifndef INDEX_FILE_H
+#define INDEX_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bumped whenever the layout of a file, or of any structure stored in one, changes
+#define INDEX_FILE_VERSION 1
+#define INDEX_FILE_META 4
+#define INDEX_FILE_SECTIONS 4
+// Sections start at multiples of this, so structures in them keep their alignment
+#define INDEX_FILE_ALIGN 64
+
+/**
+ * @brief On-disk header of an index file: a `magic` naming the kind of index, the
+ * format version, a few index-specific counts in `meta`, and the byte size of each
+ * section of the file (0 for unused ones). The checksum covers the header only, so
+ * validating a file costs the same however large it is.
+ */
+typedef struct IndexFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t meta[INDEX_FILE_META];
+  uint64_t section_sizes[INDEX_FILE_SECTIONS];
+  uint64_t checksum;
+} IndexFileHeader;
+
+/**
+ * @brief An index file mapped into memory. Its sections are mapped copy-on-write: an
+ * index may scribble on them, but must copy them out to grow them.
+ */
+typedef struct IndexFile {
+  void* base;
+  size_t size;
+  IndexFileHeader header;
+  void* sections[INDEX_FILE_SECTIONS];
+} IndexFile;
+
+/**
+ * @brief Writes an index file with sections `sections[s]` of `sizes[s]` bytes. The file
+ * is written next to `path` and then renamed over it, so a mapping of the old file
+ * stays valid.
+ * @return 0 on success, -1 on failure
+ */
+int index_file_write(const char* path, uint32_t magic,
+                     const uint64_t meta[INDEX_FILE_META],
+                     const void* const sections[INDEX_FILE_SECTIONS],
+                     const size_t sizes[INDEX_FILE_SECTIONS]);
+
+/**
+ * @brief Maps an index file written by `index_file_write` with the same `magic`.
+ * @return IndexFile* or NULL if the file is missing, of another version, or its header
+ * or size don't check out
+ */
+IndexFile* index_file_map(const char* path, uint32_t magic);
+
+void index_file_unmap(IndexFile* file);
+
+void test_index_file(void);
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef JOIN_OUTPUT_H
+#define JOIN_OUTPUT_H
+
+#include <stddef.h>
+
+// Pairs the first chunk of an output holds; every later chunk holds twice the one before
+#define JOIN_OUTPUT_FIRST_CHUNK 1024
+// Enough chunks for 2^41 pairs
+#define JOIN_OUTPUT_MAX_CHUNKS 32
+
+/**
+ * @brief The output of a join: the payloads `left[i]` and `right[i]` of the i-th pair of
+ * matching tuples.
+ */
+typedef struct JoinResult {
+  int* left;
+  int* right;
+  size_t n;
+} JoinResult;
+
+/**
+ * @brief Pairs a join writes as it finds them, in one pass, without knowing how many
+ * there will be. They go into chunks of geometrically growing size, so a full chunk is
+ * never copied or moved: a new one is added, and memory stays proportional to the
+ * output. Each thread (or morsel) writes to its own output; `join_output_concat` then
+ * joins them into one result. A zeroed output is empty.
+ */
+typedef struct JoinOutput {
+  int* left[JOIN_OUTPUT_MAX_CHUNKS];
+  int* right[JOIN_OUTPUT_MAX_CHUNKS];
+  size_t n_chunks;
+  size_t n;         // pairs in the last chunk
+  size_t capacity;  // room of the last chunk
+  size_t total;     // pairs in the chunks before the last
+} JoinOutput;
+
+/**
+ * @brief Adds a chunk to `out`, twice the size of its last one.
+ * @return 0 on success, -1 on failure
+ */
+int join_output_grow(JoinOutput* out);
+
+/**
+ * @brief Appends the pair (`left`, `right`) to `out`.
+ * @return 0 on success, -1 on failure
+ */
+static inline int join_output_emit(JoinOutput* out, int left, int right) {
+  if (out->n == out->capacity && join_output_grow(out)) return -1;
+  out->left[out->n_chunks - 1][out->n] = left;
+  out->right[out->n_chunks - 1][out->n] = right;
+  out->n++;
+  return 0;
+}
+
+static inline size_t join_output_size(const JoinOutput* out) {
+  return out->total + out->n;
+}
+
+void join_output_free(JoinOutput* out);
+
+/**
+ * @brief Concatenates `n_outputs` outputs, in order, into `result`, allocated to exactly
+ * their size (but never empty, as callers own the arrays), and frees the outputs.
+ * @return 0 on success, -1 on failure (`result` is then empty)
+ */
+int join_output_concat(JoinOutput* outputs, size_t n_outputs, JoinResult* result);
+
+void join_result_free(JoinResult* result);
+
+void test_join_output(void);
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef JOIN_PLANNER_H
+#define JOIN_PLANNER_H
+
+#include <stddef.h>
+
+// Keys `estimate_distinct` samples; inputs this small are counted exactly
+#define JOIN_PLANNER_SAMPLE 1024
+
+// The join algorithms `plan_join` chooses between
+typedef enum JoinAlgorithm {
+  JOIN_ALGO_NESTED_LOOP,
+  JOIN_ALGO_HASH,   // one hash table over the build side
+  JOIN_ALGO_RADIX,  // radix-partitioned hash join
+  JOIN_ALGO_GRACE,  // hash join spilling partitions to disk
+  JOIN_ALGO_SORT_MERGE,
+  JOIN_ALGO_INDEX_NESTED_LOOP,  // lookups of the probe side in the build side's index
+  JOIN_ALGO_COUNT
+} JoinAlgorithm;
+
+/**
+ * @brief What the planner knows of one side of a join.
+ * - `n`: its number of tuples
+ * - `distinct`: an estimate of its number of distinct keys (see `estimate_distinct`)
+ * - `sorted`: its keys are known to be in ascending order
+ * - `index_n`: the size of an index over the column its keys were read from, which can be
+ *   looked up instead of the side itself; 0 if there is none
+ */
+typedef struct JoinSideStats {
+  size_t n;
+  size_t distinct;
+  int sorted;
+  size_t index_n;
+} JoinSideStats;
+
+/**
+ * @brief The cheapest algorithm for a join, and `build_side` (0 left, 1 right): the side
+ * its hash table goes over or its index is looked up in (the smaller side if it has
+ * neither). `costs` are the estimates of every algorithm, in nanoseconds on one core,
+ * INFINITY for those that cannot run (or would not fit the memory budget); `output` is
+ * the estimated number of results.
+ */
+typedef struct JoinPlan {
+  JoinAlgorithm algorithm;
+  int build_side;
+  double costs[JOIN_ALGO_COUNT];
+  double output;
+} JoinPlan;
+
+/**
+ * @brief Estimates the number of distinct values of `keys` from an evenly spaced sample
+ * of `JOIN_PLANNER_SAMPLE` of them, with Haas and Stokes' first-order jackknife: the
+ * sample's distinct values, scaled up by how many of them it saw just once, since those
+ * stand for the values it missed. A sample of only such values says `keys` are all
+ * distinct, and one with none says it saw every value. Exact if `n` is at most the
+ * sample size.
+ */
+size_t estimate_distinct(const int* keys, size_t n);
+
+/**
+ * @brief Picks the algorithm with the least estimated cost to join `left` with `right`,
+ * from per-tuple costs measured on random keys. Equal-key pairs cost the same whichever
+ * algorithm finds them, so the results only count towards an index nested loop join,
+ * which checks each index match for membership of its side.
+ * - Nested loop compares every pair, but has no setup cost: it wins on tiny inputs.
+ * - A hash join builds one table over the smaller side, sized by its distinct keys; it is
+ *   cheap while the table stays in the cache, and slow once lookups miss it.
+ * - A radix join partitions both sides so that every table stays in the cache.
+ * - Neither fits a build side over `memory_budget`, at which point the grace join spills
+ *   partitions to disk instead.
+ * - A sort-merge join sorts the sides not already in order, then merges them: sides read
+ *   off an index cost a merge alone.
+ * - An index nested loop join looks every tuple of one side up in the other's index.
+ */
+JoinPlan plan_join(const JoinSideStats* left, const JoinSideStats* right,
+                   size_t memory_budget);
+
+// Name of `algorithm` for logs
+const char* join_algorithm_name(JoinAlgorithm algorithm);
+
+void test_join_planner(void);
+
+#endif
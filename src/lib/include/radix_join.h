@@ -0,0 +1,43 @@
+#ifndef RADIX_JOIN_H
+#define RADIX_JOIN_H
+
+#include <stddef.h>
+
+#include "join_output.h"
+#include "threadpool.h"
+
+// Most radix bits a partitioning pass splits on: 128 partitions keep one write stream
+// per partition within the L1 cache and the TLB
+#define RADIX_JOIN_PASS_BITS 7
+// Two passes at most; past that, partitions outgrow the L2 cache instead
+#define RADIX_JOIN_MAX_BITS (2 * RADIX_JOIN_PASS_BITS)
+// Cache footprint of a build tuple in its partition's table: key, payload, chain link
+// and bucket head
+#define RADIX_JOIN_TUPLE_BYTES 16
+
+/**
+ * @brief Radix bits `radix_join` should partition a build side of `build_n` tuples on,
+ * so that each partition's hash table fits in the L2 cache (0 if the whole side does).
+ */
+size_t radix_join_bits(size_t build_n);
+
+/**
+ * @brief Radix-partitioned hash join of the tuples (`l_keys[i]`, `l_payloads[i]`) with
+ * (`r_keys[j]`, `r_payloads[j]`): every pair with equal keys is written to `result` as
+ * (`l_payloads[i]`, `r_payloads[j]`), in no particular order. The caller frees the
+ * result with `join_result_free`.
+ *
+ * Both sides are partitioned on `radix_bits` bits of the keys' hash, in one or two
+ * passes; then each pair of partitions is joined on its own, building a hash table over
+ * the smaller input's partition and probing it with the other's. The first pass runs in
+ * parallel over chunks of the input, and the rest in parallel over partitions, on
+ * `pool` (single-threaded if NULL).
+ * @return 0 on success, -1 on failure (`result` is then empty)
+ */
+int radix_join(const int* l_keys, const int* l_payloads, size_t l_n, const int* r_keys,
+               const int* r_payloads, size_t r_n, size_t radix_bits, ThreadPool* pool,
+               JoinResult* result);
+
+void test_radix_join(void);
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Instruction set used by the vectorized kernels. Picked once at runtime from
+ * what the host CPU supports (see `simd_level`), so the same binary runs on older
+ * hosts with the scalar fallback.
+ */
+typedef enum SimdLevel { SIMD_SCALAR, SIMD_AVX2, SIMD_AVX512 } SimdLevel;
+
+/**
+ * @brief Shape of a scan predicate. All bounds are inclusive, so every comparator the
+ * parser produces maps onto exactly one shape without overflow at INT_MIN/INT_MAX:
+ *
+ * - `SCAN_NONE`:    nothing qualifies
+ * - `SCAN_LE`:      x <= high          (e.g. select(col,null,h) => high = h - 1)
+ * - `SCAN_GE`:      x >= low           (e.g. select(col,l,null))
+ * - `SCAN_BETWEEN`: low <= x <= high   (e.g. select(col,l,h)   => high = h - 1)
+ * - `SCAN_EQ`:      x == low
+ */
+typedef enum ScanShape { SCAN_NONE, SCAN_LE, SCAN_GE, SCAN_BETWEEN, SCAN_EQ } ScanShape;
+
+typedef struct ScanPredicate {
+  ScanShape shape;
+  int low;
+  int high;
+} ScanPredicate;
+
+/**
+ * @brief Builds the predicate `low <= x <= high` over (possibly out of int range)
+ * inclusive bounds, picking the cheapest shape: one-sided bounds become `SCAN_LE` or
+ * `SCAN_GE`, a single value becomes `SCAN_EQ`, and an empty range becomes `SCAN_NONE`.
+ */
+ScanPredicate scan_predicate(long low, long high);
+
+SimdLevel simd_level(void);
+
+/**
+ * @brief Overrides the detected instruction set, e.g. to compare kernels against the
+ * scalar fallback in tests and benchmarks. A level the CPU does not support is clamped
+ * to the best supported one. Returns the level actually in effect.
+ */
+SimdLevel simd_force_level(SimdLevel level);
+
+/**
+ * @brief Scans `data[0..n)` and writes the position of every qualifying value to `out`,
+ * in increasing order. The position of `data[i]` is `posns[i]` if `posns` is given (e.g.
+ * the positions of a prior select), else `base + i`.
+ *
+ * `out` must have room for `n` ints; the kernels write whole vectors and rely on that.
+ *
+ * @return the number of qualifying positions written to `out`
+ */
+size_t simd_select(const int* data, size_t n, const ScanPredicate* pred, const int* posns,
+                   size_t base, int* out);
+
+/**
+ * @brief Scans `data[0..n)` and sets bit `i % 64` of `words[i / 64]` for every
+ * qualifying `data[i]`. Words [0, ceil(n / 64)) are overwritten, so a short last word
+ * has its bits past `n` cleared.
+ *
+ * @return the number of qualifying values
+ */
+size_t simd_select_bitmap(const int* data, size_t n, const ScanPredicate* pred,
+                          uint64_t* words);
+
+/**
+ * @brief Running sum, min and max of the values a gather or copy has produced. Start
+ * from `{0, INT_MAX, INT_MIN}`; a kernel only folds values into it.
+ */
+typedef struct ValueStats {
+  int64_t sum;
+  int min;
+  int max;
+} ValueStats;
+
+/**
+ * @brief Gathers `out[i] = values[posns[i]]` for i in [0, n), folding every value into
+ * `stats`; with `out` NULL it only computes the stats. Random positions are prefetched
+ * a fixed distance ahead of the gather, to overlap their cache misses, and groups of
+ * consecutive positions are read with plain vector loads.
+ */
+void simd_gather(const int* values, const int* posns, size_t n, int* out,
+                 ValueStats* stats);
+
+/**
+ * @brief `simd_gather` over the dense positions [0, n): a sequential copy of
+ * `values[0..n)` to `out` (if given), folding every value into `stats`.
+ */
+void simd_copy(const int* values, size_t n, int* out, ValueStats* stats);
+
+/**
+ * @brief `simd_gather` of several columns at the same positions in one pass:
+ * `outs[c][i] = columns[c][posns[i]]`, folding column c's values into `stats[c]`. Each
+ * group of positions is read once and gathered from every column before moving on, so
+ * the columns' cache misses overlap. `outs` may be NULL to only compute the stats.
+ */
+void simd_gather_columns(const int* const* columns, size_t num_columns, const int* posns,
+                         size_t n, int* const* outs, ValueStats* stats);
+
+// Element-wise operation of `simd_arith`
+typedef enum ArithOp { ARITH_ADD, ARITH_SUB, ARITH_MUL, ARITH_DIV } ArithOp;
+
+/**
+ * @brief An operand of `simd_arith`: the array `values`, or, if `values` is NULL, the
+ * constant `constant` in every row.
+ */
+typedef struct ArithOperand {
+  const int* values;
+  int constant;
+} ArithOperand;
+
+/**
+ * @brief Computes `out[i] = lhs[i] op rhs[i]` for i in [0, n), folding every result into
+ * `stats` with 64-bit sums. Add, sub and mul wrap around on overflow like 32-bit two's
+ * complement. Div truncates toward zero, computed in double precision, which is exact
+ * for 32-bit operands (INT_MIN / -1 wraps to INT_MIN).
+ * @return 0 on success, -1 if a divisor is zero (`out` and `stats` are then incomplete)
+ */
+int simd_arith(ArithOp op, ArithOperand lhs, ArithOperand rhs, size_t n, int* out,
+               ValueStats* stats);
+
+void test_simd(void);
+
+#endif
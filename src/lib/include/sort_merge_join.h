@@ -0,0 +1,34 @@
+#ifndef SORT_MERGE_JOIN_H
+#define SORT_MERGE_JOIN_H
+
+#include <stddef.h>
+
+#include "join_output.h"
+#include "threadpool.h"
+
+// Tuples of the larger side each piece of the merge covers
+#define SORT_MERGE_JOIN_MORSEL 16384
+
+/**
+ * @brief Sort-merge join of the tuples (`l_keys[i]`, `l_payloads[i]`) with (`r_keys[j]`,
+ * `r_payloads[j]`): every pair with equal keys is written to `result` as
+ * (`l_payloads[i]`, `r_payloads[j]`), in ascending order of their keys. The caller frees
+ * the result with `join_result_free`.
+ *
+ * A side whose keys are known to be in ascending order (`l_sorted`, `r_sorted`, e.g.
+ * because they were read off a sorted index) is merged as it is; any other side is
+ * checked for order, and copied and radix sorted on `pool` if it is out of order. The
+ * merge is split into pieces of `SORT_MERGE_JOIN_MORSEL` tuples of the larger side, run
+ * in parallel on `pool` (single-threaded if NULL): each piece finds where its first key
+ * starts in the other side and merges from there. A run of equal keys may span pieces;
+ * each piece then pairs its share of the run with all of the other side's run, so a
+ * heavily duplicated key is split between workers too.
+ * @return 0 on success, -1 on failure (`result` is then empty)
+ */
+int sort_merge_join(const int* l_keys, const int* l_payloads, size_t l_n, int l_sorted,
+                    const int* r_keys, const int* r_payloads, size_t r_n, int r_sorted,
+                    ThreadPool* pool, JoinResult* result);
+
+void test_sort_merge_join(void);
+
+#endif
@@ -1 +1,146 @@
-#TODO
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <pthread.h>
+#include <stddef.h>
+
+typedef void (*TaskFn)(void* arg);
+typedef void* (*FutureFn)(void* arg);
+
+/**
+ * @brief Runs `fn` over the range [start, end) of a `threadpool_parallel_for` split;
+ * `chunk` is the index of that range, so callers can keep per-chunk results in order.
+ */
+typedef void (*RangeFn)(void* arg, size_t chunk, size_t start, size_t end);
+
+/**
+ * @brief Runs `fn` over the morsel [start, end) of a `threadpool_parallel_morsels` job.
+ * `morsel` is the morsel's index (so results can be merged in input order) and `worker`
+ * the index, below `threadpool_morsel_workers`, of the participant running it (so
+ * per-worker scratch needs no locking).
+ */
+typedef void (*MorselFn)(void* arg, size_t worker, size_t morsel, size_t start,
+                         size_t end);
+
+typedef struct Task {
+  TaskFn fn;
+  void* arg;
+  struct TaskGroup* group;
+  struct Task* next;
+} Task;
+
+/**
+ * @brief Persistent pool of worker threads, started once and fed through a shared FIFO
+ * task queue. Workers sleep on `has_tasks` when the queue is empty.
+ */
+typedef struct ThreadPool {
+  pthread_t* workers;
+  size_t n_workers;
+
+  pthread_mutex_t lock;
+  pthread_cond_t has_tasks;
+  Task* head;
+  Task* tail;
+  int shutting_down;
+} ThreadPool;
+
+/**
+ * @brief A barrier over a set of tasks: `taskgroup_wait` returns once every task
+ * submitted with the group has finished. While waiting, the caller runs queued tasks
+ * itself, so a task may fork and wait on sub-tasks without starving the pool.
+ */
+typedef struct TaskGroup {
+  ThreadPool* pool;
+  pthread_mutex_t lock;
+  pthread_cond_t all_done;
+  size_t pending;
+} TaskGroup;
+
+/**
+ * @brief The pending result of a single task submitted with `threadpool_async`.
+ */
+typedef struct Future {
+  TaskGroup group;
+  FutureFn fn;
+  void* arg;
+  void* result;
+} Future;
+
+/**
+ * @brief Starts a pool with `n_workers` threads, or one per online core if 0.
+ * @return ThreadPool* or NULL on failure
+ */
+ThreadPool* threadpool_create(size_t n_workers);
+
+/**
+ * @brief Runs the tasks still queued, then joins all workers and frees the pool.
+ */
+void threadpool_destroy(ThreadPool* pool);
+
+size_t threadpool_size(const ThreadPool* pool);
+
+void taskgroup_init(TaskGroup* group, ThreadPool* pool);
+void taskgroup_wait(TaskGroup* group);
+void taskgroup_destroy(TaskGroup* group);
+
+/**
+ * @brief Queues `fn(arg)` on the pool as part of `group` (which may be NULL for
+ * fire-and-forget tasks).
+ * @return 0 on success, -1 if the task could not be queued
+ */
+int threadpool_submit(ThreadPool* pool, TaskGroup* group, TaskFn fn, void* arg);
+
+/**
+ * @brief Queues `fn(arg)` and returns a future for its result; see `future_get`.
+ */
+Future* threadpool_async(ThreadPool* pool, FutureFn fn, void* arg);
+
+/**
+ * @brief Waits for the task behind `future`, frees the future and returns the result.
+ */
+void* future_get(Future* future);
+
+/**
+ * @brief Splits [0, n) into `n_chunks` contiguous ranges of (almost) equal size, runs
+ * `fn` on each of them on the pool and waits for all of them. Runs inline, in order,
+ * if `pool` is NULL.
+ */
+void threadpool_parallel_for(ThreadPool* pool, size_t n, size_t n_chunks, RangeFn fn,
+                             void* arg);
+
+/**
+ * @brief A work-stealing deque over one participant's run of morsels [first, last). The
+ * owner pops from the bottom and thieves steal from the top (Chase-Lev), both lock-free;
+ * jobs fill the deques before starting, so nothing is ever pushed. Slot `i` holds morsel
+ * `first + last - 1 - i`, so the owner walks its run front to back while thieves take the
+ * morsels it would reach last. Padded to a cache line against false sharing.
+ */
+typedef struct MorselDeque {
+  long top;
+  long bottom;
+  long first;
+  long last;
+  char padding[64 - 4 * sizeof(long)];
+} MorselDeque;
+
+/**
+ * @brief Number of participants in a morsel job on `pool`: every worker plus the calling
+ * thread, which works on the job instead of blocking. Size per-worker scratch with this.
+ */
+size_t threadpool_morsel_workers(const ThreadPool* pool);
+
+size_t threadpool_num_morsels(size_t n, size_t morsel_size);
+
+/**
+ * @brief Splits [0, n) into morsels of `morsel_size` values and runs `fn` on each of
+ * them, waiting for all of them. Every participant starts on its own contiguous run of
+ * morsels and steals from the far end of the others' runs once it is done, so a slow or
+ * descheduled worker only delays the morsels it is currently on. Runs inline, in order,
+ * if `pool` is NULL.
+ */
+void threadpool_parallel_morsels(ThreadPool* pool, size_t n, size_t morsel_size,
+                                 MorselFn fn, void* arg);
+
+void test_threadpool(void);
+
+#endif
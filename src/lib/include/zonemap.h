@@ -0,0 +1,61 @@
+#ifndef ZONEMAP_H
+#define ZONEMAP_H
+
+#include <stddef.h>
+
+/**
+ * @brief Per-zone min/max summary of an int array: zone `z` covers the values
+ * [z * zone_size, (z + 1) * zone_size). A scan can skip every zone whose [min, max] does
+ * not intersect its predicate, which pays off when the data is naturally clustered
+ * (e.g. time-ordered loads, or columns reordered by a clustered index).
+ *
+ * - `mins`, `maxs`: one entry per zone
+ * - `num_elements`: the number of values summarized; the last zone may be partial
+ * - `capacity`: the number of zones `mins` and `maxs` have room for
+ */
+typedef struct ZoneMap {
+  int* mins;
+  int* maxs;
+  size_t zone_size;
+  size_t num_elements;
+  size_t num_zones;
+  size_t capacity;
+} ZoneMap;
+
+/**
+ * @brief Summarizes `data[0..n)` in zones of `zone_size` values.
+ * @return ZoneMap* or NULL on failure
+ */
+ZoneMap* zonemap_build(const int* data, size_t n, size_t zone_size);
+
+/**
+ * @brief Accounts for `value` appended at position `num_elements` of the summarized
+ * array, widening the last zone or starting a new one.
+ * @return 0 on success, -1 on failure
+ */
+int zonemap_append(ZoneMap* zm, int value);
+
+/**
+ * @brief Whether any value at positions [start, end) may lie in [low, high] (inclusive),
+ * going by the zones overlapping that range.
+ */
+int zonemap_range_may_match(const ZoneMap* zm, size_t start, size_t end, int low,
+                            int high);
+
+/**
+ * @brief Writes the zone map to `path`, replacing the file.
+ * @return 0 on success, -1 on failure
+ */
+int zonemap_save(const ZoneMap* zm, const char* path);
+
+/**
+ * @brief Reads a zone map written by `zonemap_save`.
+ * @return ZoneMap* or NULL if the file is missing or malformed
+ */
+ZoneMap* zonemap_load(const char* path);
+
+void zonemap_free(ZoneMap* zm);
+
+void test_zonemap(void);
+
+#endif
@@ -0,0 +1,56 @@
+#include "join_test_utils.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int compare_pairs(const void* a, const void* b) {
+  uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+  return (x > y) - (x < y);
+}
+
+// A pair as one sortable number
+static uint64_t pair(int left, int right) {
+  return (uint64_t)(uint32_t)left << 32 | (uint32_t)right;
+}
+
+void check_nested_loop(const int* l_keys, size_t l_n, const int* r_keys, size_t r_n,
+                       const JoinResult* result) {
+  size_t n = 0;
+  for (size_t i = 0; i < l_n; i++) {
+    for (size_t j = 0; j < r_n; j++) n += l_keys[i] == r_keys[j];
+  }
+  assert(result->n == n);
+  uint64_t* expected = malloc(sizeof(uint64_t) * (n + 1));
+  uint64_t* actual = malloc(sizeof(uint64_t) * (n + 1));
+  n = 0;
+  for (size_t i = 0; i < l_n; i++) {
+    for (size_t j = 0; j < r_n; j++) {
+      if (l_keys[i] == r_keys[j]) expected[n++] = pair((int)i, (int)j);
+    }
+  }
+  for (size_t k = 0; k < n; k++) actual[k] = pair(result->left[k], result->right[k]);
+  qsort(expected, n, sizeof(uint64_t), compare_pairs);
+  qsort(actual, n, sizeof(uint64_t), compare_pairs);
+  assert(memcmp(expected, actual, sizeof(uint64_t) * n) == 0);
+  free(expected);
+  free(actual);
+}
+
+int* iota(size_t n) {
+  int* values = malloc(sizeof(int) * (n + 1));
+  for (size_t i = 0; i < n; i++) values[i] = (int)i;
+  return values;
+}
+
+JoinTestSide join_test_side(size_t n, int low, int high) {
+  JoinTestSide side = {malloc(sizeof(int) * (n + 1)), iota(n), n};
+  for (size_t i = 0; i < n; i++) side.keys[i] = low + rand() % (high - low);
+  return side;
+}
+
+void join_test_side_free(JoinTestSide* side) {
+  free(side->keys);
+  free(side->payloads);
+}
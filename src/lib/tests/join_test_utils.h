@@ -0,0 +1,30 @@
+#ifndef JOIN_TEST_UTILS_H
+#define JOIN_TEST_UTILS_H
+
+#include <stddef.h>
+
+#include "join_output.h"
+
+/**
+ * @brief Checks `result` holds exactly the pairs of a nested loop join of `l_keys` with
+ * `r_keys`, with payloads i and j, in any order.
+ */
+void check_nested_loop(const int* l_keys, size_t l_n, const int* r_keys, size_t r_n,
+                       const JoinResult* result);
+
+// The payloads 0, 1, ..., n - 1; the caller frees them
+int* iota(size_t n);
+
+// One side of a join under test: `n` keys, and a payload for each
+typedef struct JoinTestSide {
+  int* keys;
+  int* payloads;
+  size_t n;
+} JoinTestSide;
+
+// `n` keys drawn at random from [low, high), with the payloads 0, 1, ..., n - 1
+JoinTestSide join_test_side(size_t n, int low, int high);
+
+void join_test_side_free(JoinTestSide* side);
+
+#endif
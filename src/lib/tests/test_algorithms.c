@@ -1,8 +1,11 @@
+#define _GNU_SOURCE
 #include <assert.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 #include "algorithms.h"
+#include "threadpool.h"
 
 void test_sort(void) {
   // Test 1: Normal case with unsorted positive integers
@@ -139,4 +142,122 @@ void test_sort(void) {
     free(original_pos);
     printf("✅\n");
   }
+
+  // Test 9: lower/upper bounds, including duplicates and values outside the data
+  {
+    printf("test for sorted bounds...");
+    int data[] = {2, 2, 2, 5, 5, 6, 7, 7};
+    size_t n = sizeof(data) / sizeof(data[0]);
+    int probes[] = {INT_MIN, 1, 2, 3, 5, 6, 7, 8, INT_MAX};
+    for (size_t p = 0; p < sizeof(probes) / sizeof(probes[0]); p++) {
+      size_t lower = 0, upper = 0;
+      while (lower < n && data[lower] < probes[p]) lower++;
+      while (upper < n && data[upper] <= probes[p]) upper++;
+      assert(sorted_lower_bound(data, n, probes[p]) == lower);
+      assert(sorted_upper_bound(data, n, probes[p]) == upper);
+    }
+    assert(sorted_lower_bound(NULL, 0, 3) == 0 && sorted_upper_bound(NULL, 0, 3) == 0);
+    printf("✅\n");
+  }
+
+  // Test 10: run ends, for runs of every length up to past the galloping steps
+  {
+    printf("test for sorted run ends...");
+    size_t n = 0;
+    int data[2100];
+    for (int run = 1; n + run <= 2100; run++) {
+      for (int i = 0; i < run; i++) data[n++] = run;
+    }
+    for (size_t start = 0; start < n; start++) {
+      size_t end = start;
+      while (end < n && data[end] == data[start]) end++;
+      assert(sorted_run_end(data, n, start) == end);
+    }
+    int single[] = {4};
+    assert(sorted_run_end(single, 1, 0) == 1);
+    printf("✅\n");
+  }
+
+  // Test 11: Eytzinger bounds agree with binary search, whatever the size of the tree's
+  // last level, and however long the runs of duplicates
+  {
+    printf("test for eytzinger bounds...");
+    size_t sizes[] = {0, 1, 2, 3, 7, 8, 15, 16, 1000, 100000};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+      size_t n = sizes[s];
+      int* data = malloc(sizeof(int) * (n + 1));
+      int* keys = aligned_alloc(64, sizeof(int) * ((n + 16) / 16 * 16));
+      uint32_t* ranks = malloc(sizeof(uint32_t) * (n + 1));
+      int next = -50;
+      for (size_t i = 0; i < n; i++) {
+        next += rand() % 100 == 0 ? rand() % 3 : 0;  // long runs of few values
+        data[i] = next;
+      }
+      eytzinger_build(data, n, keys, ranks);
+      int last = n ? data[n - 1] : -50;
+      for (int value = -52; value <= last + 2; value++) {
+        assert(eytzinger_lower_bound(keys, ranks, n, value) ==
+               sorted_lower_bound(data, n, value));
+        assert(eytzinger_upper_bound(keys, ranks, n, value) ==
+               sorted_upper_bound(data, n, value));
+        if (n == 0) continue;
+        assert(binary_search_left(data, n, value) == sorted_lower_bound(data, n, value));
+        size_t upper = sorted_upper_bound(data, n, value);
+        assert(binary_search_right(data, n, value) == (upper ? upper - 1 : 0));
+      }
+      free(data);
+      free(keys);
+      free(ranks);
+    }
+
+    int extremes[] = {INT_MIN, INT_MIN, 0, INT_MAX, INT_MAX};
+    int keys[6] __attribute__((aligned(64)));
+    uint32_t ranks[6];
+    eytzinger_build(extremes, 5, keys, ranks);
+    assert(eytzinger_lower_bound(keys, ranks, 5, INT_MIN) == 0);
+    assert(eytzinger_upper_bound(keys, ranks, 5, INT_MIN) == 2);
+    assert(eytzinger_lower_bound(keys, ranks, 5, INT_MAX) == 3);
+    assert(eytzinger_upper_bound(keys, ranks, 5, INT_MAX) == 5);
+    printf("✅\n");
+  }
+
+  // Test 12: radix sort, single-threaded and on a pool, against a stable reference
+  {
+    printf("test for radix sort...");
+    ThreadPool* pool = threadpool_create(4);
+    size_t sizes[] = {1, 7, 1000, 300000};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+      size_t n = sizes[s];
+      int* base = malloc(sizeof(int) * n);
+      int* data = malloc(sizeof(int) * n);
+      int* positions = malloc(sizeof(int) * n);
+      // Full-range keys with the extremes, keys with shared high bytes, one distinct key
+      for (int shape = 0; shape < 3; shape++) {
+        for (size_t i = 0; i < n; i++) {
+          base[i] = shape == 0   ? (int)((unsigned)rand() * 2654435761u)
+                    : shape == 1 ? rand() % 700 - 350
+                                 : 42;
+        }
+        if (shape == 0 && n > 2) base[0] = INT_MIN, base[1] = INT_MAX, base[2] = INT_MIN;
+        for (int threaded = 0; threaded < 2; threaded++) {
+          for (size_t i = 0; i < n; i++) data[i] = base[i];
+          assert(radix_sort(data, n, positions, threaded ? pool : NULL) == 0);
+          for (size_t i = 0; i < n; i++) {
+            assert(data[i] == base[positions[i]]);
+            // Ascending, and equal keys keep their original order
+            if (i > 0) {
+              assert(data[i - 1] <= data[i]);
+              assert(data[i - 1] < data[i] || positions[i - 1] < positions[i]);
+            }
+          }
+        }
+      }
+      free(base);
+      free(data);
+      free(positions);
+    }
+    assert(radix_sort(NULL, 0, NULL, NULL) == 0);
+    threadpool_destroy(pool);
+    printf("✅\n");
+  }
 }
@@ -0,0 +1,58 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bitvector.h"
+
+void test_bitvector(void) {
+  size_t sizes[] = {0, 1, 63, 64, 65, 1000, 4096};
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    size_t n = sizes[s];
+    Bitvector* bv = bitvector_create(n);
+    assert(bv && bv->num_bits == n);
+    assert(bitvector_count(bv) == 0 && bitvector_next(bv, 0) == n);
+
+    // Set a random third of the bits, remembering which ones
+    char* expected = calloc(n + 1, 1);
+    size_t n_set = 0;
+    for (size_t i = 0; i < n; i++) {
+      if (rand() % 3 == 0) {
+        bitvector_set(bv, i);
+        expected[i] = 1;
+        n_set++;
+      }
+    }
+
+    // Test 1: test and count agree with what was set
+    for (size_t i = 0; i < n; i++) assert(bitvector_test(bv, i) == expected[i]);
+    assert(bitvector_count(bv) == n_set);
+
+    // Test 2: next visits exactly the set bits, in order
+    size_t visited = 0;
+    for (size_t i = bitvector_next(bv, 0); i < n; i = bitvector_next(bv, i + 1)) {
+      assert(expected[i]);
+      visited++;
+    }
+    assert(visited == n_set);
+
+    // Test 3: positions lists the set bits of a word range in order
+    int* positions = malloc(sizeof(int) * (n + 1));
+    size_t num_words = BITVECTOR_WORDS(n);
+    size_t k = bitvector_positions(bv, 0, num_words, positions);
+    assert(k == n_set);
+    for (size_t j = 0; j < k; j++) {
+      assert(expected[positions[j]]);
+      if (j > 0) assert(positions[j] > positions[j - 1]);
+    }
+    if (num_words > 1) {
+      size_t tail = bitvector_positions(bv, 1, num_words, positions);
+      assert(tail == bitvector_count_words(bv, 1, num_words));
+      assert(tail == 0 || positions[0] >= 64);
+    }
+
+    free(positions);
+    free(expected);
+    bitvector_free(bv);
+  }
+  printf("test for bitvector set/count/iterate...✅\n");
+}
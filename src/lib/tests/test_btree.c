@@ -1,85 +1,203 @@
 #include <assert.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 
+#include "algorithms.h"
 #include "btree.h"
+#include "simd.h"
 #include "test_helpers.h"
 #include "utils.h"
 
+// Index in the bulk loaded data of the element at `cursor`
+static size_t position(const Btree* tree, BtreeCursor cursor) {
+  return btree_cursor_rowid(tree, cursor);
+}
+
+// Inserts `n` random keys into `tree` (holding `ref_keys[0..n_ref)` so far, row ids
+// first), and checks its contents against a stable sort of the keys
+static void check_inserts(Btree* tree, int* ref_keys, size_t n_ref, size_t n, int range) {
+  for (size_t i = 0; i < n; i++) {
+    ref_keys[n_ref + i] = rand() % range - range / 2;
+    assert(btree_insert(tree, ref_keys[n_ref + i], n_ref + i) == 0);
+  }
+  size_t total = n_ref + n;
+  int* sorted = malloc(sizeof(int) * total);
+  int* order = malloc(sizeof(int) * total);
+  memcpy(sorted, ref_keys, sizeof(int) * total);
+  assert(radix_sort(sorted, total, order, NULL) == 0);
+
+  int* keys = malloc(sizeof(int) * total);
+  int* rowids = malloc(sizeof(int) * total);
+  assert(tree->n_elts == total);
+  assert(btree_range_copy(tree, btree_begin(tree), btree_end(), keys, rowids) == total);
+  for (size_t i = 0; i < total; i++) {
+    assert(keys[i] == sorted[i] && rowids[i] == order[i]);
+  }
+
+  // Bounds, as counts of the elements before them
+  for (int key = -range / 2 - 1; key <= range / 2 + 1; key += 1 + range / 200) {
+    BtreeCursor low = btree_lower_bound(tree, key), high = btree_upper_bound(tree, key);
+    size_t lower = sorted_lower_bound(sorted, total, key);
+    assert(btree_range_count(tree, btree_begin(tree), low) == lower);
+    assert(btree_range_count(tree, low, high) ==
+           sorted_upper_bound(sorted, total, key) - lower);
+  }
+  free(sorted);
+  free(order);
+  free(keys);
+  free(rowids);
+}
+
 void test_btree(void) {
   test_title("\nB-tree tests: \n");
   {
-    /* The Simple tree version: n_elements = 8, fanout = 2
-            B-tree structure:
-                    [child_ptr][10,50]
-                            |
-                [child_ptr][10,30,50,70]
-                     |
-        data        [10 20 30 40 50 60 70 80]
-        index       [ 0  1  2  3  4  5  6  7]
+    /* The Simple tree version: n_elements = 8, a single leaf
+        data    [10 20 30 40 50 60 70 80]
+        index   [ 0  1  2  3  4  5  6  7]
      */
-    test_sub_title("\nTest 1: Lookup in a B-tree with uniqe numbers; fanout 2\n");
+    test_sub_title("\nTest 1: Lookup in a B-tree with uniqe numbers\n");
     int data[] = {10, 20, 30, 40, 50, 60, 70, 80};
     size_t data_size = sizeof(data) / sizeof(data[0]);
-    int fanout = 2;
 
     // Initialize B-tree
-    Btree* tree = init_btree(data, data_size, fanout);
+    Btree* tree = btree_create(data, NULL, data_size);
     printf("\nB-tree structure:\n");
     print_tree(tree);
 
-    // Test exact matches (elements at fanout boundaries)
     for (size_t i = 0; i < data_size; i++) {
-      size_t pos_r = lookup(data[i], tree, 0);
-      size_t pos_l = lookup(data[i], tree, 1);
+      size_t pos_l = position(tree, btree_lower_bound(tree, data[i]));
+      size_t pos_r = position(tree, btree_upper_bound(tree, data[i]));
 
-      // since the data is unique, the left and right lookups should be the same
+      // since the data is unique, each value is a run of one
       assert_nice(pos_l, i, ", ");
-      assert_nice(pos_r, i, ", ");
+      assert_nice(pos_r, i + 1, ", ");
       printf("\n");
     }
+    free_btree(tree);
+  }
 
-    {
-      test_title("\nTest 4: Lookup in a B-tree with duplicate numbers; fanout 2\n");
-      int data[] = {2, 2, 2, 5, 5, 6, 7, 7};
-      size_t data_size = sizeof(data) / sizeof(data[0]);
-      int fanout = 2;
-      printf("Data: ");
-      for (size_t i = 0; i < data_size; i++) {
-        printf("%d ", data[i]);
-      }
-      printf("\n");
-      Btree* tree = init_btree(data, data_size, fanout);
-      printf("\nB-tree structure:\n");
-      print_tree(tree);
-
-      {
-        printf("checking bounds: ");
-        size_t pos_l = lookup(2, tree, 1);
-        size_t pos_r = lookup(2, tree, 0);
-        assert_nice(pos_l, 0, ", ");
-        assert_nice(pos_r, 2, ", ");
-      }
-      {
-        size_t pos_l = lookup(7, tree, 1);
-        size_t pos_r = lookup(7, tree, 0);
-        assert_nice(pos_l, 6, ", ");
-        assert_nice(pos_r, 7, "\n");
-      }
-      {
-        printf("checking middle duplicates: ");
-        size_t pos_l = lookup(5, tree, 1);
-        size_t pos_r = lookup(5, tree, 0);
-        assert_nice(pos_l, 3, ", ");
-        assert_nice(pos_r, 4, "\n");
+  {
+    test_title("\nTest 2: Lookup in a B-tree with duplicate numbers\n");
+    int data[] = {2, 2, 2, 5, 5, 6, 7, 7};
+    size_t data_size = sizeof(data) / sizeof(data[0]);
+    Btree* tree = btree_create(data, NULL, data_size);
+
+    printf("checking bounds: ");
+    assert_nice(position(tree, btree_lower_bound(tree, 2)), 0, ", ");
+    assert_nice(position(tree, btree_upper_bound(tree, 2)), 3, ", ");
+    assert_nice(position(tree, btree_lower_bound(tree, 7)), 6, ", ");
+    assert_nice(position(tree, btree_upper_bound(tree, 7)), 8, "\n");
+    printf("checking middle duplicates: ");
+    assert_nice(position(tree, btree_lower_bound(tree, 5)), 3, ", ");
+    assert_nice(position(tree, btree_upper_bound(tree, 5)), 5, "\n");
+    printf("checking missing values: ");
+    assert_nice(position(tree, btree_lower_bound(tree, 3)), 3, ", ");
+    assert_nice(position(tree, btree_upper_bound(tree, 9)), 8, "\n");
+    free_btree(tree);
+  }
+
+  {
+    test_title("\nTest 3: Range bounds agree with binary search on the data\n");
+    // Up to four levels of nodes, and sizes around whole leaves
+    size_t sizes[] = {0, 1, 2, 7, 48, 49, 576, 577, 5000, 100000};
+    SimdLevel detected = simd_level();
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+      size_t n = sizes[s];
+      int* data = malloc(sizeof(int) * (n + 1));
+      int next = -50;
+      for (size_t i = 0; i < n; i++) {
+        next += rand() % 3;  // sorted, with runs of duplicates
+        data[i] = next;
       }
-      {
-        printf("checking middle unique: ");
-        size_t pos_l = lookup(6, tree, 1);
-        size_t pos_r = lookup(6, tree, 0);
-        assert_nice(pos_l, 5, ", ");
-        assert_nice(pos_r, 5, "\n");
+      Btree* tree = btree_create(data, NULL, n);
+      int last = n ? data[n - 1] : -50;
+      for (int level = SIMD_SCALAR; level <= (int)detected; level++) {
+        simd_force_level((SimdLevel)level);
+        for (int key = -52; key <= last + 2; key++) {
+          assert(position(tree, btree_lower_bound(tree, key)) ==
+                 sorted_lower_bound(data, n, key));
+          assert(position(tree, btree_upper_bound(tree, key)) ==
+                 sorted_upper_bound(data, n, key));
+        }
       }
+      free_btree(tree);
+      free(data);
     }
+    simd_force_level(detected);
+
+    // Keys at the ends of the int range
+    int extremes[] = {INT_MIN, INT_MIN, 0, INT_MAX, INT_MAX};
+    Btree* tree = btree_create(extremes, NULL, 5);
+    assert(position(tree, btree_lower_bound(tree, INT_MIN)) == 0);
+    assert(position(tree, btree_upper_bound(tree, INT_MIN)) == 2);
+    assert(position(tree, btree_lower_bound(tree, INT_MAX)) == 3);
+    assert(position(tree, btree_upper_bound(tree, INT_MAX)) == 5);
+    assert(position(tree, btree_lower_bound(tree, 1)) == 3);
+    assert(position(tree, btree_upper_bound(tree, -1)) == 2);
+    free_btree(tree);
+    printf("test for btree range bounds...✅\n");
+  }
+
+  {
+    test_title("\nTest 4: Inserts split nodes and keep the tree in order\n");
+    size_t n = 200000;
+    int* ref_keys = malloc(sizeof(int) * 2 * n);
+
+    // From empty: every leaf and inner node is split at least once
+    Btree* tree = btree_create(NULL, NULL, 0);
+    check_inserts(tree, ref_keys, 0, n, 50000);
+    assert(tree->height >= 2);
+    free_btree(tree);
+
+    // Into a bulk loaded tree, with many duplicates of few keys
+    for (size_t i = 0; i < n; i++) ref_keys[i] = (int)(i / 100) - 500;
+    tree = btree_create(ref_keys, NULL, n);
+    size_t height = tree->height;
+    check_inserts(tree, ref_keys, n, n, 1000);
+    assert(tree->height >= height);
+    free_btree(tree);
+    free(ref_keys);
+
+    // Small key ranges at the ends of the int range
+    tree = btree_create(NULL, NULL, 0);
+    for (uint32_t i = 0; i < 1000; i++) {
+      assert(btree_insert(tree, i % 2 ? INT_MAX : INT_MIN, i) == 0);
+    }
+    assert(btree_range_count(tree, btree_lower_bound(tree, INT_MAX), btree_end()) == 500);
+    assert(position(tree, btree_lower_bound(tree, INT_MAX)) == 1);
+    assert(position(tree, btree_begin(tree)) == 0);
+    free_btree(tree);
+    printf("test for btree inserts...✅\n");
+  }
+
+  {
+    test_title("\nTest 5: A saved tree maps back, and takes inserts\n");
+    const char* path = "/tmp/cs165_test_btree.idx";
+    size_t n = 20000;
+    int* ref_keys = malloc(sizeof(int) * 2 * n);
+    for (size_t i = 0; i < n; i++) ref_keys[i] = (int)i * 2;
+    Btree* tree = btree_create(ref_keys, NULL, n);
+    assert(btree_save(tree, path, 42) == 0);
+    free_btree(tree);
+
+    uint64_t flags = 0;
+    tree = btree_load(path, &flags);
+    assert(tree && tree->file && tree->n_elts == n && flags == 42);
+    for (int key = -1; key <= (int)n * 2; key += 7) {
+      assert(position(tree, btree_lower_bound(tree, key)) == (size_t)(key + 1) / 2);
+    }
+    check_inserts(tree, ref_keys, n, n, (int)n);
+    assert(!tree->file);
+    free_btree(tree);
+
+    FILE* file = fopen(path, "r+b");
+    fputc(0, file);  // damaged header
+    fclose(file);
+    assert(!btree_load(path, NULL));
+    unlink(path);
+    free(ref_keys);
+    printf("test for btree save/load...✅\n");
   }
 }
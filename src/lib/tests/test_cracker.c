@@ -0,0 +1,117 @@
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cracker.h"
+
+// Checks that the cracker column still holds data[0..n) exactly, each value next to its
+// base position, and that every pivot separates smaller values from the rest
+static void check_cracker(const Cracker* cracker, const int* data, size_t n) {
+  assert(cracker->num_elements == n);
+  char* seen = calloc(n + 1, 1);
+  for (size_t i = 0; i < n; i++) {
+    int position = cracker->positions[i];
+    assert(position >= 0 && (size_t)position < n && !seen[position]);
+    seen[position] = 1;
+    assert(cracker->values[i] == data[position]);
+  }
+  free(seen);
+
+  const CrackerNode* stack[128];
+  size_t depth = 0;
+  if (cracker->root) stack[depth++] = cracker->root;
+  while (depth > 0) {
+    const CrackerNode* node = stack[--depth];
+    for (size_t i = 0; i < n; i++) {
+      assert((i < node->position) == (cracker->values[i] < node->pivot));
+    }
+    if (node->left) stack[depth++] = node->left;
+    if (node->right) stack[depth++] = node->right;
+  }
+}
+
+// Checks that [start, end) of the cracker column holds exactly the values in [low, high]
+static void check_select(const Cracker* cracker, const int* data, size_t n, int low,
+                         int high, size_t start, size_t end) {
+  size_t expected = 0;
+  for (size_t i = 0; i < n; i++) expected += data[i] >= low && data[i] <= high;
+  assert(end - start == expected);
+  for (size_t i = start; i < end; i++) {
+    assert(cracker->values[i] >= low && cracker->values[i] <= high);
+  }
+}
+
+void test_cracker(void) {
+  size_t n = 5000;
+  int* data = malloc(sizeof(int) * (2 * n));
+  for (size_t i = 0; i < n; i++) data[i] = rand() % 1000 - 500;
+
+  // Test 1: range selects return exactly the qualifying values and keep every pivot valid
+  {
+    printf("test for cracker selects...");
+    Cracker* cracker = cracker_create(data, n);
+    assert(cracker);
+    for (int q = 0; q < 200; q++) {
+      int low = rand() % 1200 - 600;
+      int high = low + rand() % 300;
+      size_t start, end;
+      cracker_select(cracker, low, high, &start, &end);
+      check_select(cracker, data, n, low, high, start, end);
+      if (q % 20 == 0) check_cracker(cracker, data, n);
+    }
+    check_cracker(cracker, data, n);
+
+    // Repeating a query cracks nothing new
+    size_t start, end;
+    cracker_select(cracker, -100, 100, &start, &end);
+    size_t num_pivots = cracker->num_pivots;
+    cracker_select(cracker, -100, 100, &start, &end);
+    assert(cracker->num_pivots == num_pivots);
+
+    // Open-ended and empty ranges
+    cracker_select(cracker, INT_MIN, INT_MAX, &start, &end);
+    assert(start == 0 && end == n);
+    cracker_select(cracker, 10, 9, &start, &end);
+    assert(start == end);
+    cracker_free(cracker);
+    printf("✅\n");
+  }
+
+  // Test 2: inserts ripple into the right piece, between and after cracks
+  {
+    printf("test for cracker inserts...");
+    Cracker* cracker = cracker_create(data, n);
+    assert(cracker);
+    for (size_t i = n; i < 2 * n; i++) {
+      data[i] = rand() % 1000 - 500;
+      assert(cracker_insert(cracker, data[i], (int)i) == 0);
+      if (i % 50 == 0) {
+        int low = rand() % 1000 - 500;
+        size_t start, end;
+        cracker_select(cracker, low, low + 50, &start, &end);
+        check_select(cracker, data, i + 1, low, low + 50, start, end);
+      }
+    }
+    check_cracker(cracker, data, 2 * n);
+    cracker_free(cracker);
+    printf("✅\n");
+  }
+
+  // Test 3: an empty column
+  {
+    printf("test for cracker on empty column...");
+    Cracker* cracker = cracker_create(NULL, 0);
+    assert(cracker);
+    size_t start, end;
+    cracker_select(cracker, 0, 10, &start, &end);
+    assert(start == 0 && end == 0);
+    assert(cracker_insert(cracker, 5, 0) == 0);
+    cracker_select(cracker, 0, 10, &start, &end);
+    assert(start == 0 && end == 1 && cracker->positions[0] == 0);
+    cracker_free(cracker);
+    printf("✅\n");
+  }
+
+  free(data);
+}
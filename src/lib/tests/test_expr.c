@@ -0,0 +1,134 @@
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "expr.h"
+
+#define VALUES(a) {.kind = EXPR_VALUES, .values = (a)}
+#define CONSTANT(c) {.kind = EXPR_CONSTANT, .constant = (c)}
+#define OP(o) {.kind = EXPR_OP, .op = (o)}
+
+// Evaluates row `row` of `steps` one value at a time, wrapping like 32-bit ints
+static int eval_row(const ExprStep* steps, size_t num_steps, size_t row) {
+  int stack[EXPR_MAX_DEPTH];
+  size_t depth = 0;
+  for (size_t i = 0; i < num_steps; i++) {
+    if (steps[i].kind == EXPR_VALUES) {
+      stack[depth++] = steps[i].values[row];
+      continue;
+    }
+    if (steps[i].kind == EXPR_CONSTANT) {
+      stack[depth++] = steps[i].constant;
+      continue;
+    }
+    assert(depth >= 2);
+    long y = stack[--depth], x = stack[--depth];
+    long result = steps[i].op == ARITH_ADD   ? x + y
+                  : steps[i].op == ARITH_SUB ? x - y
+                  : steps[i].op == ARITH_MUL ? x * y
+                                             : x / y;
+    stack[depth++] = (int)(unsigned)result;
+  }
+  return stack[0];
+}
+
+// Checks rows [offset, offset + n) of `steps` against the row-at-a-time evaluation
+static void check_expr(const ExprStep* steps, size_t num_steps, size_t offset, size_t n) {
+  int* out = malloc(sizeof(int) * (n + 1));
+  ValueStats stats = {0, INT_MAX, INT_MIN};
+  assert(expr_eval(steps, num_steps, offset, n, out, &stats) == 0);
+
+  int64_t sum = 0;
+  int min_value = INT_MAX, max_value = INT_MIN;
+  for (size_t i = 0; i < n; i++) {
+    assert(out[i] == eval_row(steps, num_steps, offset + i));
+    sum += out[i];
+    min_value = out[i] < min_value ? out[i] : min_value;
+    max_value = out[i] > max_value ? out[i] : max_value;
+  }
+  assert(stats.sum == sum && stats.min == min_value && stats.max == max_value);
+  free(out);
+}
+
+void test_expr(void) {
+  size_t n = 3 * EXPR_BLOCK_SIZE + 77;
+  int* a = malloc(sizeof(int) * n);
+  int* b = malloc(sizeof(int) * n);
+  int* c = malloc(sizeof(int) * n);
+  for (size_t i = 0; i < n; i++) {
+    a[i] = rand() % 2001 - 1000;
+    b[i] = rand() % 100 + 1;  // never zero: a divisor below
+    c[i] = rand() - RAND_MAX / 2;
+  }
+
+  // Test 1: expressions over arrays and constants, across blocks and at an offset
+  {
+    printf("test for expression evaluation...");
+    ExprStep simple[] = {VALUES(a), VALUES(b), OP(ARITH_ADD), VALUES(c), CONSTANT(2),
+                         OP(ARITH_MUL), OP(ARITH_SUB)};  // a+b-c*2
+    check_expr(simple, 7, 0, n);
+    check_expr(simple, 7, 5, n - 5);
+    check_expr(simple, 7, 0, 3);
+
+    ExprStep nested[] = {VALUES(a), VALUES(c), OP(ARITH_SUB), VALUES(c),
+                         CONSTANT(-3), OP(ARITH_ADD), OP(ARITH_MUL), VALUES(b),
+                         OP(ARITH_DIV)};  // (a-c)*(c+-3)/b
+    check_expr(nested, 9, 0, n);
+
+    // a-(b-(c-(a-(b-(c-(a-b)))))): seven levels of temporaries
+    ExprStep deep[] = {VALUES(a), VALUES(b), VALUES(c), VALUES(a), VALUES(b),
+                       VALUES(c), VALUES(a), VALUES(b), OP(ARITH_SUB), OP(ARITH_SUB),
+                       OP(ARITH_SUB), OP(ARITH_SUB), OP(ARITH_SUB), OP(ARITH_SUB),
+                       OP(ARITH_SUB)};
+    assert(expr_depth(deep, 15) == EXPR_MAX_DEPTH);
+    check_expr(deep, 15, 0, n);
+    printf("✅\n");
+  }
+
+  // Test 2: constant subexpressions fold, and lone operands are copied out
+  {
+    printf("test for constant folding and lone operands...");
+    ExprStep folded[] = {CONSTANT(2), CONSTANT(3), OP(ARITH_MUL), VALUES(a),
+                         OP(ARITH_ADD)};  // 2*3+a
+    check_expr(folded, 5, 0, n);
+    ExprStep lone[] = {VALUES(c)};
+    check_expr(lone, 1, 0, n);
+    ExprStep constant[] = {CONSTANT(7), CONSTANT(-2), OP(ARITH_DIV)};
+    check_expr(constant, 3, 0, n);
+    printf("✅\n");
+  }
+
+  // Test 3: zero divisors and malformed expressions fail
+  {
+    printf("test for expression errors...");
+    int* out = malloc(sizeof(int) * n);
+    ValueStats stats = {0, INT_MAX, INT_MIN};
+    ExprStep by_zero[] = {VALUES(a), VALUES(a), VALUES(a), OP(ARITH_SUB),
+                          OP(ARITH_DIV)};  // a/(a-a)
+    assert(expr_eval(by_zero, 5, 0, n, out, &stats) == -1);
+    ExprStep constant_zero[] = {VALUES(a), CONSTANT(1), CONSTANT(1), OP(ARITH_SUB),
+                                OP(ARITH_DIV)};  // a/(1-1)
+    assert(expr_eval(constant_zero, 5, 0, n, out, &stats) == -1);
+
+    ExprStep missing[] = {VALUES(a), OP(ARITH_ADD)};
+    assert(expr_depth(missing, 2) == -1);
+    assert(expr_eval(missing, 2, 0, n, out, &stats) == -1);
+    ExprStep extra[] = {VALUES(a), VALUES(b)};
+    assert(expr_depth(extra, 2) == -1);
+    ExprStep too_deep[EXPR_MAX_DEPTH * 2 + 1];
+    for (size_t i = 0; i <= EXPR_MAX_DEPTH; i++) too_deep[i] = (ExprStep)VALUES(a);
+    for (size_t i = 0; i < EXPR_MAX_DEPTH; i++) {
+      too_deep[EXPR_MAX_DEPTH + 1 + i] = (ExprStep)OP(ARITH_ADD);
+    }
+    assert(expr_depth(too_deep, EXPR_MAX_DEPTH * 2 + 1) == EXPR_MAX_DEPTH + 1);
+    assert(expr_eval(too_deep, EXPR_MAX_DEPTH * 2 + 1, 0, n, out, &stats) == -1);
+    free(out);
+    printf("✅\n");
+  }
+
+  free(a);
+  free(b);
+  free(c);
+}
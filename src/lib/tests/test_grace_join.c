@@ -0,0 +1,107 @@
+#include <assert.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "grace_join.h"
+#include "join_test_utils.h"
+#include "threadpool.h"
+
+#define SPILL_DIR "/tmp/cs165_test_grace_join"
+
+// Number of entries in SPILL_DIR besides . and ..
+static size_t spill_dir_entries(void) {
+  DIR* dir = opendir(SPILL_DIR);
+  assert(dir);
+  size_t n = 0;
+  for (struct dirent* entry; (entry = readdir(dir));) n += entry->d_name[0] != '.';
+  closedir(dir);
+  return n;
+}
+
+void test_grace_join(void) {
+  mkdir(SPILL_DIR, 0755);
+  ThreadPool* pool = threadpool_create(4);
+
+  // Test 1: build sides over the budget, spilled and joined partition by partition;
+  // either side the smaller one; one in memory for comparison
+  {
+    printf("test for grace join spilling to disk...");
+    size_t sizes[][2] = {{3000, 5000}, {5000, 3000}, {1, 4000}, {2500, 2500}};
+    size_t budgets[] = {GRACE_JOIN_BUILD_BYTES * 100, GRACE_JOIN_BUILD_BYTES * 1000,
+                        (size_t)1 << 30};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+      JoinTestSide l = join_test_side(sizes[s][0], -500, 1500);
+      JoinTestSide r = join_test_side(sizes[s][1], -500, 2500);
+      for (size_t b = 0; b < sizeof(budgets) / sizeof(budgets[0]); b++) {
+        for (int threaded = 0; threaded < 2; threaded++) {
+          JoinResult result;
+          assert(grace_join(l.keys, l.payloads, l.n, r.keys, r.payloads, r.n, budgets[b],
+                            SPILL_DIR, threaded ? pool : NULL, &result) == 0);
+          check_nested_loop(l.keys, l.n, r.keys, r.n, &result);
+          join_result_free(&result);
+        }
+      }
+      join_test_side_free(&l);
+      join_test_side_free(&r);
+    }
+    assert(spill_dir_entries() == 0);
+    printf("✅\n");
+  }
+
+  // Test 2: skew no partitioning can split, a key on most of the build side, joined in
+  // chunks of the budget; and a budget too small for even one tuple
+  {
+    printf("test for grace join with skewed partitions...");
+    size_t l_n = 3000, r_n = 4000;
+    int* l_keys = malloc(sizeof(int) * l_n);
+    int* r_keys = malloc(sizeof(int) * r_n);
+    for (size_t i = 0; i < l_n; i++) l_keys[i] = i % 10 ? 42 : (int)i;
+    for (size_t j = 0; j < r_n; j++) r_keys[j] = j % 3 ? 42 : (int)j;
+    int* payloads = iota(r_n);
+    size_t budgets[] = {GRACE_JOIN_BUILD_BYTES * 64, 1};
+    for (size_t b = 0; b < sizeof(budgets) / sizeof(budgets[0]); b++) {
+      JoinResult result;
+      assert(grace_join(l_keys, payloads, l_n, r_keys, payloads, r_n, budgets[b],
+                        SPILL_DIR, pool, &result) == 0);
+      check_nested_loop(l_keys, l_n, r_keys, r_n, &result);
+      join_result_free(&result);
+    }
+    free(l_keys);
+    free(r_keys);
+    free(payloads);
+    printf("✅\n");
+  }
+
+  // Test 3: large inputs two levels of partitioning deep, and a spill directory that
+  // does not exist
+  {
+    printf("test for large grace joins...");
+    JoinTestSide l = join_test_side(300000, 0, 1000000);
+    JoinTestSide r = join_test_side(1000000, 0, 2000000);
+    JoinResult result, expected;
+    assert(grace_join(l.keys, l.payloads, l.n, r.keys, r.payloads, r.n, (size_t)1 << 30,
+                      SPILL_DIR, pool, &expected) == 0);
+    size_t budget = l.n * GRACE_JOIN_BUILD_BYTES / 1000;
+    assert(grace_join(l.keys, l.payloads, l.n, r.keys, r.payloads, r.n, budget, SPILL_DIR,
+                      pool, &result) == 0);
+    assert(result.n == expected.n);
+    for (size_t k = 0; k < result.n; k++) {
+      assert(l.keys[result.left[k]] == r.keys[result.right[k]]);
+    }
+    join_result_free(&result);
+    join_result_free(&expected);
+    assert(spill_dir_entries() == 0);
+
+    assert(grace_join(l.keys, l.payloads, l.n, r.keys, r.payloads, r.n, budget,
+                      SPILL_DIR "/missing", pool, &result) == -1);
+    assert(result.n == 0 && result.left == NULL);
+    join_test_side_free(&l);
+    join_test_side_free(&r);
+    printf("✅\n");
+  }
+  threadpool_destroy(pool);
+  rmdir(SPILL_DIR);
+}
@@ -0,0 +1,99 @@
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "group_table.h"
+
+// Checks the groups of `gt` against a direct aggregation of keys in [0, num_keys)
+static void check_groups(const GroupTable* gt, const int* keys, const int* values,
+                         size_t n, int num_keys) {
+  GroupEntry* groups = malloc(sizeof(GroupEntry) * (gt->num_groups + 1));
+  size_t num_groups = group_table_sorted(gt, groups);
+  assert(num_groups == gt->num_groups);
+
+  size_t g = 0;
+  for (int key = 0; key < num_keys; key++) {
+    int64_t count = 0, sum = 0;
+    int min_value = INT_MAX, max_value = INT_MIN;
+    for (size_t i = 0; i < n; i++) {
+      if (keys[i] != key) continue;
+      count++;
+      sum += values[i];
+      min_value = values[i] < min_value ? values[i] : min_value;
+      max_value = values[i] > max_value ? values[i] : max_value;
+    }
+    if (count == 0) continue;
+    assert(g < num_groups && groups[g].key == key);
+    assert(groups[g].count == count && groups[g].sum == sum);
+    assert(groups[g].min == min_value && groups[g].max == max_value);
+    g++;
+  }
+  assert(g == num_groups);
+  free(groups);
+}
+
+void test_group_table(void) {
+  size_t n = 20000;
+  int num_keys = 1000;
+  int* keys = malloc(sizeof(int) * n);
+  int* values = malloc(sizeof(int) * n);
+  for (size_t i = 0; i < n; i++) {
+    keys[i] = rand() % num_keys;
+    values[i] = rand() - RAND_MAX / 2;
+  }
+  values[3] = INT_MIN;
+  values[5] = INT_MAX;
+
+  // Test 1: aggregates match a direct aggregation, growing from a small table
+  {
+    printf("test for group table aggregates...");
+    GroupTable* gt = group_table_create(1);
+    assert(gt);
+    assert(group_table_add(gt, keys, values, n) == 0);
+    assert(gt->num_groups <= (size_t)num_keys && 2 * gt->num_groups <= gt->capacity);
+    check_groups(gt, keys, values, n, num_keys);
+    group_table_free(gt);
+    printf("✅\n");
+  }
+
+  // Test 2: merging thread-local tables gives the aggregates of the whole input
+  {
+    printf("test for group table merges...");
+    GroupTable* parts[3];
+    for (int p = 0; p < 3; p++) {
+      parts[p] = group_table_create(num_keys);
+      assert(parts[p]);
+      size_t start = p * n / 3, end = (p + 1) * n / 3;
+      assert(group_table_add(parts[p], keys + start, values + start, end - start) == 0);
+    }
+    GroupTable* merged = group_table_create(1);
+    for (int p = 0; p < 3; p++) {
+      assert(group_table_merge(merged, parts[p]) == 0);
+      group_table_free(parts[p]);
+    }
+    check_groups(merged, keys, values, n, num_keys);
+    group_table_free(merged);
+    printf("✅\n");
+  }
+
+  // Test 3: negative and extreme keys, and an empty table
+  {
+    printf("test for group table keys...");
+    int odd_keys[] = {INT_MIN, -1, 0, INT_MAX, -1, INT_MIN};
+    int odd_values[] = {1, 2, 3, 4, 5, 6};
+    GroupTable* gt = group_table_create(0);
+    GroupEntry groups[6];
+    assert(group_table_sorted(gt, groups) == 0);
+    assert(group_table_add(gt, odd_keys, odd_values, 6) == 0);
+    assert(group_table_sorted(gt, groups) == 4);
+    assert(groups[0].key == INT_MIN && groups[0].count == 2 && groups[0].sum == 7);
+    assert(groups[1].key == -1 && groups[1].min == 2 && groups[1].max == 5);
+    assert(groups[3].key == INT_MAX && groups[3].count == 1);
+    group_table_free(gt);
+    printf("✅\n");
+  }
+
+  free(keys);
+  free(values);
+}
@@ -1,6 +1,8 @@
 #include <assert.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include "hash_table.h"
@@ -64,5 +66,70 @@ int test_hashmap(void) {
   assert(!failure);
   printf("Passed tests for erasing.\n");
   printf("All tests have been successfully passed.\n");
+
+  // Duplicates, growth from the smallest table, and bulk loading, against a reference:
+  // value v of key k is k * n + (its index among the values of k), so every key's values
+  // are known and in insertion order
+  size_t n = 100000, n_keys = 3000;
+  keyType* bulk_keys = malloc(sizeof(keyType) * n);
+  valType* bulk_values = malloc(sizeof(valType) * n);
+  size_t* seen = calloc(n_keys, sizeof(size_t));
+  for (size_t i = 0; i < n; i++) {
+    size_t k = (size_t)rand() % n_keys;
+    bulk_keys[i] = (keyType)(k << 20);  // keys that differ in their high bits only
+    bulk_values[i] = (valType)(k * n + seen[k]++);
+  }
+  {
+    printf("test for duplicate keys and bulk loading...");
+    hashtable *one = NULL, *bulk = NULL;
+    assert(allocate(&one, 1) == 0 && allocate(&bulk, 1) == 0);
+    for (size_t i = 0; i < n; i++) assert(put(one, bulk_keys[i], bulk_values[i]) == 0);
+    assert(bulk_put(bulk, bulk_keys, bulk_values, n) == 0);
+    assert(bulk->arena_size == n);
+    for (size_t k = 0; k < n_keys; k++) {
+      size_t count_one = 0, count_bulk = 0;
+      const valType* run_one = get_values(one, (keyType)(k << 20), &count_one);
+      const valType* run_bulk = get_values(bulk, (keyType)(k << 20), &count_bulk);
+      assert(count_one == seen[k] && count_bulk == seen[k]);
+      for (size_t v = 0; v < seen[k]; v++) {
+        assert(run_one[v] == (valType)(k * n + v) && run_bulk[v] == run_one[v]);
+      }
+      int first = 0, num = 0;
+      assert(get(bulk, (keyType)(k << 20), &first, 1, &num) == 0);
+      assert((size_t)num == seen[k] && (!num || first == (valType)(k * n)));
+    }
+    size_t missing = 0;
+    assert(get_values(bulk, 1, &missing) == NULL && missing == 0);
+
+    // Bulk loading into a table that has keys appends like `put`
+    assert(bulk_put(one, bulk_keys, bulk_values, n) == 0);
+    size_t count = 0;
+    const valType* run = get_values(one, bulk_keys[0], &count);
+    assert(count == 2 * seen[(uint32_t)bulk_keys[0] >> 20] && run[count / 2] == run[0]);
+    deallocate(one);
+    deallocate(bulk);
+    printf("✅\n");
+  }
+
+  {
+    printf("test for erasing from probe runs...");
+    hashtable* table = NULL;
+    assert(allocate(&table, 16) == 0);
+    for (size_t i = 0; i < n; i++) assert(put(table, bulk_keys[i], bulk_values[i]) == 0);
+    for (size_t k = 0; k < n_keys; k += 2) assert(erase(table, (keyType)(k << 20)) == 0);
+    for (size_t k = 0; k < n_keys; k++) {
+      size_t count = 0;
+      get_values(table, (keyType)(k << 20), &count);
+      assert(count == (k % 2 ? seen[k] : 0));
+    }
+    assert(put(table, 0, 42) == 0);
+    size_t count = 0;
+    assert(get_values(table, 0, &count)[0] == 42 && count == 1);
+    deallocate(table);
+    printf("✅\n");
+  }
+  free(bulk_keys);
+  free(bulk_values);
+  free(seen);
   return 0;
 }
@@ -0,0 +1,61 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "index_file.h"
+
+#define TEST_MAGIC 0x54455354  // "TEST"
+
+void test_index_file(void) {
+  const char* path = "/tmp/cs165_test_index_file.idx";
+  size_t n = 1000;
+  int* values = malloc(sizeof(int) * n);
+  for (size_t i = 0; i < n; i++) values[i] = rand();
+  const char name[] = "col1";
+  uint64_t meta[INDEX_FILE_META] = {n, 1, 2, 3};
+  const void* sections[INDEX_FILE_SECTIONS] = {name, NULL, values, NULL};
+  size_t sizes[INDEX_FILE_SECTIONS] = {sizeof(name), 0, sizeof(int) * n, 0};
+
+  // Test 1: sections map back aligned, with the header as written
+  {
+    printf("test for index file round trip...");
+    assert(index_file_write(path, TEST_MAGIC, meta, sections, sizes) == 0);
+    IndexFile* file = index_file_map(path, TEST_MAGIC);
+    assert(file);
+    assert(memcmp(file->header.meta, meta, sizeof(meta)) == 0);
+    assert(strcmp(file->sections[0], name) == 0 && !file->sections[1]);
+    assert((size_t)file->sections[2] % INDEX_FILE_ALIGN == 0);
+    assert(memcmp(file->sections[2], values, sizeof(int) * n) == 0);
+
+    // Copy-on-write: writes to the mapping never reach the file
+    ((int*)file->sections[2])[0] = ~values[0];
+    index_file_unmap(file);
+    file = index_file_map(path, TEST_MAGIC);
+    assert(((int*)file->sections[2])[0] == values[0]);
+    index_file_unmap(file);
+    printf("✅\n");
+  }
+
+  // Test 2: files of another kind, or damaged ones, don't map
+  {
+    printf("test for index file validation...");
+    assert(!index_file_map(path, TEST_MAGIC + 1));
+    assert(!index_file_map("/tmp/cs165_test_no_such_file.idx", TEST_MAGIC));
+
+    FILE* file = fopen(path, "r+b");
+    fseek(file, offsetof(IndexFileHeader, meta), SEEK_SET);
+    fputc(0x7f, file);  // damaged header
+    fclose(file);
+    assert(!index_file_map(path, TEST_MAGIC));
+
+    assert(index_file_write(path, TEST_MAGIC, meta, sections, sizes) == 0);
+    assert(truncate(path, sizeof(IndexFileHeader) + 100) == 0);
+    assert(!index_file_map(path, TEST_MAGIC));
+    unlink(path);
+    printf("✅\n");
+  }
+  free(values);
+}
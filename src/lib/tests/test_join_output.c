@@ -0,0 +1,75 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "join_output.h"
+#include "threadpool.h"
+
+// Writes pairs (i, -i) for i in [start, end), as many times as i % 3
+static void emit_range(JoinOutput* out, size_t start, size_t end) {
+  for (size_t i = start; i < end; i++) {
+    for (size_t k = 0; k < i % 3; k++) {
+      assert(join_output_emit(out, (int)i, -(int)i) == 0);
+    }
+  }
+}
+
+static void emit_morsel(void* arg, size_t worker, size_t morsel, size_t start,
+                        size_t end) {
+  (void)worker;
+  emit_range(&((JoinOutput*)arg)[morsel], start, end);
+}
+
+// Checks `result` holds the pairs `emit_range` writes for [0, n), in order
+static void check_result(const JoinResult* result, size_t n) {
+  size_t k = 0;
+  for (size_t i = 0; i < n; i++) {
+    for (size_t j = 0; j < i % 3; j++, k++) {
+      assert(result->left[k] == (int)i && result->right[k] == -(int)i);
+    }
+  }
+  assert(result->n == k);
+}
+
+void test_join_output(void) {
+  // Test 1: one output across many chunks, and empty outputs
+  {
+    printf("test for growing a join output...");
+    size_t n = 3 * 33333;
+    JoinOutput out = {0};
+    emit_range(&out, 0, n);
+    assert(join_output_size(&out) == n);  // 0 + 1 + 2 pairs per 3 values of i
+    assert(out.n_chunks > 1 && out.n_chunks < JOIN_OUTPUT_MAX_CHUNKS);
+    JoinResult result;
+    assert(join_output_concat(&out, 1, &result) == 0);
+    assert(out.n_chunks == 0 && join_output_size(&out) == 0);
+    check_result(&result, n);
+    join_result_free(&result);
+
+    JoinOutput empty[3];
+    memset(empty, 0, sizeof(empty));
+    assert(join_output_concat(empty, 3, &result) == 0);
+    assert(result.n == 0 && result.left && result.right);
+    join_result_free(&result);
+    assert(result.left == NULL && result.n == 0);
+    printf("✅\n");
+  }
+
+  // Test 2: one output per morsel, written in parallel, concatenated in morsel order
+  {
+    printf("test for concatenating parallel join outputs...");
+    ThreadPool* pool = threadpool_create(4);
+    size_t n = 300000, morsel_size = 4096;
+    size_t n_morsels = threadpool_num_morsels(n, morsel_size);
+    JoinOutput* outputs = calloc(n_morsels, sizeof(JoinOutput));
+    threadpool_parallel_morsels(pool, n, morsel_size, emit_morsel, outputs);
+    JoinResult result;
+    assert(join_output_concat(outputs, n_morsels, &result) == 0);
+    check_result(&result, n);
+    join_result_free(&result);
+    free(outputs);
+    threadpool_destroy(pool);
+    printf("✅\n");
+  }
+}
@@ -0,0 +1,77 @@
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "join_planner.h"
+
+#define GIB ((size_t)1 << 30)
+
+static JoinSideStats side(size_t n, size_t distinct, int sorted, size_t index_n) {
+  return (JoinSideStats){n, distinct, sorted, index_n};
+}
+
+void test_join_planner(void) {
+  // Test 1: distinct counts, exact on small inputs and close on large ones
+  {
+    printf("test for distinct count estimates...");
+    assert(estimate_distinct(NULL, 0) == 0);
+    int small[] = {5, 3, 5, 5, -1, 3, 8};
+    assert(estimate_distinct(small, 7) == 4);
+
+    size_t n = 1000000;
+    int* keys = malloc(sizeof(int) * n);
+    size_t distincts[] = {1, 100, 5000, n};
+    for (size_t d = 0; d < sizeof(distincts) / sizeof(distincts[0]); d++) {
+      for (size_t i = 0; i < n; i++) keys[i] = rand() % (int)distincts[d];
+      if (distincts[d] == n) {
+        for (size_t i = 0; i < n; i++) keys[i] = (int)(i * 7919 % n);
+      }
+      size_t estimate = estimate_distinct(keys, n);
+      assert(estimate * 2 >= distincts[d] && estimate <= distincts[d] * 2);
+    }
+    free(keys);
+    printf("✅\n");
+  }
+
+  // Test 2: the cheapest algorithm for each shape of input, and the side it builds on
+  {
+    printf("test for join plans...");
+    JoinSideStats tiny = side(100, 100, 0, 0), large = side(4000000, 4000000, 0, 0);
+    JoinPlan plan = plan_join(&tiny, &tiny, GIB);
+    assert(plan.algorithm == JOIN_ALGO_NESTED_LOOP);
+
+    // A small side stays in the cache as one table, whichever side it is
+    plan = plan_join(&large, &tiny, GIB);
+    assert(plan.algorithm == JOIN_ALGO_HASH && plan.build_side == 1);
+    plan = plan_join(&tiny, &large, GIB);
+    assert(plan.algorithm == JOIN_ALGO_HASH && plan.build_side == 0);
+
+    // Two large sides are partitioned, unless the build side has few keys, which keeps
+    // its table small
+    plan = plan_join(&large, &large, GIB);
+    assert(plan.algorithm == JOIN_ALGO_RADIX);
+    JoinSideStats few_keys = side(4000000, 1000, 0, 0);
+    plan = plan_join(&few_keys, &large, GIB);
+    assert(plan.algorithm == JOIN_ALGO_HASH && plan.build_side == 0);
+
+    // Sides in order are merged, and a build side over the budget spills
+    JoinSideStats sorted = side(4000000, 4000000, 1, 4000000);
+    plan = plan_join(&sorted, &sorted, GIB);
+    assert(plan.algorithm == JOIN_ALGO_SORT_MERGE);
+    plan = plan_join(&large, &large, 4000000);
+    assert(plan.algorithm == JOIN_ALGO_GRACE);
+    assert(isinf(plan.costs[JOIN_ALGO_HASH]) && isinf(plan.costs[JOIN_ALGO_RADIX]));
+
+    // A few lookups into an index beat reading the whole of a large side
+    JoinSideStats indexed = side(4000000, 4000000, 0, 4000000);
+    JoinSideStats few = side(1000, 1000, 0, 0);
+    plan = plan_join(&few, &indexed, GIB);
+    assert(plan.algorithm == JOIN_ALGO_INDEX_NESTED_LOOP && plan.build_side == 1);
+    plan = plan_join(&indexed, &few, GIB);
+    assert(plan.algorithm == JOIN_ALGO_INDEX_NESTED_LOOP && plan.build_side == 0);
+    plan = plan_join(&indexed, &large, GIB);
+    assert(plan.algorithm == JOIN_ALGO_RADIX);
+    printf("✅\n");
+  }
+}
@@ -0,0 +1,129 @@
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "algorithms.h"
+#include "join_test_utils.h"
+#include "radix_join.h"
+#include "threadpool.h"
+
+// Number of pairs with equal keys, by merging the sorted keys of both sides
+static size_t count_matches(const int* l_keys, size_t l_n, const int* r_keys,
+                            size_t r_n) {
+  int* l = malloc(sizeof(int) * l_n);
+  int* r = malloc(sizeof(int) * r_n);
+  int* positions = malloc(sizeof(int) * (l_n > r_n ? l_n : r_n));
+  memcpy(l, l_keys, sizeof(int) * l_n);
+  memcpy(r, r_keys, sizeof(int) * r_n);
+  radix_sort(l, l_n, positions, NULL);
+  radix_sort(r, r_n, positions, NULL);
+  size_t count = 0;
+  for (size_t i = 0, j = 0; i < l_n && j < r_n;) {
+    if (l[i] < r[j]) {
+      i++;
+    } else if (l[i] > r[j]) {
+      j++;
+    } else {
+      size_t i_end = i, j_end = j;
+      while (i_end < l_n && l[i_end] == l[i]) i_end++;
+      while (j_end < r_n && r[j_end] == r[j]) j_end++;
+      count += (i_end - i) * (j_end - j);
+      i = i_end;
+      j = j_end;
+    }
+  }
+  free(l);
+  free(r);
+  free(positions);
+  return count;
+}
+
+void test_radix_join(void) {
+  ThreadPool* pool = threadpool_create(4);
+  // No partitioning, one pass, and two passes (the second within partitions)
+  size_t bits[] = {0, 3, RADIX_JOIN_PASS_BITS, 10, RADIX_JOIN_MAX_BITS};
+  size_t n_bits = sizeof(bits) / sizeof(bits[0]);
+
+  // Test 1: many duplicates on both sides, either side the smaller one
+  {
+    printf("test for radix join with duplicates...");
+    size_t sizes[][2] = {{3000, 5000}, {5000, 3000}, {1, 4000}, {2000, 2000}};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+      JoinTestSide l = join_test_side(sizes[s][0], -100, 200);
+      JoinTestSide r = join_test_side(sizes[s][1], -100, 300);
+      for (size_t b = 0; b < n_bits; b++) {
+        for (int threaded = 0; threaded < 2; threaded++) {
+          JoinResult result;
+          assert(radix_join(l.keys, l.payloads, l.n, r.keys, r.payloads, r.n, bits[b],
+                            threaded ? pool : NULL, &result) == 0);
+          check_nested_loop(l.keys, l.n, r.keys, r.n, &result);
+          join_result_free(&result);
+        }
+      }
+      join_test_side_free(&l);
+      join_test_side_free(&r);
+    }
+    printf("✅\n");
+  }
+
+  // Test 2: keys the hash must spread (multiples of a large power of two, the int
+  // extremes), and empty sides
+  {
+    printf("test for radix join edge cases...");
+    size_t n = 2000;
+    int* l_keys = malloc(sizeof(int) * n);
+    int* r_keys = malloc(sizeof(int) * n);
+    for (size_t i = 0; i < n; i++) {
+      l_keys[i] = (int)((i % 500) << 20);
+      r_keys[i] = i % 7 == 0 ? INT_MIN : i % 7 == 1 ? INT_MAX : (int)((i % 700) << 20);
+    }
+    l_keys[0] = INT_MAX;
+    l_keys[1] = INT_MIN;
+    int* payloads = iota(n);
+    for (size_t b = 0; b < n_bits; b++) {
+      JoinResult result;
+      assert(radix_join(l_keys, payloads, n, r_keys, payloads, n, bits[b], pool,
+                        &result) == 0);
+      check_nested_loop(l_keys, n, r_keys, n, &result);
+      join_result_free(&result);
+      assert(radix_join(l_keys, payloads, n, r_keys, payloads, 0, bits[b], pool,
+                        &result) == 0);
+      assert(result.n == 0);
+      assert(radix_join(NULL, NULL, 0, r_keys, payloads, n, bits[b], pool, &result) == 0);
+      assert(result.n == 0);
+    }
+    free(l_keys);
+    free(r_keys);
+    free(payloads);
+    printf("✅\n");
+  }
+
+  // Test 3: large inputs, at the number of bits the cache size calls for
+  {
+    printf("test for large radix joins...");
+    JoinTestSide l = join_test_side(400000, 0, 1000000);
+    JoinTestSide r = join_test_side(1000000, 0, 2000000);
+    size_t expected = count_matches(l.keys, l.n, r.keys, r.n);
+    size_t cache_bits = radix_join_bits(l.n);
+    assert(radix_join_bits(0) == 0);
+    assert(radix_join_bits(SIZE_MAX / RADIX_JOIN_TUPLE_BYTES) == RADIX_JOIN_MAX_BITS);
+    size_t large_bits[] = {0, cache_bits, RADIX_JOIN_MAX_BITS};
+    for (size_t b = 0; b < sizeof(large_bits) / sizeof(large_bits[0]); b++) {
+      JoinResult result;
+      assert(radix_join(l.keys, l.payloads, l.n, r.keys, r.payloads, r.n, large_bits[b],
+                        pool, &result) == 0);
+      assert(result.n == expected);
+      for (size_t k = 0; k < result.n; k++) {
+        assert(l.keys[result.left[k]] == r.keys[result.right[k]]);
+      }
+      join_result_free(&result);
+    }
+    join_test_side_free(&l);
+    join_test_side_free(&r);
+    printf("✅\n");
+  }
+  threadpool_destroy(pool);
+}
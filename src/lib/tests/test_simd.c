@@ -0,0 +1,266 @@
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "simd.h"
+
+static const char* level_names[] = {"scalar", "avx2", "avx512"};
+
+// Reference implementation the kernels are checked against
+static size_t naive_select(const int* data, size_t n, long low, long high,
+                           const int* posns, size_t base, int* out) {
+  size_t k = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (data[i] >= low && data[i] <= high) out[k++] = posns ? posns[i] : (int)(base + i);
+  }
+  return k;
+}
+
+static void check_select(const int* data, size_t n, long low, long high,
+                         const int* posns, size_t base) {
+  int* expected = malloc(sizeof(int) * (n + 1));
+  int* found = malloc(sizeof(int) * (n + 1));
+  ScanPredicate pred = scan_predicate(low, high);
+
+  size_t n_expected = naive_select(data, n, low, high, posns, base, expected);
+  size_t n_found = simd_select(data, n, &pred, posns, base, found);
+  assert(n_found == n_expected);
+  for (size_t i = 0; i < n_found; i++) assert(found[i] == expected[i]);
+
+  free(expected);
+  free(found);
+}
+
+static void check_select_bitmap(const int* data, size_t n, long low, long high) {
+  size_t num_words = (n + 63) / 64;
+  uint64_t* words = malloc(sizeof(uint64_t) * (num_words + 1));
+  for (size_t w = 0; w <= num_words; w++) words[w] = ~0ULL;  // must be overwritten
+  ScanPredicate pred = scan_predicate(low, high);
+
+  size_t n_found = simd_select_bitmap(data, n, &pred, words);
+  size_t n_expected = 0;
+  for (size_t i = 0; i < num_words * 64; i++) {
+    int expected = i < n && data[i] >= low && data[i] <= high;
+    assert((int)((words[i / 64] >> (i % 64)) & 1) == expected);
+    n_expected += expected;
+  }
+  assert(n_found == n_expected);
+  assert(words[num_words] == ~0ULL);  // nothing written past the last word
+
+  free(words);
+}
+
+// Checks a gather of `posns` (or a copy of values[0..n) if NULL) against a plain loop
+static void check_gather(const int* values, const int* posns, size_t n) {
+  int* found = malloc(sizeof(int) * (n + 1));
+  int64_t sum = 0;
+  int min_value = INT_MAX, max_value = INT_MIN;
+  for (size_t i = 0; i < n; i++) {
+    int value = values[posns ? posns[i] : (int)i];
+    sum += value;
+    min_value = value < min_value ? value : min_value;
+    max_value = value > max_value ? value : max_value;
+  }
+
+  ValueStats stats = {0, INT_MAX, INT_MIN};
+  ValueStats stats_only = {0, INT_MAX, INT_MIN};
+  if (posns) {
+    simd_gather(values, posns, n, found, &stats);
+    simd_gather(values, posns, n, NULL, &stats_only);
+  } else {
+    simd_copy(values, n, found, &stats);
+    simd_copy(values, n, NULL, &stats_only);
+  }
+  for (size_t i = 0; i < n; i++) assert(found[i] == values[posns ? posns[i] : (int)i]);
+  assert(stats.sum == sum && stats.min == min_value && stats.max == max_value);
+  assert(stats_only.sum == sum && stats_only.min == min_value &&
+         stats_only.max == max_value);
+  free(found);
+}
+
+// Checks a multi-column gather of `num_columns` columns, column c starting at
+// `values + c`, against a plain loop per column
+static void check_gather_columns(const int* values, size_t num_columns, const int* posns,
+                                 size_t n) {
+  const int* columns[num_columns];
+  int* outs[num_columns];
+  ValueStats stats[num_columns];
+  for (size_t c = 0; c < num_columns; c++) {
+    columns[c] = values + c;
+    outs[c] = malloc(sizeof(int) * (n + 1));
+    stats[c] = (ValueStats){0, INT_MAX, INT_MIN};
+  }
+  simd_gather_columns(columns, num_columns, posns, n, outs, stats);
+  for (size_t c = 0; c < num_columns; c++) {
+    int64_t sum = 0;
+    int min_value = INT_MAX, max_value = INT_MIN;
+    for (size_t i = 0; i < n; i++) {
+      int value = columns[c][posns[i]];
+      assert(outs[c][i] == value);
+      sum += value;
+      min_value = value < min_value ? value : min_value;
+      max_value = value > max_value ? value : max_value;
+    }
+    assert(stats[c].sum == sum && stats[c].min == min_value && stats[c].max == max_value);
+    free(outs[c]);
+  }
+}
+
+// Checks `simd_arith` of every op against a plain loop, for array and constant operands
+static void check_arith(const int* lhs, const int* rhs, size_t n) {
+  int* out = malloc(sizeof(int) * (n + 1));
+  int constants[] = {7, -3, 1};
+  for (int op = ARITH_ADD; op <= ARITH_DIV; op++) {
+    for (int form = 0; form < 3; form++) {
+      // Array op array, array op constant, constant op array
+      ArithOperand a = {form == 2 ? NULL : lhs, constants[form]};
+      ArithOperand b = {form == 1 ? NULL : rhs, constants[form]};
+      ValueStats stats = {0, INT_MAX, INT_MIN};
+      assert(simd_arith((ArithOp)op, a, b, n, out, &stats) == 0);
+
+      int64_t sum = 0;
+      int min_value = INT_MAX, max_value = INT_MIN;
+      for (size_t i = 0; i < n; i++) {
+        long x = a.values ? a.values[i] : a.constant;
+        long y = b.values ? b.values[i] : b.constant;
+        long expected = op == ARITH_ADD   ? x + y
+                        : op == ARITH_SUB ? x - y
+                        : op == ARITH_MUL ? x * y
+                                          : x / y;
+        assert(out[i] == (int)(unsigned)expected);
+        sum += out[i];
+        min_value = out[i] < min_value ? out[i] : min_value;
+        max_value = out[i] > max_value ? out[i] : max_value;
+      }
+      assert(stats.sum == sum && stats.min == min_value && stats.max == max_value);
+    }
+  }
+  free(out);
+}
+
+void test_simd(void) {
+  // Test 1: predicate shapes
+  {
+    printf("test for predicate shapes...");
+    assert(scan_predicate(LONG_MIN, 9).shape == SCAN_LE);
+    assert(scan_predicate(3, LONG_MAX).shape == SCAN_GE);
+    assert(scan_predicate(3, 9).shape == SCAN_BETWEEN);
+    assert(scan_predicate(3, 3).shape == SCAN_EQ);
+    assert(scan_predicate(9, 3).shape == SCAN_NONE);
+    assert(scan_predicate((long)INT_MAX + 1, LONG_MAX).shape == SCAN_NONE);
+    printf("✅\n");
+  }
+
+  // Test 2: every kernel agrees with the naive scan, including tails and int limits
+  SimdLevel detected = simd_level();
+  for (int level = SIMD_SCALAR; level <= (int)detected; level++) {
+    simd_force_level((SimdLevel)level);
+    printf("test for %s select kernels...", level_names[level]);
+
+    size_t sizes[] = {0, 1, 7, 8, 15, 16, 17, 33, 64, 65, 1000, 4099};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+      size_t n = sizes[s];
+      int* data = malloc(sizeof(int) * (n + 1));
+      int* posns = malloc(sizeof(int) * (n + 1));
+      for (size_t i = 0; i < n; i++) {
+        data[i] = rand() % 200 - 100;
+        posns[i] = rand();
+      }
+      if (n > 2) {
+        data[0] = INT_MIN;
+        data[n - 1] = INT_MAX;
+      }
+
+      long bounds[][2] = {{LONG_MIN, 0},  {LONG_MIN, -101}, {0, LONG_MAX},
+                          {-20, 20},      {5, 5},           {50, 40},
+                          {LONG_MIN, LONG_MAX}, {INT_MIN, INT_MIN}, {INT_MAX, LONG_MAX}};
+      for (size_t b = 0; b < sizeof(bounds) / sizeof(bounds[0]); b++) {
+        check_select(data, n, bounds[b][0], bounds[b][1], NULL, 0);
+        check_select(data, n, bounds[b][0], bounds[b][1], NULL, 1000);
+        check_select(data, n, bounds[b][0], bounds[b][1], posns, 0);
+        check_select_bitmap(data, n, bounds[b][0], bounds[b][1]);
+      }
+      free(data);
+      free(posns);
+    }
+    printf("✅\n");
+  }
+
+  // Test 3: every gather kernel agrees with a plain loop, on random, dense and mixed
+  // position lists
+  for (int level = SIMD_SCALAR; level <= (int)detected; level++) {
+    simd_force_level((SimdLevel)level);
+    printf("test for %s gather kernels...", level_names[level]);
+
+    size_t num_values = 10000;
+    // Room past the end for the shifted columns of the multi-column gathers
+    int* values = malloc(sizeof(int) * (num_values + 16));
+    for (size_t i = 0; i < num_values + 16; i++) values[i] = rand() - RAND_MAX / 2;
+    values[7] = INT_MIN;
+    values[9] = INT_MAX;
+
+    size_t sizes[] = {0, 1, 7, 8, 15, 16, 17, 100, 1000, 4099};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+      size_t n = sizes[s];
+      int* posns = malloc(sizeof(int) * (n + 1));
+      for (size_t i = 0; i < n; i++) posns[i] = rand() % num_values;
+      check_gather(values, posns, n);
+      check_gather_columns(values, 3, posns, n);
+      for (size_t i = 0; i < n; i++) posns[i] = (int)(i + 3);
+      check_gather(values, posns, n);
+      // Dense runs of 40 broken up by jumps, out of step with the vector width
+      for (size_t i = 0; i < n; i++) posns[i] = (int)((i / 40) * 100 % 9000 + i % 40);
+      check_gather(values, posns, n);
+      check_gather(values, NULL, n);
+      // More columns than one pass of the multi-column kernel gathers
+      check_gather_columns(values, 3, posns, n);
+      check_gather_columns(values, 11, posns, n);
+      free(posns);
+    }
+    free(values);
+    printf("✅\n");
+  }
+  // Test 4: every arithmetic kernel agrees with a plain loop, including overflow and
+  // negative division, and rejects zero divisors
+  for (int level = SIMD_SCALAR; level <= (int)detected; level++) {
+    simd_force_level((SimdLevel)level);
+    printf("test for %s arithmetic kernels...", level_names[level]);
+
+    size_t sizes[] = {0, 1, 7, 8, 15, 16, 17, 100, 1000};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+      size_t n = sizes[s];
+      int* lhs = malloc(sizeof(int) * (n + 1));
+      int* rhs = malloc(sizeof(int) * (n + 1));
+      for (size_t i = 0; i < n; i++) {
+        lhs[i] = rand() - RAND_MAX / 2;
+        rhs[i] = rand() % 2000 - 1000;
+        if (rhs[i] == 0) rhs[i] = 1;
+      }
+      if (n > 3) {
+        lhs[0] = INT_MIN;
+        rhs[0] = -1;
+        lhs[1] = INT_MAX;
+        rhs[1] = 2;
+        lhs[2] = -7;
+        rhs[2] = 2;
+      }
+      check_arith(lhs, rhs, n);
+
+      if (n > 0) {
+        int out[1000];
+        ValueStats stats = {0, INT_MAX, INT_MIN};
+        rhs[n - 1] = 0;
+        ArithOperand a = {lhs, 0}, b = {rhs, 0};
+        assert(simd_arith(ARITH_DIV, a, b, n, out, &stats) == -1);
+        b = (ArithOperand){NULL, 0};
+        assert(simd_arith(ARITH_DIV, a, b, n, out, &stats) == -1);
+      }
+      free(lhs);
+      free(rhs);
+    }
+    printf("✅\n");
+  }
+  simd_force_level(detected);
+}
@@ -0,0 +1,129 @@
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "algorithms.h"
+#include "join_test_utils.h"
+#include "sort_merge_join.h"
+#include "threadpool.h"
+
+// Checks `result` lists its pairs in ascending order of their keys
+static void check_ascending(const int* l_keys, const JoinResult* result) {
+  for (size_t k = 1; k < result->n; k++) {
+    assert(l_keys[result->left[k - 1]] <= l_keys[result->left[k]]);
+  }
+}
+
+// Sorts `keys` and permutes `payloads` along with them
+static void sort_side(int* keys, int* payloads, size_t n) {
+  int* positions = malloc(sizeof(int) * (n + 1));
+  int* sorted_payloads = malloc(sizeof(int) * (n + 1));
+  radix_sort(keys, n, positions, NULL);
+  for (size_t i = 0; i < n; i++) sorted_payloads[i] = payloads[positions[i]];
+  memcpy(payloads, sorted_payloads, sizeof(int) * n);
+  free(positions);
+  free(sorted_payloads);
+}
+
+void test_sort_merge_join(void) {
+  ThreadPool* pool = threadpool_create(4);
+
+  // Test 1: unsorted sides with many duplicates, either side the larger one
+  {
+    printf("test for sort-merge join with duplicates...");
+    size_t sizes[][2] = {{3000, 5000}, {5000, 3000}, {1, 4000}, {40000, 7}};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+      JoinTestSide l = join_test_side(sizes[s][0], -100, 200);
+      JoinTestSide r = join_test_side(sizes[s][1], -100, 300);
+      for (int threaded = 0; threaded < 2; threaded++) {
+        JoinResult result;
+        assert(sort_merge_join(l.keys, l.payloads, l.n, 0, r.keys, r.payloads, r.n, 0,
+                               threaded ? pool : NULL, &result) == 0);
+        check_nested_loop(l.keys, l.n, r.keys, r.n, &result);
+        check_ascending(l.keys, &result);
+        join_result_free(&result);
+      }
+      join_test_side_free(&l);
+      join_test_side_free(&r);
+    }
+    printf("✅\n");
+  }
+
+  // Test 2: sides already sorted, whether the caller says so or not; a run of one key
+  // across many pieces of the merge; the int extremes; empty sides
+  {
+    printf("test for sort-merge join of sorted sides...");
+    size_t l_n = 3 * SORT_MERGE_JOIN_MORSEL, r_n = 3000;
+    int* l_keys = malloc(sizeof(int) * l_n);
+    int* r_keys = malloc(sizeof(int) * r_n);
+    for (size_t i = 0; i < l_n; i++) {
+      l_keys[i] = i % 2       ? 7
+                  : i % 11 == 0 ? INT_MIN
+                  : i % 13 == 0 ? INT_MAX
+                                : (int)i % 500;
+    }
+    for (size_t j = 0; j < r_n; j++) {
+      r_keys[j] = j % 20 == 0  ? 7
+                  : j % 7 == 0 ? INT_MIN
+                  : j % 9 == 0 ? INT_MAX
+                               : (int)j;
+    }
+    int* l_payloads = iota(l_n);
+    int* r_payloads = iota(r_n);
+    sort_side(l_keys, l_payloads, l_n);
+    sort_side(r_keys, r_payloads, r_n);
+    for (int flagged = 0; flagged < 2; flagged++) {
+      JoinResult result;
+      assert(sort_merge_join(l_keys, l_payloads, l_n, flagged, r_keys, r_payloads, r_n,
+                             flagged, pool, &result) == 0);
+      // Payloads are positions in the sorted sides, so the nested loop runs over those
+      int* l_by_payload = malloc(sizeof(int) * l_n);
+      int* r_by_payload = malloc(sizeof(int) * r_n);
+      for (size_t i = 0; i < l_n; i++) l_by_payload[l_payloads[i]] = l_keys[i];
+      for (size_t j = 0; j < r_n; j++) r_by_payload[r_payloads[j]] = r_keys[j];
+      check_nested_loop(l_by_payload, l_n, r_by_payload, r_n, &result);
+      check_ascending(l_by_payload, &result);
+      free(l_by_payload);
+      free(r_by_payload);
+      join_result_free(&result);
+    }
+    JoinResult result;
+    assert(sort_merge_join(l_keys, l_payloads, l_n, 1, r_keys, r_payloads, 0, 1, pool,
+                           &result) == 0);
+    assert(result.n == 0 && result.left && result.right);
+    join_result_free(&result);
+    free(l_keys);
+    free(r_keys);
+    free(l_payloads);
+    free(r_payloads);
+    printf("✅\n");
+  }
+
+  // Test 3: large inputs, one sorted and one not
+  {
+    printf("test for large sort-merge joins...");
+    size_t l_n = 400000;
+    int* l_keys = malloc(sizeof(int) * l_n);
+    for (size_t i = 0; i < l_n; i++) l_keys[i] = (int)(i * 5 / 2);
+    int* l_payloads = iota(l_n);
+    JoinTestSide r = join_test_side(1000000, 0, 1000000);
+    JoinResult result;
+    assert(sort_merge_join(l_keys, l_payloads, l_n, 1, r.keys, r.payloads, r.n, 0, pool,
+                           &result) == 0);
+    size_t expected = 0;
+    for (size_t j = 0; j < r.n; j++) expected += r.keys[j] % 5 == 0 || r.keys[j] % 5 == 2;
+    assert(result.n == expected);
+    for (size_t k = 0; k < result.n; k++) {
+      assert(l_keys[result.left[k]] == r.keys[result.right[k]]);
+      assert(k == 0 || result.left[k - 1] <= result.left[k]);
+    }
+    join_result_free(&result);
+    free(l_keys);
+    free(l_payloads);
+    join_test_side_free(&r);
+    printf("✅\n");
+  }
+  threadpool_destroy(pool);
+}
@@ -0,0 +1,204 @@
+#include <assert.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "threadpool.h"
+
+typedef struct {
+  pthread_mutex_t lock;
+  long total;
+} Counter;
+
+static void add_one(void* arg) {
+  Counter* counter = (Counter*)arg;
+  pthread_mutex_lock(&counter->lock);
+  counter->total++;
+  pthread_mutex_unlock(&counter->lock);
+}
+
+static void* square(void* arg) {
+  long* x = (long*)arg;
+  *x = *x * *x;
+  return x;
+}
+
+// Writes each index into its own slot and records which chunk covered it
+typedef struct {
+  int* slots;
+  size_t* chunk_of;
+} RangeCheck;
+
+static void fill_range(void* arg, size_t chunk, size_t start, size_t end) {
+  RangeCheck* check = (RangeCheck*)arg;
+  for (size_t i = start; i < end; i++) {
+    check->slots[i]++;
+    check->chunk_of[i] = chunk;
+  }
+}
+
+// A task that forks sub-tasks and waits for them, as a nested parallel section would
+typedef struct {
+  ThreadPool* pool;
+  Counter* counter;
+} NestedArgs;
+
+static void fork_and_wait(void* arg) {
+  NestedArgs* nested = (NestedArgs*)arg;
+  TaskGroup group;
+  taskgroup_init(&group, nested->pool);
+  for (int i = 0; i < 8; i++) {
+    threadpool_submit(nested->pool, &group, add_one, nested->counter);
+  }
+  taskgroup_wait(&group);
+  taskgroup_destroy(&group);
+}
+
+typedef struct {
+  int* slots;
+  size_t morsel_size;
+  size_t n_workers;
+  size_t n_morsels;
+  long done;
+} MorselCheck;
+
+static void fill_morsel(void* arg, size_t worker, size_t morsel, size_t start,
+                        size_t end) {
+  MorselCheck* check = (MorselCheck*)arg;
+  assert(worker < check->n_workers);
+  assert(start == morsel * check->morsel_size && end > start);
+  for (size_t i = start; i < end; i++) check->slots[i]++;
+  __atomic_add_fetch(&check->done, 1, __ATOMIC_SEQ_CST);
+}
+
+// The caller's first morsel only finishes once every other morsel is done, which can
+// only happen if the rest of its run gets stolen
+static void stall_first_morsel(void* arg, size_t worker, size_t morsel, size_t start,
+                               size_t end) {
+  MorselCheck* check = (MorselCheck*)arg;
+  if (morsel == 0) {
+    while (__atomic_load_n(&check->done, __ATOMIC_SEQ_CST) < (long)check->n_morsels - 1) {
+      sched_yield();
+    }
+  }
+  fill_morsel(arg, worker, morsel, start, end);
+}
+
+static void check_parallel_morsels(ThreadPool* pool, size_t n, size_t morsel_size,
+                                   MorselFn fn) {
+  MorselCheck check = {calloc(n + 1, sizeof(int)), morsel_size,
+                       threadpool_morsel_workers(pool),
+                       threadpool_num_morsels(n, morsel_size), 0};
+  threadpool_parallel_morsels(pool, n, morsel_size, fn, &check);
+  assert(check.done == (long)check.n_morsels);
+  for (size_t i = 0; i < n; i++) assert(check.slots[i] == 1);
+  free(check.slots);
+}
+
+static void check_parallel_for(ThreadPool* pool, size_t n, size_t n_chunks) {
+  RangeCheck check = {calloc(n + 1, sizeof(int)), calloc(n + 1, sizeof(size_t))};
+  threadpool_parallel_for(pool, n, n_chunks, fill_range, &check);
+  for (size_t i = 0; i < n; i++) {
+    assert(check.slots[i] == 1);
+    // chunks are contiguous and in increasing order
+    if (i > 0) assert(check.chunk_of[i] >= check.chunk_of[i - 1]);
+    assert(check.chunk_of[i] < (n_chunks ? n_chunks : 1));
+  }
+  free(check.slots);
+  free(check.chunk_of);
+}
+
+void test_threadpool(void) {
+  size_t worker_counts[] = {1, 4};
+  for (size_t w = 0; w < sizeof(worker_counts) / sizeof(worker_counts[0]); w++) {
+    ThreadPool* pool = threadpool_create(worker_counts[w]);
+    assert(pool && threadpool_size(pool) == worker_counts[w]);
+
+    // Test 1: a task group waits for every submitted task
+    {
+      printf("test for task groups (%zu workers)...", worker_counts[w]);
+      Counter counter = {PTHREAD_MUTEX_INITIALIZER, 0};
+      TaskGroup group;
+      taskgroup_init(&group, pool);
+      for (int i = 0; i < 1000; i++) {
+        assert(threadpool_submit(pool, &group, add_one, &counter) == 0);
+      }
+      taskgroup_wait(&group);
+      taskgroup_destroy(&group);
+      assert(counter.total == 1000);
+      printf("✅\n");
+    }
+
+    // Test 2: futures return their task's result
+    {
+      printf("test for futures (%zu workers)...", worker_counts[w]);
+      long values[16];
+      Future* futures[16];
+      for (long i = 0; i < 16; i++) {
+        values[i] = i;
+        futures[i] = threadpool_async(pool, square, &values[i]);
+      }
+      for (long i = 0; i < 16; i++) {
+        long* result = future_get(futures[i]);
+        assert(result == &values[i] && *result == i * i);
+      }
+      printf("✅\n");
+    }
+
+    // Test 3: parallel_for covers every index exactly once, in chunk order
+    {
+      printf("test for parallel_for (%zu workers)...", worker_counts[w]);
+      size_t sizes[] = {0, 1, 3, 100, 10007};
+      size_t chunks[] = {0, 1, 3, 8, 64};
+      for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+          check_parallel_for(pool, sizes[s], chunks[c]);
+        }
+      }
+      printf("✅\n");
+    }
+
+    // Test 4: morsels cover every index exactly once, and idle workers steal
+    {
+      printf("test for morsel scheduling (%zu workers)...", worker_counts[w]);
+      size_t sizes[] = {0, 1, 100, 10007, 100000};
+      size_t morsel_sizes[] = {1, 7, 1024};
+      for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        for (size_t m = 0; m < sizeof(morsel_sizes) / sizeof(morsel_sizes[0]); m++) {
+          check_parallel_morsels(pool, sizes[s], morsel_sizes[m], fill_morsel);
+        }
+      }
+      check_parallel_morsels(pool, 100000, 1000, stall_first_morsel);
+      printf("✅\n");
+    }
+
+    // Test 5: tasks waiting on their own sub-tasks don't deadlock the pool
+    {
+      printf("test for nested task groups (%zu workers)...", worker_counts[w]);
+      Counter counter = {PTHREAD_MUTEX_INITIALIZER, 0};
+      NestedArgs nested = {pool, &counter};
+      TaskGroup group;
+      taskgroup_init(&group, pool);
+      for (int i = 0; i < 16; i++) {
+        threadpool_submit(pool, &group, fork_and_wait, &nested);
+      }
+      taskgroup_wait(&group);
+      taskgroup_destroy(&group);
+      assert(counter.total == 16 * 8);
+      printf("✅\n");
+    }
+
+    threadpool_destroy(pool);
+  }
+
+  // Test 6: without a pool everything runs inline on the caller
+  {
+    printf("test for running without a pool...");
+    Counter counter = {PTHREAD_MUTEX_INITIALIZER, 0};
+    assert(threadpool_submit(NULL, NULL, add_one, &counter) == 0);
+    assert(counter.total == 1);
+    check_parallel_for(NULL, 1000, 4);
+    check_parallel_morsels(NULL, 1000, 64, fill_morsel);
+    printf("✅\n");
+  }
+}
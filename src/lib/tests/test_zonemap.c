@@ -0,0 +1,104 @@
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "zonemap.h"
+
+// Reference: whether any value in data[start..end) lies in [low, high]
+static int naive_may_match(const int* data, size_t start, size_t end, int low, int high) {
+  for (size_t i = start; i < end; i++) {
+    if (data[i] >= low && data[i] <= high) return 1;
+  }
+  return 0;
+}
+
+static void check_zones(const ZoneMap* zm, const int* data, size_t n) {
+  assert(zm->num_elements == n);
+  assert(zm->num_zones == (n + zm->zone_size - 1) / zm->zone_size);
+  for (size_t z = 0; z < zm->num_zones; z++) {
+    size_t start = z * zm->zone_size;
+    size_t end = start + zm->zone_size < n ? start + zm->zone_size : n;
+    int min_value = INT_MAX, max_value = INT_MIN;
+    for (size_t i = start; i < end; i++) {
+      min_value = data[i] < min_value ? data[i] : min_value;
+      max_value = data[i] > max_value ? data[i] : max_value;
+    }
+    assert(zm->mins[z] == min_value && zm->maxs[z] == max_value);
+  }
+}
+
+void test_zonemap(void) {
+  // Time-ordered data with some noise, as the zone maps are meant for
+  size_t n = 10000;
+  int* data = malloc(sizeof(int) * n);
+  for (size_t i = 0; i < n; i++) data[i] = (int)i + rand() % 50;
+
+  // Test 1: build summarizes every zone, including a partial last one
+  {
+    printf("test for zonemap build...");
+    size_t zone_sizes[] = {1, 64, 1000, 1024, 20000};
+    for (size_t s = 0; s < sizeof(zone_sizes) / sizeof(zone_sizes[0]); s++) {
+      ZoneMap* zm = zonemap_build(data, n, zone_sizes[s]);
+      assert(zm);
+      check_zones(zm, data, n);
+      zonemap_free(zm);
+    }
+    ZoneMap* empty = zonemap_build(NULL, 0, 64);
+    assert(empty && empty->num_zones == 0);
+    assert(!zonemap_range_may_match(empty, 0, 0, INT_MIN, INT_MAX));
+    zonemap_free(empty);
+    printf("✅\n");
+  }
+
+  // Test 2: appending keeps the zones as if they were built from scratch
+  {
+    printf("test for zonemap append...");
+    ZoneMap* zm = zonemap_build(data, 0, 64);
+    for (size_t i = 0; i < n; i++) {
+      assert(zonemap_append(zm, data[i]) == 0);
+      if (i % 997 == 0) check_zones(zm, data, i + 1);
+    }
+    check_zones(zm, data, n);
+    zonemap_free(zm);
+    printf("✅\n");
+  }
+
+  // Test 3: no zone that holds a match is ever skipped, and far-off ranges are
+  {
+    printf("test for zonemap skipping...");
+    ZoneMap* zm = zonemap_build(data, n, 256);
+    for (int t = 0; t < 2000; t++) {
+      size_t start = rand() % n, end = start + rand() % 3000;
+      if (end > n) end = n;
+      int low = rand() % 11000 - 500, high = low + rand() % 300;
+      if (naive_may_match(data, start, end, low, high)) {
+        assert(zonemap_range_may_match(zm, start, end, low, high));
+      }
+    }
+    assert(!zonemap_range_may_match(zm, 0, 256, 5000, 6000));
+    assert(!zonemap_range_may_match(zm, 0, n, INT_MIN, -1));
+    assert(zonemap_range_may_match(zm, 0, n + 1, INT_MIN, -1));  // unknown tail
+    zonemap_free(zm);
+    printf("✅\n");
+  }
+
+  // Test 4: a saved zone map loads back identical
+  {
+    printf("test for zonemap save/load...");
+    const char* path = "test_zonemap.zones";
+    ZoneMap* zm = zonemap_build(data, n, 100);
+    assert(zonemap_save(zm, path) == 0);
+    ZoneMap* loaded = zonemap_load(path);
+    assert(loaded && loaded->zone_size == 100);
+    check_zones(loaded, data, n);
+    assert(zonemap_append(loaded, INT_MIN) == 0);
+    zonemap_free(zm);
+    zonemap_free(loaded);
+    remove(path);
+    assert(zonemap_load(path) == NULL);
+    printf("✅\n");
+  }
+
+  free(data);
+}
@@ -1,8 +1,21 @@
 #include <stdio.h>
 
 #include "algorithms.h"
+#include "bitvector.h"
 #include "btree.h"
+#include "cracker.h"
+#include "expr.h"
+#include "grace_join.h"
+#include "group_table.h"
 #include "hash_table.h"
+#include "index_file.h"
+#include "join_output.h"
+#include "join_planner.h"
+#include "radix_join.h"
+#include "simd.h"
+#include "sort_merge_join.h"
+#include "threadpool.h"
+#include "zonemap.h"
 
 int main(void) {
   printf("\n\ntesting sort...\n");
@@ -11,6 +24,45 @@ int main(void) {
   printf("\n\ntesting btree...\n");
   test_btree();
 
+  printf("\n\ntesting simd kernels...\n");
+  test_simd();
+
+  printf("\n\ntesting thread pool...\n");
+  test_threadpool();
+
+  printf("\n\ntesting zone maps...\n");
+  test_zonemap();
+
+  printf("\n\ntesting bitvectors...\n");
+  test_bitvector();
+
+  printf("\n\ntesting cracking...\n");
+  test_cracker();
+
+  printf("\n\ntesting group tables...\n");
+  test_group_table();
+
+  printf("\n\ntesting expressions...\n");
+  test_expr();
+
+  printf("\n\ntesting index files...\n");
+  test_index_file();
+
+  printf("\n\ntesting join outputs...\n");
+  test_join_output();
+
+  printf("\n\ntesting radix joins...\n");
+  test_radix_join();
+
+  printf("\n\ntesting grace joins...\n");
+  test_grace_join();
+
+  printf("\n\ntesting sort-merge joins...\n");
+  test_sort_merge_join();
+
+  printf("\n\ntesting join planning...\n");
+  test_join_planner();
+
   printf("\n\nAll tests passed!\n");
 
   printf("\n\ntesting hashmap...\n");